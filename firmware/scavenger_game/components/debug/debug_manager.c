@@ -3,12 +3,20 @@
 #include "esp_heap_caps.h"
 #include "sensor_manager.h"
 #include "quest_system.h"
+#include "quest_table.h"
 #include "storage_manager.h"
+#include "ml_model_manager.h"
+#include <string.h>
 
 static const char *TAG = "DEBUG_MANAGER";
 
 static bool debug_logging_enabled = true;
 
+// Samples copied per read of the debug consumer's ring cursor
+#define DEBUG_SAMPLE_BATCH 8
+
+static uint32_t debug_samples_seen = 0;
+
 esp_err_t debug_manager_init(void)
 {
     ESP_LOGI(TAG, "Debug manager initialized");
@@ -31,9 +39,26 @@ void debug_manager_log_sensor_data(void)
 {
     if (!debug_logging_enabled) return;
 
+    // Everything published since the last report, through the debug cursor;
+    // the newest sample is the one shown
+    sensor_sample_t samples[DEBUG_SAMPLE_BATCH];
     sensor_data_t data;
-    if (sensor_manager_get_data(&data) == ESP_OK) {
+    size_t count, received = 0;
+    bool have_data = false;
+    while ((count = sensor_manager_read_samples(SENSOR_CONSUMER_DEBUG, samples, DEBUG_SAMPLE_BATCH)) > 0) {
+        data = samples[count - 1].data;
+        received += count;
+        have_data = true;
+    }
+    if (!have_data) {
+        have_data = sensor_manager_get_data(&data) == ESP_OK;
+    }
+    
+    if (have_data) {
         ESP_LOGI(TAG, "=== Sensor Data ===");
+        debug_samples_seen += received;
+        ESP_LOGI(TAG, "Samples: %u new, %lu seen, %lu overwritten before this report", (unsigned)received,
+                 debug_samples_seen, sensor_manager_get_dropped_samples(SENSOR_CONSUMER_DEBUG));
         ESP_LOGI(TAG, "Temperature: %.1f°C", data.temperature);
         ESP_LOGI(TAG, "Humidity: %.1f%%", data.humidity);
         ESP_LOGI(TAG, "Pressure: %.1f hPa", data.pressure);
@@ -79,13 +104,15 @@ void debug_manager_log_quest_state(void)
         ESP_LOGI(TAG, "Total score: %lu", state.total_score);
         
         for (int i = 0; i < state.active_quest_count; i++) {
-            ESP_LOGI(TAG, "Quest %d: %s - %s (%lu/%lu)", 
+            // Text and target come from the catalog
+            const quest_def_t* def = quest_get_def(state.quests[i].quest_id);
+            ESP_LOGI(TAG, "Quest %d: %s - %s (%u/%u)", 
                      state.quests[i].quest_id,
-                     state.quests[i].name,
+                     def ? def->name : "?",
                      state.quests[i].status == QUEST_ACTIVE ? "ACTIVE" : 
                      state.quests[i].status == QUEST_COMPLETED ? "COMPLETED" : "INACTIVE",
                      state.quests[i].progress,
-                     state.quests[i].target_value);
+                     def ? def->target_value : 0);
         }
     }
 }
@@ -103,4 +130,32 @@ void debug_manager_print_memory_info(void)
     ESP_LOGI(TAG, "Total free: %zu bytes", info.total_free_bytes);
     ESP_LOGI(TAG, "Largest free block: %zu bytes", info.largest_free_block);
     ESP_LOGI(TAG, "Total allocated: %zu bytes", info.total_allocated_bytes);
+}
+
+void debug_manager_log_ml_profile(void)
+{
+#if ML_PROFILE
+    if (!debug_logging_enabled) return;
+
+    ESP_LOGI(TAG, "=== ML Profile ===");
+    char info[512];
+    for (int type = 0; type < MODEL_TYPE_MAX; type++) {
+        ml_model_get_info(type, info, sizeof(info));
+        // One log line per info line
+        for (char* line = strtok(info, "\n"); line; line = strtok(NULL, "\n")) {
+            ESP_LOGI(TAG, "%s", line);
+        }
+    }
+#if ML_VOC_CACHE_ENTRIES
+    ml_voc_cache_stats_t cache;
+    ml_voc_cache_get_stats(&cache);
+    ESP_LOGI(TAG, "VOC cache: %lu hits, %lu misses, %lu evictions", (unsigned long)cache.hits,
+             (unsigned long)cache.misses, (unsigned long)cache.evictions);
+#endif
+    ml_cascade_stats_t cascade;
+    ml_cascade_get_stats(&cascade);
+    ESP_LOGI(TAG, "VOC cascade: %lu samples, %lu gated, %lu cleared by the forest (%lu runs), %lu full",
+             (unsigned long)cascade.samples, (unsigned long)cascade.gated, (unsigned long)cascade.small_cleared,
+             (unsigned long)cascade.small_runs, (unsigned long)cascade.full_runs);
+#endif
 }
\ No newline at end of file
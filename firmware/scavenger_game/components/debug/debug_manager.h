@@ -9,5 +9,7 @@ bool debug_manager_is_logging_enabled(void);
 void debug_manager_log_sensor_data(void);
 void debug_manager_log_quest_state(void);
 void debug_manager_print_memory_info(void);
+// Inference cost of every model (nothing unless ML_PROFILE)
+void debug_manager_log_ml_profile(void);
 
 #endif // DEBUG_MANAGER_H
\ No newline at end of file
@@ -0,0 +1,203 @@
+#include "ml_forest.h"
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+static size_t align4(size_t n)
+{
+    return (n + 3) & ~(size_t)3;
+}
+
+// Walks the tree at root depth-first and checks that no leaf is more than
+// depth steps down, so `depth` steps always end on a leaf. In a tree every
+// node is reached once; more visits than nodes means shared subtrees, which
+// the converter never writes and which could make the walk exponential.
+static bool tree_depth_ok(const uint16_t *child, uint32_t root, uint32_t end, uint8_t depth)
+{
+    // One pending right child per level, plus the node being expanded
+    struct { uint32_t node; uint8_t level; } stack[ML_FOREST_MAX_DEPTH + 2];
+    stack[0].node = root;
+    stack[0].level = 0;
+    size_t top = 1;
+    uint32_t visits = 0;
+    while (top > 0) {
+        uint32_t node = stack[--top].node;
+        uint8_t level = stack[top].level;
+        if (++visits > end - root) {
+            return false;
+        }
+        if (child[node] == 0) {
+            continue;
+        }
+        if (level >= depth) {
+            return false;
+        }
+        stack[top].node = node + child[node] + 1;
+        stack[top++].level = level + 1;
+        stack[top].node = node + child[node];
+        stack[top++].level = level + 1;
+    }
+    return true;
+}
+
+esp_err_t ml_forest_load(ml_forest_t *forest, const uint8_t *blob, size_t size)
+{
+    if (!forest || !blob) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // Roots and thresholds are read as words in place
+    if (((uintptr_t)blob & 3) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (size < sizeof(ml_forest_header_t)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    const ml_forest_header_t *header = (const ml_forest_header_t *)blob;
+    if (header->magic != ML_FOREST_MAGIC) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    if (header->version != ML_FOREST_VERSION) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (header->tree_count == 0 || header->feature_count == 0 || header->node_count == 0 ||
+        header->class_count < 2 || header->class_count > ML_FOREST_MAX_CLASSES ||
+        header->depth > ML_FOREST_MAX_DEPTH || header->leaf_count == 0 ||
+        header->node_count < header->tree_count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint64_t nodes = header->node_count;
+    uint64_t offset = sizeof(ml_forest_header_t);
+    uint64_t root_offset = offset;
+    offset += (uint64_t)header->tree_count * sizeof(uint32_t);
+    uint64_t threshold_offset = offset;
+    offset += nodes * sizeof(float);
+    uint64_t child_offset = offset;
+    offset += align4(nodes * sizeof(uint16_t));
+    uint64_t value_offset = offset;
+    offset += align4(nodes * sizeof(uint16_t));
+    uint64_t feature_offset = offset;
+    offset += align4(nodes);
+    uint64_t leaf_offset = offset;
+    offset += (uint64_t)header->leaf_count * header->class_count;
+    if (offset > size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    const uint32_t *root = (const uint32_t *)(blob + root_offset);
+    const float *threshold = (const float *)(blob + threshold_offset);
+    const uint16_t *child = (const uint16_t *)(blob + child_offset);
+    const uint16_t *value = (const uint16_t *)(blob + value_offset);
+    const uint8_t *feature = blob + feature_offset;
+
+    // Trees are contiguous and in order; every step must stay inside its tree
+    if (root[0] != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (uint32_t t = 0; t < header->tree_count; t++) {
+        uint32_t end = t + 1 < header->tree_count ? root[t + 1] : header->node_count;
+        if (root[t] >= end) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        for (uint32_t i = root[t]; i < end; i++) {
+            if (feature[i] >= header->feature_count || value[i] >= header->leaf_count) {
+                return ESP_ERR_INVALID_ARG;
+            }
+            if (child[i] == 0) {
+                // A leaf must never step right off itself
+                if (!(isinf(threshold[i]) && threshold[i] > 0.0f)) {
+                    return ESP_ERR_INVALID_ARG;
+                }
+            } else if ((uint64_t)i + child[i] + 1 >= end) {
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+        // The walk takes exactly header->depth steps
+        if (!tree_depth_ok(child, root[t], end, header->depth)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    forest->header = header;
+    forest->root = root;
+    forest->threshold = threshold;
+    forest->child = child;
+    forest->value = value;
+    forest->feature = feature;
+    forest->leaf = blob + leaf_offset;
+    forest->blob_size = size;
+    return ESP_OK;
+}
+
+// One step of a walk: no branch depends on the sample
+#define ML_FOREST_STEP(forest, node, x) \
+    ((node) + (forest)->child[node] + ((x)[(forest)->feature[node]] > (forest)->threshold[node]))
+
+void ml_forest_predict(const ml_forest_t *forest, const float *x, uint32_t *scores)
+{
+    const ml_forest_header_t *header = forest->header;
+    size_t classes = header->class_count;
+    memset(scores, 0, classes * sizeof(uint32_t));
+
+    // Independent trees side by side, so their loads overlap
+    for (uint32_t first = 0; first < header->tree_count; first += ML_FOREST_LANES) {
+        uint32_t lanes = header->tree_count - first;
+        if (lanes > ML_FOREST_LANES) {
+            lanes = ML_FOREST_LANES;
+        }
+        uint32_t node[ML_FOREST_LANES];
+        for (uint32_t l = 0; l < lanes; l++) {
+            node[l] = forest->root[first + l];
+        }
+        for (int d = 0; d < header->depth; d++) {
+            for (uint32_t l = 0; l < lanes; l++) {
+                node[l] = ML_FOREST_STEP(forest, node[l], x);
+            }
+        }
+        for (uint32_t l = 0; l < lanes; l++) {
+            const uint8_t *leaf = forest->leaf + (size_t)forest->value[node[l]] * classes;
+            for (size_t c = 0; c < classes; c++) {
+                scores[c] += leaf[c];
+            }
+        }
+    }
+}
+
+void ml_forest_predict_batch(const ml_forest_t *forest, const float *x, size_t count, uint32_t *scores)
+{
+    const ml_forest_header_t *header = forest->header;
+    size_t classes = header->class_count;
+    size_t features = header->feature_count;
+    size_t blocks = count / ML_FOREST_LANES;
+    memset(scores, 0, blocks * ML_FOREST_LANES * classes * sizeof(uint32_t));
+
+    // One tree at a time stays in cache while every full block walks it
+    for (uint32_t t = 0; t < header->tree_count; t++) {
+        uint32_t root = forest->root[t];
+        for (size_t b = 0; b < blocks; b++) {
+            const float *sample = x + b * ML_FOREST_LANES * features;
+            uint32_t node[ML_FOREST_LANES];
+            for (int l = 0; l < ML_FOREST_LANES; l++) {
+                node[l] = root;
+            }
+            for (int d = 0; d < header->depth; d++) {
+                for (int l = 0; l < ML_FOREST_LANES; l++) {
+                    node[l] = ML_FOREST_STEP(forest, node[l], sample + l * features);
+                }
+            }
+            uint32_t *out = scores + b * ML_FOREST_LANES * classes;
+            for (int l = 0; l < ML_FOREST_LANES; l++) {
+                const uint8_t *leaf = forest->leaf + (size_t)forest->value[node[l]] * classes;
+                for (size_t c = 0; c < classes; c++) {
+                    out[l * classes + c] += leaf[c];
+                }
+            }
+        }
+    }
+
+    // Too few samples left to fill the lanes; walk their trees in lockstep
+    for (size_t i = blocks * ML_FOREST_LANES; i < count; i++) {
+        ml_forest_predict(forest, x + i * features, scores + i * classes);
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef ML_FOREST_H
+#define ML_FOREST_H
+
+#include <stddef.h>
+#include "stdint.h"
+#include "esp_err.h"
+
+// Decision-forest classifier (tools/ml_forest_convert.py), evaluated in place
+// from its blob without branches on the data.
+//
+// Nodes of all trees live in structure-of-arrays form, each tree breadth-first
+// from its root. A node goes right when x[feature] > threshold, to
+//     node + child + (x[feature] > threshold)
+// i.e. child is the forward offset of its left child; the right child follows
+// it. Leaves have child 0 and threshold +inf, so they loop on themselves and
+// every tree can be walked for exactly `depth` steps. value[leaf] indexes the
+// leaf's class scores (uint8, ~probability * 255); the forest's score for a
+// class is the sum over its trees.
+//
+// Blob layout (little endian), arrays 4-byte aligned in this order:
+//   ml_forest_header_t
+//   uint32_t root[tree_count]
+//   float    threshold[node_count]
+//   uint16_t child[node_count]
+//   uint16_t value[node_count]
+//   uint8_t  feature[node_count]
+//   uint8_t  leaf[leaf_count][class_count]
+#define ML_FOREST_MAGIC         0x31535246  // "FRS1"
+#define ML_FOREST_VERSION       1
+#define ML_FOREST_MAX_CLASSES   8
+#define ML_FOREST_MAX_DEPTH     32
+#define ML_FOREST_NAME_LEN      16
+#define ML_FOREST_LANES         8           // Trees or samples walked in lockstep
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t tree_count;
+    uint16_t feature_count;
+    uint8_t class_count;
+    uint8_t depth;                  // Deepest leaf, in steps from the root
+    uint32_t node_count;
+    uint32_t leaf_count;
+    char name[ML_FOREST_NAME_LEN];  // Model version string
+} ml_forest_header_t;
+
+// Validated view of a blob; points into it
+typedef struct {
+    const ml_forest_header_t *header;
+    const uint32_t *root;
+    const float *threshold;
+    const uint16_t *child;
+    const uint16_t *value;
+    const uint8_t *feature;
+    const uint8_t *leaf;
+    size_t blob_size;
+} ml_forest_t;
+
+// Checks the header, every node and each tree's depth against the header's,
+// so evaluation cannot leave the blob and always ends on a leaf
+esp_err_t ml_forest_load(ml_forest_t *forest, const uint8_t *blob, size_t size);
+
+// scores receives class_count sums; trees are walked in lockstep
+void ml_forest_predict(const ml_forest_t *forest, const float *x, uint32_t *scores);
+
+// count samples of feature_count values each; scores is count x class_count.
+// Full blocks of ML_FOREST_LANES samples are walked in lockstep, one tree at a
+// time; the rest go through ml_forest_predict.
+void ml_forest_predict_batch(const ml_forest_t *forest, const float *x, size_t count, uint32_t *scores);
+
+#endif // ML_FOREST_H
@@ -0,0 +1,36 @@
+#ifndef ML_MODEL_IMAGE_H
+#define ML_MODEL_IMAGE_H
+
+#include "stdint.h"
+
+// Model image in the "storage" data partition (tools/ml_model_image.py).
+// Models are executed in place through a flash mapping, so loading one
+// costs no heap.
+//
+// Layout (little endian): ml_model_image_header_t at offset 0, then each
+// model blob at its entry's offset (4-byte aligned). Unused entries are
+// zero. header_crc32 covers the entries array, each entry's crc32 its blob;
+// both are esp_rom_crc32_le(0, ...), i.e. zlib's CRC-32.
+#define ML_MODEL_IMAGE_MAGIC        0x314C444D  // "MDL1"
+#define ML_MODEL_IMAGE_VERSION      1
+#define ML_MODEL_IMAGE_MAX_ENTRIES  4
+#define ML_MODEL_PARTITION          "storage"
+
+typedef struct __attribute__((packed)) {
+    uint8_t model_type;             // ml_model_type_t
+    uint8_t reserved[3];
+    uint32_t offset;                // From the start of the partition
+    uint32_t size;
+    uint32_t crc32;
+} ml_model_image_entry_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t entry_count;
+    uint32_t header_crc32;
+    uint32_t reserved;
+    ml_model_image_entry_t entries[ML_MODEL_IMAGE_MAX_ENTRIES];
+} ml_model_image_header_t;
+
+#endif // ML_MODEL_IMAGE_H
@@ -1,38 +1,422 @@
 #include "ml_model_manager.h"
+#include "ml_net.h"
+#include "ml_forest.h"
+#include "sensor_manager.h"
+#include "voc_baseline.h"
 #include "esp_log.h"
 #include "esp_heap_caps.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <math.h>
+#include <stdatomic.h>
+#include <stdio.h>
 #include <string.h>
 
 static const char *TAG = "ML_MODEL_MANAGER";
 
-// Model state
+// Activations of every model live here; nothing is allocated per inference
+#ifndef ML_ARENA_SIZE
+#define ML_ARENA_SIZE (4 * 1024)
+#endif
+
+// Samples per ml_model_inference_batch pass (logits live on the stack)
+#ifndef ML_BATCH_CHUNK
+#define ML_BATCH_CHUNK 64
+#endif
+
+// One loaded model; readers counts the inferences still using it
 typedef struct {
-    bool initialized;
-    bool loaded;
-    uint8_t* model_data;
+    const uint8_t* model_data;
     size_t model_size;
     char model_version[32];
+    ml_net_t net;               // MODEL_VOC_CLASSIFIER
+    ml_forest_t forest;         // MODEL_VOC_FOREST
+    bool mapped;                // model_data points into flash, not the heap
+    esp_partition_mmap_handle_t map_handle;
+    atomic_uint readers;
+} ml_model_slot_t;
+
+// Model state. An update is staged in the slot not in use and published by
+// swapping current, so inference never waits; the old slot is released once
+// the last inference that picked it up is done.
+typedef struct {
+    bool initialized;
+    ml_model_slot_t slots[2];
+    _Atomic(ml_model_slot_t*) current;      // NULL until a model is loaded
 } ml_model_state_t;
 
 static ml_model_state_t models[MODEL_TYPE_MAX] = {0};
 
+// Serialises updates; inference never takes it
+static SemaphoreHandle_t update_lock = NULL;
+
+#if ML_PROFILE
+// Written by the inference caller, read by anyone: relaxed atomics, so a
+// snapshot may mix counts of neighbouring calls
+typedef struct {
+    atomic_uint calls;
+    atomic_uint samples;
+    atomic_uint errors;
+    _Atomic uint64_t total_us;
+    atomic_uint max_us;
+    atomic_uint histogram[ML_PROFILE_BUCKETS];
+    atomic_uint arena_peak;
+#if ML_PROFILE_LAYERS
+    _Atomic uint64_t layer_us[ML_NET_MAX_LAYERS];
+#endif
+} ml_profile_counters_t;
+
+static ml_profile_counters_t profiles[MODEL_TYPE_MAX];
+
+#define PROF_ADD(field, n)  atomic_fetch_add_explicit(&(field), (n), memory_order_relaxed)
+#define PROF_GET(field)     atomic_load_explicit(&(field), memory_order_relaxed)
+#define PROF_SET(field, n)  atomic_store_explicit(&(field), (n), memory_order_relaxed)
+
+static void profile_reset(ml_model_type_t model_type)
+{
+    ml_profile_counters_t* p = &profiles[model_type];
+    PROF_SET(p->calls, 0);
+    PROF_SET(p->samples, 0);
+    PROF_SET(p->errors, 0);
+    PROF_SET(p->total_us, 0);
+    PROF_SET(p->max_us, 0);
+    for (int i = 0; i < ML_PROFILE_BUCKETS; i++) {
+        PROF_SET(p->histogram[i], 0);
+    }
+    PROF_SET(p->arena_peak, 0);
+#if ML_PROFILE_LAYERS
+    for (int i = 0; i < ML_NET_MAX_LAYERS; i++) {
+        PROF_SET(p->layer_us[i], 0);
+    }
+#endif
+}
+
+static void profile_record(ml_model_type_t model_type, int64_t start, size_t samples, size_t arena, esp_err_t ret)
+{
+    ml_profile_counters_t* p = &profiles[model_type];
+    uint32_t us = (uint32_t)(esp_timer_get_time() - start);
+    
+    // Bucket = bit length of the latency in us
+    int bucket = 0;
+    for (uint32_t v = us; v && bucket < ML_PROFILE_BUCKETS - 1; v >>= 1) {
+        bucket++;
+    }
+    PROF_ADD(p->histogram[bucket], 1);
+    PROF_ADD(p->calls, 1);
+    PROF_ADD(p->samples, (unsigned)samples);
+    PROF_ADD(p->total_us, us);
+    if (ret != ESP_OK) {
+        PROF_ADD(p->errors, 1);
+    }
+    // Only the inference caller writes these two
+    if (us > PROF_GET(p->max_us)) {
+        PROF_SET(p->max_us, us);
+    }
+    if (arena > PROF_GET(p->arena_peak)) {
+        PROF_SET(p->arena_peak, (unsigned)arena);
+    }
+#if ML_PROFILE_LAYERS
+    if (model_type != MODEL_VOC_FOREST) {
+        const uint32_t* times = ml_net_layer_times();
+        for (int i = 0; i < ML_NET_MAX_LAYERS; i++) {
+            PROF_ADD(p->layer_us[i], times[i]);
+        }
+    }
+#endif
+}
+
+#define PROFILE_START()                         int64_t profile_start = esp_timer_get_time()
+#define PROFILE_END(type, samples, arena, ret)  profile_record(type, profile_start, samples, arena, ret)
+#define PROFILE_RESET(type)                     profile_reset(type)
+#else
+#define PROFILE_START()
+#define PROFILE_END(type, samples, arena, ret)
+#define PROFILE_RESET(type)
+#endif
+
+// Bumped by every install after publishing the model; a cache entry only
+// counts for the generation it was computed under
+static atomic_uint model_generation;
+
+#if ML_VOC_CACHE_ENTRIES
+#if ML_VOC_CACHE_ENTRIES & (ML_VOC_CACHE_ENTRIES - 1)
+#error "ML_VOC_CACHE_ENTRIES must be a power of two"
+#endif
+
+typedef struct {
+    int32_t key[ML_VOC_INPUTS];     // Bucket indices of VOC, temperature, humidity
+    uint32_t generation;
+    float confidence;
+    uint8_t classification;
+    bool valid;
+} ml_voc_cache_entry_t;
+
+// Only the classifying task touches the table; the counters are read by anyone
+static struct {
+    ml_voc_cache_entry_t entries[ML_VOC_CACHE_ENTRIES];
+    uint32_t voc_step;
+    float temp_scale;               // 1 / step
+    float hum_scale;
+    atomic_uint hits;
+    atomic_uint misses;
+    atomic_uint evictions;
+} voc_cache = {
+    .voc_step = ML_VOC_CACHE_VOC_STEP,
+    .temp_scale = 1.0f / ML_VOC_CACHE_TEMP_STEP,
+    .hum_scale = 1.0f / ML_VOC_CACHE_HUM_STEP,
+};
+#endif
+
+// Cascade settings belong to the classifying task; the counters are read by anyone
+static ml_cascade_config_t cascade_config = ML_CASCADE_DEFAULT_CONFIG;
+static struct {
+    atomic_uint samples;
+    atomic_uint gated;
+    atomic_uint small_runs;
+    atomic_uint small_cleared;
+    atomic_uint full_runs;
+} cascade_stats;
+
+#define CASCADE_COUNT(field) atomic_fetch_add_explicit(&cascade_stats.field, 1, memory_order_relaxed)
+
+// One inference at a time: callers share the arena
+static int8_t inference_arena[ML_ARENA_SIZE] __attribute__((aligned(4)));
+
 esp_err_t ml_model_init(void)
 {
     ESP_LOGI(TAG, "Initializing ML model manager");
     
-    // Initialize model states
+    if (!update_lock) {
+        update_lock = xSemaphoreCreateMutex();
+        if (!update_lock) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    
+    // Initialize model states; loaded models stay loaded
     for (int i = 0; i < MODEL_TYPE_MAX; i++) {
         models[i].initialized = true;
-        models[i].loaded = false;
-        models[i].model_data = NULL;
-        models[i].model_size = 0;
-        strcpy(models[i].model_version, "v1.0-placeholder");
     }
     
     ESP_LOGI(TAG, "ML model manager initialized");
     return ESP_OK;
 }
 
+// Engine view of a checked blob; points into it
+typedef struct {
+    ml_net_t net;
+    ml_forest_t forest;
+    const char* name;           // Not terminated
+    size_t name_len;
+} ml_model_view_t;
+
+// Checks a blob for model_type
+static esp_err_t check_model(ml_model_type_t model_type, const uint8_t* data, size_t size, ml_model_view_t* view)
+{
+    esp_err_t ret;
+    memset(view, 0, sizeof(*view));
+    if (model_type == MODEL_VOC_FOREST) {
+        ret = ml_forest_load(&view->forest, data, size);
+        if (ret == ESP_OK && view->forest.header->feature_count != ML_VOC_INPUTS) {
+            ret = ESP_ERR_INVALID_ARG;
+        }
+        if (ret == ESP_OK) {
+            view->name = view->forest.header->name;
+            view->name_len = ML_FOREST_NAME_LEN;
+        }
+    } else {
+        ret = ml_net_load(&view->net, data, size);
+        if (ret == ESP_OK && ml_net_arena_size(&view->net) > sizeof(inference_arena)) {
+            ret = ESP_ERR_INVALID_SIZE;
+        }
+        if (ret == ESP_OK && (view->net.input_size != ML_VOC_INPUTS || view->net.output_size < 2)) {
+            ret = ESP_ERR_INVALID_ARG;
+        }
+        if (ret == ESP_OK) {
+            view->name = view->net.header->name;
+            view->name_len = ML_NET_NAME_LEN;
+        }
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Rejected model: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+// Allocate new model in SPIRAM if available, otherwise in internal RAM
+static uint8_t* alloc_model(size_t size)
+{
+    uint8_t* data = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!data) {
+        data = heap_caps_malloc(size, MALLOC_CAP_8BIT);
+        if (!data) {
+            ESP_LOGE(TAG, "Failed to allocate memory for model");
+        }
+    }
+    return data;
+}
+
+static void release_slot(ml_model_slot_t* slot)
+{
+    if (slot->mapped) {
+        esp_partition_munmap(slot->map_handle);
+    } else if (slot->model_data) {
+        heap_caps_free((void*)slot->model_data);
+    }
+    slot->model_data = NULL;
+    slot->model_size = 0;
+    slot->mapped = false;
+}
+
+// Pins the current model of model_type for one inference, or returns NULL.
+// The second look at current closes the race with an update retiring the
+// slot between the load and the increment; all four accesses (here and in
+// install_model) are sequentially consistent for that reason.
+static ml_model_slot_t* acquire_model(ml_model_type_t model_type)
+{
+    ml_model_state_t* model = &models[model_type];
+    for (;;) {
+        ml_model_slot_t* slot = atomic_load(&model->current);
+        if (!slot) {
+            return NULL;
+        }
+        atomic_fetch_add(&slot->readers, 1);
+        if (atomic_load(&model->current) == slot) {
+            return slot;
+        }
+        atomic_fetch_sub(&slot->readers, 1);
+    }
+}
+
+static void release_model(ml_model_slot_t* slot)
+{
+    atomic_fetch_sub_explicit(&slot->readers, 1, memory_order_release);
+}
+
+// Publishes a checked model for model_type. Inference keeps running on the
+// old model until the swap and is never blocked; the old model is freed
+// after the inferences still holding it have finished.
+static esp_err_t install_model(ml_model_type_t model_type, const uint8_t* data, size_t size,
+                               const ml_model_view_t* view, bool mapped, esp_partition_mmap_handle_t map_handle)
+{
+    ml_model_state_t* model = &models[model_type];
+    if (!update_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(update_lock, portMAX_DELAY);
+    
+    // Stage into the spare slot; a reader can only touch its counter, and
+    // only until it sees the slot is not current
+    ml_model_slot_t* old = atomic_load(&model->current);
+    ml_model_slot_t* slot = old == &model->slots[0] ? &model->slots[1] : &model->slots[0];
+    slot->model_data = data;
+    slot->model_size = size;
+    slot->net = view->net;
+    slot->forest = view->forest;
+    slot->mapped = mapped;
+    slot->map_handle = map_handle;
+    memcpy(slot->model_version, view->name, view->name_len);
+    slot->model_version[view->name_len] = '\0';
+    
+    atomic_store(&model->current, slot);
+    atomic_fetch_add(&model_generation, 1);
+    PROFILE_RESET(model_type);
+    
+    if (old) {
+        while (atomic_load(&old->readers) != 0) {
+            vTaskDelay(1);
+        }
+        release_slot(old);
+    }
+    
+    if (model_type == MODEL_VOC_FOREST) {
+        ESP_LOGI(TAG, "Model %s loaded (%s): %u trees, %lu nodes, depth %u",
+                 slot->model_version, mapped ? "mapped from flash" : "in RAM",
+                 view->forest.header->tree_count, (unsigned long)view->forest.header->node_count,
+                 view->forest.header->depth);
+    } else {
+        ESP_LOGI(TAG, "Model %s loaded (%s): %zu inputs, %zu outputs, %zu arena bytes",
+                 slot->model_version, mapped ? "mapped from flash" : "in RAM",
+                 view->net.input_size, view->net.output_size, ml_net_arena_size(&view->net));
+    }
+    xSemaphoreGive(update_lock);
+    return ESP_OK;
+}
+
+// Maps model_type's blob out of a model image partition; nothing is copied
+static esp_err_t load_from_partition(ml_model_type_t model_type, const char* label)
+{
+    const esp_partition_t* partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                                ESP_PARTITION_SUBTYPE_ANY, label);
+    if (!partition) {
+        ESP_LOGE(TAG, "No partition '%s'", label);
+        return ESP_ERR_NOT_FOUND;
+    }
+    
+    ml_model_image_header_t header;
+    esp_err_t ret = esp_partition_read(partition, 0, &header, sizeof(header));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (header.magic != ML_MODEL_IMAGE_MAGIC) {
+        ESP_LOGW(TAG, "No model image in '%s'", label);
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (header.version != ML_MODEL_IMAGE_VERSION || header.entry_count > ML_MODEL_IMAGE_MAX_ENTRIES) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (esp_rom_crc32_le(0, (const uint8_t*)header.entries, sizeof(header.entries)) != header.header_crc32) {
+        ESP_LOGE(TAG, "Model image header CRC mismatch");
+        return ESP_ERR_INVALID_CRC;
+    }
+    
+    const ml_model_image_entry_t* entry = NULL;
+    for (int i = 0; i < header.entry_count; i++) {
+        if (header.entries[i].model_type == model_type) {
+            entry = &header.entries[i];
+            break;
+        }
+    }
+    if (!entry) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (entry->size == 0 || (entry->offset & 3) != 0 || entry->offset < sizeof(header) ||
+        entry->offset > partition->size || entry->size > partition->size - entry->offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    
+    const void* data;
+    esp_partition_mmap_handle_t handle;
+    ret = esp_partition_mmap(partition, entry->offset, entry->size, ESP_PARTITION_MMAP_DATA, &data, &handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to map model: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    
+    // Reads through the flash cache once; afterwards only inference touches it
+    ml_model_view_t view;
+    if (esp_rom_crc32_le(0, data, entry->size) != entry->crc32) {
+        ESP_LOGE(TAG, "Model CRC mismatch");
+        ret = ESP_ERR_INVALID_CRC;
+    } else {
+        ret = check_model(model_type, data, entry->size, &view);
+    }
+    if (ret != ESP_OK) {
+        esp_partition_munmap(handle);
+        return ret;
+    }
+    
+    ret = install_model(model_type, data, entry->size, &view, true, handle);
+    if (ret != ESP_OK) {
+        esp_partition_munmap(handle);
+    }
+    return ret;
+}
+
 esp_err_t ml_model_load(ml_model_type_t model_type, const char* model_path)
 {
     if (model_type >= MODEL_TYPE_MAX || !model_path) {
@@ -45,12 +429,75 @@ esp_err_t ml_model_load(ml_model_type_t model_type, const char* model_path)
     
     ESP_LOGI(TAG, "Loading model type %d from %s", model_type, model_path);
     
-    // TODO: Implement actual model loading from SD card or flash
-    // For now, mark as loaded with placeholder
-    models[model_type].loaded = true;
+    if (model_path[0] != '/') {
+        return load_from_partition(model_type, model_path);
+    }
     
-    ESP_LOGI(TAG, "Model loaded successfully (placeholder)");
-    return ESP_OK;
+    // A file (SD card) cannot be mapped; it is copied into RAM
+    FILE* f = fopen(model_path, "rb");
+    if (!f) {
+        ESP_LOGE(TAG, "Failed to open %s", model_path);
+        return ESP_ERR_NOT_FOUND;
+    }
+    
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    
+    uint8_t* data = size > 0 ? alloc_model((size_t)size) : NULL;
+    if (!data) {
+        fclose(f);
+        return size > 0 ? ESP_ERR_NO_MEM : ESP_ERR_INVALID_SIZE;
+    }
+    
+    // Read straight into the model's own buffer
+    ml_model_view_t view;
+    esp_err_t ret = ESP_FAIL;
+    if (fread(data, 1, (size_t)size, f) == (size_t)size) {
+        ret = check_model(model_type, data, (size_t)size, &view);
+    }
+    fclose(f);
+    if (ret != ESP_OK) {
+        heap_caps_free(data);
+        return ret;
+    }
+    
+    ret = install_model(model_type, data, (size_t)size, &view, false, 0);
+    if (ret != ESP_OK) {
+        heap_caps_free(data);
+    }
+    return ret;
+}
+
+// Output i scores voc_class_t i; softmax of the dequantized logits
+static void net_result(const ml_net_t* net, const int8_t* logits, ml_inference_result_t* result)
+{
+    size_t best = 0;
+    for (size_t i = 1; i < net->output_size; i++) {
+        if (logits[i] > logits[best]) {
+            best = i;
+        }
+    }
+    float sum = 0.0f;
+    for (size_t i = 0; i < net->output_size; i++) {
+        sum += expf((logits[i] - logits[best]) * net->output_scale);
+    }
+    
+    result->classification = best < VOC_CLASS_UNKNOWN ? (voc_class_t)best : VOC_CLASS_UNKNOWN;
+    result->confidence = 1.0f / sum;
+}
+
+// Scores are summed leaf probabilities, 255 per tree
+static void forest_result(const ml_forest_t* forest, const uint32_t* scores, ml_inference_result_t* result)
+{
+    size_t best = 0;
+    for (size_t i = 1; i < forest->header->class_count; i++) {
+        if (scores[i] > scores[best]) {
+            best = i;
+        }
+    }
+    result->classification = best < VOC_CLASS_UNKNOWN ? (voc_class_t)best : VOC_CLASS_UNKNOWN;
+    result->confidence = scores[best] / (255.0f * forest->header->tree_count);
 }
 
 esp_err_t ml_model_inference(ml_model_type_t model_type, const void* input_data, ml_inference_result_t* result)
@@ -59,14 +506,102 @@ esp_err_t ml_model_inference(ml_model_type_t model_type, const void* input_data,
         return ESP_ERR_INVALID_ARG;
     }
     
-    if (!models[model_type].loaded) {
+    ml_model_slot_t* slot = acquire_model(model_type);
+    if (!slot) {
         ESP_LOGW(TAG, "Model not loaded, using threshold-based fallback");
         return ESP_ERR_INVALID_STATE;
     }
     
-    // TODO: Implement actual TinyML inference
-    // This is a placeholder that will be replaced with real model
+    PROFILE_START();
+    esp_err_t ret = ESP_OK;
+    size_t arena_used = 0;
+    if (model_type == MODEL_VOC_FOREST) {
+        uint32_t scores[ML_FOREST_MAX_CLASSES];
+        ml_forest_predict(&slot->forest, input_data, scores);
+        forest_result(&slot->forest, scores, result);
+    } else {
+        int8_t logits[ML_NET_MAX_OUTPUTS];
+        ret = ml_net_run(&slot->net, input_data, inference_arena, sizeof(inference_arena), logits);
+        if (ret == ESP_OK) {
+            net_result(&slot->net, logits, result);
+        }
+        arena_used = ml_net_arena_size(&slot->net);
+    }
+    PROFILE_END(model_type, 1, arena_used, ret);
+    (void)arena_used;
+    
+    release_model(slot);
+    return ret;
+}
+
+esp_err_t ml_model_inference_batch(ml_model_type_t model_type, const float* inputs, size_t count,
+                                   ml_inference_result_t* results)
+{
+    if (model_type >= MODEL_TYPE_MAX || !inputs || !results) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    // Checked and pinned once; each chunk then runs through the engine's batch kernel
+    ml_model_slot_t* slot = acquire_model(model_type);
+    if (!slot) {
+        ESP_LOGW(TAG, "Model not loaded, using threshold-based fallback");
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    PROFILE_START();
+    esp_err_t ret = ESP_OK;
+    size_t arena_used;
+    if (model_type == MODEL_VOC_FOREST) {
+        const ml_forest_t* forest = &slot->forest;
+        size_t features = forest->header->feature_count;
+        size_t classes = forest->header->class_count;
+        // The arena holds one chunk's scores
+        uint32_t* scores = (uint32_t*)inference_arena;
+        size_t chunk = sizeof(inference_arena) / (classes * sizeof(uint32_t));
+        arena_used = (count < chunk ? count : chunk) * classes * sizeof(uint32_t);
+        for (size_t first = 0; first < count; first += chunk) {
+            size_t n = count - first < chunk ? count - first : chunk;
+            ml_forest_predict_batch(forest, inputs + first * features, n, scores);
+            for (size_t i = 0; i < n; i++) {
+                forest_result(forest, scores + i * classes, &results[first + i]);
+            }
+        }
+    } else {
+        const ml_net_t* net = &slot->net;
+        int8_t logits[ML_BATCH_CHUNK * ML_NET_MAX_OUTPUTS];
+        // Models too large for a batch block in the arena run one by one
+        bool blocks = ml_net_batch_arena_size(net) <= sizeof(inference_arena);
+        arena_used = blocks && count >= ML_NET_BATCH_LANES ? ml_net_batch_arena_size(net) : ml_net_arena_size(net);
+        for (size_t first = 0; first < count && ret == ESP_OK; first += ML_BATCH_CHUNK) {
+            size_t n = count - first < ML_BATCH_CHUNK ? count - first : ML_BATCH_CHUNK;
+            for (size_t i = 0; i < n && !blocks && ret == ESP_OK; i++) {
+                ret = ml_net_run(net, inputs + (first + i) * net->input_size, inference_arena,
+                                 sizeof(inference_arena), logits + i * net->output_size);
+            }
+            if (blocks) {
+                ret = ml_net_run_batch(net, inputs + first * net->input_size, n,
+                                       inference_arena, sizeof(inference_arena), logits);
+            }
+            // The first error ends the batch
+            for (size_t i = 0; i < n && ret == ESP_OK; i++) {
+                net_result(net, logits + i * net->output_size, &results[first + i]);
+            }
+        }
+    }
+    PROFILE_END(model_type, count, arena_used, ret);
+    (void)arena_used;
+    release_model(slot);
+    if (ret != ESP_OK) {
+        return ret;
+    }
     
+    // Both VOC model types take [VOC, temperature, humidity]
+    for (size_t i = 0; i < count; i++) {
+        const float* x = inputs + i * ML_VOC_INPUTS;
+        results[i].voc_value = x[0] > 0.0f ? (uint32_t)x[0] : 0;
+        results[i].temperature = x[1];
+        results[i].humidity = x[2];
+    }
     return ESP_OK;
 }
 
@@ -78,27 +613,26 @@ esp_err_t ml_model_update(ml_model_type_t model_type, const uint8_t* model_data,
     
     ESP_LOGI(TAG, "Updating model type %d, size: %zu bytes", model_type, model_size);
     
-    // Free old model if exists
-    if (models[model_type].model_data) {
-        heap_caps_free(models[model_type].model_data);
+    uint8_t* data = alloc_model(model_size);
+    if (!data) {
+        return ESP_ERR_NO_MEM;
     }
+    memcpy(data, model_data, model_size);
     
-    // Allocate new model in SPIRAM if available, otherwise in internal RAM
-    models[model_type].model_data = heap_caps_malloc(model_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    if (!models[model_type].model_data) {
-        models[model_type].model_data = heap_caps_malloc(model_size, MALLOC_CAP_8BIT);
-        if (!models[model_type].model_data) {
-            ESP_LOGE(TAG, "Failed to allocate memory for model");
-            return ESP_ERR_NO_MEM;
-        }
+    // Validate the copy (aligned, unlike an arbitrary update buffer); the old
+    // model stays loaded if the new one is rejected
+    ml_model_view_t view;
+    esp_err_t ret = check_model(model_type, data, model_size, &view);
+    if (ret != ESP_OK) {
+        heap_caps_free(data);
+        return ret;
     }
     
-    memcpy(models[model_type].model_data, model_data, model_size);
-    models[model_type].model_size = model_size;
-    models[model_type].loaded = true;
-    
-    ESP_LOGI(TAG, "Model updated successfully");
-    return ESP_OK;
+    ret = install_model(model_type, data, model_size, &view, false, 0);
+    if (ret != ESP_OK) {
+        heap_caps_free(data);
+    }
+    return ret;
 }
 
 esp_err_t ml_model_get_info(ml_model_type_t model_type, char* info_buffer, size_t buffer_size)
@@ -107,18 +641,141 @@ esp_err_t ml_model_get_info(ml_model_type_t model_type, char* info_buffer, size_
         return ESP_ERR_INVALID_ARG;
     }
     
-    snprintf(info_buffer, buffer_size, 
+    ml_model_slot_t* slot = acquire_model(model_type);
+    int len = snprintf(info_buffer, buffer_size, 
              "Model Type: %d\n"
              "Version: %s\n"
              "Loaded: %s\n"
-             "Size: %zu bytes\n",
+             "Size: %zu bytes\n"
+             "Source: %s\n",
              model_type,
-             models[model_type].model_version,
-             models[model_type].loaded ? "Yes" : "No",
-             models[model_type].model_size);
+             slot ? slot->model_version : "-",
+             slot ? "Yes" : "No",
+             slot ? slot->model_size : 0,
+             !slot ? "-" : slot->mapped ? "flash (mapped)" : "RAM");
+    if (slot) {
+        release_model(slot);
+    }
     
+#if ML_PROFILE
+    ml_model_profile_t profile;
+    ml_model_get_profile(model_type, &profile);
+    size_t used = len < 0 ? buffer_size : (size_t)len;
+    
+    #define INFO_APPEND(...) do { \
+        if (used < buffer_size) { \
+            int n = snprintf(info_buffer + used, buffer_size - used, __VA_ARGS__); \
+            used += n > 0 ? (size_t)n : 0; \
+        } \
+    } while (0)
+    INFO_APPEND("Calls: %lu (%lu samples, %lu errors)\n", (unsigned long)profile.calls,
+                (unsigned long)profile.samples, (unsigned long)profile.errors);
+    INFO_APPEND("Latency: mean %.1f us, max %lu us\n",
+                profile.calls ? (double)profile.total_us / profile.calls : 0.0, (unsigned long)profile.max_us);
+    INFO_APPEND("Histogram:");
+    for (int i = 0; i < ML_PROFILE_BUCKETS; i++) {
+        if (!profile.histogram[i]) {
+            continue;
+        }
+        if (i < ML_PROFILE_BUCKETS - 1) {
+            INFO_APPEND(" <%luus:%lu", 1ul << i, (unsigned long)profile.histogram[i]);
+        } else {
+            INFO_APPEND(" >=%luus:%lu", 1ul << (i - 1), (unsigned long)profile.histogram[i]);
+        }
+    }
+    INFO_APPEND("\nArena peak: %lu of %u bytes\n", (unsigned long)profile.arena_peak, ML_ARENA_SIZE);
+#if ML_PROFILE_LAYERS
+    INFO_APPEND("Layer us:");
+    for (int i = 0; i < ML_NET_MAX_LAYERS && profile.layer_us[i]; i++) {
+        INFO_APPEND(" %llu", (unsigned long long)profile.layer_us[i]);
+    }
+    INFO_APPEND("\n");
+#endif
+    #undef INFO_APPEND
+#else
+    (void)len;
+#endif
+    
+    return ESP_OK;
+}
+
+#if ML_PROFILE
+esp_err_t ml_model_get_profile(ml_model_type_t model_type, ml_model_profile_t* profile)
+{
+    if (model_type >= MODEL_TYPE_MAX || !profile) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    const ml_profile_counters_t* p = &profiles[model_type];
+    profile->calls = PROF_GET(p->calls);
+    profile->samples = PROF_GET(p->samples);
+    profile->errors = PROF_GET(p->errors);
+    profile->total_us = PROF_GET(p->total_us);
+    profile->max_us = PROF_GET(p->max_us);
+    for (int i = 0; i < ML_PROFILE_BUCKETS; i++) {
+        profile->histogram[i] = PROF_GET(p->histogram[i]);
+    }
+    profile->arena_peak = PROF_GET(p->arena_peak);
+#if ML_PROFILE_LAYERS
+    for (int i = 0; i < ML_NET_MAX_LAYERS; i++) {
+        profile->layer_us[i] = PROF_GET(p->layer_us[i]);
+    }
+#endif
     return ESP_OK;
 }
+#endif
+
+#if ML_VOC_CACHE_ENTRIES
+// The entry (voc, temp, humidity) maps to, with its bucket indices in key;
+// NULL when the cache is off or a reading is not finite
+static ml_voc_cache_entry_t* voc_cache_lookup(uint32_t voc, float temp, float humidity, int32_t* key)
+{
+    if (voc_cache.voc_step == 0 || !isfinite(temp) || !isfinite(humidity)) {
+        return NULL;
+    }
+    key[0] = (int32_t)(voc / voc_cache.voc_step);
+    key[1] = (int32_t)floorf(temp * voc_cache.temp_scale);
+    key[2] = (int32_t)floorf(humidity * voc_cache.hum_scale);
+    
+    // Neighbouring buckets land on different entries
+    uint32_t hash = (uint32_t)key[0] * 0x9E3779B1u ^ (uint32_t)key[1] * 0x85EBCA77u ^
+                    (uint32_t)key[2] * 0xC2B2AE3Du;
+    hash ^= hash >> 15;
+    return &voc_cache.entries[hash & (ML_VOC_CACHE_ENTRIES - 1)];
+}
+
+esp_err_t ml_voc_cache_configure(uint32_t voc_step, float temp_step, float hum_step)
+{
+    if (voc_step != 0 && !(temp_step > 0.0f && hum_step > 0.0f)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    memset(voc_cache.entries, 0, sizeof(voc_cache.entries));
+    voc_cache.voc_step = voc_step;
+    if (voc_step != 0) {
+        voc_cache.temp_scale = 1.0f / temp_step;
+        voc_cache.hum_scale = 1.0f / hum_step;
+    }
+    atomic_store_explicit(&voc_cache.hits, 0, memory_order_relaxed);
+    atomic_store_explicit(&voc_cache.misses, 0, memory_order_relaxed);
+    atomic_store_explicit(&voc_cache.evictions, 0, memory_order_relaxed);
+    
+    ESP_LOGI(TAG, "VOC cache: %s", voc_step ? "on" : "off");
+    return ESP_OK;
+}
+
+esp_err_t ml_voc_cache_get_stats(ml_voc_cache_stats_t* stats)
+{
+    if (!stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    stats->hits = atomic_load_explicit(&voc_cache.hits, memory_order_relaxed);
+    stats->misses = atomic_load_explicit(&voc_cache.misses, memory_order_relaxed);
+    stats->evictions = atomic_load_explicit(&voc_cache.evictions, memory_order_relaxed);
+    return ESP_OK;
+}
+#endif
 
 esp_err_t ml_voc_classify(uint32_t voc, float temp, float humidity, ml_inference_result_t* result)
 {
@@ -131,27 +788,53 @@ esp_err_t ml_voc_classify(uint32_t voc, float temp, float humidity, ml_inference
     result->temperature = temp;
     result->humidity = humidity;
     
-    // Check if model is loaded
-    if (models[MODEL_VOC_CLASSIFIER].loaded) {
-        // TODO: Run actual ML inference
+    // Check if a model is loaded; the network wins over the forest
+    ml_model_type_t model_type = atomic_load(&models[MODEL_VOC_CLASSIFIER].current) ? MODEL_VOC_CLASSIFIER
+                                                                                   : MODEL_VOC_FOREST;
+    if (atomic_load(&models[model_type].current)) {
+#if ML_VOC_CACHE_ENTRIES
+        uint32_t generation = atomic_load(&model_generation);
+        int32_t key[ML_VOC_INPUTS];
+        ml_voc_cache_entry_t* entry = voc_cache_lookup(voc, temp, humidity, key);
+        if (entry && entry->valid && entry->generation == generation &&
+            memcmp(entry->key, key, sizeof(key)) == 0) {
+            atomic_fetch_add_explicit(&voc_cache.hits, 1, memory_order_relaxed);
+            result->classification = (voc_class_t)entry->classification;
+            result->confidence = entry->confidence;
+            return ESP_OK;
+        }
+#endif
         ESP_LOGD(TAG, "Running ML inference on VOC=%lu, T=%.1f, H=%.1f", voc, temp, humidity);
         
-        // Placeholder: Will be replaced with actual model inference
-        result->classification = VOC_CLASS_UNKNOWN;
-        result->confidence = 0.0f;
-        
-        return ml_model_inference(MODEL_VOC_CLASSIFIER, &voc, result);
+        const float input[ML_VOC_INPUTS] = { (float)voc, temp, humidity };
+        esp_err_t ret = ml_model_inference(model_type, input, result);
+#if ML_VOC_CACHE_ENTRIES
+        if (entry && ret == ESP_OK) {
+            atomic_fetch_add_explicit(&voc_cache.misses, 1, memory_order_relaxed);
+            if (entry->valid && entry->generation == generation) {
+                atomic_fetch_add_explicit(&voc_cache.evictions, 1, memory_order_relaxed);
+            }
+            memcpy(entry->key, key, sizeof(key));
+            entry->generation = generation;
+            entry->confidence = result->confidence;
+            entry->classification = (uint8_t)result->classification;
+            entry->valid = true;
+        }
+#endif
+        return ret;
     } else {
-        // Fallback to threshold-based classification
+        // Fallback to threshold-based classification, on VOC relative to
+        // this sensor's baseline (thresholds are at VOC_BASELINE_NOMINAL)
         ESP_LOGD(TAG, "Using threshold-based classification (no ML model)");
+        float relative = voc_baseline_compensate(sensor_manager_get_voc_baseline(), (float)voc);
         
-        if (voc < 350) {
+        if (relative < 350.0f) {
             result->classification = VOC_CLASS_NORMAL;
             result->confidence = 0.9f;
-        } else if (voc >= 350 && voc < 600) {
+        } else if (relative >= 350.0f && relative < 600.0f) {
             result->classification = VOC_CLASS_CIGARETTE;
             result->confidence = 0.7f;
-        } else if (voc >= 600) {
+        } else if (relative >= 600.0f) {
             result->classification = VOC_CLASS_HERBAL;
             result->confidence = 0.6f;
         } else {
@@ -163,6 +846,91 @@ esp_err_t ml_voc_classify(uint32_t voc, float temp, float humidity, ml_inference
     return ESP_OK;
 }
 
+esp_err_t ml_voc_classify_features(const sensor_features_t* features, ml_inference_result_t* result)
+{
+    if (!features || !result) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    // Smoothed window values instead of a single instantaneous reading
+    return ml_voc_classify((uint32_t)SENSOR_FEATURE(features, SENSOR_CH_VOC, SENSOR_FEAT_MEAN),
+                           SENSOR_FEATURE(features, SENSOR_CH_TEMPERATURE, SENSOR_FEAT_MEAN),
+                           SENSOR_FEATURE(features, SENSOR_CH_HUMIDITY, SENSOR_FEAT_MEAN),
+                           result);
+}
+
+esp_err_t ml_cascade_configure(const ml_cascade_config_t* config)
+{
+    static const ml_cascade_config_t defaults = ML_CASCADE_DEFAULT_CONFIG;
+    if (config && !(config->small_confidence >= 0.0f && config->small_confidence <= 1.0f)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    cascade_config = config ? *config : defaults;
+    atomic_store_explicit(&cascade_stats.samples, 0, memory_order_relaxed);
+    atomic_store_explicit(&cascade_stats.gated, 0, memory_order_relaxed);
+    atomic_store_explicit(&cascade_stats.small_runs, 0, memory_order_relaxed);
+    atomic_store_explicit(&cascade_stats.small_cleared, 0, memory_order_relaxed);
+    atomic_store_explicit(&cascade_stats.full_runs, 0, memory_order_relaxed);
+    return ESP_OK;
+}
+
+esp_err_t ml_cascade_get_stats(ml_cascade_stats_t* stats)
+{
+    if (!stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    stats->samples = atomic_load_explicit(&cascade_stats.samples, memory_order_relaxed);
+    stats->gated = atomic_load_explicit(&cascade_stats.gated, memory_order_relaxed);
+    stats->small_runs = atomic_load_explicit(&cascade_stats.small_runs, memory_order_relaxed);
+    stats->small_cleared = atomic_load_explicit(&cascade_stats.small_cleared, memory_order_relaxed);
+    stats->full_runs = atomic_load_explicit(&cascade_stats.full_runs, memory_order_relaxed);
+    return ESP_OK;
+}
+
+esp_err_t ml_voc_classify_cascade(const sensor_features_t* features, ml_inference_result_t* result)
+{
+    if (!features || !result) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    float voc = SENSOR_FEATURE(features, SENSOR_CH_VOC, SENSOR_FEAT_MEAN);
+    float temp = SENSOR_FEATURE(features, SENSOR_CH_TEMPERATURE, SENSOR_FEAT_MEAN);
+    float humidity = SENSOR_FEATURE(features, SENSOR_CH_HUMIDITY, SENSOR_FEAT_MEAN);
+    result->voc_value = (uint32_t)voc;
+    result->temperature = temp;
+    result->humidity = humidity;
+    CASCADE_COUNT(samples);
+    
+    // Stage 1: flat, clean air needs no model
+    float baseline = sensor_manager_get_voc_baseline();
+    float level = voc_baseline_compensate(baseline, voc);
+    float slope = voc_baseline_compensate(baseline, SENSOR_FEATURE(features, SENSOR_CH_VOC, SENSOR_FEAT_SLOPE));
+    if (level < cascade_config.gate_voc && slope < cascade_config.gate_slope) {
+        CASCADE_COUNT(gated);
+        result->classification = VOC_CLASS_NORMAL;
+        result->confidence = 0.9f;
+        return ESP_OK;
+    }
+    
+    // Stage 2: the forest clears what it is sure about before the network runs
+    if (cascade_config.small_model && atomic_load(&models[MODEL_VOC_CLASSIFIER].current) &&
+        atomic_load(&models[MODEL_VOC_FOREST].current)) {
+        const float input[ML_VOC_INPUTS] = { (float)result->voc_value, temp, humidity };
+        CASCADE_COUNT(small_runs);
+        if (ml_model_inference(MODEL_VOC_FOREST, input, result) == ESP_OK &&
+            result->classification == VOC_CLASS_NORMAL && result->confidence >= cascade_config.small_confidence) {
+            CASCADE_COUNT(small_cleared);
+            return ESP_OK;
+        }
+    }
+    
+    // Stage 3: the full classifier
+    CASCADE_COUNT(full_runs);
+    return ml_voc_classify(result->voc_value, temp, humidity, result);
+}
+
 const char* ml_voc_class_to_string(voc_class_t voc_class)
 {
     switch (voc_class) {
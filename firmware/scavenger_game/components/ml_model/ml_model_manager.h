@@ -3,10 +3,14 @@
 
 #include "stdint.h"
 #include "esp_err.h"
+#include "sensor_features.h"
+#include "ml_model_image.h"
+#include "ml_net.h"
 
 // Model types
 typedef enum {
-    MODEL_VOC_CLASSIFIER = 0,
+    MODEL_VOC_CLASSIFIER = 0,   // int8 network (ml_net.h)
+    MODEL_VOC_FOREST,           // Decision forest (ml_forest.h)
     MODEL_TYPE_MAX
 } ml_model_type_t;
 
@@ -27,23 +31,132 @@ typedef struct {
     float humidity;
 } ml_inference_result_t;
 
+// Per-model call counts, latency histogram and arena peak, reset when a new
+// model is installed (0 compiles the instrumentation out). Per-layer times
+// additionally need ML_PROFILE_LAYERS (ml_net.h).
+#ifndef ML_PROFILE
+#define ML_PROFILE 1
+#endif
+
+#define ML_PROFILE_BUCKETS 12   // Bucket 0: < 1 us, bucket b: [2^(b-1), 2^b) us, last: all above
+
+#if ML_PROFILE
+typedef struct {
+    uint32_t calls;             // ml_model_inference / _batch calls
+    uint32_t samples;           // Inferences, batch samples included
+    uint32_t errors;
+    uint64_t total_us;
+    uint32_t max_us;            // Slowest call
+    uint32_t histogram[ML_PROFILE_BUCKETS];     // Call latency
+    uint32_t arena_peak;        // Bytes of the inference arena used
+#if ML_PROFILE_LAYERS
+    uint64_t layer_us[ML_NET_MAX_LAYERS];       // int8 networks only
+#endif
+} ml_model_profile_t;
+
+// Snapshot of model_type's counters
+esp_err_t ml_model_get_profile(ml_model_type_t model_type, ml_model_profile_t* profile);
+#endif
+
 // Initialize ML model manager
 esp_err_t ml_model_init(void);
 
-// Load model from storage
+// Load model from storage. model_path is either a partition label holding a
+// model image (ML_MODEL_PARTITION, executed in place from flash) or an
+// absolute file path (SD card, copied into RAM).
 esp_err_t ml_model_load(ml_model_type_t model_type, const char* model_path);
 
-// Run inference
+// VOC classifier models take [VOC, temperature, humidity] and score
+// voc_class_t in order
+#define ML_VOC_INPUTS 3
+
+// Run inference. input_data is the model's float input vector
+// ([length][channels] for ml_net.h, [feature_count] for ml_forest.h).
+// Not reentrant, but safe against concurrent loads and updates: the model
+// in use stays valid until the call returns.
 esp_err_t ml_model_inference(ml_model_type_t model_type, const void* input_data, ml_inference_result_t* result);
 
-// Update model (for future OTA updates)
+// Run count inferences in one pass. inputs holds count input vectors back to
+// back; results[i] also gets sample i's VOC, temperature and humidity. For
+// scoring captured logs or a drained sample ring. Not reentrant. Stops at
+// the first inference error and returns it; results are not valid then.
+esp_err_t ml_model_inference_batch(ml_model_type_t model_type, const float* inputs, size_t count,
+                                   ml_inference_result_t* results);
+
+// Update model (for future OTA updates). The new model is checked in a spare
+// slot and swapped in atomically; inference keeps running on the old one
+// meanwhile, and a rejected or unallocatable update leaves it loaded. Blocks
+// until no inference uses the old model any more.
 esp_err_t ml_model_update(ml_model_type_t model_type, const uint8_t* model_data, size_t model_size);
 
-// Get model info
+// Get model info (with ML_PROFILE, also the profile counters)
 esp_err_t ml_model_get_info(ml_model_type_t model_type, char* info_buffer, size_t buffer_size);
 
+// ml_voc_classify remembers model results per bucket of (VOC, temperature,
+// humidity) in a direct-mapped cache, so readings that drift within a bucket
+// skip the model. Installing a model empties it. 0 entries compiles it out.
+#ifndef ML_VOC_CACHE_ENTRIES
+#define ML_VOC_CACHE_ENTRIES 64     // Power of two
+#endif
+#ifndef ML_VOC_CACHE_VOC_STEP
+#define ML_VOC_CACHE_VOC_STEP 4
+#endif
+#ifndef ML_VOC_CACHE_TEMP_STEP
+#define ML_VOC_CACHE_TEMP_STEP 0.25f
+#endif
+#ifndef ML_VOC_CACHE_HUM_STEP
+#define ML_VOC_CACHE_HUM_STEP 0.5f
+#endif
+
+#if ML_VOC_CACHE_ENTRIES
+typedef struct {
+    uint32_t hits;
+    uint32_t misses;            // Model runs, evictions included
+    uint32_t evictions;         // Misses that replaced another bucket
+} ml_voc_cache_stats_t;
+
+// Sets the bucket sizes (voc_step 0 turns the cache off), empties the cache
+// and clears its counters. Call from the task that classifies.
+esp_err_t ml_voc_cache_configure(uint32_t voc_step, float temp_step, float hum_step);
+esp_err_t ml_voc_cache_get_stats(ml_voc_cache_stats_t* stats);
+#endif
+
+// Detection cascade for per-sample classification. Stage 1 answers clean air
+// without a model when the window's VOC and its slope, both relative to the
+// badge's baseline, stay below the gate. Stage 2 (optional) runs the forest
+// when a network is the full classifier and stops at a confident "normal".
+// Stage 3 is ml_voc_classify. VOC levels are at VOC_BASELINE_NOMINAL.
+typedef struct {
+    float gate_voc;             // Window mean VOC below this...
+    float gate_slope;           // ...and slope below this (VOC per second) is clean air
+    bool small_model;           // Stage 2 on/off
+    float small_confidence;     // Stage 2 "normal" at least this sure ends the cascade
+} ml_cascade_config_t;
+
+typedef struct {
+    uint32_t samples;
+    uint32_t gated;             // Ended at stage 1
+    uint32_t small_runs;
+    uint32_t small_cleared;     // Ended at stage 2
+    uint32_t full_runs;
+} ml_cascade_stats_t;
+
+#define ML_CASCADE_DEFAULT_CONFIG { \
+    .gate_voc = 200.0f, \
+    .gate_slope = 4.0f, \
+    .small_model = true, \
+    .small_confidence = 0.8f, \
+}
+
+// config NULL restores the defaults; clears the stats. Call from the task
+// that classifies.
+esp_err_t ml_cascade_configure(const ml_cascade_config_t* config);
+esp_err_t ml_cascade_get_stats(ml_cascade_stats_t* stats);
+esp_err_t ml_voc_classify_cascade(const sensor_features_t* features, ml_inference_result_t* result);
+
 // VOC-specific functions
 esp_err_t ml_voc_classify(uint32_t voc, float temp, float humidity, ml_inference_result_t* result);
+esp_err_t ml_voc_classify_features(const sensor_features_t* features, ml_inference_result_t* result);
 const char* ml_voc_class_to_string(voc_class_t voc_class);
 
 #endif // ML_MODEL_MANAGER_H
\ No newline at end of file
@@ -0,0 +1,332 @@
+#include "ml_net.h"
+#include <math.h>
+#include <string.h>
+#if ML_PROFILE_LAYERS
+#include "esp_timer.h"
+#endif
+
+#define ML_NET_MIN_MULTIPLIER   (1 << 30)
+
+#if ML_PROFILE_LAYERS
+static uint32_t layer_times[ML_NET_MAX_LAYERS];
+
+const uint32_t *ml_net_layer_times(void)
+{
+    return layer_times;
+}
+
+#define LAYER_TIMES_RESET()     memset(layer_times, 0, sizeof(layer_times))
+#define LAYER_BEGIN()           int64_t layer_start = esp_timer_get_time()
+#define LAYER_END(i)            layer_times[i] += (uint32_t)(esp_timer_get_time() - layer_start)
+#else
+#define LAYER_TIMES_RESET()
+#define LAYER_BEGIN()
+#define LAYER_END(i)
+#endif
+
+static bool in_blob(uint64_t offset, uint64_t bytes, size_t size)
+{
+    return offset <= size && bytes <= size - offset;
+}
+
+esp_err_t ml_net_load(ml_net_t *net, const uint8_t *blob, size_t size)
+{
+    if (!net || !blob) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // Biases are read as int32 in place
+    if (((uintptr_t)blob & 3) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (size < sizeof(ml_net_header_t)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    const ml_net_header_t *header = (const ml_net_header_t *)blob;
+    if (header->magic != ML_NET_MAGIC) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    if (header->version != ML_NET_VERSION) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (header->layer_count == 0 || header->layer_count > ML_NET_MAX_LAYERS ||
+        header->input_length == 0 || header->input_channels == 0 ||
+        header->input_channels > ML_NET_MAX_CHANNELS ||
+        !(header->input_scale > 0.0f) || !isfinite(header->input_scale)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!in_blob(sizeof(ml_net_header_t), (uint64_t)header->layer_count * sizeof(ml_layer_desc_t), size)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Walk the shapes through every layer
+    const ml_layer_desc_t *layers = (const ml_layer_desc_t *)(blob + sizeof(ml_net_header_t));
+    uint32_t length = header->input_length;
+    uint32_t channels = header->input_channels;
+    uint64_t largest = (uint64_t)length * channels;
+
+    for (int i = 0; i < header->layer_count; i++) {
+        ml_layer_desc_t layer;
+        memcpy(&layer, &layers[i], sizeof(layer));
+
+        if (layer.out_channels == 0 || layer.activation > ML_ACT_RELU ||
+            layer.multiplier < ML_NET_MIN_MULTIPLIER || layer.shift < -30 || layer.shift > 31 ||
+            !(layer.out_scale > 0.0f) || !isfinite(layer.out_scale)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (layer.type == ML_LAYER_DENSE) {
+            if (layer.kernel != 1 || layer.stride != 1 || layer.in_channels != (uint64_t)length * channels) {
+                return ESP_ERR_INVALID_ARG;
+            }
+            length = 1;
+        } else if (layer.type == ML_LAYER_CONV1D) {
+            if (layer.kernel == 0 || layer.kernel > length || layer.stride == 0 ||
+                layer.in_channels != channels) {
+                return ESP_ERR_INVALID_ARG;
+            }
+            length = (length - layer.kernel) / layer.stride + 1;
+        } else {
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        channels = layer.out_channels;
+
+        uint64_t weight_bytes = (uint64_t)layer.out_channels * layer.kernel * layer.in_channels;
+        if (!in_blob(layer.weights_offset, weight_bytes, size) ||
+            (layer.bias_offset & 3) != 0 ||
+            !in_blob(layer.bias_offset, (uint64_t)layer.out_channels * sizeof(int32_t), size)) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        if ((uint64_t)length * channels > largest) {
+            largest = (uint64_t)length * channels;
+        }
+    }
+
+    if ((uint64_t)length * channels > ML_NET_MAX_OUTPUTS || largest > SIZE_MAX / 2) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    net->header = header;
+    net->layers = layers;
+    net->blob_size = size;
+    net->input_size = (size_t)header->input_length * header->input_channels;
+    net->output_size = (size_t)length * channels;
+    // Rounded up so the second buffer stays word aligned
+    net->activation_size = ((size_t)largest + 3) & ~(size_t)3;
+    net->output_scale = layers[header->layer_count - 1].out_scale;
+    return ESP_OK;
+}
+
+size_t ml_net_arena_size(const ml_net_t *net)
+{
+    return net ? 2 * net->activation_size : 0;
+}
+
+static inline int32_t dot_s8(const int8_t *a, const int8_t *b, size_t n)
+{
+    int32_t acc0 = 0;
+    int32_t acc1 = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 += a[i] * b[i] + a[i + 1] * b[i + 1];
+        acc1 += a[i + 2] * b[i + 2] + a[i + 3] * b[i + 3];
+    }
+    for (; i < n; i++) {
+        acc0 += a[i] * b[i];
+    }
+    return acc0 + acc1;
+}
+
+static inline int8_t requantize(int32_t acc, int32_t multiplier, int32_t shift, int32_t low)
+{
+    int total = 31 + shift;
+    int64_t v = ((int64_t)acc * multiplier + ((int64_t)1 << (total - 1))) >> total;
+    if (v < low) {
+        v = low;
+    } else if (v > 127) {
+        v = 127;
+    }
+    return (int8_t)v;
+}
+
+// Input is already in the first arena buffer
+static void run_layers(const ml_net_t *net, int8_t *arena, int8_t *output)
+{
+    const uint8_t *base = (const uint8_t *)net->header;
+    int8_t *src = arena;
+    int8_t *dst = arena + net->activation_size;
+    size_t length = net->header->input_length;
+
+    for (int i = 0; i < net->header->layer_count; i++) {
+        LAYER_BEGIN();
+        ml_layer_desc_t layer;
+        memcpy(&layer, &net->layers[i], sizeof(layer));
+
+        const int8_t *weights = (const int8_t *)(base + layer.weights_offset);
+        const int32_t *bias = (const int32_t *)(base + layer.bias_offset);
+        size_t taps = (size_t)layer.kernel * layer.in_channels;
+        size_t out_length = 1;
+        size_t step = 0;
+        if (layer.type == ML_LAYER_CONV1D) {
+            out_length = (length - layer.kernel) / layer.stride + 1;
+            step = (size_t)layer.stride * layer.in_channels;
+        }
+        int32_t low = layer.activation == ML_ACT_RELU ? 0 : -128;
+
+        // Channels-last makes every conv window, like a dense input, one contiguous run
+        for (size_t t = 0; t < out_length; t++) {
+            const int8_t *window = src + t * step;
+            int8_t *out = dst + t * layer.out_channels;
+            for (size_t o = 0; o < layer.out_channels; o++) {
+                int32_t acc = bias[o] + dot_s8(weights + o * taps, window, taps);
+                out[o] = requantize(acc, layer.multiplier, layer.shift, low);
+            }
+        }
+
+        length = out_length;
+        int8_t *swap = src;
+        src = dst;
+        dst = swap;
+        LAYER_END(i);
+    }
+
+    memcpy(output, src, net->output_size);
+}
+
+// Normalises and quantizes one input vector into dst[i * stride]
+static void quantize_input(const ml_net_t *net, const float *input, int8_t *dst, size_t stride)
+{
+    const ml_net_header_t *header = net->header;
+    float inv_scale = 1.0f / header->input_scale;
+    size_t channels = header->input_channels;
+    for (size_t i = 0; i < net->input_size; i++) {
+        size_t c = i % channels;
+        float v = (input[i] - header->input_mean[c]) * header->input_inv_std[c] * inv_scale;
+        if (!(v > -128.0f)) {
+            v = -128.0f;        // Also catches NaN
+        } else if (v > 127.0f) {
+            v = 127.0f;
+        }
+        dst[i * stride] = (int8_t)(v >= 0.0f ? v + 0.5f : v - 0.5f);
+    }
+}
+
+esp_err_t ml_net_run(const ml_net_t *net, const float *input, int8_t *arena, size_t arena_size, int8_t *output)
+{
+    if (!net || !net->header || !input || !arena || !output) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (arena_size < ml_net_arena_size(net)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    LAYER_TIMES_RESET();
+    quantize_input(net, input, arena, 1);
+    run_layers(net, arena, output);
+    return ESP_OK;
+}
+
+esp_err_t ml_net_run_quantized(const ml_net_t *net, const int8_t *input, int8_t *arena, size_t arena_size, int8_t *output)
+{
+    if (!net || !net->header || !input || !arena || !output) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (arena_size < ml_net_arena_size(net)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    LAYER_TIMES_RESET();
+    memcpy(arena, input, net->input_size);
+    run_layers(net, arena, output);
+    return ESP_OK;
+}
+
+size_t ml_net_batch_arena_size(const ml_net_t *net)
+{
+    return net ? ML_NET_BATCH_LANES * ml_net_arena_size(net) : 0;
+}
+
+// Same arithmetic as run_layers for one block, activations [element][lane]
+static void run_layers_block(const ml_net_t *net, int8_t *arena, int8_t *output)
+{
+    const uint8_t *base = (const uint8_t *)net->header;
+    int8_t *src = arena;
+    int8_t *dst = arena + net->activation_size * ML_NET_BATCH_LANES;
+    size_t length = net->header->input_length;
+    int32_t acc[ML_NET_BATCH_LANES];
+
+    for (int i = 0; i < net->header->layer_count; i++) {
+        LAYER_BEGIN();
+        ml_layer_desc_t layer;
+        memcpy(&layer, &net->layers[i], sizeof(layer));
+
+        const int8_t *weights = (const int8_t *)(base + layer.weights_offset);
+        const int32_t *bias = (const int32_t *)(base + layer.bias_offset);
+        size_t taps = (size_t)layer.kernel * layer.in_channels;
+        size_t out_length = 1;
+        size_t step = 0;
+        if (layer.type == ML_LAYER_CONV1D) {
+            out_length = (length - layer.kernel) / layer.stride + 1;
+            step = (size_t)layer.stride * layer.in_channels;
+        }
+        int32_t low = layer.activation == ML_ACT_RELU ? 0 : -128;
+
+        for (size_t t = 0; t < out_length; t++) {
+            const int8_t *window = src + t * step * ML_NET_BATCH_LANES;
+            for (size_t o = 0; o < layer.out_channels; o++) {
+                const int8_t *row = weights + o * taps;
+                for (int l = 0; l < ML_NET_BATCH_LANES; l++) {
+                    acc[l] = bias[o];
+                }
+                for (size_t k = 0; k < taps; k++) {
+                    int32_t w = row[k];
+                    const int8_t *a = window + k * ML_NET_BATCH_LANES;
+                    for (int l = 0; l < ML_NET_BATCH_LANES; l++) {
+                        acc[l] += w * a[l];
+                    }
+                }
+                int8_t *out = dst + (t * layer.out_channels + o) * ML_NET_BATCH_LANES;
+                for (int l = 0; l < ML_NET_BATCH_LANES; l++) {
+                    out[l] = requantize(acc[l], layer.multiplier, layer.shift, low);
+                }
+            }
+        }
+
+        length = out_length;
+        int8_t *swap = src;
+        src = dst;
+        dst = swap;
+        LAYER_END(i);
+    }
+
+    for (int l = 0; l < ML_NET_BATCH_LANES; l++) {
+        for (size_t i = 0; i < net->output_size; i++) {
+            output[l * net->output_size + i] = src[i * ML_NET_BATCH_LANES + l];
+        }
+    }
+}
+
+esp_err_t ml_net_run_batch(const ml_net_t *net, const float *input, size_t count,
+                           int8_t *arena, size_t arena_size, int8_t *output)
+{
+    if (!net || !net->header || !input || !arena || !output) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (arena_size < ml_net_batch_arena_size(net)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    LAYER_TIMES_RESET();
+    size_t done = 0;
+    for (; done + ML_NET_BATCH_LANES <= count; done += ML_NET_BATCH_LANES) {
+        for (int l = 0; l < ML_NET_BATCH_LANES; l++) {
+            quantize_input(net, input + (done + l) * net->input_size, arena + l, ML_NET_BATCH_LANES);
+        }
+        run_layers_block(net, arena, output + done * net->output_size);
+    }
+    // A partial block would cost a full one
+    for (; done < count; done++) {
+        quantize_input(net, input + done * net->input_size, arena, 1);
+        run_layers(net, arena, output + done * net->output_size);
+    }
+    return ESP_OK;
+}
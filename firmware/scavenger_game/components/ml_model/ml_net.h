@@ -0,0 +1,114 @@
+#ifndef ML_NET_H
+#define ML_NET_H
+
+#include <stddef.h>
+#include "stdint.h"
+#include "stdbool.h"
+#include "esp_err.h"
+
+// Int8 inference for small MLP / 1-D conv models (tools/ml_quantize.py).
+//
+// Tensors are int8 with one symmetric scale each (real = scale * q) and are
+// laid out channels-last: [length][channels]. Weights are int8, biases int32
+// in accumulator scale (input scale * weight scale), accumulation is int32 and
+// each layer requantizes to its output scale with a Q31 multiplier and shift:
+//     q_out = clamp((acc * multiplier + 2^(n-1)) >> n), n = 31 + shift
+// The arithmetic is integer-only after input quantization, so results are
+// bit-exact with the Python reference.
+//
+// Blob layout (little endian): ml_net_header_t, layer_count ml_layer_desc_t,
+// then the weight and bias arrays at the offsets the layers give (from the
+// start of the blob, 4-byte aligned). The blob is used in place.
+#define ML_NET_MAGIC            0x314E4D51  // "QMN1"
+#define ML_NET_VERSION          1
+#define ML_NET_MAX_LAYERS       8
+#define ML_NET_MAX_CHANNELS     8           // Input channels with their own normalisation
+#define ML_NET_MAX_OUTPUTS      8
+#define ML_NET_NAME_LEN         16
+#define ML_NET_BATCH_LANES      16          // Samples per ml_net_run_batch block
+
+// Time every layer (two timer reads per layer and run)
+#ifndef ML_PROFILE_LAYERS
+#define ML_PROFILE_LAYERS 0
+#endif
+
+typedef enum {
+    ML_LAYER_DENSE = 1,         // Flattens its input
+    ML_LAYER_CONV1D = 2         // Valid padding
+} ml_layer_type_t;
+
+typedef enum {
+    ML_ACT_NONE = 0,
+    ML_ACT_RELU = 1
+} ml_activation_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint8_t layer_count;
+    uint8_t reserved;
+    uint16_t input_length;      // Time steps; 1 for a plain feature vector
+    uint16_t input_channels;    // Values per step
+    float input_scale;          // Of the normalised input
+    float input_mean[ML_NET_MAX_CHANNELS];
+    float input_inv_std[ML_NET_MAX_CHANNELS];
+    char name[ML_NET_NAME_LEN]; // Model version string
+} ml_net_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t type;               // ml_layer_type_t
+    uint8_t activation;         // ml_activation_t
+    uint16_t kernel;            // Conv taps; 1 for dense
+    uint16_t stride;            // Conv stride; 1 for dense
+    uint16_t in_channels;       // Dense: flattened input size
+    uint16_t out_channels;
+    uint16_t reserved;
+    int32_t multiplier;         // Q31, in [2^30, 2^31)
+    int32_t shift;
+    float out_scale;
+    uint32_t weights_offset;    // int8 [out_channels][kernel][in_channels]
+    uint32_t bias_offset;       // int32 [out_channels]
+} ml_layer_desc_t;
+
+// Validated view of a blob; holds pointers into it, no copies
+typedef struct {
+    const ml_net_header_t *header;
+    const ml_layer_desc_t *layers;
+    size_t blob_size;
+    size_t input_size;          // Values per inference
+    size_t output_size;
+    size_t activation_size;     // Largest tensor, bytes
+    float output_scale;
+} ml_net_t;
+
+// Checks the header, every offset and the shape chain
+esp_err_t ml_net_load(ml_net_t *net, const uint8_t *blob, size_t size);
+
+// Arena bytes needed by ml_net_run (two ping-pong activation buffers)
+size_t ml_net_arena_size(const ml_net_t *net);
+
+// Runs one inference entirely inside arena. input holds input_size raw
+// values (normalised and quantized here); output receives output_size int8
+// values in output_scale.
+esp_err_t ml_net_run(const ml_net_t *net, const float *input, int8_t *arena, size_t arena_size, int8_t *output);
+
+// Same from an already quantized input (bit-exact checks)
+esp_err_t ml_net_run_quantized(const ml_net_t *net, const int8_t *input, int8_t *arena, size_t arena_size, int8_t *output);
+
+// Arena bytes needed by ml_net_run_batch
+size_t ml_net_batch_arena_size(const ml_net_t *net);
+
+// Runs count inferences; input is [count][input_size], output
+// [count][output_size]. Full blocks of ML_NET_BATCH_LANES samples keep their
+// activations [element][lane], so each weight is applied to the whole block
+// in one fixed-length run the compiler vectorizes; the rest go one by one.
+// Results are bit-exact with ml_net_run.
+esp_err_t ml_net_run_batch(const ml_net_t *net, const float *input, size_t count,
+                           int8_t *arena, size_t arena_size, int8_t *output);
+
+#if ML_PROFILE_LAYERS
+// Microseconds spent in each layer by the last ml_net_run* call
+const uint32_t *ml_net_layer_times(void);
+#endif
+
+#endif // ML_NET_H
@@ -0,0 +1,143 @@
+#include "quest_conditions.h"
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+// quest_field_t -> float member of sensor_data_t (voc, the only integer, is special-cased)
+static const uint8_t field_offsets[QUEST_FIELD_COUNT] = {
+    offsetof(sensor_data_t, temperature),
+    offsetof(sensor_data_t, humidity),
+    offsetof(sensor_data_t, pressure),
+    offsetof(sensor_data_t, voc),
+    offsetof(sensor_data_t, accel_x),
+    offsetof(sensor_data_t, accel_y),
+    offsetof(sensor_data_t, accel_z),
+    offsetof(sensor_data_t, gyro_x),
+    offsetof(sensor_data_t, gyro_y),
+    offsetof(sensor_data_t, gyro_z),
+    offsetof(sensor_data_t, tilt_angle),
+    offsetof(sensor_data_t, movement_magnitude),
+};
+
+static inline uint32_t read_u32(const uint8_t *code)
+{
+    return code[0] | (uint32_t)code[1] << 8 | (uint32_t)code[2] << 16 | (uint32_t)code[3] << 24;
+}
+
+static inline float field_value(const sensor_data_t *data, uint8_t field)
+{
+    if (field == QUEST_FIELD_VOC) {
+        return (float)data->voc;
+    }
+    float value;
+    memcpy(&value, (const uint8_t *)data + field_offsets[field], sizeof(value));
+    return value;
+}
+
+static inline bool compare(float value, quest_cmp_t cmp, float constant)
+{
+    switch (cmp) {
+        case QUEST_CMP_LT: return value < constant;
+        case QUEST_CMP_LE: return value <= constant;
+        case QUEST_CMP_GT: return value > constant;
+        case QUEST_CMP_GE: return value >= constant;
+        case QUEST_CMP_EQ: return value == constant;
+        case QUEST_CMP_NE: return value != constant;
+        default:           return false;
+    }
+}
+
+bool quest_cond_eval(const quest_cond_program_t *program, quest_cond_state_t *state,
+                     const sensor_data_t *data, uint32_t trigger_levels, uint32_t now_ms)
+{
+    // The operand stack is a bit string, top of stack in bit 0
+    uint32_t stack = 0;
+    const uint8_t *code = program->code;
+    const uint8_t *end = code + program->length;
+
+    while (code < end) {
+        switch (*code) {
+            case QUEST_OP_FALSE:
+            case QUEST_OP_TRUE:
+                stack = stack << 1 | *code;
+                code += 1;
+                break;
+            case QUEST_OP_CMP: {
+                uint8_t operand = code[1];
+                uint32_t bits = read_u32(&code[2]);
+                float constant;
+                memcpy(&constant, &bits, sizeof(constant));
+                float value = field_value(data, operand & 0x0F);
+                if (operand & 0x80) {
+                    value = fabsf(value);
+                }
+                stack = stack << 1 | compare(value, (operand >> 4) & 0x07, constant);
+                code += 6;
+                break;
+            }
+            case QUEST_OP_LEVEL:
+                stack = stack << 1 | ((trigger_levels & code[1]) != 0);
+                code += 2;
+                break;
+            case QUEST_OP_NOT:
+                stack ^= 1;
+                code += 1;
+                break;
+            case QUEST_OP_AND:
+                stack = (stack >> 2) << 1 | (stack & (stack >> 1) & 1);
+                code += 1;
+                break;
+            case QUEST_OP_OR:
+                stack = (stack >> 2) << 1 | ((stack | (stack >> 1)) & 1);
+                code += 1;
+                break;
+            case QUEST_OP_FOR: {
+                uint8_t timer = code[1];
+                uint8_t bit = 1u << timer;
+                bool value = stack & 1;
+                if (!value) {
+                    state->armed &= ~bit;
+                } else if (!(state->armed & bit)) {
+                    state->armed |= bit;
+                    state->since_ms[timer] = now_ms;
+                }
+                stack = (stack & ~1u) | (value && now_ms - state->since_ms[timer] >= read_u32(&code[2]));
+                code += 6;
+                break;
+            }
+            case QUEST_OP_THEN: {
+                uint8_t timer = code[1];
+                uint8_t bit = 1u << timer;
+                uint32_t window = read_u32(&code[2]);
+                bool after = stack & 1;
+                bool before = (stack >> 1) & 1;
+                // b now, after an a on an earlier tick; firing uses the a up
+                bool fired = after && (state->armed & bit) &&
+                             (window == 0 || now_ms - state->since_ms[timer] <= window);
+                if (fired) {
+                    state->armed &= ~bit;
+                }
+                if (before) {
+                    state->armed |= bit;
+                    state->since_ms[timer] = now_ms;
+                }
+                stack = (stack >> 2) << 1 | fired;
+                code += 6;
+                break;
+            }
+            default:
+                // Not from quest_cond_compile
+                return false;
+        }
+    }
+    return stack & 1;
+}
+
+bool quest_cond_eval_edge(const quest_cond_program_t *program, quest_cond_state_t *state,
+                          const sensor_data_t *data, uint32_t trigger_levels, uint32_t now_ms)
+{
+    bool value = quest_cond_eval(program, state, data, trigger_levels, now_ms);
+    bool rising = value && !state->last;
+    state->last = value;
+    return rising;
+}
@@ -0,0 +1,116 @@
+#ifndef QUEST_CONDITIONS_H
+#define QUEST_CONDITIONS_H
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stddef.h"
+#include "esp_err.h"
+#include "sensor_manager.h"
+
+// Compound quest conditions. A condition is written as text (quest_map.json
+// "condition"), compiled at build time by tools/quest_table_gen.py into a few
+// dozen bytes of stack bytecode and evaluated every quest tick.
+// quest_cond_compile() is the same compiler in C, for the host tools.
+// Grammar, loosest first:
+//
+//   expr     := seq
+//   seq      := or { "then" or [ "within" DURATION ] }
+//   or       := and { ("||" | "or") and }
+//   and      := not { ("&&" | "and") not }
+//   not      := ("!" | "not") not | postfix
+//   postfix  := primary { "for" DURATION }
+//   primary  := "(" expr ")" | value CMP NUMBER | TRIGGER | "true" | "false"
+//   value    := FIELD | "abs" "(" FIELD ")"
+//   CMP      := "<" | "<=" | ">" | ">=" | "==" | "!="
+//   DURATION := NUMBER ("ms" | "s" | "min")
+//
+// FIELD is a sensor_data_t member (temperature, humidity, pressure, voc,
+// accel_x/y/z, gyro_x/y/z, tilt_angle, movement_magnitude); TRIGGER is a
+// trigger level (rain, cold, dark, cigarette, herbal, movement, tilt).
+//
+// "a for 30s" is true once a has been true on every tick for 30 s.
+// "a then b within 5s" is true on a tick where b is true and a was true on
+// an earlier tick at most 5 s ago (any time without "within"); firing uses
+// up that a. Every operator is evaluated on every tick, without short
+// circuits, so the timers see each sample and the cost is fixed by the
+// program length.
+//
+// Example: "(temperature < 15 && humidity > 80) for 30s"
+//          "movement then tilt within 5s"
+
+#define QUEST_COND_MAX_CODE     64      // Bytes of bytecode per condition
+#define QUEST_COND_MAX_TIMERS   8       // "for" and "then" operators per condition
+#define QUEST_COND_MAX_DEPTH    32      // Operand stack, one bit per entry
+
+typedef struct {
+    uint8_t code[QUEST_COND_MAX_CODE];
+    uint8_t length;
+    uint8_t timers;
+    uint8_t depth;                      // Deepest stack use
+    uint32_t events;                    // SENSOR_EVENT_* bits of the sensors it reads
+} quest_cond_program_t;
+
+// Per-quest evaluation state; zero it when the quest becomes active
+typedef struct {
+    uint32_t since_ms[QUEST_COND_MAX_TIMERS];   // "for": start of the true run, "then": last left-hand true
+    uint8_t armed;                      // Bit per timer holding a time
+    bool last;                          // Previous result, for edges
+} quest_cond_state_t;
+
+// Bytecode, postfix: operands are pushed before their operator. Numbers in
+// the code are little-endian.
+typedef enum {
+    QUEST_OP_FALSE = 0,
+    QUEST_OP_TRUE,
+    QUEST_OP_CMP,       // u8 field | cmp << 4 | abs << 7, f32 constant; pushes 1
+    QUEST_OP_LEVEL,     // u8 SENSOR_EVENT_* bit; pushes 1
+    QUEST_OP_NOT,
+    QUEST_OP_AND,       // Pops 2, pushes 1
+    QUEST_OP_OR,
+    QUEST_OP_FOR,       // u8 timer, u32 duration ms; pops 1, pushes 1
+    QUEST_OP_THEN,      // u8 timer, u32 window ms (0: none); pops 2, pushes 1
+    QUEST_OP_MAX
+} quest_op_t;
+
+typedef enum {
+    QUEST_CMP_LT = 0,
+    QUEST_CMP_LE,
+    QUEST_CMP_GT,
+    QUEST_CMP_GE,
+    QUEST_CMP_EQ,
+    QUEST_CMP_NE
+} quest_cmp_t;
+
+// sensor_data_t fields, in declaration order
+typedef enum {
+    QUEST_FIELD_TEMPERATURE = 0,
+    QUEST_FIELD_HUMIDITY,
+    QUEST_FIELD_PRESSURE,
+    QUEST_FIELD_VOC,
+    QUEST_FIELD_ACCEL_X,
+    QUEST_FIELD_ACCEL_Y,
+    QUEST_FIELD_ACCEL_Z,
+    QUEST_FIELD_GYRO_X,
+    QUEST_FIELD_GYRO_Y,
+    QUEST_FIELD_GYRO_Z,
+    QUEST_FIELD_TILT_ANGLE,
+    QUEST_FIELD_MOVEMENT_MAGNITUDE,
+    QUEST_FIELD_COUNT
+} quest_field_t;
+
+// Compiles source into program. On ESP_ERR_INVALID_ARG (syntax, unknown
+// name) or ESP_ERR_NO_MEM (over a QUEST_COND_MAX_* limit), error_offset (may
+// be NULL) gets the offset in source the error was found at.
+esp_err_t quest_cond_compile(const char *source, quest_cond_program_t *program, size_t *error_offset);
+
+// One tick: data is the latest sample, trigger_levels the current
+// SENSOR_EVENT_* levels (sensor_manager_get_trigger_state()), now_ms a
+// monotonic millisecond clock
+bool quest_cond_eval(const quest_cond_program_t *program, quest_cond_state_t *state,
+                     const sensor_data_t *data, uint32_t trigger_levels, uint32_t now_ms);
+
+// As quest_cond_eval, but true only on the tick the condition becomes true
+bool quest_cond_eval_edge(const quest_cond_program_t *program, quest_cond_state_t *state,
+                          const sensor_data_t *data, uint32_t trigger_levels, uint32_t now_ms);
+
+#endif // QUEST_CONDITIONS_H
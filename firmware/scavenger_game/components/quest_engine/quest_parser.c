@@ -0,0 +1,339 @@
+#include "quest_conditions.h"
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Recursive descent over the grammar in quest_conditions.h, emitting postfix
+// code as it goes
+
+typedef struct {
+    const char *pos;
+    quest_cond_program_t *program;
+    uint8_t depth;
+    uint8_t nesting;        // Parentheses and "not", bounding the recursion
+    esp_err_t error;
+    const char *error_pos;
+} parser_t;
+
+typedef struct {
+    const char *name;
+    uint32_t event;         // SENSOR_EVENT_* bit of the sensor behind it
+} name_t;
+
+// quest_field_t order
+static const name_t fields[QUEST_FIELD_COUNT] = {
+    { "temperature", SENSOR_EVENT_COLD },
+    { "humidity", SENSOR_EVENT_RAIN },
+    { "pressure", SENSOR_EVENT_RAIN },
+    { "voc", SENSOR_EVENT_CIGARETTE },
+    { "accel_x", SENSOR_EVENT_MOVEMENT },
+    { "accel_y", SENSOR_EVENT_MOVEMENT },
+    { "accel_z", SENSOR_EVENT_MOVEMENT },
+    { "gyro_x", SENSOR_EVENT_MOVEMENT },
+    { "gyro_y", SENSOR_EVENT_MOVEMENT },
+    { "gyro_z", SENSOR_EVENT_MOVEMENT },
+    { "tilt_angle", SENSOR_EVENT_TILT },
+    { "movement_magnitude", SENSOR_EVENT_MOVEMENT },
+};
+
+static const name_t triggers[] = {
+    { "rain", SENSOR_EVENT_RAIN },
+    { "cold", SENSOR_EVENT_COLD },
+    { "dark", SENSOR_EVENT_DARK },
+    { "cigarette", SENSOR_EVENT_CIGARETTE },
+    { "herbal", SENSOR_EVENT_HERBAL },
+    { "movement", SENSOR_EVENT_MOVEMENT },
+    { "tilt", SENSOR_EVENT_TILT },
+};
+
+static void fail(parser_t *p, esp_err_t error)
+{
+    if (p->error == ESP_OK) {
+        p->error = error;
+        p->error_pos = p->pos;
+    }
+}
+
+static void skip_space(parser_t *p)
+{
+    while (isspace((unsigned char)*p->pos)) {
+        p->pos++;
+    }
+}
+
+// Consumes the operator or keyword tok if it comes next
+static bool accept(parser_t *p, const char *tok)
+{
+    skip_space(p);
+    size_t len = strlen(tok);
+    if (strncmp(p->pos, tok, len) != 0) {
+        return false;
+    }
+    // Keywords must not run into a longer name
+    if (isalpha((unsigned char)tok[0]) && (isalnum((unsigned char)p->pos[len]) || p->pos[len] == '_')) {
+        return false;
+    }
+    p->pos += len;
+    return true;
+}
+
+static void expect(parser_t *p, const char *tok)
+{
+    if (!accept(p, tok)) {
+        fail(p, ESP_ERR_INVALID_ARG);
+    }
+}
+
+static size_t read_name(parser_t *p, char *name, size_t size)
+{
+    skip_space(p);
+    size_t len = 0;
+    while (isalnum((unsigned char)p->pos[len]) || p->pos[len] == '_') {
+        len++;
+    }
+    if (len == 0 || len >= size || isdigit((unsigned char)p->pos[0])) {
+        return 0;
+    }
+    memcpy(name, p->pos, len);
+    name[len] = '\0';
+    return len;
+}
+
+static int find_name(const name_t *names, size_t count, const char *name)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(names[i].name, name) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static float read_number(parser_t *p)
+{
+    skip_space(p);
+    char *end;
+    float value = strtof(p->pos, &end);
+    if (end == p->pos || !isfinite(value)) {
+        fail(p, ESP_ERR_INVALID_ARG);
+        return 0.0f;
+    }
+    p->pos = end;
+    return value;
+}
+
+static uint32_t read_duration(parser_t *p)
+{
+    skip_space(p);
+    const char *start = p->pos;
+    float value = read_number(p);
+    float scale = accept(p, "ms") ? 1.0f : accept(p, "s") ? 1000.0f : accept(p, "min") ? 60000.0f : 0.0f;
+    if (scale == 0.0f) {
+        fail(p, ESP_ERR_INVALID_ARG);
+        return 0;
+    }
+    if (value < 0.0f || value * scale > (float)UINT32_MAX / 2) {
+        p->pos = start;
+        fail(p, ESP_ERR_INVALID_ARG);
+        return 0;
+    }
+    return (uint32_t)(value * scale + 0.5f);
+}
+
+// Appends an opcode and its operand bytes; pushes and pops track the stack
+static void emit(parser_t *p, quest_op_t op, const void *operands, size_t size, int pops, int pushes)
+{
+    quest_cond_program_t *program = p->program;
+    if (p->error != ESP_OK) {
+        return;
+    }
+    if (program->length + 1 + size > QUEST_COND_MAX_CODE) {
+        fail(p, ESP_ERR_NO_MEM);
+        return;
+    }
+    program->code[program->length++] = op;
+    memcpy(&program->code[program->length], operands, size);
+    program->length += size;
+
+    p->depth = p->depth - pops + pushes;
+    if (p->depth > QUEST_COND_MAX_DEPTH) {
+        fail(p, ESP_ERR_NO_MEM);
+    } else if (p->depth > program->depth) {
+        program->depth = p->depth;
+    }
+}
+
+static void emit_timer(parser_t *p, quest_op_t op, uint32_t ms, int pops)
+{
+    if (p->program->timers >= QUEST_COND_MAX_TIMERS) {
+        fail(p, ESP_ERR_NO_MEM);
+        return;
+    }
+    uint8_t operands[5] = {
+        p->program->timers++, ms & 0xFF, (ms >> 8) & 0xFF, (ms >> 16) & 0xFF, ms >> 24
+    };
+    emit(p, op, operands, sizeof(operands), pops, 1);
+}
+
+static void parse_seq(parser_t *p);
+
+// value CMP NUMBER, with the field name already read
+static void parse_comparison(parser_t *p, int field, bool absolute)
+{
+    static const struct { const char *tok; quest_cmp_t cmp; } cmps[] = {
+        // Two-character operators first
+        { "<=", QUEST_CMP_LE }, { ">=", QUEST_CMP_GE }, { "==", QUEST_CMP_EQ }, { "!=", QUEST_CMP_NE },
+        { "<", QUEST_CMP_LT }, { ">", QUEST_CMP_GT },
+    };
+    int cmp = -1;
+    for (size_t i = 0; i < sizeof(cmps) / sizeof(cmps[0]) && cmp < 0; i++) {
+        if (accept(p, cmps[i].tok)) {
+            cmp = cmps[i].cmp;
+        }
+    }
+    if (cmp < 0) {
+        fail(p, ESP_ERR_INVALID_ARG);
+        return;
+    }
+    float value = read_number(p);
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint8_t operands[5] = {
+        field | cmp << 4 | (absolute ? 0x80 : 0), bits & 0xFF, (bits >> 8) & 0xFF, (bits >> 16) & 0xFF, bits >> 24
+    };
+    emit(p, QUEST_OP_CMP, operands, sizeof(operands), 0, 1);
+    p->program->events |= fields[field].event;
+}
+
+static void parse_primary(parser_t *p)
+{
+    if (accept(p, "(")) {
+        if (++p->nesting > QUEST_COND_MAX_DEPTH) {
+            fail(p, ESP_ERR_NO_MEM);
+            return;
+        }
+        parse_seq(p);
+        expect(p, ")");
+        p->nesting--;
+        return;
+    }
+
+    char name[24];
+    skip_space(p);
+    const char *start = p->pos;
+    size_t len = read_name(p, name, sizeof(name));
+    if (len == 0) {
+        fail(p, ESP_ERR_INVALID_ARG);
+        return;
+    }
+    p->pos += len;
+
+    if (strcmp(name, "true") == 0 || strcmp(name, "false") == 0) {
+        emit(p, name[0] == 't' ? QUEST_OP_TRUE : QUEST_OP_FALSE, NULL, 0, 0, 1);
+        return;
+    }
+    if (strcmp(name, "abs") == 0) {
+        expect(p, "(");
+        len = read_name(p, name, sizeof(name));
+        int field = len ? find_name(fields, QUEST_FIELD_COUNT, name) : -1;
+        if (field < 0) {
+            fail(p, ESP_ERR_INVALID_ARG);
+            return;
+        }
+        p->pos += len;
+        expect(p, ")");
+        parse_comparison(p, field, true);
+        return;
+    }
+    int field = find_name(fields, QUEST_FIELD_COUNT, name);
+    if (field >= 0) {
+        parse_comparison(p, field, false);
+        return;
+    }
+    int trigger = find_name(triggers, sizeof(triggers) / sizeof(triggers[0]), name);
+    if (trigger >= 0) {
+        uint8_t event = (uint8_t)triggers[trigger].event;
+        emit(p, QUEST_OP_LEVEL, &event, 1, 0, 1);
+        p->program->events |= triggers[trigger].event;
+        return;
+    }
+    p->pos = start;
+    fail(p, ESP_ERR_INVALID_ARG);
+}
+
+static void parse_postfix(parser_t *p)
+{
+    parse_primary(p);
+    while (p->error == ESP_OK && accept(p, "for")) {
+        emit_timer(p, QUEST_OP_FOR, read_duration(p), 1);
+    }
+}
+
+static void parse_not(parser_t *p)
+{
+    if (accept(p, "!") || accept(p, "not")) {
+        if (++p->nesting > QUEST_COND_MAX_DEPTH) {
+            fail(p, ESP_ERR_NO_MEM);
+            return;
+        }
+        parse_not(p);
+        p->nesting--;
+        emit(p, QUEST_OP_NOT, NULL, 0, 1, 1);
+        return;
+    }
+    parse_postfix(p);
+}
+
+static void parse_and(parser_t *p)
+{
+    parse_not(p);
+    while (p->error == ESP_OK && (accept(p, "&&") || accept(p, "and"))) {
+        parse_not(p);
+        emit(p, QUEST_OP_AND, NULL, 0, 2, 1);
+    }
+}
+
+static void parse_or(parser_t *p)
+{
+    parse_and(p);
+    while (p->error == ESP_OK && (accept(p, "||") || accept(p, "or"))) {
+        parse_and(p);
+        emit(p, QUEST_OP_OR, NULL, 0, 2, 1);
+    }
+}
+
+static void parse_seq(parser_t *p)
+{
+    parse_or(p);
+    while (p->error == ESP_OK && accept(p, "then")) {
+        parse_or(p);
+        emit_timer(p, QUEST_OP_THEN, accept(p, "within") ? read_duration(p) : 0, 2);
+    }
+}
+
+esp_err_t quest_cond_compile(const char *source, quest_cond_program_t *program, size_t *error_offset)
+{
+    if (!source || !program) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(program, 0, sizeof(*program));
+    parser_t p = {
+        .pos = source,
+        .program = program,
+        .error = ESP_OK,
+    };
+
+    parse_seq(&p);
+    skip_space(&p);
+    if (*p.pos != '\0') {
+        fail(&p, ESP_ERR_INVALID_ARG);
+    }
+    if (p.error != ESP_OK) {
+        if (error_offset) {
+            *error_offset = (size_t)(p.error_pos - source);
+        }
+        memset(program, 0, sizeof(*program));
+    }
+    return p.error;
+}
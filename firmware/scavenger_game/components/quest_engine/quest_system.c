@@ -1,6 +1,9 @@
 #include "quest_system.h"
+#include "quest_table.h"
+#include "quest_conditions.h"
 #include "sensor_manager.h"
 #include "storage_manager.h"
+#include "state_persistence.h"
 #include "lora_manager.h"
 #include "esp_log.h"
 #include "esp_timer.h"
@@ -8,154 +11,314 @@
 
 static const char *TAG = "QUEST_SYSTEM";
 
-static quest_t available_quests[MAX_QUESTS];
 static player_state_t player_state;
 static bool system_initialized = false;
 
-// Quest definitions based on sensor triggers
-static const quest_t default_quests[] = {
-    {
-        .quest_id = 1,
-        .name = "Rain Dancer",
-        .description = "Find a rainy spot and dance in the rain!",
-        .trigger_type = TRIGGER_RAIN,
-        .trigger_threshold = 1,
-        .target_value = 1,
-        .status = QUEST_INACTIVE
-    },
-    {
-        .quest_id = 2,
-        .name = "Cold Explorer",
-        .description = "Find a cold location (below 15°C)",
-        .trigger_type = TRIGGER_COLD,
-        .trigger_threshold = 1,
-        .target_value = 1,
-        .status = QUEST_INACTIVE
-    },
-    {
-        .quest_id = 3,
-        .name = "Shadow Hunter",
-        .description = "Find a dark or covered area",
-        .trigger_type = TRIGGER_DARK,
-        .trigger_threshold = 1,
-        .target_value = 1,
-        .status = QUEST_INACTIVE
-    },
-    {
-        .quest_id = 4,
-        .name = "Smoke Detective",
-        .description = "Detect cigarette smoke",
-        .trigger_type = TRIGGER_SMOKE,
-        .trigger_threshold = 1,
-        .target_value = 1,
-        .status = QUEST_INACTIVE
-    },
-    {
-        .quest_id = 9,
-        .name = "Herbal Detective",
-        .description = "Detect unique herbal smoke signatures",
-        .trigger_type = TRIGGER_HERBAL,
-        .trigger_threshold = 1,
-        .target_value = 1,
-        .status = QUEST_INACTIVE
-    },
-    {
-        .quest_id = 5,
-        .name = "Shake It Off",
-        .description = "Shake your badge vigorously",
-        .trigger_type = TRIGGER_MOVEMENT,
-        .trigger_threshold = 5,
-        .target_value = 5,
-        .status = QUEST_INACTIVE
-    },
-    {
-        .quest_id = 6,
-        .name = "Tilt Master",
-        .description = "Tilt your badge at different angles",
-        .trigger_type = TRIGGER_TILT,
-        .trigger_threshold = 3,
-        .target_value = 3,
-        .status = QUEST_INACTIVE
-    },
-    {
-        .quest_id = 7,
-        .name = "Badge Network",
-        .description = "Find another badge nearby via LoRa",
-        .trigger_type = TRIGGER_PROXIMITY,
-        .trigger_threshold = 1,
-        .target_value = 1,
-        .status = QUEST_INACTIVE
-    }
+// Quests added at run time by quest_add(), after the generated quest_table
+#ifndef MAX_ADDED_QUESTS
+#define MAX_ADDED_QUESTS 4
+#endif
+
+static quest_def_t added_quests[MAX_ADDED_QUESTS];
+static uint8_t added_quest_count = 0;
+static uint8_t added_quest_index[MAX_QUESTS + 1];  // quest_id -> added_quests slot + 1, 0 for none
+
+// Condition quests (quest_conditions.h) are evaluated at least this often
+#ifndef QUEST_COND_TICK_MS
+#define QUEST_COND_TICK_MS 100
+#endif
+
+// Condition (quest_table bytecode) and its timers per player quest slot
+static const quest_cond_program_t *condition_programs[MAX_QUESTS_PER_PLAYER];
+static quest_cond_state_t condition_states[MAX_QUESTS_PER_PLAYER];
+static uint32_t condition_slots;        // Active slots with a condition
+static uint32_t condition_events;       // Sensors those conditions read
+
+// Sensor event raised by each trigger type; 0 for triggers not driven by sensors
+static const uint32_t trigger_event_bits[] = {
+    [TRIGGER_RAIN] = SENSOR_EVENT_RAIN,
+    [TRIGGER_COLD] = SENSOR_EVENT_COLD,
+    [TRIGGER_DARK] = SENSOR_EVENT_DARK,
+    [TRIGGER_SMOKE] = SENSOR_EVENT_CIGARETTE,
+    [TRIGGER_HERBAL] = SENSOR_EVENT_HERBAL,
+    [TRIGGER_MOVEMENT] = SENSOR_EVENT_MOVEMENT,
+    [TRIGGER_TILT] = SENSOR_EVENT_TILT,
 };
 
+static uint32_t trigger_event(trigger_type_t trigger)
+{
+    if ((unsigned)trigger >= sizeof(trigger_event_bits) / sizeof(trigger_event_bits[0])) {
+        return 0;
+    }
+    return trigger_event_bits[trigger];
+}
+
+#define TRIGGER_EVENT_COUNT (sizeof(trigger_event_bits) / sizeof(trigger_event_bits[0]))
+
+_Static_assert(MAX_QUESTS_PER_PLAYER <= 32, "trigger_subscribers holds a bit per player quest");
+
+// Trigger -> quest index: bit i of trigger_subscribers[t] is set when
+// player_state.quests[i] is active and advanced by trigger t. Rebuilt when
+// quests are loaded, activated or completed, so a tick only visits the
+// quests of the triggers that fired.
+static uint32_t trigger_subscribers[TRIGGER_EVENT_COUNT];
+static uint32_t subscribed_events;      // Events at least one active quest waits for
+
+static void rebuild_trigger_index(void)
+{
+    memset(trigger_subscribers, 0, sizeof(trigger_subscribers));
+    subscribed_events = 0;
+    condition_slots = 0;
+    condition_events = 0;
+    for (int i = 0; i < player_state.active_quest_count && i < MAX_QUESTS_PER_PLAYER; i++) {
+        const quest_t *quest = &player_state.quests[i];
+        const quest_def_t *def = quest_get_def(quest->quest_id);
+        if (quest->status != QUEST_ACTIVE || !def) {
+            continue;
+        }
+        uint32_t event = trigger_event(def->trigger_type);
+        if (event) {
+            trigger_subscribers[def->trigger_type] |= 1u << i;
+            subscribed_events |= event;
+        }
+        if (condition_programs[i]) {
+            condition_slots |= 1u << i;
+            condition_events |= condition_programs[i]->events;
+        }
+    }
+    
+    // Sensors no active quest needs may drop to their idle rate
+    sensor_manager_set_demand(subscribed_events | condition_events);
+}
+
+// Points slot at the condition of its quest, if it has one, with fresh timers
+static void load_condition(int slot, uint8_t quest_id)
+{
+    const quest_def_t *def = quest_get_def(quest_id);
+    condition_programs[slot] = def ? def->condition : NULL;
+    memset(&condition_states[slot], 0, sizeof(condition_states[slot]));
+}
+
+const quest_def_t* quest_get_def(uint8_t quest_id)
+{
+    // Looked up on every progress step: both paths are a table index
+    const quest_def_t *def = quest_table_find(quest_id);
+    if (!def && quest_id <= MAX_QUESTS && added_quest_index[quest_id]) {
+        def = &added_quests[added_quest_index[quest_id] - 1];
+    }
+    return def;
+}
+
+static quest_t* find_player_quest(uint8_t quest_id)
+{
+    for (int i = 0; i < player_state.active_quest_count && i < MAX_QUESTS_PER_PLAYER; i++) {
+        if (player_state.quests[i].quest_id == quest_id) {
+            return &player_state.quests[i];
+        }
+    }
+    return NULL;
+}
+
+// Bit (id - 1) per completed quest, as in quest_def_t.required
+static uint32_t completed_quest_mask(void)
+{
+    uint32_t mask = 0;
+    for (int i = 0; i < player_state.active_quest_count && i < MAX_QUESTS_PER_PLAYER; i++) {
+        const quest_t *quest = &player_state.quests[i];
+        if (quest->status == QUEST_COMPLETED && quest->quest_id >= 1 && quest->quest_id <= 32) {
+            mask |= 1u << (quest->quest_id - 1);
+        }
+    }
+    return mask;
+}
+
+// Advance active combo quests to the number of their required quests done
+static void update_combo_quests(void)
+{
+    uint32_t completed = completed_quest_mask();
+    for (int i = 0; i < player_state.active_quest_count && i < MAX_QUESTS_PER_PLAYER; i++) {
+        quest_t *quest = &player_state.quests[i];
+        const quest_def_t *def = quest_get_def(quest->quest_id);
+        if (quest->status != QUEST_ACTIVE || !def || !(def->flags & QUEST_FLAG_COMBO)) {
+            continue;
+        }
+        uint32_t progress = __builtin_popcount(completed & def->required);
+        if (progress != quest->progress) {
+            quest->progress = progress;
+            state_persistence_mark(STATE_DIRTY_SLOT(i));
+        }
+        if (quest->progress >= def->target_value) {
+            // Completing it may in turn finish another combo
+            quest_complete(quest->quest_id);
+            return;
+        }
+    }
+}
+
 esp_err_t quest_system_init(void)
 {
     if (system_initialized) {
         return ESP_OK;
     }
 
-    // Initialize player state
+    // Initialize player state; quest definitions stay in flash (quest_table.h)
     memset(&player_state, 0, sizeof(player_state));
     
-    // Load available quests
-    memcpy(available_quests, default_quests, sizeof(default_quests));
+    // The table's trigger thresholds replace the sensor defaults; quests on
+    // one trigger agree on it (tools/quest_table_gen.py)
+    for (int i = 0; i < quest_table_count; i++) {
+        const quest_def_t* def = &quest_table[i];
+        if ((def->flags & QUEST_FLAG_THRESHOLD) &&
+            sensor_manager_set_threshold(trigger_event(def->trigger_type), def->threshold) != ESP_OK) {
+            ESP_LOGW(TAG, "Threshold of quest %d not applied", def->quest_id);
+        }
+    }
     
     // Load saved player state from storage
-    storage_manager_load_player_state(&player_state);
+    state_persistence_init();
+    state_persistence_load(&player_state);
+    for (int i = 0; i < player_state.active_quest_count && i < MAX_QUESTS_PER_PLAYER; i++) {
+        if (player_state.quests[i].status == QUEST_ACTIVE) {
+            load_condition(i, player_state.quests[i].quest_id);
+        }
+    }
     
     system_initialized = true;
-    ESP_LOGI(TAG, "Quest system initialized with %d available quests", 
-             sizeof(default_quests)/sizeof(default_quests[0]));
+    rebuild_trigger_index();
+    ESP_LOGI(TAG, "Quest system initialized with %d available quests", quest_table_count);
     
     return ESP_OK;
 }
 
-void quest_system_update(void)
+static void advance_quest(quest_t *quest)
 {
-    if (!system_initialized) {
+    const quest_def_t *def = quest_get_def(quest->quest_id);
+    if (!def || quest->progress >= UINT16_MAX) {
         return;
     }
+    quest->progress++;
+    // Written back in a batch; completion below forces a flush
+    state_persistence_mark(STATE_DIRTY_SLOT(quest - player_state.quests));
+    ESP_LOGD(TAG, "Quest '%s' progress: %u/%u", 
+             def->name, quest->progress, def->target_value);
+    
+    if (quest->progress >= def->target_value) {
+        quest_complete(quest->quest_id);
+    }
+}
 
-    // Check all active quests for trigger conditions
-    for (int i = 0; i < player_state.active_quest_count && i < MAX_QUESTS_PER_PLAYER; i++) {
-        quest_t *quest = &player_state.quests[i];
-        
-        if (quest->status != QUEST_ACTIVE) {
+static void apply_trigger_events(uint32_t events)
+{
+    events &= subscribed_events;
+    
+    // Each fired trigger advances only its subscribers
+    for (unsigned t = 0; events && t < TRIGGER_EVENT_COUNT; t++) {
+        if (!(events & trigger_event_bits[t])) {
             continue;
         }
+        events &= ~trigger_event_bits[t];
         
-        if (quest_check_trigger(quest->trigger_type)) {
-            quest->progress++;
-            ESP_LOGD(TAG, "Quest '%s' progress: %lu/%lu", 
-                     quest->name, quest->progress, quest->target_value);
-            
-            if (quest->progress >= quest->target_value) {
-                quest_complete(quest->quest_id);
+        // A copy: completing a quest rebuilds the index
+        uint32_t slots = trigger_subscribers[t];
+        while (slots) {
+            quest_t *quest = &player_state.quests[__builtin_ctz(slots)];
+            slots &= slots - 1;
+            if (quest->status == QUEST_ACTIVE) {
+                advance_quest(quest);
             }
         }
     }
 }
 
+// One tick of every condition quest, on the latest sample; a condition
+// becoming true advances its quest
+static void evaluate_conditions(void)
+{
+    sensor_data_t data;
+    if (!condition_slots || sensor_manager_get_data(&data) != ESP_OK) {
+        return;
+    }
+    uint32_t levels = sensor_manager_get_trigger_state();
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    
+    uint32_t slots = condition_slots;
+    while (slots) {
+        int i = __builtin_ctz(slots);
+        slots &= slots - 1;
+        quest_t *quest = &player_state.quests[i];
+        if (quest->status == QUEST_ACTIVE &&
+            quest_cond_eval_edge(condition_programs[i], &condition_states[i], &data, levels, now_ms)) {
+            advance_quest(quest);
+        }
+    }
+}
+
+void quest_system_update(void)
+{
+    if (!system_initialized) {
+        return;
+    }
+
+    // Consume pending trigger events without blocking
+    apply_trigger_events(sensor_manager_wait_events(subscribed_events, 0));
+    evaluate_conditions();
+    sensor_manager_service();
+    state_persistence_poll(&player_state);
+}
+
+void quest_system_wait_and_update(uint32_t timeout_ms)
+{
+    if (!system_initialized) {
+        return;
+    }
+
+    // Sleep until a trigger relevant to an active quest fires. The wake bit lets
+    // quest_activate() interrupt the wait so the new quest's trigger is included;
+    // the service bit hands over work the sampling timer must not do itself.
+    // Condition quests need a tick even when no trigger fires
+    if (condition_slots && timeout_ms > QUEST_COND_TICK_MS) {
+        timeout_ms = QUEST_COND_TICK_MS;
+    }
+    // Pending progress must not wait past its flush deadline
+    uint32_t flush_ms = state_persistence_ms_until_due();
+    if (timeout_ms > flush_ms) {
+        timeout_ms = flush_ms;
+    }
+    uint32_t events = sensor_manager_wait_events(subscribed_events | SENSOR_EVENT_WAKE | SENSOR_EVENT_SERVICE,
+                                                 timeout_ms);
+    apply_trigger_events(events & ~(SENSOR_EVENT_WAKE | SENSOR_EVENT_SERVICE));
+    evaluate_conditions();
+    sensor_manager_service();
+    state_persistence_poll(&player_state);
+}
+
 esp_err_t quest_add(const char* name, const char* description, trigger_type_t trigger, uint32_t target)
 {
-    if (!name || !description || target == 0) {
+    if (!name || !description || target == 0 || target > UINT16_MAX) {
         return ESP_ERR_INVALID_ARG;
     }
     
-    for (int i = 0; i < MAX_QUESTS; i++) {
-        if (available_quests[i].status == QUEST_INACTIVE) {
-            available_quests[i].quest_id = i + 1;
-            available_quests[i].name[0] = '\0';
-            available_quests[i].description[0] = '\0';
-            strncat(available_quests[i].name, name, MAX_QUEST_NAME_LEN - 1);
-            strncat(available_quests[i].description, description, MAX_QUEST_DESC_LEN - 1);
-            available_quests[i].trigger_type = trigger;
-            available_quests[i].target_value = target;
-            available_quests[i].status = QUEST_INACTIVE;
-            
-            ESP_LOGI(TAG, "Added quest: %s", name);
-            return ESP_OK;
+    // Lowest id that neither the table nor an earlier quest_add() uses
+    for (uint8_t id = 1; id <= MAX_QUESTS; id++) {
+        if (quest_get_def(id)) {
+            continue;
+        }
+        if (added_quest_count >= MAX_ADDED_QUESTS) {
+            break;
         }
+        added_quest_index[id] = added_quest_count + 1;
+        added_quests[added_quest_count++] = (quest_def_t) {
+            .name = name,
+            .description = description,
+            .hint = "",
+            .points = 100,
+            .quest_id = id,
+            .trigger_type = trigger,
+            .target_value = target,
+        };
+        
+        ESP_LOGI(TAG, "Added quest %d: %s", id, name);
+        return ESP_OK;
     }
     
     return ESP_ERR_NO_MEM;
@@ -163,28 +326,53 @@ esp_err_t quest_add(const char* name, const char* description, trigger_type_t tr
 
 esp_err_t quest_activate(uint8_t quest_id)
 {
-    if (quest_id == 0 || quest_id > MAX_QUESTS) {
+    const quest_def_t *def = quest_get_def(quest_id);
+    if (!def) {
         return ESP_ERR_INVALID_ARG;
     }
     
+    // A level trigger already true at activation is its first occurrence.
+    // Edges raised before that belong to the quests already waiting; hand
+    // them over first so the new quest does not count the same one again.
+    uint32_t event = trigger_event(def->trigger_type);
+    bool already = event && (sensor_manager_get_trigger_state() & event);
+    apply_trigger_events(sensor_manager_wait_events(subscribed_events | event, 0));
+    
+    if (find_player_quest(quest_id)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
     if (player_state.active_quest_count >= MAX_QUESTS_PER_PLAYER) {
         return ESP_ERR_NO_MEM;
     }
     
-    quest_t *quest = &available_quests[quest_id - 1];
-    if (quest->status != QUEST_INACTIVE) {
-        return ESP_ERR_INVALID_STATE;
-    }
+    load_condition(player_state.active_quest_count, quest_id);
     
     // Add to player active quests
-    player_state.quests[player_state.active_quest_count] = *quest;
-    player_state.quests[player_state.active_quest_count].status = QUEST_ACTIVE;
-    player_state.active_quest_count++;
+    int slot = player_state.active_quest_count++;
+    quest_t *quest = &player_state.quests[slot];
+    *quest = (quest_t) {
+        .quest_id = quest_id,
+        .status = QUEST_ACTIVE,
+    };
+    
+    // Re-arm the waiting quest loop with the new subscription
+    rebuild_trigger_index();
+    sensor_manager_post_events(SENSOR_EVENT_WAKE);
+    
+    ESP_LOGI(TAG, "Activated quest: %s", def->name);
     
-    ESP_LOGI(TAG, "Activated quest: %s", quest->name);
+    // Save state, with any progress still pending
+    state_persistence_mark(STATE_DIRTY_SLOT(slot));
+    state_persistence_flush(&player_state);
     
-    // Save state
-    storage_manager_save_player_state(&player_state);
+    // From here on only new rising edges count
+    if (already) {
+        advance_quest(quest);
+    }
+    
+    // A combo may already have its required quests done
+    update_combo_quests();
     
     return ESP_OK;
 }
@@ -197,13 +385,18 @@ esp_err_t quest_complete(uint8_t quest_id)
             quest->status = QUEST_COMPLETED;
             quest->completed_timestamp = esp_timer_get_time() / 1000000;
             player_state.completed_quest_count++;
-            player_state.total_score += 100; // Base score per quest
+            const quest_def_t *def = quest_get_def(quest_id);
+            player_state.total_score += def ? def->points : 100;
+            
+            rebuild_trigger_index();
             
-            ESP_LOGI(TAG, "Quest completed: %s", quest->name);
+            ESP_LOGI(TAG, "Quest completed: %s", def ? def->name : "?");
             
-            // Save state
-            storage_manager_save_player_state(&player_state);
+            // Save state now; a completion is never left to the batch
+            state_persistence_mark(STATE_DIRTY_SLOT(i));
+            state_persistence_flush(&player_state);
             
+            update_combo_quests();
             return ESP_OK;
         }
     }
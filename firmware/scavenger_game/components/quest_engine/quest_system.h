@@ -5,10 +5,14 @@
 #include "stdbool.h"
 #include "esp_err.h"
 
-#define MAX_QUESTS 20
-#define MAX_QUEST_NAME_LEN 32
+#ifndef MAX_QUESTS
+#define MAX_QUESTS 20               // Highest quest_id
+#endif
+#define MAX_QUEST_NAME_LEN 32       // Catalog text limits, with the terminator
 #define MAX_QUEST_DESC_LEN 128
-#define MAX_QUESTS_PER_PLAYER 10
+#ifndef MAX_QUESTS_PER_PLAYER
+#define MAX_QUESTS_PER_PLAYER 10    // At most 32
+#endif
 
 typedef enum {
     QUEST_INACTIVE = 0,
@@ -30,16 +34,16 @@ typedef enum {
     TRIGGER_MANUAL
 } trigger_type_t;
 
+// Catalog entry of a quest (quest_table.h)
+typedef struct quest_def quest_def_t;
+
+// A player's record of one quest. Name, description, trigger and target are
+// static and come from the quest's definition, quest_get_def(quest_id).
 typedef struct {
+    uint32_t completed_timestamp;   // Seconds since boot
+    uint16_t progress;
     uint8_t quest_id;
-    char name[MAX_QUEST_NAME_LEN];
-    char description[MAX_QUEST_DESC_LEN];
-    trigger_type_t trigger_type;
-    uint32_t trigger_threshold;
-    quest_status_t status;
-    uint32_t progress;
-    uint32_t target_value;
-    uint32_t completed_timestamp;
+    uint8_t status;                 // quest_status_t
 } quest_t;
 
 typedef struct {
@@ -51,10 +55,17 @@ typedef struct {
 
 esp_err_t quest_system_init(void);
 void quest_system_update(void);
+void quest_system_wait_and_update(uint32_t timeout_ms);
+// Adds a quest next to the generated table (quest_table.h); name and
+// description are referenced, not copied, and must stay valid
 esp_err_t quest_add(const char* name, const char* description, trigger_type_t trigger, uint32_t target);
+// Sensor quests advance once per rising edge of their trigger; a trigger
+// already true at activation counts as the first
 esp_err_t quest_activate(uint8_t quest_id);
 esp_err_t quest_complete(uint8_t quest_id);
 esp_err_t quest_get_state(uint8_t quest_id, quest_t* quest);
+// Definition of a table or quest_add() quest, NULL if there is none
+const quest_def_t* quest_get_def(uint8_t quest_id);
 esp_err_t quest_get_player_state(player_state_t* state);
 bool quest_check_trigger(trigger_type_t trigger);
 
@@ -0,0 +1,43 @@
+#ifndef QUEST_TABLE_H
+#define QUEST_TABLE_H
+
+#include "stdint.h"
+#include "stddef.h"
+#include "quest_system.h"
+#include "quest_conditions.h"
+
+// Static quest definitions, compiled at build time from quests/quest_map.json
+// by tools/quest_table_gen.py into a const table in flash. Strings point into
+// one shared pool with duplicates merged. Thresholds are in the units
+// sensor_manager compares, one per trigger: quest_system_init() passes them
+// to sensor_manager_set_threshold(). Condition quests are compiled by the
+// generator too, and a condition that does not compile fails the build.
+
+#define QUEST_FLAG_THRESHOLD 0x01   // threshold is set; only for triggers that have one
+#define QUEST_FLAG_COMBO     0x02   // Completed by completing the required quests
+
+#define QUEST_TABLE_NONE    0xFF
+
+struct quest_def {
+    const char* name;
+    const char* description;
+    const char* hint;
+    const char* condition_source;   // quest_conditions.h expression, NULL for trigger quests
+    const quest_cond_program_t* condition;  // Its bytecode
+    float threshold;
+    uint32_t required;          // Combo quests: bit (id - 1) per required quest
+    uint16_t points;
+    uint16_t target_value;
+    uint8_t quest_id;
+    uint8_t trigger_type;       // trigger_type_t
+    uint8_t flags;              // QUEST_FLAG_*
+};
+
+// Sorted by quest_id
+extern const quest_def_t quest_table[];
+extern const uint8_t quest_table_count;
+
+// Definition of quest_id, NULL if the table has none
+const quest_def_t* quest_table_find(uint8_t quest_id);
+
+#endif // QUEST_TABLE_H
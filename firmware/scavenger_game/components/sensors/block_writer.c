@@ -0,0 +1,289 @@
+#include "block_writer.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/task.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const char *TAG = "BLOCK_WRITER";
+
+#define WRITER_STACK_SIZE           4096
+#define WRITER_PRIORITY             3
+
+static esp_err_t write_all(int fd, const uint8_t *data, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n <= 0) {
+            return ESP_FAIL;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return ESP_OK;
+}
+
+static void flush_block(block_writer_t *writer, block_writer_block_t *block)
+{
+    int64_t start = esp_timer_get_time();
+
+    // fsync per block keeps the FAT current, so a dead battery loses at most one block
+    esp_err_t ret = write_all(writer->fd, block->data, block->len);
+    if (ret == ESP_OK && fsync(writer->fd) != 0) {
+        ret = ESP_FAIL;
+    }
+    uint32_t elapsed_us = (uint32_t)(esp_timer_get_time() - start);
+
+    xSemaphoreTake(writer->lock, portMAX_DELAY);
+    if (ret == ESP_OK) {
+        writer->stats.blocks_written++;
+        writer->stats.bytes_written += block->len;
+    } else {
+        writer->stats.write_errors++;
+    }
+    if (elapsed_us > writer->stats.max_write_us) {
+        writer->stats.max_write_us = elapsed_us;
+    }
+    xSemaphoreGive(writer->lock);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "%s: block write failed, %u bytes lost", writer->name, (unsigned)block->len);
+    }
+
+    block->len = 0;
+    atomic_store_explicit(&block->full, false, memory_order_release);
+}
+
+static void writer_task(void *arg)
+{
+    block_writer_t *writer = arg;
+    int next = 0;
+
+    for (;;) {
+        xSemaphoreTake(writer->work, portMAX_DELAY);
+
+        // Blocks are handed over alternately, so draining in turn keeps file order
+        while (atomic_load_explicit(&writer->blocks[next].full, memory_order_acquire)) {
+            flush_block(writer, &writer->blocks[next]);
+            next ^= 1;
+        }
+
+        xSemaphoreTake(writer->lock, portMAX_DELAY);
+        bool finished = writer->stopping && !atomic_load(&writer->blocks[next].full);
+        xSemaphoreGive(writer->lock);
+        if (finished) {
+            break;
+        }
+    }
+
+    xSemaphoreGive(writer->done);
+    vTaskDelete(NULL);
+}
+
+// Caller holds lock
+static void hand_off(block_writer_t *writer, int index)
+{
+    atomic_store_explicit(&writer->blocks[index].full, true, memory_order_release);
+    xSemaphoreGive(writer->work);
+}
+
+// Caller holds lock. Appends bytes across the block boundary, all or nothing.
+static esp_err_t append_locked(block_writer_t *writer, const void *data, size_t len)
+{
+    block_writer_block_t *block = &writer->blocks[writer->fill_block];
+    block_writer_block_t *spare = &writer->blocks[writer->fill_block ^ 1];
+
+    if (len > BLOCK_WRITER_BLOCK_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (atomic_load_explicit(&block->full, memory_order_acquire)) {
+        return ESP_ERR_NO_MEM;
+    }
+    size_t space = BLOCK_WRITER_BLOCK_SIZE - block->len;
+    if (len > space && atomic_load_explicit(&spare->full, memory_order_acquire)) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    size_t first = (len < space) ? len : space;
+    memcpy(block->data + block->len, data, first);
+    block->len += first;
+
+    if (block->len == BLOCK_WRITER_BLOCK_SIZE) {
+        hand_off(writer, writer->fill_block);
+        writer->fill_block ^= 1;
+        if (first < len) {
+            memcpy(spare->data, (const uint8_t *)data + first, len - first);
+            spare->len = len - first;
+        }
+    }
+    return ESP_OK;
+}
+
+static void free_blocks(block_writer_t *writer)
+{
+    for (int i = 0; i < 2; i++) {
+        if (writer->blocks[i].data) {
+            heap_caps_free(writer->blocks[i].data);
+            writer->blocks[i].data = NULL;
+        }
+    }
+}
+
+static esp_err_t alloc_blocks(block_writer_t *writer)
+{
+    for (int i = 0; i < 2; i++) {
+        // Prefer PSRAM; the card is far slower than either memory
+        block_writer_block_t *block = &writer->blocks[i];
+        block->data = heap_caps_malloc(BLOCK_WRITER_BLOCK_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!block->data) {
+            block->data = heap_caps_malloc(BLOCK_WRITER_BLOCK_SIZE, MALLOC_CAP_8BIT);
+        }
+        if (!block->data) {
+            free_blocks(writer);
+            return ESP_ERR_NO_MEM;
+        }
+        block->len = 0;
+        atomic_store(&block->full, false);
+    }
+    return ESP_OK;
+}
+
+esp_err_t block_writer_init(block_writer_t *writer, const char *name)
+{
+    if (!writer || !name) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(writer, 0, sizeof(*writer));
+    writer->fd = -1;
+    writer->name = name;
+    atomic_init(&writer->open, false);
+    atomic_init(&writer->blocks[0].full, false);
+    atomic_init(&writer->blocks[1].full, false);
+
+    writer->lock = xSemaphoreCreateMutex();
+    writer->work = xSemaphoreCreateBinary();
+    writer->done = xSemaphoreCreateBinary();
+    if (!writer->lock || !writer->work || !writer->done) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t block_writer_open(block_writer_t *writer, const char *path, const void *header, size_t header_len)
+{
+    if (!writer || !writer->lock || !path || header_len > BLOCK_WRITER_BLOCK_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (atomic_load(&writer->open)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t ret = alloc_blocks(writer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "%s: failed to allocate buffers", writer->name);
+        return ret;
+    }
+
+    writer->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (writer->fd < 0) {
+        ESP_LOGE(TAG, "%s: failed to create %s", writer->name, path);
+        free_blocks(writer);
+        return ESP_FAIL;
+    }
+
+    xSemaphoreTake(writer->lock, portMAX_DELAY);
+    writer->fill_block = 0;
+    writer->stopping = false;
+    memset(&writer->stats, 0, sizeof(writer->stats));
+    if (header && header_len > 0) {
+        append_locked(writer, header, header_len);
+    }
+    xSemaphoreGive(writer->lock);
+
+    if (xTaskCreate(writer_task, writer->name, WRITER_STACK_SIZE, writer, WRITER_PRIORITY, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "%s: failed to start writer task", writer->name);
+        close(writer->fd);
+        writer->fd = -1;
+        free_blocks(writer);
+        return ESP_ERR_NO_MEM;
+    }
+
+    atomic_store(&writer->open, true);
+    return ESP_OK;
+}
+
+esp_err_t block_writer_close(block_writer_t *writer)
+{
+    if (!writer || !writer->lock) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(writer->lock, portMAX_DELAY);
+    if (!atomic_load(&writer->open)) {
+        xSemaphoreGive(writer->lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    atomic_store(&writer->open, false);
+    writer->stopping = true;
+
+    // Final partial block: the only write that is not a whole allocation unit
+    block_writer_block_t *block = &writer->blocks[writer->fill_block];
+    if (!atomic_load(&block->full) && block->len > 0) {
+        hand_off(writer, writer->fill_block);
+    } else {
+        xSemaphoreGive(writer->work);
+    }
+    xSemaphoreGive(writer->lock);
+
+    xSemaphoreTake(writer->done, portMAX_DELAY);
+
+    esp_err_t ret = (close(writer->fd) == 0) ? ESP_OK : ESP_FAIL;
+    writer->fd = -1;
+    free_blocks(writer);
+    return ret;
+}
+
+bool block_writer_is_open(block_writer_t *writer)
+{
+    return atomic_load(&writer->open);
+}
+
+esp_err_t block_writer_append(block_writer_t *writer, const void *data, size_t len)
+{
+    if (!writer->lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(writer->lock, portMAX_DELAY);
+    if (!atomic_load(&writer->open)) {
+        xSemaphoreGive(writer->lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t ret = append_locked(writer, data, len);
+    if (ret == ESP_OK) {
+        writer->stats.records_written++;
+    } else {
+        writer->stats.records_dropped++;
+    }
+    xSemaphoreGive(writer->lock);
+    return ret;
+}
+
+void block_writer_get_stats(block_writer_t *writer, block_writer_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+    if (!writer || !writer->lock) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+
+    xSemaphoreTake(writer->lock, portMAX_DELAY);
+    *stats = writer->stats;
+    xSemaphoreGive(writer->lock);
+}
@@ -0,0 +1,63 @@
+#ifndef BLOCK_WRITER_H
+#define BLOCK_WRITER_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include "stdint.h"
+#include "stdbool.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+// Double-buffered file writer for the SD card. Producers append records to one
+// RAM block while a writer task flushes the other, so a slow card never stalls
+// the sampling timer. Blocks match the FAT allocation unit used by
+// storage_manager_mount_sd, so every write except the final one is a whole
+// cluster at a cluster boundary.
+#define BLOCK_WRITER_BLOCK_SIZE     (16 * 1024)
+
+typedef struct {
+    uint32_t records_written;       // Accepted into a RAM block
+    uint32_t records_dropped;       // Both blocks were still with the writer
+    uint32_t blocks_written;
+    uint32_t write_errors;
+    uint64_t bytes_written;
+    uint32_t max_write_us;          // Slowest block write including fsync
+} block_writer_stats_t;
+
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    atomic_bool full;               // Owned by the writer task until it clears this
+} block_writer_block_t;
+
+typedef struct {
+    block_writer_block_t blocks[2];
+    int fill_block;                 // Block producers append to
+    int fd;
+    atomic_bool open;
+    bool stopping;
+    const char *name;
+    block_writer_stats_t stats;
+    SemaphoreHandle_t lock;         // Producer state and stats
+    SemaphoreHandle_t work;         // Wakes the writer task
+    SemaphoreHandle_t done;
+} block_writer_t;
+
+// Once per writer; name is used for the task and must outlive it
+esp_err_t block_writer_init(block_writer_t *writer, const char *name);
+
+// Creates path (truncating it) and starts the writer task. header may be NULL.
+esp_err_t block_writer_open(block_writer_t *writer, const char *path, const void *header, size_t header_len);
+
+// Flushes the partial block, waits for the writer task and closes the file
+esp_err_t block_writer_close(block_writer_t *writer);
+
+bool block_writer_is_open(block_writer_t *writer);
+
+// All or nothing, never blocks on the card. ESP_ERR_NO_MEM means the record was dropped.
+esp_err_t block_writer_append(block_writer_t *writer, const void *data, size_t len);
+
+void block_writer_get_stats(block_writer_t *writer, block_writer_stats_t *stats);
+
+#endif // BLOCK_WRITER_H
@@ -1,17 +1,55 @@
 #include "bmi270_driver.h"
 #include "driver/i2c.h"
 #include "esp_log.h"
+#include "freertos/FreeRTOS.h"
 #include "math.h"
+#include <stdlib.h>
+#include <string.h>
 
 static const char *TAG = "BMI270";
 
 // BMI270 I2C address
 #define BMI270_I2C_ADDR    0x68
 #define I2C_MASTER_NUM     0
+#define I2C_TIMEOUT_MS     20
 
 // BMI270 registers
-#define BMI270_REG_CHIP_ID 0x00
-#define BMI270_CHIP_ID     0x24
+#define BMI270_REG_CHIP_ID       0x00
+#define BMI270_CHIP_ID           0x24
+#define BMI270_REG_FIFO_LENGTH_0 0x24
+#define BMI270_REG_FIFO_DATA     0x26
+#define BMI270_REG_ACC_CONF      0x40
+#define BMI270_REG_ACC_RANGE     0x41
+#define BMI270_REG_GYR_CONF      0x42
+#define BMI270_REG_GYR_RANGE     0x43
+#define BMI270_REG_FIFO_CONFIG_0 0x48
+#define BMI270_REG_FIFO_CONFIG_1 0x49
+#define BMI270_REG_PWR_CONF      0x7C
+#define BMI270_REG_PWR_CTRL      0x7D
+#define BMI270_REG_CMD           0x7E
+
+#define BMI270_CMD_FIFO_FLUSH    0xB0
+#define BMI270_PWR_CTRL_ACC_GYR  0x06
+#define BMI270_FIFO_ACC_GYR_HDR  0xD0   // fifo_gyr_en | fifo_acc_en | fifo_header_en
+#define BMI270_ACC_FILTER_PERF   0x80
+#define BMI270_ACC_BWP_NORMAL    0x20
+#define BMI270_GYR_FILTER_PERF   0x80
+#define BMI270_GYR_BWP_NORMAL    0x20
+#define BMI270_ACC_RANGE_8G      0x02
+#define BMI270_GYR_RANGE_2000DPS 0x00
+
+// FIFO frame headers (header mode)
+#define FIFO_HDR_ACC_GYR         0x8C
+#define FIFO_HDR_ACC             0x84
+#define FIFO_HDR_GYR             0x88
+#define FIFO_HDR_SKIP            0x40
+#define FIFO_HDR_SENSORTIME      0x44
+#define FIFO_HDR_CONFIG_CHANGE   0x48
+#define FIFO_HDR_DROP            0x50
+#define FIFO_HDR_EMPTY           0x80
+
+#define ACC_LSB_PER_G            (32768.0f / 8.0f)
+#define GYR_LSB_PER_DPS          (32768.0f / 2000.0f)
 
 // Placeholder values
 static float base_accel_x = 0.0f;
@@ -21,6 +59,42 @@ static float base_gyro_x = 0.0f;
 static float base_gyro_y = 0.0f;
 static float base_gyro_z = 0.0f;
 
+static esp_err_t i2c_bus_read(void *ctx, uint8_t reg, uint8_t *data, size_t len);
+static esp_err_t i2c_bus_write(void *ctx, uint8_t reg, const uint8_t *data, size_t len);
+
+static bmi270_bus_t bus = {
+    .read = i2c_bus_read,
+    .write = i2c_bus_write,
+    .ctx = NULL
+};
+static bool fifo_enabled = false;
+static uint8_t fifo_buffer[BMI270_FIFO_SIZE];
+
+static esp_err_t i2c_bus_read(void *ctx, uint8_t reg, uint8_t *data, size_t len)
+{
+    (void)ctx;
+    return i2c_master_write_read_device(I2C_MASTER_NUM, BMI270_I2C_ADDR, &reg, 1, data, len,
+                                        pdMS_TO_TICKS(I2C_TIMEOUT_MS));
+}
+
+static esp_err_t i2c_bus_write(void *ctx, uint8_t reg, const uint8_t *data, size_t len)
+{
+    (void)ctx;
+    uint8_t buf[8];
+    if (len + 1 > sizeof(buf)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    buf[0] = reg;
+    memcpy(&buf[1], data, len);
+    return i2c_master_write_to_device(I2C_MASTER_NUM, BMI270_I2C_ADDR, buf, len + 1,
+                                      pdMS_TO_TICKS(I2C_TIMEOUT_MS));
+}
+
+static esp_err_t write_reg(uint8_t reg, uint8_t value)
+{
+    return bus.write(bus.ctx, reg, &value, 1);
+}
+
 esp_err_t bmi270_init(void)
 {
     ESP_LOGI(TAG, "Initializing BMI270 sensor");
@@ -52,4 +126,199 @@ esp_err_t bmi270_read_data(float *accel_x, float *accel_y, float *accel_z,
     *gyro_z = base_gyro_z + ((rand() % 100) - 50) * 0.01f;
     
     return ESP_OK;
-}
\ No newline at end of file
+}
+
+void bmi270_set_bus(const bmi270_bus_t *new_bus)
+{
+    if (new_bus && new_bus->read && new_bus->write) {
+        bus = *new_bus;
+    }
+}
+
+esp_err_t bmi270_fifo_start(bmi270_odr_t odr)
+{
+    if (odr < BMI270_ODR_100HZ || odr > BMI270_ODR_1600HZ) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t chip_id = 0;
+    esp_err_t ret = bus.read(bus.ctx, BMI270_REG_CHIP_ID, &chip_id, 1);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read chip ID");
+        return ret;
+    }
+    if (chip_id != BMI270_CHIP_ID) {
+        ESP_LOGE(TAG, "Unexpected chip ID 0x%02x", chip_id);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Accel and gyro at the same ODR so every FIFO frame carries both
+    const uint8_t config[][2] = {
+        { BMI270_REG_PWR_CONF,      0x00 },    // Disable advanced power save
+        { BMI270_REG_ACC_CONF,      BMI270_ACC_FILTER_PERF | BMI270_ACC_BWP_NORMAL | odr },
+        { BMI270_REG_ACC_RANGE,     BMI270_ACC_RANGE_8G },
+        { BMI270_REG_GYR_CONF,      BMI270_GYR_FILTER_PERF | BMI270_GYR_BWP_NORMAL | odr },
+        { BMI270_REG_GYR_RANGE,     BMI270_GYR_RANGE_2000DPS },
+        { BMI270_REG_FIFO_CONFIG_0, 0x00 },    // Stream mode: overwrite oldest when full
+        { BMI270_REG_FIFO_CONFIG_1, BMI270_FIFO_ACC_GYR_HDR },
+        { BMI270_REG_PWR_CTRL,      BMI270_PWR_CTRL_ACC_GYR },
+        { BMI270_REG_CMD,           BMI270_CMD_FIFO_FLUSH },
+    };
+
+    for (size_t i = 0; i < sizeof(config) / sizeof(config[0]); i++) {
+        ret = write_reg(config[i][0], config[i][1]);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to write register 0x%02x", config[i][0]);
+            return ret;
+        }
+    }
+
+    fifo_enabled = true;
+    ESP_LOGI(TAG, "FIFO mode enabled (ODR code 0x%02x)", odr);
+    return ESP_OK;
+}
+
+esp_err_t bmi270_fifo_stop(void)
+{
+    if (!fifo_enabled) {
+        return ESP_OK;
+    }
+
+    fifo_enabled = false;
+    esp_err_t ret = write_reg(BMI270_REG_FIFO_CONFIG_1, 0x00);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to disable FIFO");
+    }
+    return ret;
+}
+
+bool bmi270_fifo_is_enabled(void)
+{
+    return fifo_enabled;
+}
+
+static inline int16_t read_le16(const uint8_t *p)
+{
+    return (int16_t)((uint16_t)p[0] | ((uint16_t)p[1] << 8));
+}
+
+size_t bmi270_fifo_decode(const uint8_t *data, size_t len, bmi270_batch_t *batch)
+{
+    size_t pos = 0;
+    size_t n = batch->count;
+
+    while (pos < len && n < BMI270_FIFO_MAX_FRAMES) {
+        uint8_t header = data[pos++];
+        size_t remaining = len - pos;
+
+        if (header == FIFO_HDR_ACC_GYR) {
+            if (remaining < 12) break;
+            // Frame payload order is gyro then accel
+            batch->gx[n] = read_le16(&data[pos + 0]);
+            batch->gy[n] = read_le16(&data[pos + 2]);
+            batch->gz[n] = read_le16(&data[pos + 4]);
+            batch->ax[n] = read_le16(&data[pos + 6]);
+            batch->ay[n] = read_le16(&data[pos + 8]);
+            batch->az[n] = read_le16(&data[pos + 10]);
+            pos += 12;
+            n++;
+        } else if (header == FIFO_HDR_ACC || header == FIFO_HDR_GYR) {
+            // Partial frames only appear around ODR changes; drop them
+            if (remaining < 6) break;
+            pos += 6;
+        } else if (header == FIFO_HDR_SKIP || header == FIFO_HDR_DROP) {
+            if (remaining < 1) break;
+            batch->skipped_frames += data[pos];
+            pos += 1;
+        } else if (header == FIFO_HDR_SENSORTIME) {
+            if (remaining < 3) break;
+            pos += 3;
+        } else if (header == FIFO_HDR_CONFIG_CHANGE) {
+            if (remaining < 1) break;
+            pos += 1;
+        } else {
+            // FIFO_HDR_EMPTY or garbage: nothing more to decode
+            break;
+        }
+    }
+
+    size_t decoded = n - batch->count;
+    batch->count = n;
+    return decoded;
+}
+
+esp_err_t bmi270_fifo_read(bmi270_batch_t *batch)
+{
+    if (!batch) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!fifo_enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    batch->count = 0;
+    batch->skipped_frames = 0;
+    batch->accel_lsb_per_g = ACC_LSB_PER_G;
+    batch->gyro_lsb_per_dps = GYR_LSB_PER_DPS;
+
+    uint8_t len_buf[2];
+    esp_err_t ret = bus.read(bus.ctx, BMI270_REG_FIFO_LENGTH_0, len_buf, sizeof(len_buf));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    size_t fifo_len = ((size_t)(len_buf[1] & 0x3F) << 8) | len_buf[0];
+    if (fifo_len == 0) {
+        return ESP_OK;
+    }
+    if (fifo_len > sizeof(fifo_buffer)) {
+        fifo_len = sizeof(fifo_buffer);
+    }
+
+    // Drain everything in a single burst
+    ret = bus.read(bus.ctx, BMI270_REG_FIFO_DATA, fifo_buffer, fifo_len);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "FIFO burst read failed");
+        return ret;
+    }
+
+    bmi270_fifo_decode(fifo_buffer, fifo_len, batch);
+    return ESP_OK;
+}
+
+static int16_t to_raw(float value, float lsb_per_unit)
+{
+    float raw = roundf(value * lsb_per_unit);
+    if (raw > 32767.0f) return 32767;
+    if (raw < -32768.0f) return -32768;
+    return (int16_t)raw;
+}
+
+esp_err_t bmi270_read_batch(bmi270_batch_t *batch)
+{
+    if (!batch) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (fifo_enabled) {
+        return bmi270_fifo_read(batch);
+    }
+
+    float ax, ay, az, gx, gy, gz;
+    esp_err_t ret = bmi270_read_data(&ax, &ay, &az, &gx, &gy, &gz);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    batch->count = 1;
+    batch->skipped_frames = 0;
+    batch->accel_lsb_per_g = ACC_LSB_PER_G;
+    batch->gyro_lsb_per_dps = GYR_LSB_PER_DPS;
+    batch->ax[0] = to_raw(ax, ACC_LSB_PER_G);
+    batch->ay[0] = to_raw(ay, ACC_LSB_PER_G);
+    batch->az[0] = to_raw(az, ACC_LSB_PER_G);
+    batch->gx[0] = to_raw(gx, GYR_LSB_PER_DPS);
+    batch->gy[0] = to_raw(gy, GYR_LSB_PER_DPS);
+    batch->gz[0] = to_raw(gz, GYR_LSB_PER_DPS);
+    return ESP_OK;
+}
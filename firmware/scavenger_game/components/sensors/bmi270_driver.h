@@ -1,10 +1,58 @@
 #ifndef BMI270_DRIVER_H
 #define BMI270_DRIVER_H
 
+#include <stddef.h>
+#include "stdint.h"
+#include "stdbool.h"
 #include "esp_err.h"
 
+// Worst case number of accel+gyro frames in the 2 KB FIFO (13 bytes each)
+#define BMI270_FIFO_SIZE        2048
+#define BMI270_FIFO_MAX_FRAMES  (BMI270_FIFO_SIZE / 13 + 1)
+
+// Output data rates usable in FIFO mode (register encoding)
+typedef enum {
+    BMI270_ODR_100HZ  = 0x08,
+    BMI270_ODR_200HZ  = 0x09,
+    BMI270_ODR_400HZ  = 0x0A,
+    BMI270_ODR_800HZ  = 0x0B,
+    BMI270_ODR_1600HZ = 0x0C
+} bmi270_odr_t;
+
+// Register access, replaceable so the driver can run against another device model
+typedef struct {
+    esp_err_t (*read)(void *ctx, uint8_t reg, uint8_t *data, size_t len);
+    esp_err_t (*write)(void *ctx, uint8_t reg, const uint8_t *data, size_t len);
+    void *ctx;
+} bmi270_bus_t;
+
+// Decoded FIFO contents as raw sensor counts, one array per axis
+typedef struct {
+    size_t count;
+    uint32_t skipped_frames;        // Overflow/skip frames reported by the FIFO
+    float accel_lsb_per_g;
+    float gyro_lsb_per_dps;
+    int16_t ax[BMI270_FIFO_MAX_FRAMES];
+    int16_t ay[BMI270_FIFO_MAX_FRAMES];
+    int16_t az[BMI270_FIFO_MAX_FRAMES];
+    int16_t gx[BMI270_FIFO_MAX_FRAMES];
+    int16_t gy[BMI270_FIFO_MAX_FRAMES];
+    int16_t gz[BMI270_FIFO_MAX_FRAMES];
+} bmi270_batch_t;
+
 esp_err_t bmi270_init(void);
 esp_err_t bmi270_read_data(float *accel_x, float *accel_y, float *accel_z,
                           float *gyro_x, float *gyro_y, float *gyro_z);
 
-#endif // BMI270_DRIVER_H
\ No newline at end of file
+// FIFO acquisition mode
+void bmi270_set_bus(const bmi270_bus_t *bus);
+esp_err_t bmi270_fifo_start(bmi270_odr_t odr);
+esp_err_t bmi270_fifo_stop(void);
+bool bmi270_fifo_is_enabled(void);
+esp_err_t bmi270_fifo_read(bmi270_batch_t *batch);
+size_t bmi270_fifo_decode(const uint8_t *data, size_t len, bmi270_batch_t *batch);
+
+// Drains the FIFO when enabled, otherwise returns a single-frame batch
+esp_err_t bmi270_read_batch(bmi270_batch_t *batch);
+
+#endif // BMI270_DRIVER_H
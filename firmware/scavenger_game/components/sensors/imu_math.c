@@ -0,0 +1,128 @@
+#include "imu_math.h"
+#include <math.h>
+#include <stdbool.h>
+
+#define CORDIC_ITERATIONS 16
+
+// atan(2^-i) in Q16.16 degrees
+static const int32_t cordic_atan_q16[CORDIC_ITERATIONS] = {
+    2949120, 1740967, 919879, 466945, 234379, 117304, 58666, 29335,
+    14668, 7334, 3667, 1833, 917, 458, 229, 115
+};
+
+#define Q16_180_DEG (180 * IMU_Q16_ONE)
+
+uint32_t imu_q_isqrt(uint32_t value)
+{
+    uint32_t result = 0;
+    uint32_t bit = 1u << 30;
+
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (value >= result + bit) {
+            value -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return result;
+}
+
+int32_t imu_q_atan2(int32_t y, int32_t x)
+{
+    if (x == 0 && y == 0) {
+        return 0;
+    }
+
+    int64_t yy = y;
+    int64_t xx = x;
+    int32_t angle = 0;
+
+    // Fold the left half-plane onto the right one; CORDIC converges for |angle| < 99.9 deg
+    if (xx < 0) {
+        angle = (yy >= 0) ? Q16_180_DEG : -Q16_180_DEG;
+        xx = -xx;
+        yy = -yy;
+    }
+
+    // Normalize into [2^28, 2^29) so the CORDIC gain cannot overflow 32 bits
+    int64_t m = (xx > (yy < 0 ? -yy : yy)) ? xx : (yy < 0 ? -yy : yy);
+    while (m >= (1 << 29)) {
+        xx >>= 1;
+        yy >>= 1;
+        m >>= 1;
+    }
+    while (m < (1 << 28)) {
+        xx <<= 1;
+        yy <<= 1;
+        m <<= 1;
+    }
+
+    int32_t cx = (int32_t)xx;
+    int32_t cy = (int32_t)yy;
+    for (int i = 0; i < CORDIC_ITERATIONS; i++) {
+        int32_t nx;
+        if (cy > 0) {
+            nx = cx + (cy >> i);
+            cy = cy - (cx >> i);
+            angle += cordic_atan_q16[i];
+        } else {
+            nx = cx - (cy >> i);
+            cy = cy + (cx >> i);
+            angle -= cordic_atan_q16[i];
+        }
+        cx = nx;
+    }
+
+    if (angle > Q16_180_DEG) {
+        angle -= 2 * Q16_180_DEG;
+    } else if (angle <= -Q16_180_DEG) {
+        angle += 2 * Q16_180_DEG;
+    }
+    return angle;
+}
+
+// Once per scale change, so double precision keeps the comparison exact
+uint32_t imu_q_threshold_sq(float threshold, float lsb_per_unit)
+{
+    double raw = (double)threshold * lsb_per_unit;
+    double sq = raw * raw;
+    if (sq >= 4294967295.0) {
+        return UINT32_MAX;
+    }
+    return (uint32_t)sq;
+}
+
+static inline uint32_t mag_sq(int16_t x, int16_t y, int16_t z)
+{
+    return (uint32_t)((int32_t)x * x) + (uint32_t)((int32_t)y * y) + (uint32_t)((int32_t)z * z);
+}
+
+uint32_t imu_q_peak_mag_sq(const int16_t *ax, const int16_t *ay, const int16_t *az, size_t count)
+{
+    uint32_t peak = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t m = mag_sq(ax[i], ay[i], az[i]);
+        peak = (m > peak) ? m : peak;
+    }
+    return peak;
+}
+
+float imu_f_peak_mag_sq(const int16_t *ax, const int16_t *ay, const int16_t *az,
+                        size_t count, float lsb_per_unit)
+{
+    float scale = 1.0f / lsb_per_unit;
+    float peak = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        float x = ax[i] * scale;
+        float y = ay[i] * scale;
+        float z = az[i] * scale;
+        float m = x * x + y * y + z * z;
+        peak = (m > peak) ? m : peak;
+    }
+    return peak;
+}
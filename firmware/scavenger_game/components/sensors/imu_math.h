@@ -0,0 +1,28 @@
+#ifndef IMU_MATH_H
+#define IMU_MATH_H
+
+#include <stddef.h>
+#include "stdint.h"
+
+// Select the integer kernels for the sensor timer (0 = float reference path)
+#ifndef SENSOR_IMU_FIXED_POINT
+#define SENSOR_IMU_FIXED_POINT 1
+#endif
+
+// Angles are returned in Q16.16 degrees, range (-180, 180]
+#define IMU_Q16_ONE              65536
+#define IMU_Q16_TO_FLOAT(q)      ((float)(q) * (1.0f / IMU_Q16_ONE))
+#define IMU_FLOAT_TO_Q16(f)      ((int32_t)((f) * IMU_Q16_ONE))
+
+// Fixed-point kernels over raw int16 sample blocks (one array per axis)
+uint32_t imu_q_isqrt(uint32_t value);
+int32_t imu_q_atan2(int32_t y, int32_t x);
+// Squared threshold in raw counts: mag_sq > this exactly when magnitude > threshold
+uint32_t imu_q_threshold_sq(float threshold, float lsb_per_unit);
+uint32_t imu_q_peak_mag_sq(const int16_t *ax, const int16_t *ay, const int16_t *az, size_t count);
+
+// Float reference version
+float imu_f_peak_mag_sq(const int16_t *ax, const int16_t *ay, const int16_t *az,
+                        size_t count, float lsb_per_unit);
+
+#endif // IMU_MATH_H
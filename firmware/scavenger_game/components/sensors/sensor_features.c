@@ -0,0 +1,256 @@
+#include "sensor_features.h"
+#include <string.h>
+
+// Default windows: slow channels look back 6 s, VOC reacts within 1.5 s so
+// short smoke puffs are not averaged away. At the 10 Hz BME690 rate that is
+// 60 and 15 samples; at slower rates the windows hold fewer, never less
+// than two.
+static const sensor_window_config_t default_config[SENSOR_CH_MAX] = {
+    [SENSOR_CH_TEMPERATURE] = { .window_ms = 6000, .ema_tau_ms = 2000 },
+    [SENSOR_CH_HUMIDITY]    = { .window_ms = 6000, .ema_tau_ms = 2000 },
+    [SENSOR_CH_PRESSURE]    = { .window_ms = 6000, .ema_tau_ms = 2000 },
+    [SENSOR_CH_VOC]         = { .window_ms = 1500, .ema_tau_ms = 400 },
+};
+
+// Bounded retries for sensor_features_read when racing the writer
+#define READ_MAX_RETRIES 4
+
+_Static_assert(sizeof(sensor_features_t) % 4 == 0, "the shared copy is whole words");
+
+#define QUEUE_AT(q, head, i) ((q)[((head) + (i)) % SENSOR_FEATURE_MAX_WINDOW])
+#define SLOT(index)          ((index) % SENSOR_FEATURE_MAX_WINDOW)
+
+void sensor_stream_stats_init(sensor_stream_stats_t *stats, const sensor_window_config_t *config)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->window_ms = config->window_ms;
+    stats->slot_ms = config->window_ms / SENSOR_FEATURE_MAX_WINDOW;
+    stats->ema_tau_ms = config->ema_tau_ms;
+}
+
+static inline float value_at(const sensor_stream_stats_t *stats, uint32_t index)
+{
+    return stats->values[SLOT(index)];
+}
+
+static void evict_oldest(sensor_stream_stats_t *stats)
+{
+    uint32_t index = stats->pushed - stats->count;
+    double y = value_at(stats, index);
+    double t = stats->times_ms[SLOT(index)] - stats->origin_ms;
+    stats->sum -= y;
+    stats->sum_sq -= y * y;
+    stats->sum_t -= t;
+    stats->sum_tt -= t * t;
+    stats->sum_ty -= t * y;
+    stats->count--;
+
+    if (stats->min_len && QUEUE_AT(stats->min_q, stats->min_head, 0) == index) {
+        stats->min_head = (stats->min_head + 1) % SENSOR_FEATURE_MAX_WINDOW;
+        stats->min_len--;
+    }
+    if (stats->max_len && QUEUE_AT(stats->max_q, stats->max_head, 0) == index) {
+        stats->max_head = (stats->max_head + 1) % SENSOR_FEATURE_MAX_WINDOW;
+        stats->max_len--;
+    }
+}
+
+static void add_newest(sensor_stream_stats_t *stats, float y, uint32_t time_ms)
+{
+    uint32_t index = stats->pushed++;
+    double t = time_ms - stats->origin_ms;
+    stats->values[SLOT(index)] = y;
+    stats->times_ms[SLOT(index)] = time_ms;
+    stats->sum += y;
+    stats->sum_sq += (double)y * y;
+    stats->sum_t += t;
+    stats->sum_tt += t * t;
+    stats->sum_ty += t * y;
+    stats->count++;
+
+    while (stats->min_len && value_at(stats, QUEUE_AT(stats->min_q, stats->min_head, stats->min_len - 1)) >= y) {
+        stats->min_len--;
+    }
+    QUEUE_AT(stats->min_q, stats->min_head, stats->min_len) = index;
+    stats->min_len++;
+
+    while (stats->max_len && value_at(stats, QUEUE_AT(stats->max_q, stats->max_head, stats->max_len - 1)) <= y) {
+        stats->max_len--;
+    }
+    QUEUE_AT(stats->max_q, stats->max_head, stats->max_len) = index;
+    stats->max_len++;
+}
+
+// Moves the time origin to the oldest slot so the sums stay small
+static void rebase(sensor_stream_stats_t *stats)
+{
+    uint32_t oldest = stats->times_ms[SLOT(stats->pushed - stats->count)];
+    double c = oldest - stats->origin_ms;
+    double n = stats->count;
+    stats->sum_tt += c * (n * c - 2.0 * stats->sum_t);
+    stats->sum_ty -= c * stats->sum;
+    stats->sum_t -= n * c;
+    stats->origin_ms = oldest;
+}
+
+void sensor_stream_stats_push(sensor_stream_stats_t *stats, float value, uint32_t time_ms)
+{
+    if (stats->samples == 0) {
+        stats->offset = value;
+        stats->ema = value;
+        stats->origin_ms = time_ms;
+    } else {
+        // Same decay per unit of time whatever the sample spacing
+        float dt = (float)(time_ms - stats->last_ms);
+        float alpha = stats->ema_tau_ms ? dt / ((float)stats->ema_tau_ms + dt) : 1.0f;
+        stats->ema += alpha * (value - stats->ema);
+    }
+
+    // Kept as float so the value removed later matches the one added now
+    float y = value - stats->offset;
+    stats->last = y;
+    stats->last_ms = time_ms;
+    stats->samples++;
+
+    // A value too close to the newest slot only updates LAST and the EMA
+    if (stats->count == 0 || time_ms - stats->times_ms[SLOT(stats->pushed - 1)] >= stats->slot_ms) {
+        if (stats->count == SENSOR_FEATURE_MAX_WINDOW) {
+            evict_oldest(stats);
+        }
+        add_newest(stats, y, time_ms);
+    }
+
+    while (stats->count > 2 && time_ms - stats->times_ms[SLOT(stats->pushed - stats->count)] >= stats->window_ms) {
+        evict_oldest(stats);
+    }
+    rebase(stats);
+}
+
+void sensor_stream_stats_write(const sensor_stream_stats_t *stats, float *out)
+{
+    if (stats->count == 0) {
+        memset(out, 0, SENSOR_FEAT_PER_CHANNEL * sizeof(float));
+        return;
+    }
+
+    double n = stats->count;
+    double mean = stats->sum / n;
+    double variance = stats->sum_sq / n - mean * mean;
+    float oldest = value_at(stats, stats->pushed - stats->count);
+
+    double slope = 0.0;
+    double denom = n * stats->sum_tt - stats->sum_t * stats->sum_t;
+    if (stats->count > 1 && denom > 0.0) {
+        // Per ms over the slot times, reported per second
+        slope = (n * stats->sum_ty - stats->sum_t * stats->sum) / denom * 1000.0;
+    }
+
+    out[SENSOR_FEAT_LAST] = stats->last + stats->offset;
+    out[SENSOR_FEAT_MEAN] = (float)(mean + stats->offset);
+    out[SENSOR_FEAT_VARIANCE] = variance > 0.0 ? (float)variance : 0.0f;
+    out[SENSOR_FEAT_MIN] = value_at(stats, QUEUE_AT(stats->min_q, stats->min_head, 0)) + stats->offset;
+    out[SENSOR_FEAT_MAX] = value_at(stats, QUEUE_AT(stats->max_q, stats->max_head, 0)) + stats->offset;
+    out[SENSOR_FEAT_SLOPE] = (float)slope;
+    out[SENSOR_FEAT_EMA] = stats->ema;
+    out[SENSOR_FEAT_ROC] = stats->last - oldest;
+}
+
+// Copies the writer's vector to the shared one under the sequence lock
+static void publish(sensor_feature_engine_t *engine)
+{
+    uint32_t version = atomic_load_explicit(&engine->version, memory_order_relaxed);
+    atomic_store_explicit(&engine->version, version + 1u, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    uint32_t words[SENSOR_FEATURE_WORDS];
+    memcpy(words, &engine->latest, sizeof(words));
+    for (size_t i = 0; i < SENSOR_FEATURE_WORDS; i++) {
+        atomic_store_explicit(&engine->shared[i], words[i], memory_order_relaxed);
+    }
+
+    atomic_store_explicit(&engine->version, version + 2u, memory_order_release);
+}
+
+void sensor_features_init(sensor_feature_engine_t *engine, const sensor_window_config_t config[SENSOR_CH_MAX])
+{
+    if (!config) {
+        config = default_config;
+    }
+
+    for (int ch = 0; ch < SENSOR_CH_MAX; ch++) {
+        sensor_stream_stats_init(&engine->channels[ch], &config[ch]);
+    }
+    engine->origin_us = 0;
+    engine->last_us = 0;
+    memset(&engine->latest, 0, sizeof(engine->latest));
+    atomic_init(&engine->version, 0);
+    for (size_t i = 0; i < SENSOR_FEATURE_WORDS; i++) {
+        atomic_init(&engine->shared[i], 0);
+    }
+}
+
+// Empties the windows but keeps their configuration
+static void restart(sensor_feature_engine_t *engine)
+{
+    for (int ch = 0; ch < SENSOR_CH_MAX; ch++) {
+        sensor_stream_stats_t *stats = &engine->channels[ch];
+        const sensor_window_config_t config = { .window_ms = stats->window_ms, .ema_tau_ms = stats->ema_tau_ms };
+        sensor_stream_stats_init(stats, &config);
+    }
+}
+
+void sensor_features_reset(sensor_feature_engine_t *engine)
+{
+    restart(engine);
+    engine->origin_us = 0;
+    engine->last_us = 0;
+    memset(&engine->latest, 0, sizeof(engine->latest));
+    publish(engine);
+}
+
+void sensor_features_update(sensor_feature_engine_t *engine, const float values[SENSOR_CH_MAX], uint32_t seq,
+                            int64_t timestamp_us)
+{
+    sensor_features_t *next = &engine->latest;
+
+    if (engine->channels[0].samples == 0 || timestamp_us < engine->last_us) {
+        restart(engine);
+        engine->origin_us = timestamp_us;
+    }
+    engine->last_us = timestamp_us;
+    uint32_t time_ms = (uint32_t)((timestamp_us - engine->origin_us) / 1000);
+
+    for (int ch = 0; ch < SENSOR_CH_MAX; ch++) {
+        sensor_stream_stats_push(&engine->channels[ch], values[ch], time_ms);
+        sensor_stream_stats_write(&engine->channels[ch], &next->v[ch * SENSOR_FEAT_PER_CHANNEL]);
+    }
+    next->seq = seq;
+    next->samples = engine->channels[0].samples;
+
+    publish(engine);
+}
+
+const sensor_features_t *sensor_features_latest(sensor_feature_engine_t *engine)
+{
+    return engine->latest.samples ? &engine->latest : NULL;
+}
+
+bool sensor_features_read(sensor_feature_engine_t *engine, sensor_features_t *features)
+{
+    uint32_t words[SENSOR_FEATURE_WORDS];
+    for (int attempt = 0; attempt < READ_MAX_RETRIES; attempt++) {
+        uint32_t before = atomic_load_explicit(&engine->version, memory_order_acquire);
+        if (before & 1u) {
+            continue;
+        }
+        for (size_t i = 0; i < SENSOR_FEATURE_WORDS; i++) {
+            words[i] = atomic_load_explicit(&engine->shared[i], memory_order_relaxed);
+        }
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&engine->version, memory_order_relaxed) == before) {
+            memcpy(features, words, sizeof(*features));
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,115 @@
+#ifndef SENSOR_FEATURES_H
+#define SENSOR_FEATURES_H
+
+#include <stdatomic.h>
+#include "stdint.h"
+#include "stdbool.h"
+
+// Values a window holds. A window spans a time; values closer together than
+// window_ms / SENSOR_FEATURE_MAX_WINDOW share a slot, so any sample rate fits.
+#define SENSOR_FEATURE_MAX_WINDOW 64
+
+// BME690 channels tracked by the feature engine
+typedef enum {
+    SENSOR_CH_TEMPERATURE = 0,
+    SENSOR_CH_HUMIDITY,
+    SENSOR_CH_PRESSURE,
+    SENSOR_CH_VOC,
+    SENSOR_CH_MAX
+} sensor_channel_t;
+
+// Per-channel statistics, in this order, in the feature vector
+typedef enum {
+    SENSOR_FEAT_LAST = 0,       // Most recent value
+    SENSOR_FEAT_MEAN,
+    SENSOR_FEAT_VARIANCE,
+    SENSOR_FEAT_MIN,
+    SENSOR_FEAT_MAX,
+    SENSOR_FEAT_SLOPE,          // Least-squares slope over time, units per second
+    SENSOR_FEAT_EMA,
+    SENSOR_FEAT_ROC,            // Change from the oldest to the newest value in the window
+    SENSOR_FEAT_PER_CHANNEL
+} sensor_feature_t;
+
+#define SENSOR_FEATURE_COUNT (SENSOR_CH_MAX * SENSOR_FEAT_PER_CHANNEL)
+
+// Fixed-layout feature vector, channel-major
+typedef struct {
+    uint32_t seq;               // Sample the vector was computed from
+    uint32_t samples;           // Samples seen since init
+    float v[SENSOR_FEATURE_COUNT];
+} sensor_features_t;
+
+#define SENSOR_FEATURE(f, ch, feat) ((f)->v[(ch) * SENSOR_FEAT_PER_CHANNEL + (feat)])
+
+#define SENSOR_FEATURE_WORDS (sizeof(sensor_features_t) / 4)
+
+// Windows and the EMA are set in time, not samples, so features keep their
+// meaning when the scheduler changes the BME690 rate
+typedef struct {
+    uint32_t window_ms;         // Values older than this leave the window
+    uint32_t ema_tau_ms;        // EMA time constant; 0 follows the last value
+} sensor_window_config_t;
+
+// Incremental statistics over a sliding time window. Every update is O(1)
+// (amortized for min/max, which use monotonic queues). The window always
+// keeps the last two slots, so slope and change stay defined when samples
+// come further apart than the window.
+typedef struct {
+    uint32_t window_ms;
+    uint32_t slot_ms;           // Minimum spacing of the slots
+    uint32_t ema_tau_ms;
+    uint16_t count;
+    uint32_t pushed;            // Slots opened, also the index of the next one
+    uint32_t samples;           // Values pushed
+    uint32_t last_ms;
+    uint32_t origin_ms;         // Time of the oldest slot; times are kept relative to it
+    float last;                 // Newest value, relative to offset; may be between slots
+    float ema;
+    float offset;               // First value; sums are kept relative to it
+    double sum;
+    double sum_sq;
+    double sum_t;               // Times in ms since origin_ms
+    double sum_tt;
+    double sum_ty;
+    float values[SENSOR_FEATURE_MAX_WINDOW];
+    uint32_t times_ms[SENSOR_FEATURE_MAX_WINDOW];
+    uint32_t min_q[SENSOR_FEATURE_MAX_WINDOW];
+    uint32_t max_q[SENSOR_FEATURE_MAX_WINDOW];
+    uint16_t min_head, min_len;
+    uint16_t max_head, max_len;
+} sensor_stream_stats_t;
+
+// The writer's vector, and a copy for other tasks behind a sequence lock as
+// in sensor_ring.h: copied in and out a word at a time with relaxed atomics,
+// so a reader racing the writer retries instead of seeing a torn vector.
+typedef struct {
+    sensor_stream_stats_t channels[SENSOR_CH_MAX];
+    int64_t origin_us;          // Timestamp of the first update
+    int64_t last_us;
+    sensor_features_t latest;   // samples is 0 until the first update
+    atomic_uint_fast32_t version;   // Odd while shared is being written
+    _Atomic uint32_t shared[SENSOR_FEATURE_WORDS];
+} sensor_feature_engine_t;
+
+void sensor_stream_stats_init(sensor_stream_stats_t *stats, const sensor_window_config_t *config);
+// time_ms must not go backwards
+void sensor_stream_stats_push(sensor_stream_stats_t *stats, float value, uint32_t time_ms);
+void sensor_stream_stats_write(const sensor_stream_stats_t *stats, float *out);
+
+// config may be NULL for the defaults. Before any reader uses the engine.
+void sensor_features_init(sensor_feature_engine_t *engine, const sensor_window_config_t config[SENSOR_CH_MAX]);
+// Writer side, one task. Reset empties the windows and publishes "no vector
+// yet"; a timestamp older than the previous one restarts the windows.
+void sensor_features_reset(sensor_feature_engine_t *engine);
+void sensor_features_update(sensor_feature_engine_t *engine, const float values[SENSOR_CH_MAX], uint32_t seq,
+                            int64_t timestamp_us);
+// The writer's latest vector in place, NULL before the first update; valid
+// until its next update or reset. Only for the writer task.
+const sensor_features_t *sensor_features_latest(sensor_feature_engine_t *engine);
+
+// Any task: copy of the latest published vector (samples 0 before the first
+// update). False if the writer rewrote it during every attempt.
+bool sensor_features_read(sensor_feature_engine_t *engine, sensor_features_t *features);
+
+#endif // SENSOR_FEATURES_H
@@ -1,81 +1,596 @@
 #include "sensor_manager.h"
 #include "bme690_driver.h"
 #include "bmi270_driver.h"
+#include "sensor_ring.h"
+#include "imu_math.h"
+#include "sensor_scheduler.h"
+#include "voc_log.h"
+#include "voc_stream.h"
+#include "sensor_record.h"
+#include "voc_baseline.h"
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "nvs.h"
+#include <stdatomic.h>
 #include <math.h>
+#include <stdio.h>
 #include <string.h>
 
 static const char *TAG = "SENSOR_MANAGER";
 
+// Working copy filled by the sampling timer; readers only see published samples
 static sensor_data_t current_data = {0};
+static sensor_ring_t sample_ring;
+static sensor_ring_cursor_t consumer_cursors[SENSOR_CONSUMER_MAX];
+static sensor_feature_engine_t feature_engine;
+static EventGroupHandle_t trigger_events = NULL;
+static atomic_uint_fast32_t trigger_levels;
+static bmi270_batch_t imu_batch;
+static bool movement_detected = false;  // Peak of the last IMU batch above the movement threshold
+static sensor_scheduler_t scheduler;
+static uint32_t imu_period_applied = 0;
+static atomic_uint_fast32_t sensor_demand;
+static atomic_uint_fast32_t voc_burst_request_ms;
 static esp_timer_handle_t sensor_timer = NULL;
+static SemaphoreHandle_t pipeline_lock = NULL;  // Timer tick vs. replay, never taken by consumers
+static bool pipeline_ready = false;
+static bool replaying = false;
 static bool initialized = false;
 
-// Thresholds for environmental triggers
+#ifndef ESP_PLATFORM
+// Host build: once a tool takes the timer, ticks only come from
+// sensor_manager_host_tick() and the next one is noted instead of armed
+static bool host_timer_taken = false;
+static int64_t host_next_tick_us = 0;
+#endif
+
+// Clean-air VOC level, updated by the pipeline and published for readers as
+// float bits. The live tracker is parked while a replay learns its own.
+static voc_baseline_t voc_tracker;
+static voc_baseline_t live_voc_tracker;
+static atomic_uint_fast32_t voc_baseline_bits;
+// The timer decides when the baseline is worth saving and hands the value to
+// sensor_manager_service(), which does the NVS write and publishes what is
+// stored. voc_baseline_save_us is the timer's: the time of the last request.
+static atomic_uint_fast32_t voc_baseline_stored_bits;
+static atomic_uint_fast32_t voc_baseline_save_bits;
+static atomic_bool voc_baseline_save_pending;
+static int64_t voc_baseline_save_us = 0;
+
+// Trigger thresholds until quest_system_init() sets the quest table's
+// (sensor_manager_set_threshold)
 #define RAIN_HUMIDITY_THRESHOLD     85.0f
 #define COLD_TEMP_THRESHOLD         15.0f
+// VOC thresholds are at VOC_BASELINE_NOMINAL; readings are scaled by the
+// badge's own baseline before the comparison
 #define CIGARETTE_VOC_THRESHOLD     350   // Cigarette smoke
 #define HERBAL_VOC_THRESHOLD        600   // Herbal smoke (will be ML-enhanced)
 #define SMOKE_VOC_THRESHOLD         400   // Legacy threshold
 #define MOVEMENT_THRESHOLD          1.5f
 #define TILT_THRESHOLD              30.0f
+#define DARK_TEMP_DROP              2.0f    // Over the temperature feature window
+#define DARK_HUMIDITY_RISE          5.0f    // Over the humidity feature window
+
+// Triggers with a threshold, and the thresholds as float bits by event bit
+#define THRESHOLD_EVENTS            (SENSOR_EVENT_RAIN | SENSOR_EVENT_COLD | SENSOR_EVENT_CIGARETTE | \
+                                     SENSOR_EVENT_HERBAL | SENSOR_EVENT_MOVEMENT | SENSOR_EVENT_TILT)
+#define TRIGGER_EVENT_COUNT         7
+_Static_assert(SENSOR_EVENT_ALL == (1u << TRIGGER_EVENT_COUNT) - 1, "one threshold slot per trigger event");
+static atomic_uint_fast32_t trigger_thresholds[TRIGGER_EVENT_COUNT];
+
+// Suspected smoke, this share of the cigarette threshold, switches the
+// BME690 to burst rate for this long
+#define VOC_BURST_LEVEL             0.8f
+#define VOC_BURST_DURATION_MS       10000
+
+// The baseline survives reboots in NVS; rewritten at most hourly, and only
+// once it has moved noticeably, to spare the flash
+#define SENSOR_NVS_NAMESPACE        "sensors"
+#define VOC_BASELINE_KEY            "voc_baseline"
+#define VOC_BASELINE_SAVE_INTERVAL_S 3600
+#define VOC_BASELINE_SAVE_CHANGE    0.05f
 
-// Data logging for ML
-#define MAX_VOC_SAMPLES             1000
+// Shortest delay used when re-arming the one-shot sampling timer
+#define MIN_TIMER_DELAY_US          1000
+
+// Data logging for ML: delta-encoded columns, same RAM as the old 1000-sample array
+#define VOC_LOG_BUFFER_SIZE         48000
+
+// The logger consumer copies the samples of each logging session, [start,
+// stop) in ring sequence numbers, out of the ring in sensor_manager_service().
+// The timer asks for that every VOC_LOG_SERVICE_SAMPLES samples, well
+// before the ring laps the logger. Sessions the service has not finished
+// wait in a queue, so a short one is not lost and a new one does not cut
+// the tail off the last.
+#define VOC_LOG_SERVICE_SAMPLES     (SENSOR_RING_SIZE / 4)
+#define VOC_LOG_DRAIN_BATCH         8
+#define VOC_LOG_SESSIONS            4
+
+// Filled by start, stopped by stop, read by the service; stop_seq is valid
+// once stopped is set
 typedef struct {
-    uint32_t timestamp;
-    uint32_t voc_value;
-    float temperature;
-    float humidity;
+    uint32_t start_seq;
+    atomic_uint_fast32_t stop_seq;
+    atomic_bool stopped;
     char label[32];
-} voc_sample_t;
+} voc_log_session_t;
 
-static voc_sample_t voc_samples[MAX_VOC_SAMPLES];
-static uint32_t sample_count = 0;
-static bool logging_enabled = false;
-static char current_label[32] = {0};
+static uint8_t voc_log_buffer[VOC_LOG_BUFFER_SIZE];
+static voc_log_t voc_log;
+static atomic_bool logging_enabled;
+static voc_log_session_t log_sessions[VOC_LOG_SESSIONS];
+static atomic_uint_fast32_t log_sessions_started;
+static atomic_uint_fast32_t log_sessions_drained;
+static bool log_cursor_placed = false;  // At the start of the oldest undrained session (service only)
+// Samples lost or refused since the last export
+static atomic_uint_fast32_t log_dropped_ring;
+static atomic_uint_fast32_t log_dropped_full;
+static atomic_uint_fast32_t log_dropped_rewind;
 
-static void sensor_timer_callback(void* arg)
+// Snapshot of the latest published sample. Leaves data alone when there is
+// none yet or when the producer kept overwriting it while we copied.
+static esp_err_t latest_data(sensor_data_t *data)
 {
-    (void)arg;
+    sensor_sample_t sample;
+    if (atomic_load_explicit(&sample_ring.head, memory_order_acquire) == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (!sensor_ring_latest(&sample_ring, &sample)) {
+        return ESP_ERR_TIMEOUT;
+    }
+    *data = sample.data;
+    return ESP_OK;
+}
+
+static void store_threshold(uint32_t event, float threshold)
+{
+    uint32_t bits;
+    memcpy(&bits, &threshold, sizeof(bits));
+    atomic_store_explicit(&trigger_thresholds[__builtin_ctz(event)], bits, memory_order_relaxed);
+}
+
+static float trigger_threshold(uint32_t event)
+{
+    uint32_t bits = atomic_load_explicit(&trigger_thresholds[__builtin_ctz(event)], memory_order_relaxed);
+    float threshold;
+    memcpy(&threshold, &bits, sizeof(threshold));
+    return threshold;
+}
+
+// Evaluate every trigger condition once for a freshly published sample
+static uint32_t evaluate_triggers(const sensor_data_t *data, const sensor_features_t *features)
+{
+    uint32_t levels = 0;
     
-    // Read BME690 data
-    if (bme690_read_data(&current_data.temperature, &current_data.humidity, &current_data.pressure, &current_data.voc) == ESP_OK) {
-        ESP_LOGD(TAG, "BME690: T=%.1f°C, H=%.1f%%, P=%.1f hPa, VOC=%lu", 
-                 current_data.temperature, current_data.humidity, current_data.pressure, current_data.voc);
+    if (data->humidity > trigger_threshold(SENSOR_EVENT_RAIN)) {
+        levels |= SENSOR_EVENT_RAIN;
+    }
+    if (data->temperature < trigger_threshold(SENSOR_EVENT_COLD)) {
+        levels |= SENSOR_EVENT_COLD;
+    }
+    if (movement_detected) {
+        levels |= SENSOR_EVENT_MOVEMENT;
+    }
+    if (fabsf(data->tilt_angle) > trigger_threshold(SENSOR_EVENT_TILT)) {
+        levels |= SENSOR_EVENT_TILT;
+    }
+    
+    if (features) {
+        // Dark proxy: temp drop + humidity rise across the feature windows
+        float temp_drop = -SENSOR_FEATURE(features, SENSOR_CH_TEMPERATURE, SENSOR_FEAT_ROC);
+        float humidity_rise = SENSOR_FEATURE(features, SENSOR_CH_HUMIDITY, SENSOR_FEAT_ROC);
+        if (temp_drop > DARK_TEMP_DROP && humidity_rise > DARK_HUMIDITY_RISE) {
+            levels |= SENSOR_EVENT_DARK;
+        }
         
-        // Log VOC data if enabled
-        if (logging_enabled && sample_count < MAX_VOC_SAMPLES) {
-            voc_samples[sample_count].timestamp = esp_timer_get_time() / 1000; // ms
-            voc_samples[sample_count].voc_value = current_data.voc;
-            voc_samples[sample_count].temperature = current_data.temperature;
-            voc_samples[sample_count].humidity = current_data.humidity;
-            voc_samples[sample_count].label[0] = '\0';
-            strncat(voc_samples[sample_count].label, current_label, sizeof(voc_samples[sample_count].label) - 1);
-            sample_count++;
+        // VOC window mean so a single noisy reading does not trigger, relative
+        // to this sensor's baseline.
+        // Herbal is basic threshold detection for now, will be enhanced with ML model later
+        float voc = voc_baseline_compensate(voc_tracker.baseline,
+                                            SENSOR_FEATURE(features, SENSOR_CH_VOC, SENSOR_FEAT_MEAN));
+        float herbal = trigger_threshold(SENSOR_EVENT_HERBAL);
+        if (voc > trigger_threshold(SENSOR_EVENT_CIGARETTE) && voc < herbal) {
+            levels |= SENSOR_EVENT_CIGARETTE;
+        } else if (voc > herbal) {
+            levels |= SENSOR_EVENT_HERBAL;
         }
     }
     
-    // Read BMI270 data
-    if (bmi270_read_data(&current_data.accel_x, &current_data.accel_y, &current_data.accel_z,
-                        &current_data.gyro_x, &current_data.gyro_y, &current_data.gyro_z) == ESP_OK) {
-        
-        // Calculate movement magnitude
-        current_data.movement_magnitude = sqrt(
-            current_data.accel_x * current_data.accel_x +
-            current_data.accel_y * current_data.accel_y +
-            current_data.accel_z * current_data.accel_z
-        );
+    return levels;
+}
+
+// Highest FIFO rate whose frames for one IMU period fit in 3/4 of the FIFO
+static bmi270_odr_t fifo_odr_for_period(uint32_t period_ms)
+{
+    static const struct {
+        bmi270_odr_t odr;
+        uint32_t hz;
+    } rates[] = {
+        { BMI270_ODR_400HZ, 400 },
+        { BMI270_ODR_200HZ, 200 },
+        { BMI270_ODR_100HZ, 100 },
+    };
+    
+    for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+        if (rates[i].hz * period_ms / 1000 * 13 <= BMI270_FIFO_SIZE * 3 / 4) {
+            return rates[i].odr;
+        }
+    }
+    return BMI270_ODR_100HZ;
+}
+
+static void apply_imu_period(uint32_t period_ms)
+{
+    if (period_ms == imu_period_applied) {
+        return;
+    }
+    
+    imu_period_applied = period_ms;
+    if (bmi270_fifo_is_enabled() && bmi270_fifo_start(fifo_odr_for_period(period_ms)) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to change BMI270 FIFO rate");
+    }
+}
+
+static void schedule_next_tick(int64_t now_us)
+{
+    int64_t delay = sensor_scheduler_next_deadline(&scheduler, now_us) - esp_timer_get_time();
+    if (delay < MIN_TIMER_DELAY_US) {
+        delay = MIN_TIMER_DELAY_US;
+    }
+#ifndef ESP_PLATFORM
+    if (host_timer_taken) {
+        host_next_tick_us = esp_timer_get_time() + delay;
+        return;
+    }
+#endif
+    esp_timer_start_once(sensor_timer, (uint64_t)delay);
+}
+
+// Re-run the scheduler now so a higher rate takes effect without waiting
+// for a long idle period to expire
+static void kick_sensor_timer(void)
+{
+    if (!initialized || replaying) {
+        return;
+    }
+#ifndef ESP_PLATFORM
+    if (host_timer_taken) {
+        host_next_tick_us = esp_timer_get_time() + MIN_TIMER_DELAY_US;
+        return;
+    }
+#endif
+    esp_timer_stop(sensor_timer);
+    esp_timer_start_once(sensor_timer, MIN_TIMER_DELAY_US);
+}
+
+// Derive movement and tilt from the raw IMU batch
+static void process_imu_batch(void)
+{
+    size_t last = imu_batch.count - 1;
+    float accel_scale = 1.0f / imu_batch.accel_lsb_per_g;
+    float gyro_scale = 1.0f / imu_batch.gyro_lsb_per_dps;
+    
+    current_data.accel_x = imu_batch.ax[last] * accel_scale;
+    current_data.accel_y = imu_batch.ay[last] * accel_scale;
+    current_data.accel_z = imu_batch.az[last] * accel_scale;
+    current_data.gyro_x = imu_batch.gx[last] * gyro_scale;
+    current_data.gyro_y = imu_batch.gy[last] * gyro_scale;
+    current_data.gyro_z = imu_batch.gz[last] * gyro_scale;
+    
+    // Movement is the peak over the batch so short shakes between polls count.
+    // The trigger compares squared magnitudes; the one root per batch only
+    // fills the published movement_magnitude.
+    float threshold = trigger_threshold(SENSOR_EVENT_MOVEMENT);
+#if SENSOR_IMU_FIXED_POINT
+    static float threshold_lsb = 0.0f;
+    static float threshold_g = 0.0f;
+    static uint32_t threshold_sq = 0;
+    if (imu_batch.accel_lsb_per_g != threshold_lsb || threshold != threshold_g) {
+        threshold_lsb = imu_batch.accel_lsb_per_g;
+        threshold_g = threshold;
+        threshold_sq = imu_q_threshold_sq(threshold, threshold_lsb);
+    }
+    uint32_t peak_sq = imu_q_peak_mag_sq(imu_batch.ax, imu_batch.ay, imu_batch.az, imu_batch.count);
+    movement_detected = peak_sq > threshold_sq;
+    current_data.movement_magnitude = imu_q_isqrt(peak_sq) * accel_scale;
+    current_data.tilt_angle = IMU_Q16_TO_FLOAT(imu_q_atan2(imu_batch.ay[last], imu_batch.az[last]));
+#else
+    float peak_sq = imu_f_peak_mag_sq(imu_batch.ax, imu_batch.ay, imu_batch.az,
+                                      imu_batch.count, imu_batch.accel_lsb_per_g);
+    movement_detected = peak_sq > threshold * threshold;
+    current_data.movement_magnitude = sqrtf(peak_sq);
+    current_data.tilt_angle = atan2f(current_data.accel_y, current_data.accel_z) * 180.0f / (float)M_PI;
+#endif
+    
+    ESP_LOGD(TAG, "BMI270: %u frames, Movement=%.2f, Tilt=%.1f°", 
+             (unsigned)imu_batch.count, current_data.movement_magnitude, current_data.tilt_angle);
+}
+
+static void publish_voc_baseline(void)
+{
+    uint32_t bits;
+    memcpy(&bits, &voc_tracker.baseline, sizeof(bits));
+    atomic_store_explicit(&voc_baseline_bits, bits, memory_order_relaxed);
+}
+
+static void load_voc_baseline(void)
+{
+    nvs_handle_t handle;
+    float baseline = 0.0f;
+    size_t length = sizeof(baseline);
+    esp_err_t ret = nvs_open(SENSOR_NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (ret == ESP_OK) {
+        ret = nvs_get_blob(handle, VOC_BASELINE_KEY, &baseline, &length);
+        nvs_close(handle);
+    }
+    if (ret == ESP_OK && length == sizeof(baseline) && baseline > 0.0f) {
+        ESP_LOGI(TAG, "VOC baseline %.1f restored", baseline);
+    } else {
+        ESP_LOGI(TAG, "No stored VOC baseline, learning from scratch");
+        baseline = 0.0f;
+    }
+    voc_baseline_init(&voc_tracker, baseline);
+    uint32_t bits;
+    memcpy(&bits, &baseline, sizeof(bits));
+    atomic_store_explicit(&voc_baseline_stored_bits, bits, memory_order_relaxed);
+    publish_voc_baseline();
+}
+
+// Sampling timer: asks the service to store the baseline at most once an
+// hour, and only once it moved away from the stored value
+static void request_voc_baseline_save(int64_t now_us)
+{
+    float baseline = voc_tracker.baseline;
+    float stored;
+    uint32_t bits = atomic_load_explicit(&voc_baseline_stored_bits, memory_order_relaxed);
+    memcpy(&stored, &bits, sizeof(stored));
+    if (voc_tracker.warmup_ms > 0 ||
+        now_us - voc_baseline_save_us < (int64_t)VOC_BASELINE_SAVE_INTERVAL_S * 1000000 ||
+        fabsf(baseline - stored) <= stored * VOC_BASELINE_SAVE_CHANGE) {
+        return;
+    }
+    
+    // A failed write is retried with the next request, an hour later
+    voc_baseline_save_us = now_us;
+    memcpy(&bits, &baseline, sizeof(bits));
+    atomic_store_explicit(&voc_baseline_save_bits, bits, memory_order_relaxed);
+    atomic_store_explicit(&voc_baseline_save_pending, true, memory_order_release);
+    xEventGroupSetBits(trigger_events, SENSOR_EVENT_SERVICE);
+}
+
+// Service: the NVS write the timer asked for
+static void save_voc_baseline(void)
+{
+    if (!atomic_exchange_explicit(&voc_baseline_save_pending, false, memory_order_acquire)) {
+        return;
+    }
+    
+    uint32_t bits = atomic_load_explicit(&voc_baseline_save_bits, memory_order_relaxed);
+    float baseline;
+    memcpy(&baseline, &bits, sizeof(baseline));
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(SENSOR_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret == ESP_OK) {
+        ret = nvs_set_blob(handle, VOC_BASELINE_KEY, &baseline, sizeof(baseline));
+        if (ret == ESP_OK) {
+            ret = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to store VOC baseline: %s", esp_err_to_name(ret));
+        return;
+    }
+    atomic_store_explicit(&voc_baseline_stored_bits, bits, memory_order_relaxed);
+    ESP_LOGI(TAG, "VOC baseline %.1f stored", baseline);
+}
+
+// Everything after the sensor reads: shared by live sampling and replay so a
+// recording exercises exactly the code that runs on the badge.
+// Returns the rising trigger edges.
+static uint32_t process_readings(int64_t now_us, uint8_t sources)
+{
+    bool env_valid = sources & SENSOR_SOURCE_ENV;
+    
+    if (env_valid) {
+        ESP_LOGD(TAG, "BME690: T=%.1f°C, H=%.1f%%, P=%.1f hPa, VOC=%lu", 
+                 current_data.temperature, current_data.humidity, current_data.pressure, current_data.voc);
         
-        // Calculate tilt angle (simplified)
-        current_data.tilt_angle = atan2(current_data.accel_y, current_data.accel_z) * 180.0f / 3.14159f;
+        if (voc_stream_is_active()) {
+            voc_stream_push((uint32_t)(now_us / 1000), current_data.voc,
+                            current_data.temperature, current_data.humidity);
+        }
         
-        ESP_LOGD(TAG, "BMI270: Movement=%.2f, Tilt=%.1f°", 
-                 current_data.movement_magnitude, current_data.tilt_angle);
+        voc_baseline_update(&voc_tracker, (float)current_data.voc, now_us);
+        publish_voc_baseline();
+        if (!replaying) {
+            request_voc_baseline_save(now_us);
+        }
+    }
+    if (sources & SENSOR_SOURCE_IMU) {
+        process_imu_batch();
+    }
+    
+    // Publish without locking; consumers pick it up through their cursors
+    uint32_t seq = sensor_ring_publish(&sample_ring, &current_data, sources, now_us);
+    if (atomic_load_explicit(&logging_enabled, memory_order_relaxed) && seq % VOC_LOG_SERVICE_SAMPLES == 0) {
+        xEventGroupSetBits(trigger_events, SENSOR_EVENT_SERVICE);
+    }
+    
+    if (env_valid) {
+        const float env[SENSOR_CH_MAX] = {
+            [SENSOR_CH_TEMPERATURE] = current_data.temperature,
+            [SENSOR_CH_HUMIDITY] = current_data.humidity,
+            [SENSOR_CH_PRESSURE] = current_data.pressure,
+            [SENSOR_CH_VOC] = (float)current_data.voc,
+        };
+        sensor_features_update(&feature_engine, env, seq, now_us);
+    }
+    
+    // Wake consumers only on rising edges, never for an unchanged condition
+    uint32_t levels = evaluate_triggers(&current_data, sensor_features_latest(&feature_engine));
+    uint32_t previous = atomic_exchange_explicit(&trigger_levels, levels, memory_order_acq_rel);
+    uint32_t edges = levels & ~previous;
+    if (edges) {
+        xEventGroupSetBits(trigger_events, edges);
+    }
+    
+    // Feed activity back into the scheduler
+    if (levels & SENSOR_EVENT_MOVEMENT) {
+        sensor_scheduler_note_motion(&scheduler, now_us);
+    }
+    if (env_valid && voc_baseline_compensate(voc_tracker.baseline, (float)current_data.voc) >=
+                     trigger_threshold(SENSOR_EVENT_CIGARETTE) * VOC_BURST_LEVEL) {
+        sensor_scheduler_request_burst(&scheduler, now_us, VOC_BURST_DURATION_MS);
+    }
+    
+    return edges;
+}
+
+// One sampling tick; caller holds pipeline_lock
+static void sample_due_sensors(void)
+{
+    if (replaying) {
+        // Replay owns the pipeline; sensor_manager_end_replay re-arms the timer
+        return;
+    }
+    
+    int64_t now_us = esp_timer_get_time();
+    
+    // Apply requests from other tasks, then decide which sensors are due
+    sensor_scheduler_set_demand(&scheduler, atomic_load_explicit(&sensor_demand, memory_order_relaxed));
+    sensor_scheduler_set_continuous_burst(&scheduler, atomic_load_explicit(&logging_enabled, memory_order_relaxed) ||
+                                                      voc_stream_is_active());
+    uint32_t burst_ms = atomic_exchange_explicit(&voc_burst_request_ms, 0, memory_order_relaxed);
+    if (burst_ms) {
+        sensor_scheduler_request_burst(&scheduler, now_us, burst_ms);
+    }
+    uint32_t due = sensor_scheduler_due(&scheduler, now_us);
+    uint8_t sources = 0;
+    
+    // Read BME690 data
+    if ((due & SENSOR_SOURCE_ENV) &&
+        bme690_read_data(&current_data.temperature, &current_data.humidity, &current_data.pressure, &current_data.voc) == ESP_OK) {
+        sources |= SENSOR_SOURCE_ENV;
+        if (sensor_record_is_active()) {
+            sensor_record_env(now_us, current_data.temperature, current_data.humidity,
+                              current_data.pressure, current_data.voc);
+        }
+    }
+    
+    // Read BMI270 data (whole FIFO in FIFO mode, otherwise a single frame)
+    if (due & SENSOR_SOURCE_IMU) {
+        apply_imu_period(sensor_scheduler_imu_period_ms(&scheduler, now_us));
+    }
+    if ((due & SENSOR_SOURCE_IMU) &&
+        bmi270_read_batch(&imu_batch) == ESP_OK && imu_batch.count > 0) {
+        sources |= SENSOR_SOURCE_IMU;
+        if (sensor_record_is_active()) {
+            sensor_record_imu(now_us, &imu_batch);
+        }
+    }
+    
+    if (sources) {
+        process_readings(now_us, sources);
+    }
+    
+    schedule_next_tick(now_us);
+}
+
+static void sensor_timer_callback(void* arg)
+{
+    (void)arg;
+    // Never wait in the esp_timer task. The lock is only held elsewhere to
+    // start, feed or end a replay (which owns the pipeline and re-arms the
+    // timer when it ends) or for a host tool's tick, so the tick is skipped.
+    if (xSemaphoreTake(pipeline_lock, 0) != pdTRUE) {
+        return;
+    }
+    sample_due_sensors();
+    xSemaphoreGive(pipeline_lock);
+}
+
+#ifndef ESP_PLATFORM
+void sensor_manager_host_tick(bool all_due)
+{
+    if (!initialized) {
+        return;
+    }
+    xSemaphoreTake(pipeline_lock, portMAX_DELAY);
+    if (all_due) {
+        sensor_scheduler_init(&scheduler, NULL, esp_timer_get_time());
+    }
+    sample_due_sensors();
+    xSemaphoreGive(pipeline_lock);
+}
+
+void sensor_manager_host_take_timer(void)
+{
+    if (!initialized) {
+        return;
     }
+    // Under the lock a running tick either re-arms before the stop or sees the flag
+    xSemaphoreTake(pipeline_lock, portMAX_DELAY);
+    host_timer_taken = true;
+    host_next_tick_us = esp_timer_get_time();
+    esp_timer_stop(sensor_timer);
+    xSemaphoreGive(pipeline_lock);
+}
+
+int64_t sensor_manager_host_next_tick_us(void)
+{
+    return host_next_tick_us;
+}
+#endif
+
+// Sample ring, features and trigger events; no hardware involved
+static esp_err_t init_pipeline(void)
+{
+    if (pipeline_ready) {
+        return ESP_OK;
+    }
+    
+    sensor_ring_init(&sample_ring);
+    sensor_features_init(&feature_engine, NULL);
+    voc_log_init(&voc_log, voc_log_buffer, sizeof(voc_log_buffer));
+    atomic_init(&trigger_levels, 0);
+    atomic_init(&sensor_demand, 0);
+    atomic_init(&voc_burst_request_ms, 0);
+    voc_baseline_init(&voc_tracker, 0.0f);
+    atomic_init(&voc_baseline_bits, 0);
+    store_threshold(SENSOR_EVENT_RAIN, RAIN_HUMIDITY_THRESHOLD);
+    store_threshold(SENSOR_EVENT_COLD, COLD_TEMP_THRESHOLD);
+    store_threshold(SENSOR_EVENT_CIGARETTE, CIGARETTE_VOC_THRESHOLD);
+    store_threshold(SENSOR_EVENT_HERBAL, HERBAL_VOC_THRESHOLD);
+    store_threshold(SENSOR_EVENT_MOVEMENT, MOVEMENT_THRESHOLD);
+    store_threshold(SENSOR_EVENT_TILT, TILT_THRESHOLD);
+    atomic_init(&logging_enabled, false);
+    atomic_init(&log_sessions_started, 0);
+    atomic_init(&log_sessions_drained, 0);
+    atomic_init(&log_dropped_ring, 0);
+    atomic_init(&log_dropped_full, 0);
+    atomic_init(&log_dropped_rewind, 0);
+    for (int i = 0; i < VOC_LOG_SESSIONS; i++) {
+        atomic_init(&log_sessions[i].stop_seq, 0);
+        atomic_init(&log_sessions[i].stopped, false);
+    }
+    
+    pipeline_lock = xSemaphoreCreateMutex();
+    trigger_events = xEventGroupCreate();
+    if (!pipeline_lock || !trigger_events) {
+        ESP_LOGE(TAG, "Failed to create trigger event group");
+        return ESP_ERR_NO_MEM;
+    }
+    for (int i = 0; i < SENSOR_CONSUMER_MAX; i++) {
+        sensor_ring_cursor_init(&sample_ring, &consumer_cursors[i]);
+    }
+    
+    pipeline_ready = true;
+    return ESP_OK;
 }
 
 esp_err_t sensor_manager_init(void)
@@ -84,7 +599,13 @@ esp_err_t sensor_manager_init(void)
         return ESP_OK;
     }
     
-    esp_err_t ret = ESP_OK;
+    esp_err_t ret = init_pipeline();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    // Pick up this sensor's baseline from the last run
+    load_voc_baseline();
     
     // Initialize BME690
     ret = bme690_init();
@@ -100,7 +621,16 @@ esp_err_t sensor_manager_init(void)
         return ret;
     }
     
-    // Create timer for periodic sensor reading
+    // Rates adapt to active quests and activity, starting from the idle schedule
+    sensor_scheduler_init(&scheduler, NULL, esp_timer_get_time());
+    imu_period_applied = sensor_scheduler_imu_period_ms(&scheduler, esp_timer_get_time());
+    
+    // Prefer FIFO burst reads; fall back to one sample per tick if unavailable
+    if (bmi270_fifo_start(fifo_odr_for_period(imu_period_applied)) != ESP_OK) {
+        ESP_LOGW(TAG, "BMI270 FIFO unavailable, using single-sample reads");
+    }
+    
+    // One-shot timer, re-armed by each tick for the next scheduled sample
     esp_timer_create_args_t timer_args = {
         .callback = &sensor_timer_callback,
         .name = "sensor_timer"
@@ -112,8 +642,7 @@ esp_err_t sensor_manager_init(void)
         return ret;
     }
     
-    // Start timer (100ms interval)
-    ret = esp_timer_start_periodic(sensor_timer, 100000);
+    ret = esp_timer_start_once(sensor_timer, MIN_TIMER_DELAY_US);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to start sensor timer");
         return ret;
@@ -126,45 +655,120 @@ esp_err_t sensor_manager_init(void)
 
 esp_err_t sensor_manager_get_data(sensor_data_t *data)
 {
-    if (!initialized || !data) {
+    if (!pipeline_ready || !data) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    return latest_data(data);
+}
+
+size_t sensor_manager_read_samples(sensor_consumer_t consumer, sensor_sample_t *samples, size_t max_samples)
+{
+    if (!pipeline_ready || consumer >= SENSOR_CONSUMER_MAX || !samples) {
+        return 0;
+    }
+    
+    return sensor_ring_read(&sample_ring, &consumer_cursors[consumer], samples, max_samples);
+}
+
+uint32_t sensor_manager_get_dropped_samples(sensor_consumer_t consumer)
+{
+    if (consumer >= SENSOR_CONSUMER_MAX) {
+        return 0;
+    }
+    
+    return consumer_cursors[consumer].dropped;
+}
+
+esp_err_t sensor_manager_get_features(sensor_features_t *features)
+{
+    if (!pipeline_ready || !features) {
         return ESP_ERR_INVALID_STATE;
     }
+    if (!sensor_features_read(&feature_engine, features)) {
+        return ESP_ERR_TIMEOUT;
+    }
+    return features->samples ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+uint32_t sensor_manager_wait_events(uint32_t mask, uint32_t timeout_ms)
+{
+    if (!pipeline_ready || mask == 0) {
+        return 0;
+    }
     
-    *data = current_data;
+    TickType_t ticks = (timeout_ms == SENSOR_WAIT_FOREVER) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    EventBits_t bits = xEventGroupWaitBits(trigger_events, mask, pdTRUE, pdFALSE, ticks);
+    return bits & mask;
+}
+
+void sensor_manager_post_events(uint32_t events)
+{
+    if (pipeline_ready && events) {
+        xEventGroupSetBits(trigger_events, events);
+    }
+}
+
+void sensor_manager_clear_events(uint32_t events)
+{
+    if (pipeline_ready && events) {
+        xEventGroupClearBits(trigger_events, events);
+    }
+}
+
+void sensor_manager_set_demand(uint32_t events)
+{
+    uint32_t previous = atomic_exchange_explicit(&sensor_demand, events, memory_order_relaxed);
+    if (previous != events) {
+        kick_sensor_timer();
+    }
+}
+
+void sensor_manager_request_voc_burst(uint32_t duration_ms)
+{
+    atomic_store_explicit(&voc_burst_request_ms, duration_ms, memory_order_relaxed);
+    kick_sensor_timer();
+}
+
+uint32_t sensor_manager_get_trigger_state(void)
+{
+    return atomic_load_explicit(&trigger_levels, memory_order_acquire);
+}
+
+esp_err_t sensor_manager_set_threshold(uint32_t event, float threshold)
+{
+    if (!pipeline_ready) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (__builtin_popcount(event) != 1 || !(event & THRESHOLD_EVENTS) || !isfinite(threshold)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // The next sample is evaluated against it
+    store_threshold(event, threshold);
     return ESP_OK;
 }
 
+float sensor_manager_get_voc_baseline(void)
+{
+    uint32_t bits = atomic_load_explicit(&voc_baseline_bits, memory_order_relaxed);
+    float baseline;
+    memcpy(&baseline, &bits, sizeof(baseline));
+    return baseline;
+}
+
 bool sensor_manager_is_rain_detected(void)
 {
-    return current_data.humidity > RAIN_HUMIDITY_THRESHOLD;
+    return sensor_manager_get_trigger_state() & SENSOR_EVENT_RAIN;
 }
 
 bool sensor_manager_is_cold_detected(void)
 {
-    return current_data.temperature < COLD_TEMP_THRESHOLD;
+    return sensor_manager_get_trigger_state() & SENSOR_EVENT_COLD;
 }
 
 bool sensor_manager_is_dark_detected(void)
 {
-    // Proxy detection: temp drop + humidity rise
-    static float prev_temp = 0.0f;
-    static float prev_humidity = 0.0f;
-    static bool first_reading = true;
-    
-    if (first_reading) {
-        prev_temp = current_data.temperature;
-        prev_humidity = current_data.humidity;
-        first_reading = false;
-        return false;
-    }
-    
-    float temp_drop = prev_temp - current_data.temperature;
-    float humidity_rise = current_data.humidity - prev_humidity;
-    
-    prev_temp = current_data.temperature;
-    prev_humidity = current_data.humidity;
-    
-    return (temp_drop > 2.0f) && (humidity_rise > 5.0f);
+    return sensor_manager_get_trigger_state() & SENSOR_EVENT_DARK;
 }
 
 bool sensor_manager_is_smoke_detected(void)
@@ -175,58 +779,325 @@ bool sensor_manager_is_smoke_detected(void)
 
 bool sensor_manager_is_cigarette_detected(void)
 {
-    return current_data.voc > CIGARETTE_VOC_THRESHOLD && current_data.voc < HERBAL_VOC_THRESHOLD;
+    return sensor_manager_get_trigger_state() & SENSOR_EVENT_CIGARETTE;
 }
 
 bool sensor_manager_is_herbal_detected(void)
 {
-    // Basic threshold detection for now
-    // Will be enhanced with ML model later
-    return current_data.voc > HERBAL_VOC_THRESHOLD;
+    return sensor_manager_get_trigger_state() & SENSOR_EVENT_HERBAL;
 }
 
 bool sensor_manager_is_movement_detected(void)
 {
-    return current_data.movement_magnitude > MOVEMENT_THRESHOLD;
+    return sensor_manager_get_trigger_state() & SENSOR_EVENT_MOVEMENT;
 }
 
 bool sensor_manager_is_tilt_detected(void)
 {
-    return fabs(current_data.tilt_angle) > TILT_THRESHOLD;
+    return sensor_manager_get_trigger_state() & SENSOR_EVENT_TILT;
+}
+
+// Logger consumer: appends the environmental samples of one session to the
+// training log. Returns true once the session is stopped and copied.
+static bool drain_voc_log_session(voc_log_session_t* session, sensor_ring_cursor_t* cursor)
+{
+    uint32_t dropped = cursor->dropped;
+    uint32_t length = UINT32_MAX;
+    bool stopped;
+    sensor_sample_t samples[VOC_LOG_DRAIN_BATCH];
+    size_t count;
+    do {
+        count = sensor_ring_read(&sample_ring, cursor, samples, VOC_LOG_DRAIN_BATCH);
+        // Looked at after the read, so a stop that came first bounds it; the
+        // read may run into the next session, which starts over from its own
+        // start anyway
+        stopped = atomic_load_explicit(&session->stopped, memory_order_acquire);
+        if (stopped) {
+            length = atomic_load_explicit(&session->stop_seq, memory_order_relaxed) - session->start_seq;
+        }
+        for (size_t i = 0; i < count && samples[i].seq - session->start_seq < length; i++) {
+            const sensor_sample_t* sample = &samples[i];
+            if (!(sample->sources & SENSOR_SOURCE_ENV)) {
+                continue;
+            }
+            esp_err_t ret = voc_log_append(&voc_log, (uint32_t)(sample->timestamp_us / 1000), sample->data.voc,
+                                           sample->data.temperature, sample->data.humidity, session->label);
+            if (ret == ESP_ERR_NO_MEM &&
+                atomic_fetch_add_explicit(&log_dropped_full, 1, memory_order_relaxed) == 0) {
+                ESP_LOGW(TAG, "VOC log full after %lu samples, dropping until export", voc_log_count(&voc_log));
+            } else if (ret == ESP_ERR_INVALID_ARG &&
+                       atomic_fetch_add_explicit(&log_dropped_rewind, 1, memory_order_relaxed) == 0) {
+                // A replay publishes its recording's timestamps; the log only goes forward
+                ESP_LOGW(TAG, "VOC sample timestamps went backwards, dropping until they pass the log's last one");
+            }
+        }
+    } while (count == VOC_LOG_DRAIN_BATCH);
+    atomic_fetch_add_explicit(&log_dropped_ring, cursor->dropped - dropped, memory_order_relaxed);
+    
+    if (!stopped || cursor->next - session->start_seq < length) {
+        return false;
+    }
+    ESP_LOGI(TAG, "Stopped VOC logging (%s). Collected %lu samples (%u bytes), %lu lost in the ring, "
+             "%lu dropped with the log full, %lu out of order", session->label,
+             voc_log_count(&voc_log), (unsigned)voc_log_bytes_used(&voc_log),
+             (unsigned long)atomic_load_explicit(&log_dropped_ring, memory_order_relaxed),
+             (unsigned long)atomic_load_explicit(&log_dropped_full, memory_order_relaxed),
+             (unsigned long)atomic_load_explicit(&log_dropped_rewind, memory_order_relaxed));
+    return true;
+}
+
+// Sessions in the order they ran, each up to its stop before the next
+static void drain_voc_log(void)
+{
+    sensor_ring_cursor_t* cursor = &consumer_cursors[SENSOR_CONSUMER_LOGGER];
+    uint32_t drained = atomic_load_explicit(&log_sessions_drained, memory_order_relaxed);
+    
+    while (drained != atomic_load_explicit(&log_sessions_started, memory_order_acquire)) {
+        voc_log_session_t* session = &log_sessions[drained % VOC_LOG_SESSIONS];
+        if (!log_cursor_placed) {
+            cursor->next = session->start_seq;
+            log_cursor_placed = true;
+        }
+        if (!drain_voc_log_session(session, cursor)) {
+            return;
+        }
+        log_cursor_placed = false;
+        // Hands the slot back to sensor_manager_start_voc_logging()
+        atomic_store_explicit(&log_sessions_drained, ++drained, memory_order_release);
+    }
+}
+
+void sensor_manager_service(void)
+{
+    if (!pipeline_ready) {
+        return;
+    }
+    
+    drain_voc_log();
+    save_voc_baseline();
 }
 
-// Data collection functions for ML training
+// Data collection functions for ML training. Start and stop come from one
+// task; the session they fill is not the one the service may be reading.
 void sensor_manager_start_voc_logging(const char* label)
 {
-    if (!initialized || !label) return;
+    if (!pipeline_ready || !label || atomic_load_explicit(&logging_enabled, memory_order_relaxed)) return;
+    
+    uint32_t started = atomic_load_explicit(&log_sessions_started, memory_order_relaxed);
+    if (started - atomic_load_explicit(&log_sessions_drained, memory_order_acquire) == VOC_LOG_SESSIONS) {
+        ESP_LOGW(TAG, "VOC logging not started: %d stopped sessions still to copy", VOC_LOG_SESSIONS);
+        return;
+    }
+    voc_log_session_t* session = &log_sessions[started % VOC_LOG_SESSIONS];
+    session->label[0] = '\0';
+    strncat(session->label, label, sizeof(session->label) - 1);
+    session->start_seq = atomic_load_explicit(&sample_ring.head, memory_order_acquire);
+    atomic_store_explicit(&session->stopped, false, memory_order_relaxed);
+    atomic_store_explicit(&log_sessions_started, started + 1, memory_order_release);
+    atomic_store_explicit(&logging_enabled, true, memory_order_relaxed);
     
-    logging_enabled = true;
-    current_label[0] = '\0';
-    strncat(current_label, label, sizeof(current_label) - 1);
+    // Training data is collected at the VOC burst rate
+    kick_sensor_timer();
     
-    ESP_LOGI(TAG, "Started VOC logging with label: %s", current_label);
+    ESP_LOGI(TAG, "Started VOC logging with label: %s", session->label);
 }
 
 void sensor_manager_stop_voc_logging(void)
 {
-    logging_enabled = false;
-    ESP_LOGI(TAG, "Stopped VOC logging. Collected %lu samples", sample_count);
+    if (!pipeline_ready || !atomic_load_explicit(&logging_enabled, memory_order_relaxed)) return;
+    
+    uint32_t started = atomic_load_explicit(&log_sessions_started, memory_order_relaxed);
+    voc_log_session_t* session = &log_sessions[(started - 1) % VOC_LOG_SESSIONS];
+    atomic_store_explicit(&session->stop_seq, atomic_load_explicit(&sample_ring.head, memory_order_acquire),
+                          memory_order_relaxed);
+    atomic_store_explicit(&session->stopped, true, memory_order_release);
+    atomic_store_explicit(&logging_enabled, false, memory_order_relaxed);
+    // The last samples are still in the ring
+    xEventGroupSetBits(trigger_events, SENSOR_EVENT_SERVICE);
 }
 
 esp_err_t sensor_manager_export_voc_data(const char* filename)
 {
-    if (!filename || sample_count == 0) {
+    if (atomic_load_explicit(&logging_enabled, memory_order_relaxed) ||
+        atomic_load_explicit(&log_sessions_drained, memory_order_acquire) !=
+        atomic_load_explicit(&log_sessions_started, memory_order_relaxed)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!filename || voc_log_count(&voc_log) == 0) {
         return ESP_ERR_INVALID_ARG;
     }
     
-    // TODO: Implement actual file export to SD card
-    ESP_LOGI(TAG, "Exporting %lu VOC samples to %s", sample_count, filename);
+    FILE* f = fopen(filename, "w");
+    if (!f) {
+        ESP_LOGE(TAG, "Failed to create %s", filename);
+        return ESP_FAIL;
+    }
+    // Let stdio write whole allocation units
+    setvbuf(f, NULL, _IOFBF, VOC_STREAM_BLOCK_SIZE);
     
-    // For now, log the data format
-    ESP_LOGI(TAG, "CSV Format: timestamp,voc,temperature,humidity,label");
+    ESP_LOGI(TAG, "Exporting %lu VOC samples to %s", voc_log_count(&voc_log), filename);
+    
+    fprintf(f, "timestamp,voc,temperature,humidity,label\n");
+    voc_log_iter_t iter;
+    voc_log_sample_t sample;
+    voc_log_iter_init(&iter, &voc_log);
+    while (voc_log_iter_next(&iter, &sample)) {
+        fprintf(f, "%lu,%lu,%.2f,%.2f,%s\n", (unsigned long)sample.timestamp_ms, (unsigned long)sample.voc,
+                sample.temperature, sample.humidity, sample.label);
+    }
+    
+    if (fclose(f) != 0) {
+        ESP_LOGE(TAG, "Failed to write %s", filename);
+        return ESP_FAIL;
+    }
     
     // Reset sample buffer after export
-    sample_count = 0;
+    voc_log_reset(&voc_log);
+    atomic_store_explicit(&log_dropped_ring, 0, memory_order_relaxed);
+    atomic_store_explicit(&log_dropped_full, 0, memory_order_relaxed);
+    atomic_store_explicit(&log_dropped_rewind, 0, memory_order_relaxed);
+    
+    return ESP_OK;
+}
+
+esp_err_t sensor_manager_start_voc_stream(const char* filename, const char* label, bool csv)
+{
+    if (!initialized || !filename || !label) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    esp_err_t ret = voc_stream_start(filename, csv ? VOC_STREAM_FORMAT_CSV : VOC_STREAM_FORMAT_BINARY, label);
+    if (ret == ESP_OK) {
+        kick_sensor_timer();
+    }
+    return ret;
+}
+
+esp_err_t sensor_manager_stop_voc_stream(void)
+{
+    return voc_stream_stop();
+}
+
+void sensor_manager_get_voc_log_stats(sensor_voc_log_stats_t* stats)
+{
+    stats->samples = voc_log_count(&voc_log);
+    stats->bytes = voc_log_bytes_used(&voc_log);
+    stats->dropped_ring = atomic_load_explicit(&log_dropped_ring, memory_order_relaxed);
+    stats->dropped_full = atomic_load_explicit(&log_dropped_full, memory_order_relaxed);
+    stats->dropped_rewind = atomic_load_explicit(&log_dropped_rewind, memory_order_relaxed);
+}
+
+void sensor_manager_get_voc_stream_stats(voc_stream_stats_t* stats)
+{
+    voc_stream_get_stats(stats);
+}
+
+esp_err_t sensor_manager_start_recording(const char* filename)
+{
+    if (!filename) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    return sensor_record_start(filename);
+}
+
+esp_err_t sensor_manager_stop_recording(void)
+{
+    return sensor_record_stop();
+}
+
+// Features and trigger levels restart so replay results do not depend on
+// whatever was sampled live before. Consumers keep their ring cursors.
+static void reset_pipeline_state(void)
+{
+    sensor_features_reset(&feature_engine);
+    voc_baseline_init(&voc_tracker, 0.0f);
+    publish_voc_baseline();
+    atomic_store_explicit(&trigger_levels, 0, memory_order_release);
+    xEventGroupClearBits(trigger_events, SENSOR_EVENT_ALL);
+    memset(&current_data, 0, sizeof(current_data));
+    movement_detected = false;
+}
+
+esp_err_t sensor_manager_begin_replay(void)
+{
+    // Replay works without the sensors, e.g. in the host build
+    esp_err_t ret = init_pipeline();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    xSemaphoreTake(pipeline_lock, portMAX_DELAY);
+    if (replaying) {
+        xSemaphoreGive(pipeline_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    replaying = true;
+    if (sensor_timer) {
+        esp_timer_stop(sensor_timer);
+    }
+    live_voc_tracker = voc_tracker;
+    reset_pipeline_state();
+    sensor_scheduler_init(&scheduler, NULL, 0);
+    xSemaphoreGive(pipeline_lock);
+    
+    ESP_LOGI(TAG, "Replay started, live sampling paused");
+    return ESP_OK;
+}
+
+esp_err_t sensor_manager_replay_tick(int64_t timestamp_us, const sensor_data_t* env,
+                                     const bmi270_batch_t* imu, sensor_sample_t* sample, uint32_t* edges)
+{
+    if (!replaying || (!env && !imu)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (imu && (imu->count == 0 || imu->count > BMI270_FIFO_MAX_FRAMES)) {
+        return ESP_ERR_INVALID_ARG;
+    }
     
+    xSemaphoreTake(pipeline_lock, portMAX_DELAY);
+    uint8_t sources = 0;
+    if (env) {
+        current_data.temperature = env->temperature;
+        current_data.humidity = env->humidity;
+        current_data.pressure = env->pressure;
+        current_data.voc = env->voc;
+        sources |= SENSOR_SOURCE_ENV;
+    }
+    if (imu) {
+        imu_batch = *imu;
+        sources |= SENSOR_SOURCE_IMU;
+    }
+    
+    uint32_t new_edges = process_readings(timestamp_us, sources);
+    if (sample) {
+        sensor_ring_latest(&sample_ring, sample);
+    }
+    if (edges) {
+        *edges = new_edges;
+    }
+    xSemaphoreGive(pipeline_lock);
     return ESP_OK;
-}
\ No newline at end of file
+}
+
+void sensor_manager_end_replay(void)
+{
+    if (!pipeline_ready) {
+        return;
+    }
+    
+    xSemaphoreTake(pipeline_lock, portMAX_DELAY);
+    if (!replaying) {
+        xSemaphoreGive(pipeline_lock);
+        return;
+    }
+    reset_pipeline_state();
+    voc_tracker = live_voc_tracker;
+    publish_voc_baseline();
+    sensor_scheduler_init(&scheduler, NULL, esp_timer_get_time());
+    replaying = false;
+    xSemaphoreGive(pipeline_lock);
+    
+    kick_sensor_timer();
+    ESP_LOGI(TAG, "Replay finished, live sampling resumed");
+}
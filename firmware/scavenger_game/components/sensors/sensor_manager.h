@@ -2,7 +2,12 @@
 #define SENSOR_MANAGER_H
 
 #include "stdint.h"
+#include "stdbool.h"
+#include <stddef.h>
 #include "esp_err.h"
+#include "sensor_features.h"
+#include "voc_stream.h"
+#include "bmi270_driver.h"
 
 typedef struct {
     float temperature;
@@ -19,8 +24,87 @@ typedef struct {
     float movement_magnitude;
 } sensor_data_t;
 
+// Sensors refreshed in a sample; fields of the other sensor carry their last value
+#define SENSOR_SOURCE_IMU       (1u << 0)
+#define SENSOR_SOURCE_ENV       (1u << 1)
+
+// Timestamped, sequence-numbered sample as published by the sampling timer
+typedef struct {
+    uint32_t seq;
+    uint8_t sources;
+    int64_t timestamp_us;
+    sensor_data_t data;
+} sensor_sample_t;
+
+// Independent readers of the sample stream, each with its own ring cursor
+typedef enum {
+    SENSOR_CONSUMER_QUEST = 0,
+    SENSOR_CONSUMER_ML,
+    SENSOR_CONSUMER_DEBUG,
+    SENSOR_CONSUMER_LOGGER,
+    SENSOR_CONSUMER_MAX
+} sensor_consumer_t;
+
+// Training log (sensor_manager_start_voc_logging) contents and losses
+typedef struct {
+    uint32_t samples;
+    size_t bytes;                   // Encoded column bytes
+    uint32_t dropped_ring;          // Overwritten before the logger copied them
+    uint32_t dropped_full;          // Buffer, label dictionary or run table full
+    uint32_t dropped_rewind;        // Timestamp before the last logged one, e.g. after a replay
+} sensor_voc_log_stats_t;
+
+// Trigger events, one bit per condition. Set on the sample where the condition
+// becomes true; sensor_manager_get_trigger_state() returns the current levels.
+#define SENSOR_EVENT_RAIN       (1u << 0)
+#define SENSOR_EVENT_COLD       (1u << 1)
+#define SENSOR_EVENT_DARK       (1u << 2)
+#define SENSOR_EVENT_CIGARETTE  (1u << 3)
+#define SENSOR_EVENT_HERBAL     (1u << 4)
+#define SENSOR_EVENT_MOVEMENT   (1u << 5)
+#define SENSOR_EVENT_TILT       (1u << 6)
+#define SENSOR_EVENT_ALL        0x7Fu
+#define SENSOR_EVENT_SERVICE    (1u << 22)  // Posted by the sampling timer: call sensor_manager_service()
+#define SENSOR_EVENT_WAKE       (1u << 23)  // Posted by consumers to interrupt a wait
+
+#define SENSOR_WAIT_FOREVER     UINT32_MAX
+
 esp_err_t sensor_manager_init(void);
+// Latest published sample; ESP_ERR_NOT_FOUND before the first one and
+// ESP_ERR_TIMEOUT if the sampling timer kept overwriting it, data untouched
 esp_err_t sensor_manager_get_data(sensor_data_t *data);
+
+// Batch read of samples not yet seen by this consumer. Returns the number copied.
+size_t sensor_manager_read_samples(sensor_consumer_t consumer, sensor_sample_t *samples, size_t max_samples);
+uint32_t sensor_manager_get_dropped_samples(sensor_consumer_t consumer);
+
+// Copy of the rolling BME690 features, updated once per sample;
+// ESP_ERR_NOT_FOUND before the first one and ESP_ERR_TIMEOUT if the
+// sampling timer kept rewriting them, as for sensor_manager_get_data()
+esp_err_t sensor_manager_get_features(sensor_features_t *features);
+
+// Blocks until any event in mask fires; returns (and clears) the events that fired
+uint32_t sensor_manager_wait_events(uint32_t mask, uint32_t timeout_ms);
+void sensor_manager_post_events(uint32_t events);
+void sensor_manager_clear_events(uint32_t events);
+uint32_t sensor_manager_get_trigger_state(void);
+// Threshold of one trigger event: %RH above which it rains, degC below which
+// it is cold, VOC at VOC_BASELINE_NOMINAL for cigarette and herbal smoke (the
+// cigarette band ends at the herbal threshold), g of movement, degrees of
+// tilt. quest_system_init() sets them from the quest table; the defaults in
+// sensor_manager.c apply until then. ESP_ERR_INVALID_ARG for an event
+// without a threshold (dark).
+esp_err_t sensor_manager_set_threshold(uint32_t event, float threshold);
+
+// Sampling rate control: SENSOR_EVENT_* bits the active quests depend on,
+// and a temporary high-rate VOC burst (e.g. while classifying smoke)
+void sensor_manager_set_demand(uint32_t events);
+void sensor_manager_request_voc_burst(uint32_t duration_ms);
+
+// This sensor's clean-air VOC level (voc_baseline.h), learned continuously
+// and kept in NVS across reboots; 0 until the first reading
+float sensor_manager_get_voc_baseline(void);
+
 bool sensor_manager_is_rain_detected(void);
 bool sensor_manager_is_cold_detected(void);
 bool sensor_manager_is_dark_detected(void);
@@ -30,9 +114,50 @@ bool sensor_manager_is_herbal_detected(void);
 bool sensor_manager_is_movement_detected(void);
 bool sensor_manager_is_tilt_detected(void);
 
-// Data collection for ML training
+// Work the sampling timer hands off to a task: copies the training log out of
+// the sample ring (logger consumer) and stores the VOC baseline in NVS. Call
+// from the quest task, at the latest when SENSOR_EVENT_SERVICE fires.
+void sensor_manager_service(void);
+
+// Data collection for ML training. Samples reach the log through
+// sensor_manager_service(), which may run after the session has stopped or
+// another has started; export fails with ESP_ERR_INVALID_STATE until it has
+// caught up with the last stop. Start and stop from one task.
 void sensor_manager_start_voc_logging(const char* label);
 void sensor_manager_stop_voc_logging(void);
 esp_err_t sensor_manager_export_voc_data(const char* filename);
+// Log contents and the samples lost on the way since the last export
+void sensor_manager_get_voc_log_stats(sensor_voc_log_stats_t* stats);
+
+// Continuous capture straight to SD card (storage_manager_mount_sd first).
+// Runs the BME690 at the burst rate until stopped.
+esp_err_t sensor_manager_start_voc_stream(const char* filename, const char* label, bool csv);
+esp_err_t sensor_manager_stop_voc_stream(void);
+void sensor_manager_get_voc_stream_stats(voc_stream_stats_t* stats);
+
+// Record raw driver output (sensor_record.h format) alongside live sampling
+esp_err_t sensor_manager_start_recording(const char* filename);
+esp_err_t sensor_manager_stop_recording(void);
+
+// Replay: pauses live sampling and feeds recorded readings through the same
+// trigger pipeline. Works without sensor_manager_init (host build).
+// Only the environmental fields of env are used; either env or imu may be NULL.
+esp_err_t sensor_manager_begin_replay(void);
+esp_err_t sensor_manager_replay_tick(int64_t timestamp_us, const sensor_data_t* env,
+                                     const bmi270_batch_t* imu, sensor_sample_t* sample, uint32_t* edges);
+void sensor_manager_end_replay(void);
+
+#ifndef ESP_PLATFORM
+// Host build only: runs the sampling timer callback once, synchronously.
+// all_due makes every sensor due (benchmarks); otherwise the scheduler
+// decides at the current esp_timer time.
+void sensor_manager_host_tick(bool all_due);
+// Host build only: stops the sampling timer for good, so only
+// sensor_manager_host_tick() samples. Drive it on a simulated clock by
+// advancing esp_timer to sensor_manager_host_next_tick_us() before each tick.
+void sensor_manager_host_take_timer(void);
+// When the sampling timer would fire next, in esp_timer time
+int64_t sensor_manager_host_next_tick_us(void);
+#endif
 
 #endif // SENSOR_MANAGER_H
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "sensor_record.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <string.h>
+
+static const char *TAG = "SENSOR_RECORD";
+
+static block_writer_t writer;
+static atomic_bool writer_ready;     // Read by the sampling timer
+
+// Scratch space for one IMU entry; only the sampling timer writes entries
+static uint8_t entry_buffer[SENSOR_RECORD_MAX_ENTRY];
+
+esp_err_t sensor_record_start(const char *path)
+{
+    if (!path) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!atomic_load(&writer_ready)) {
+        esp_err_t ret = block_writer_init(&writer, "sensor_record");
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        atomic_store(&writer_ready, true);
+    }
+
+    sensor_record_header_t header = {
+        .magic = SENSOR_RECORD_MAGIC,
+        .version = SENSOR_RECORD_VERSION,
+        .start_us = esp_timer_get_time(),
+    };
+    esp_err_t ret = block_writer_open(&writer, path, &header, sizeof(header));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "Recording sensor data to %s", path);
+    return ESP_OK;
+}
+
+esp_err_t sensor_record_stop(void)
+{
+    if (!atomic_load(&writer_ready)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t ret = block_writer_close(&writer);
+    if (ret == ESP_ERR_INVALID_STATE) {
+        return ret;
+    }
+
+    block_writer_stats_t stats;
+    block_writer_get_stats(&writer, &stats);
+    ESP_LOGI(TAG, "Recording closed: %lu entries, %lu dropped, %lu write errors",
+             stats.records_written, stats.records_dropped, stats.write_errors);
+    return ret;
+}
+
+bool sensor_record_is_active(void)
+{
+    return atomic_load(&writer_ready) && block_writer_is_open(&writer);
+}
+
+esp_err_t sensor_record_env(int64_t timestamp_us, float temperature, float humidity, float pressure, uint32_t voc)
+{
+    if (!sensor_record_is_active()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    struct __attribute__((packed)) {
+        sensor_record_entry_t entry;
+        sensor_record_env_t env;
+    } record = {
+        .entry = {
+            .type = SENSOR_RECORD_ENV,
+            .length = sizeof(sensor_record_env_t),
+            .timestamp_us = timestamp_us,
+        },
+        .env = {
+            .temperature = temperature,
+            .humidity = humidity,
+            .pressure = pressure,
+            .voc = voc,
+        },
+    };
+    return block_writer_append(&writer, &record, sizeof(record));
+}
+
+esp_err_t sensor_record_imu(int64_t timestamp_us, const bmi270_batch_t *batch)
+{
+    if (!batch || batch->count == 0 || batch->count > BMI270_FIFO_MAX_FRAMES) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!sensor_record_is_active()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    size_t axis_bytes = batch->count * sizeof(int16_t);
+    sensor_record_entry_t entry = {
+        .type = SENSOR_RECORD_IMU,
+        .length = (uint16_t)(sizeof(sensor_record_imu_t) + SENSOR_RECORD_IMU_AXES * axis_bytes),
+        .timestamp_us = timestamp_us,
+    };
+    sensor_record_imu_t imu = {
+        .count = (uint16_t)batch->count,
+        .skipped_frames = batch->skipped_frames,
+        .accel_lsb_per_g = batch->accel_lsb_per_g,
+        .gyro_lsb_per_dps = batch->gyro_lsb_per_dps,
+    };
+    const int16_t *axes[SENSOR_RECORD_IMU_AXES] = {
+        batch->ax, batch->ay, batch->az, batch->gx, batch->gy, batch->gz
+    };
+
+    uint8_t *p = entry_buffer;
+    memcpy(p, &entry, sizeof(entry));
+    p += sizeof(entry);
+    memcpy(p, &imu, sizeof(imu));
+    p += sizeof(imu);
+    for (int axis = 0; axis < SENSOR_RECORD_IMU_AXES; axis++) {
+        memcpy(p, axes[axis], axis_bytes);
+        p += axis_bytes;
+    }
+
+    return block_writer_append(&writer, entry_buffer, (size_t)(p - entry_buffer));
+}
+
+void sensor_record_get_stats(block_writer_stats_t *stats)
+{
+    block_writer_get_stats(atomic_load(&writer_ready) ? &writer : NULL, stats);
+}
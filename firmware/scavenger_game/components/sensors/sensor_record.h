@@ -0,0 +1,73 @@
+#ifndef SENSOR_RECORD_H
+#define SENSOR_RECORD_H
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "esp_err.h"
+#include "bmi270_driver.h"
+#include "block_writer.h"
+
+// Raw sensor recording: exactly what the drivers returned, with the sampling
+// timestamp, so sensor_replay can feed it back through the trigger pipeline.
+//
+// File layout (little endian): sensor_record_header_t, then entries. Each entry
+// is a sensor_record_entry_t followed by `length` payload bytes:
+//  - ENV: sensor_record_env_t
+//  - IMU: sensor_record_imu_t, then count int16 values for each axis in
+//         ax, ay, az, gx, gy, gz order (raw counts, as in bmi270_batch_t)
+// An ENV and an IMU entry with the same timestamp came from the same tick.
+#define SENSOR_RECORD_MAGIC         0x31525353  // "SSR1"
+#define SENSOR_RECORD_VERSION       1
+
+typedef enum {
+    SENSOR_RECORD_ENV = 1,
+    SENSOR_RECORD_IMU = 2
+} sensor_record_type_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    int64_t start_us;               // esp_timer time when recording started
+    uint8_t reserved2[16];
+} sensor_record_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t type;
+    uint8_t reserved;
+    uint16_t length;
+    int64_t timestamp_us;
+} sensor_record_entry_t;
+
+typedef struct __attribute__((packed)) {
+    float temperature;
+    float humidity;
+    float pressure;
+    uint32_t voc;
+} sensor_record_env_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t count;
+    uint16_t reserved;
+    uint32_t skipped_frames;
+    float accel_lsb_per_g;
+    float gyro_lsb_per_dps;
+} sensor_record_imu_t;
+
+#define SENSOR_RECORD_IMU_AXES      6
+#define SENSOR_RECORD_MAX_ENTRY     (sizeof(sensor_record_entry_t) + sizeof(sensor_record_imu_t) + \
+                                     SENSOR_RECORD_IMU_AXES * BMI270_FIFO_MAX_FRAMES * sizeof(int16_t))
+
+// Creates path (truncating it). The SD card must be mounted on the badge.
+esp_err_t sensor_record_start(const char *path);
+esp_err_t sensor_record_stop(void);
+bool sensor_record_is_active(void);
+
+// Called from the sampling timer only. Never blocks on the card;
+// ESP_ERR_NO_MEM means the entry was dropped.
+esp_err_t sensor_record_env(int64_t timestamp_us, float temperature, float humidity, float pressure, uint32_t voc);
+esp_err_t sensor_record_imu(int64_t timestamp_us, const bmi270_batch_t *batch);
+
+void sensor_record_get_stats(block_writer_stats_t *stats);
+
+#endif // SENSOR_RECORD_H
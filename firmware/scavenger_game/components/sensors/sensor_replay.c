@@ -0,0 +1,190 @@
+#include "sensor_replay.h"
+#include "sensor_record.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "SENSOR_REPLAY";
+
+// Readings of one recorded tick, collected until the timestamp changes
+typedef struct {
+    int64_t timestamp_us;
+    bool has_env;
+    bool has_imu;
+    sensor_data_t env;
+    bmi270_batch_t imu;
+} replay_tick_t;
+
+static replay_tick_t pending;
+static uint8_t payload[SENSOR_RECORD_MAX_ENTRY];
+
+static void wait_until(int64_t target_us)
+{
+    for (;;) {
+        int64_t remaining = target_us - esp_timer_get_time();
+        if (remaining <= 0) {
+            return;
+        }
+        TickType_t ticks = pdMS_TO_TICKS(remaining / 1000);
+        vTaskDelay(ticks > 0 ? ticks : 1);
+    }
+}
+
+static void flush_tick(sensor_replay_speed_t speed, int64_t wall_start_us, int64_t first_us,
+                       sensor_replay_hook_t hook, void *ctx, sensor_replay_stats_t *stats)
+{
+    if (!pending.has_env && !pending.has_imu) {
+        return;
+    }
+
+    if (speed == SENSOR_REPLAY_REALTIME) {
+        wait_until(wall_start_us + (pending.timestamp_us - first_us));
+    }
+
+    sensor_sample_t sample;
+    uint32_t edges = 0;
+    if (sensor_manager_replay_tick(pending.timestamp_us, pending.has_env ? &pending.env : NULL,
+                                   pending.has_imu ? &pending.imu : NULL, &sample, &edges) == ESP_OK) {
+        stats->ticks++;
+        for (int bit = 0; bit < SENSOR_REPLAY_EVENT_BITS; bit++) {
+            if (edges & (1u << bit)) {
+                stats->trigger_edges[bit]++;
+            }
+        }
+        if (hook) {
+            hook(&sample, edges, ctx);
+        }
+    }
+
+    pending.has_env = false;
+    pending.has_imu = false;
+}
+
+static bool decode_env(const uint8_t *data, size_t len)
+{
+    sensor_record_env_t env;
+    if (len != sizeof(env)) {
+        return false;
+    }
+    memcpy(&env, data, sizeof(env));
+
+    pending.env.temperature = env.temperature;
+    pending.env.humidity = env.humidity;
+    pending.env.pressure = env.pressure;
+    pending.env.voc = env.voc;
+    pending.has_env = true;
+    return true;
+}
+
+static bool decode_imu(const uint8_t *data, size_t len)
+{
+    sensor_record_imu_t imu;
+    if (len < sizeof(imu)) {
+        return false;
+    }
+    memcpy(&imu, data, sizeof(imu));
+
+    size_t axis_bytes = imu.count * sizeof(int16_t);
+    if (imu.count == 0 || imu.count > BMI270_FIFO_MAX_FRAMES ||
+        len != sizeof(imu) + SENSOR_RECORD_IMU_AXES * axis_bytes) {
+        return false;
+    }
+
+    bmi270_batch_t *batch = &pending.imu;
+    int16_t *axes[SENSOR_RECORD_IMU_AXES] = {
+        batch->ax, batch->ay, batch->az, batch->gx, batch->gy, batch->gz
+    };
+    const uint8_t *p = data + sizeof(imu);
+    for (int axis = 0; axis < SENSOR_RECORD_IMU_AXES; axis++) {
+        memcpy(axes[axis], p, axis_bytes);
+        p += axis_bytes;
+    }
+    batch->count = imu.count;
+    batch->skipped_frames = imu.skipped_frames;
+    batch->accel_lsb_per_g = imu.accel_lsb_per_g;
+    batch->gyro_lsb_per_dps = imu.gyro_lsb_per_dps;
+    pending.has_imu = true;
+    return true;
+}
+
+esp_err_t sensor_replay_run(const char *path, sensor_replay_speed_t speed,
+                            sensor_replay_hook_t hook, void *ctx, sensor_replay_stats_t *stats_out)
+{
+    if (!path) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        ESP_LOGE(TAG, "Failed to open %s", path);
+        return ESP_ERR_NOT_FOUND;
+    }
+    setvbuf(f, NULL, _IOFBF, BLOCK_WRITER_BLOCK_SIZE);
+
+    sensor_record_header_t header;
+    if (fread(&header, sizeof(header), 1, f) != 1 ||
+        header.magic != SENSOR_RECORD_MAGIC || header.version != SENSOR_RECORD_VERSION) {
+        ESP_LOGE(TAG, "%s is not a sensor recording", path);
+        fclose(f);
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    esp_err_t ret = sensor_manager_begin_replay();
+    if (ret != ESP_OK) {
+        fclose(f);
+        return ret;
+    }
+
+    sensor_replay_stats_t stats = {0};
+    memset(&pending, 0, sizeof(pending));
+    int64_t wall_start_us = esp_timer_get_time();
+    int64_t first_us = 0;
+    bool first = true;
+
+    sensor_record_entry_t entry;
+    while (fread(&entry, sizeof(entry), 1, f) == 1) {
+        if (entry.length > sizeof(payload) || fread(payload, 1, entry.length, f) != entry.length) {
+            ESP_LOGW(TAG, "Truncated entry at %lld us", (long long)entry.timestamp_us);
+            break;
+        }
+
+        if (first) {
+            first_us = entry.timestamp_us;
+            pending.timestamp_us = entry.timestamp_us;
+            first = false;
+        }
+        if (entry.timestamp_us != pending.timestamp_us) {
+            flush_tick(speed, wall_start_us, first_us, hook, ctx, &stats);
+            pending.timestamp_us = entry.timestamp_us;
+        }
+
+        bool ok = false;
+        if (entry.type == SENSOR_RECORD_ENV) {
+            ok = decode_env(payload, entry.length);
+            stats.env_entries += ok;
+        } else if (entry.type == SENSOR_RECORD_IMU) {
+            ok = decode_imu(payload, entry.length);
+            stats.imu_entries += ok;
+            stats.imu_frames += ok ? pending.imu.count : 0;
+        }
+        if (!ok) {
+            stats.skipped_entries++;
+        }
+    }
+    flush_tick(speed, wall_start_us, first_us, hook, ctx, &stats);
+
+    stats.recording_us = first ? 0 : pending.timestamp_us - first_us;
+    stats.elapsed_us = esp_timer_get_time() - wall_start_us;
+    fclose(f);
+    sensor_manager_end_replay();
+
+    ESP_LOGI(TAG, "Replayed %lu ticks (%lld ms recorded) in %lld ms",
+             stats.ticks, (long long)(stats.recording_us / 1000), (long long)(stats.elapsed_us / 1000));
+    if (stats_out) {
+        *stats_out = stats;
+    }
+    return ESP_OK;
+}
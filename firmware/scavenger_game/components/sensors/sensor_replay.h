@@ -0,0 +1,36 @@
+#ifndef SENSOR_REPLAY_H
+#define SENSOR_REPLAY_H
+
+#include "stdint.h"
+#include "esp_err.h"
+#include "sensor_manager.h"
+
+#define SENSOR_REPLAY_EVENT_BITS    7       // Bits in SENSOR_EVENT_ALL
+
+typedef enum {
+    SENSOR_REPLAY_REALTIME = 0,     // Keep the recorded spacing between ticks
+    SENSOR_REPLAY_FAST              // As fast as the CPU allows
+} sensor_replay_speed_t;
+
+// Called after every replayed tick, in the replaying task, with the sample it
+// published and its rising trigger edges. Driving consumers from here (e.g.
+// quest_system_update) keeps fast replay deterministic.
+typedef void (*sensor_replay_hook_t)(const sensor_sample_t *sample, uint32_t edges, void *ctx);
+
+typedef struct {
+    uint32_t ticks;
+    uint32_t env_entries;
+    uint32_t imu_entries;
+    uint32_t imu_frames;
+    uint32_t skipped_entries;       // Unknown type or malformed payload
+    uint32_t trigger_edges[SENSOR_REPLAY_EVENT_BITS];  // Rising edges per SENSOR_EVENT_* bit
+    int64_t recording_us;           // Recorded time span
+    int64_t elapsed_us;             // Wall time spent replaying
+} sensor_replay_stats_t;
+
+// Replays a sensor_record file through sensor_manager, then resumes live
+// sampling. hook and stats may be NULL.
+esp_err_t sensor_replay_run(const char *path, sensor_replay_speed_t speed,
+                            sensor_replay_hook_t hook, void *ctx, sensor_replay_stats_t *stats);
+
+#endif // SENSOR_REPLAY_H
@@ -0,0 +1,127 @@
+#include "sensor_ring.h"
+#include <string.h>
+
+// Slot version for sample number seq once it is completely written.
+// While the producer is writing it the version is one less (odd).
+#define SLOT_VERSION(seq) (((uint32_t)(seq) + 1u) * 2u)
+
+// Bounded retries for sensor_ring_latest when racing the producer
+#define LATEST_MAX_RETRIES 4
+
+static void store_sample(sensor_ring_slot_t *slot, const sensor_sample_t *sample)
+{
+    uint32_t words[SENSOR_RING_SAMPLE_WORDS] = {0};
+    memcpy(words, sample, sizeof(*sample));
+    for (size_t i = 0; i < SENSOR_RING_SAMPLE_WORDS; i++) {
+        atomic_store_explicit(&slot->sample[i], words[i], memory_order_relaxed);
+    }
+}
+
+static void load_sample(sensor_ring_slot_t *slot, sensor_sample_t *sample)
+{
+    uint32_t words[SENSOR_RING_SAMPLE_WORDS];
+    for (size_t i = 0; i < SENSOR_RING_SAMPLE_WORDS; i++) {
+        words[i] = atomic_load_explicit(&slot->sample[i], memory_order_relaxed);
+    }
+    memcpy(sample, words, sizeof(*sample));
+}
+
+void sensor_ring_init(sensor_ring_t *ring)
+{
+    memset(ring, 0, sizeof(*ring));
+    atomic_init(&ring->head, 0);
+    for (int i = 0; i < SENSOR_RING_SIZE; i++) {
+        atomic_init(&ring->slots[i].version, 0);
+    }
+}
+
+uint32_t sensor_ring_publish(sensor_ring_t *ring, const sensor_data_t *data, uint8_t sources, int64_t timestamp_us)
+{
+    // Only the producer writes head, so a relaxed load is enough here
+    uint32_t seq = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    sensor_ring_slot_t *slot = &ring->slots[seq & SENSOR_RING_MASK];
+
+    atomic_store_explicit(&slot->version, SLOT_VERSION(seq) - 1u, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    sensor_sample_t sample = {
+        .seq = seq,
+        .sources = sources,
+        .timestamp_us = timestamp_us,
+        .data = *data,
+    };
+    store_sample(slot, &sample);
+
+    atomic_store_explicit(&slot->version, SLOT_VERSION(seq), memory_order_release);
+    atomic_store_explicit(&ring->head, seq + 1u, memory_order_release);
+    return seq;
+}
+
+void sensor_ring_cursor_init(sensor_ring_t *ring, sensor_ring_cursor_t *cursor)
+{
+    cursor->next = atomic_load_explicit(&ring->head, memory_order_acquire);
+    cursor->dropped = 0;
+}
+
+// Copy sample seq out of its slot. Fails if the producer has started
+// overwriting the slot with a newer sample before or during the copy.
+static bool read_slot(sensor_ring_t *ring, uint32_t seq, sensor_sample_t *out)
+{
+    sensor_ring_slot_t *slot = &ring->slots[seq & SENSOR_RING_MASK];
+
+    uint32_t before = atomic_load_explicit(&slot->version, memory_order_acquire);
+    if (before != SLOT_VERSION(seq)) {
+        return false;
+    }
+
+    load_sample(slot, out);
+
+    atomic_thread_fence(memory_order_acquire);
+    uint32_t after = atomic_load_explicit(&slot->version, memory_order_relaxed);
+    return after == before;
+}
+
+size_t sensor_ring_read(sensor_ring_t *ring, sensor_ring_cursor_t *cursor,
+                        sensor_sample_t *samples, size_t max_samples)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t count = 0;
+
+    while (count < max_samples && cursor->next != head) {
+        uint32_t behind = head - cursor->next;
+        if (behind > SENSOR_RING_SIZE) {
+            // Lapped by the producer: skip to the oldest sample still in the ring
+            cursor->dropped += behind - SENSOR_RING_SIZE;
+            cursor->next = head - SENSOR_RING_SIZE;
+            continue;
+        }
+
+        if (!read_slot(ring, cursor->next, &samples[count])) {
+            // Overwritten while we were reading it
+            cursor->dropped++;
+            cursor->next++;
+            head = atomic_load_explicit(&ring->head, memory_order_acquire);
+            continue;
+        }
+
+        cursor->next++;
+        count++;
+    }
+
+    return count;
+}
+
+bool sensor_ring_latest(sensor_ring_t *ring, sensor_sample_t *sample)
+{
+    for (int attempt = 0; attempt < LATEST_MAX_RETRIES; attempt++) {
+        uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (head == 0) {
+            return false;
+        }
+        if (read_slot(ring, head - 1u, sample)) {
+            return true;
+        }
+    }
+
+    return false;
+}
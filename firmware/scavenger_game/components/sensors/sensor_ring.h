@@ -0,0 +1,53 @@
+#ifndef SENSOR_RING_H
+#define SENSOR_RING_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include "stdint.h"
+#include "stdbool.h"
+#include "sensor_manager.h"
+
+// Number of samples kept in the ring (must be a power of two)
+#define SENSOR_RING_SIZE 64
+#define SENSOR_RING_MASK (SENSOR_RING_SIZE - 1)
+
+// Single-producer/multi-consumer broadcast ring. The producer never waits:
+// it overwrites the oldest slot, and readers that fall more than
+// SENSOR_RING_SIZE samples behind skip ahead and count the lost samples.
+// Each slot is guarded by a sequence lock so readers never see torn data.
+// The sample is copied in and out a word at a time with relaxed atomics
+// (plain loads and stores on the target), so racing the producer is
+// defined behaviour rather than a data race.
+#define SENSOR_RING_SAMPLE_WORDS ((sizeof(sensor_sample_t) + 3) / 4)
+
+typedef struct {
+    atomic_uint_fast32_t version;   // Odd while the slot is being written
+    _Atomic uint32_t sample[SENSOR_RING_SAMPLE_WORDS];
+} sensor_ring_slot_t;
+
+typedef struct {
+    atomic_uint_fast32_t head;      // Number of samples published so far
+    sensor_ring_slot_t slots[SENSOR_RING_SIZE];
+} sensor_ring_t;
+
+// Per-consumer read position. Owned by exactly one reader task.
+typedef struct {
+    uint32_t next;                  // Sequence number of the next sample to read
+    uint32_t dropped;               // Samples overwritten before they were read
+} sensor_ring_cursor_t;
+
+void sensor_ring_init(sensor_ring_t *ring);
+
+// Producer side. Lock-free and wait-free, safe to call from the timer callback.
+// Returns the sequence number assigned to the sample.
+uint32_t sensor_ring_publish(sensor_ring_t *ring, const sensor_data_t *data, uint8_t sources, int64_t timestamp_us);
+
+// Consumer side. A new cursor starts at the next sample to be published.
+void sensor_ring_cursor_init(sensor_ring_t *ring, sensor_ring_cursor_t *cursor);
+size_t sensor_ring_read(sensor_ring_t *ring, sensor_ring_cursor_t *cursor,
+                        sensor_sample_t *samples, size_t max_samples);
+
+// Copy of the most recent sample; false if nothing has been published yet
+bool sensor_ring_latest(sensor_ring_t *ring, sensor_sample_t *sample);
+
+#endif // SENSOR_RING_H
@@ -0,0 +1,97 @@
+#include "sensor_scheduler.h"
+#include "sensor_manager.h"
+
+static const sensor_schedule_config_t default_config = {
+    .imu_fast_ms = 100,
+    .imu_idle_ms = 1000,
+    .env_active_ms = 1000,
+    .env_idle_ms = 10000,
+    .env_burst_ms = 100,
+    .motion_hold_ms = 5000,
+    .imu_demand_events = SENSOR_EVENT_MOVEMENT | SENSOR_EVENT_TILT,
+    .env_demand_events = SENSOR_EVENT_RAIN | SENSOR_EVENT_COLD | SENSOR_EVENT_DARK |
+                         SENSOR_EVENT_CIGARETTE | SENSOR_EVENT_HERBAL,
+};
+
+void sensor_scheduler_init(sensor_scheduler_t *sched, const sensor_schedule_config_t *config, int64_t now_us)
+{
+    sched->config = config ? *config : default_config;
+    sched->demand = 0;
+    sched->burst_continuous = false;
+    sched->motion_until_us = 0;
+    sched->burst_until_us = 0;
+
+    // Pretend the last sample was long ago so the first tick reads everything
+    sched->imu_last_us = now_us - (int64_t)sched->config.imu_idle_ms * 1000;
+    sched->env_last_us = now_us - (int64_t)sched->config.env_idle_ms * 1000;
+}
+
+void sensor_scheduler_set_demand(sensor_scheduler_t *sched, uint32_t demand_events)
+{
+    sched->demand = demand_events;
+}
+
+void sensor_scheduler_note_motion(sensor_scheduler_t *sched, int64_t now_us)
+{
+    sched->motion_until_us = now_us + (int64_t)sched->config.motion_hold_ms * 1000;
+}
+
+void sensor_scheduler_request_burst(sensor_scheduler_t *sched, int64_t now_us, uint32_t duration_ms)
+{
+    int64_t until = now_us + (int64_t)duration_ms * 1000;
+    if (until > sched->burst_until_us) {
+        sched->burst_until_us = until;
+    }
+}
+
+void sensor_scheduler_set_continuous_burst(sensor_scheduler_t *sched, bool enabled)
+{
+    sched->burst_continuous = enabled;
+}
+
+uint32_t sensor_scheduler_imu_period_ms(const sensor_scheduler_t *sched, int64_t now_us)
+{
+    if ((sched->demand & sched->config.imu_demand_events) || now_us < sched->motion_until_us) {
+        return sched->config.imu_fast_ms;
+    }
+    return sched->config.imu_idle_ms;
+}
+
+uint32_t sensor_scheduler_env_period_ms(const sensor_scheduler_t *sched, int64_t now_us)
+{
+    if (sched->burst_continuous || now_us < sched->burst_until_us) {
+        return sched->config.env_burst_ms;
+    }
+    if (sched->demand & sched->config.env_demand_events) {
+        return sched->config.env_active_ms;
+    }
+    return sched->config.env_idle_ms;
+}
+
+uint32_t sensor_scheduler_due(sensor_scheduler_t *sched, int64_t now_us)
+{
+    uint32_t due = 0;
+
+    // Deadlines follow the current period, so a rate change applies immediately
+    if (now_us >= sched->imu_last_us + (int64_t)sensor_scheduler_imu_period_ms(sched, now_us) * 1000) {
+        sched->imu_last_us = now_us;
+        due |= SENSOR_SOURCE_IMU;
+    }
+    if (now_us >= sched->env_last_us + (int64_t)sensor_scheduler_env_period_ms(sched, now_us) * 1000) {
+        sched->env_last_us = now_us;
+        due |= SENSOR_SOURCE_ENV;
+    }
+
+    return due;
+}
+
+int64_t sensor_scheduler_next_deadline(const sensor_scheduler_t *sched, int64_t now_us)
+{
+    int64_t imu_next = sched->imu_last_us + (int64_t)sensor_scheduler_imu_period_ms(sched, now_us) * 1000;
+    int64_t env_next = sched->env_last_us + (int64_t)sensor_scheduler_env_period_ms(sched, now_us) * 1000;
+    int64_t next = (imu_next < env_next) ? imu_next : env_next;
+
+    // A motion hold or burst expiring earlier can only slow things down, so it
+    // never needs an earlier wakeup than the deadlines computed above
+    return (next < now_us) ? now_us : next;
+}
@@ -0,0 +1,47 @@
+#ifndef SENSOR_SCHEDULER_H
+#define SENSOR_SCHEDULER_H
+
+#include "stdint.h"
+#include "stdbool.h"
+
+typedef struct {
+    uint32_t imu_fast_ms;           // Movement/tilt quest active or recent motion
+    uint32_t imu_idle_ms;
+    uint32_t env_active_ms;         // Environmental quest active
+    uint32_t env_idle_ms;
+    uint32_t env_burst_ms;          // VOC burst (smoke classification, logging)
+    uint32_t motion_hold_ms;        // Stay fast this long after the last motion
+    uint32_t imu_demand_events;     // SENSOR_EVENT_* bits that need the IMU
+    uint32_t env_demand_events;     // SENSOR_EVENT_* bits that need the BME690
+} sensor_schedule_config_t;
+
+// Pure decision logic: time is passed in, so it runs the same on a simulated clock.
+// Not thread-safe; owned by the sampling timer.
+typedef struct {
+    sensor_schedule_config_t config;
+    uint32_t demand;                // SENSOR_EVENT_* bits wanted by active quests
+    bool burst_continuous;
+    int64_t motion_until_us;
+    int64_t burst_until_us;
+    int64_t imu_last_us;
+    int64_t env_last_us;
+} sensor_scheduler_t;
+
+// config may be NULL for the defaults. Both sensors are due immediately.
+void sensor_scheduler_init(sensor_scheduler_t *sched, const sensor_schedule_config_t *config, int64_t now_us);
+
+void sensor_scheduler_set_demand(sensor_scheduler_t *sched, uint32_t demand_events);
+void sensor_scheduler_note_motion(sensor_scheduler_t *sched, int64_t now_us);
+void sensor_scheduler_request_burst(sensor_scheduler_t *sched, int64_t now_us, uint32_t duration_ms);
+void sensor_scheduler_set_continuous_burst(sensor_scheduler_t *sched, bool enabled);
+
+uint32_t sensor_scheduler_imu_period_ms(const sensor_scheduler_t *sched, int64_t now_us);
+uint32_t sensor_scheduler_env_period_ms(const sensor_scheduler_t *sched, int64_t now_us);
+
+// Sensors due at now_us (SENSOR_SOURCE_* bits); marks them as sampled
+uint32_t sensor_scheduler_due(sensor_scheduler_t *sched, int64_t now_us);
+
+// Absolute time of the next sample of any sensor
+int64_t sensor_scheduler_next_deadline(const sensor_scheduler_t *sched, int64_t now_us);
+
+#endif // SENSOR_SCHEDULER_H
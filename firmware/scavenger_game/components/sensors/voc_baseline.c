@@ -0,0 +1,61 @@
+#include "voc_baseline.h"
+#include <math.h>
+
+void voc_baseline_init(voc_baseline_t *tracker, float baseline)
+{
+    tracker->baseline = baseline > 0.0f ? fmaxf(baseline, VOC_BASELINE_MIN) : 0.0f;
+    tracker->outlier_ms = 0;
+    tracker->warmup_ms = baseline > 0.0f ? 0 : VOC_BASELINE_WARMUP_S * 1000u;
+    tracker->last_us = -1;
+}
+
+void voc_baseline_update(voc_baseline_t *tracker, float voc, int64_t now_us)
+{
+    if (!(voc >= 0.0f)) {
+        return;
+    }
+    int64_t elapsed_us = tracker->last_us >= 0 ? now_us - tracker->last_us : 0;
+    tracker->last_us = now_us;
+    if (tracker->baseline <= 0.0f) {
+        tracker->baseline = fmaxf(voc, VOC_BASELINE_MIN);
+        return;
+    }
+    if (elapsed_us <= 0) {
+        return;
+    }
+    if (elapsed_us > VOC_BASELINE_MAX_STEP_S * 1000000LL) {
+        elapsed_us = VOC_BASELINE_MAX_STEP_S * 1000000LL;
+    }
+    uint32_t elapsed_ms = (uint32_t)(elapsed_us / 1000);
+
+    // Smoke must not drag the baseline up, unless it never goes away
+    if (voc > tracker->baseline * VOC_BASELINE_OUTLIER_RATIO) {
+        if (tracker->outlier_ms < VOC_BASELINE_OUTLIER_HOLD_S * 1000u) {
+            tracker->outlier_ms += elapsed_ms;
+            return;
+        }
+    } else {
+        tracker->outlier_ms = 0;
+    }
+
+    float rate = (float)elapsed_us / (VOC_BASELINE_TAU_S * 1e6f);
+    if (tracker->warmup_ms > 0) {
+        rate *= 8.0f;
+        tracker->warmup_ms = tracker->warmup_ms > elapsed_ms ? tracker->warmup_ms - elapsed_ms : 0;
+    }
+
+    // Sign-only steps make it a quantile; never stepping past the reading
+    // keeps the jitter below the sensor noise at slow sampling rates
+    float step = tracker->baseline * rate;
+    if (voc > tracker->baseline) {
+        tracker->baseline += fminf(step * VOC_BASELINE_QUANTILE, voc - tracker->baseline);
+    } else if (voc < tracker->baseline) {
+        tracker->baseline -= fminf(step * (1.0f - VOC_BASELINE_QUANTILE), tracker->baseline - voc);
+    }
+    tracker->baseline = fmaxf(tracker->baseline, VOC_BASELINE_MIN);
+}
+
+float voc_baseline_compensate(float baseline, float voc)
+{
+    return baseline > 0.0f ? voc * (VOC_BASELINE_NOMINAL / baseline) : voc;
+}
@@ -0,0 +1,56 @@
+#ifndef VOC_BASELINE_H
+#define VOC_BASELINE_H
+
+#include "stdint.h"
+
+// Long-horizon clean-air VOC level of this badge's gas sensor. MOX sensors
+// differ unit to unit and drift over days, so smoke is judged relative to
+// this baseline rather than against raw counts.
+//
+// The baseline is a streaming low quantile: each reading nudges it up by
+// QUANTILE or down by 1 - QUANTILE of a step proportional to the baseline and
+// the time since the previous reading, so it settles where QUANTILE of the
+// readings lie below it, independent of the sampling rate. Readings above
+// OUTLIER_RATIO x baseline (smoke) are ignored unless VOC stays that high for
+// OUTLIER_HOLD_S, which is taken as a new environment.
+#ifndef VOC_BASELINE_NOMINAL
+#define VOC_BASELINE_NOMINAL        100.0f  // Baseline the VOC thresholds are expressed at
+#endif
+#ifndef VOC_BASELINE_QUANTILE
+#define VOC_BASELINE_QUANTILE       0.2f
+#endif
+#ifndef VOC_BASELINE_TAU_S
+#define VOC_BASELINE_TAU_S          3600    // Full step per second is baseline / TAU_S
+#endif
+#ifndef VOC_BASELINE_OUTLIER_RATIO
+#define VOC_BASELINE_OUTLIER_RATIO  1.5f
+#endif
+#ifndef VOC_BASELINE_OUTLIER_HOLD_S
+#define VOC_BASELINE_OUTLIER_HOLD_S 7200
+#endif
+#ifndef VOC_BASELINE_WARMUP_S
+#define VOC_BASELINE_WARMUP_S       900     // Cold start learns 8x faster for this long
+#endif
+
+#define VOC_BASELINE_MIN            1.0f
+#define VOC_BASELINE_MAX_STEP_S     60      // Longer gaps (sleep, reboot) count as this
+
+// Pure tracker: time is passed in. Not thread-safe; owned by the sampling timer.
+typedef struct {
+    float baseline;                 // 0 until the first reading
+    uint32_t outlier_ms;            // Time VOC has stayed above the outlier gate
+    uint32_t warmup_ms;             // Fast learning left after a cold start
+    int64_t last_us;                // Previous reading, -1 before the first
+} voc_baseline_t;
+
+// baseline 0 starts cold from the first reading; otherwise continues from a
+// stored baseline
+void voc_baseline_init(voc_baseline_t *tracker, float baseline);
+
+void voc_baseline_update(voc_baseline_t *tracker, float voc, int64_t now_us);
+
+// voc as it would read on a sensor whose baseline is VOC_BASELINE_NOMINAL;
+// unchanged while the baseline is unknown (0)
+float voc_baseline_compensate(float baseline, float voc);
+
+#endif // VOC_BASELINE_H
@@ -0,0 +1,251 @@
+#include "voc_log.h"
+#include <math.h>
+#include <string.h>
+
+#define VARINT_MAX_BYTES 5
+#define CHUNK_PAYLOAD    (VOC_LOG_CHUNK_SIZE - 2)
+#define CHUNK_NONE       0xFFFF
+
+static inline uint32_t zigzag_encode(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t zigzag_decode(uint32_t value)
+{
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static size_t varint_encode(uint32_t value, uint8_t *out)
+{
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+static int32_t quantize(float value, float scale, int32_t min, int32_t max)
+{
+    int32_t q = (int32_t)lroundf(value * scale);
+    return q < min ? min : (q > max ? max : q);
+}
+
+esp_err_t voc_log_init(voc_log_t *log, uint8_t *buffer, size_t capacity)
+{
+    if (!log || !buffer || capacity < VOC_LOG_COL_MAX * VOC_LOG_CHUNK_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t chunks = capacity / VOC_LOG_CHUNK_SIZE;
+    log->buffer = buffer;
+    log->chunk_count = (uint16_t)(chunks < CHUNK_NONE ? chunks : CHUNK_NONE);
+    voc_log_reset(log);
+    return ESP_OK;
+}
+
+void voc_log_reset(voc_log_t *log)
+{
+    // Every column starts with one chunk; further chunks go to whichever column fills up
+    for (int col = 0; col < VOC_LOG_COL_MAX; col++) {
+        log->columns[col].first_chunk = (uint16_t)col;
+        log->columns[col].chunk = (uint16_t)col;
+        log->columns[col].offset = 0;
+        log->columns[col].len = 0;
+    }
+    log->chunks_used = VOC_LOG_COL_MAX;
+    log->count = 0;
+    log->prev_timestamp = 0;
+    log->prev_voc = 0;
+    log->prev_temperature = 0;
+    log->prev_humidity = 0;
+    log->label_count = 0;
+    log->run_count = 0;
+}
+
+static void set_link(uint8_t *chunk, uint16_t next)
+{
+    chunk[CHUNK_PAYLOAD] = (uint8_t)(next & 0xFF);
+    chunk[CHUNK_PAYLOAD + 1] = (uint8_t)(next >> 8);
+}
+
+static uint16_t get_link(const uint8_t *chunk)
+{
+    return (uint16_t)(chunk[CHUNK_PAYLOAD] | (chunk[CHUNK_PAYLOAD + 1] << 8));
+}
+
+// Append bytes to a column, chaining a new chunk when the current one is full.
+// The caller has already checked that enough free chunks exist.
+static void column_write(voc_log_t *log, voc_log_column_state_t *column, const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (column->offset == CHUNK_PAYLOAD) {
+            uint16_t next = log->chunks_used++;
+            set_link(log->buffer + (size_t)column->chunk * VOC_LOG_CHUNK_SIZE, next);
+            column->chunk = next;
+            column->offset = 0;
+        }
+        log->buffer[(size_t)column->chunk * VOC_LOG_CHUNK_SIZE + column->offset++] = data[i];
+    }
+    column->len += len;
+}
+
+static size_t chunks_needed(const voc_log_column_state_t *column, size_t len)
+{
+    size_t free_bytes = CHUNK_PAYLOAD - column->offset;
+    return (len <= free_bytes) ? 0 : (len - free_bytes + CHUNK_PAYLOAD - 1) / CHUNK_PAYLOAD;
+}
+
+// Label id for a new sample, adding a dictionary entry and/or run as needed.
+// Returns -1 if either table is full.
+static int label_for_append(voc_log_t *log, const char *label, bool *new_run)
+{
+    *new_run = false;
+    if (log->run_count > 0) {
+        uint8_t id = log->runs[log->run_count - 1].label_id;
+        if (strncmp(log->labels[id], label, VOC_LOG_LABEL_LEN - 1) == 0) {
+            return id;
+        }
+    }
+    if (log->run_count >= VOC_LOG_MAX_RUNS) {
+        return -1;
+    }
+
+    *new_run = true;
+    for (int i = 0; i < log->label_count; i++) {
+        if (strncmp(log->labels[i], label, VOC_LOG_LABEL_LEN - 1) == 0) {
+            return i;
+        }
+    }
+    if (log->label_count >= VOC_LOG_MAX_LABELS) {
+        return -1;
+    }
+    return log->label_count;
+}
+
+esp_err_t voc_log_append(voc_log_t *log, uint32_t timestamp_ms, uint32_t voc,
+                         float temperature, float humidity, const char *label)
+{
+    if (!log || !label) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (log->count > 0 && timestamp_ms < log->prev_timestamp) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int32_t temp_q = quantize(temperature, 100.0f, INT16_MIN, INT16_MAX);
+    int32_t hum_q = quantize(humidity, 100.0f, 0, UINT16_MAX);
+
+    // Encode every column first so running out of chunks leaves the log untouched
+    uint8_t encoded[VOC_LOG_COL_MAX][VARINT_MAX_BYTES];
+    size_t len[VOC_LOG_COL_MAX];
+    len[VOC_LOG_COL_TIMESTAMP] = varint_encode(timestamp_ms - log->prev_timestamp, encoded[VOC_LOG_COL_TIMESTAMP]);
+    len[VOC_LOG_COL_VOC] = varint_encode(zigzag_encode((int32_t)(voc - log->prev_voc)), encoded[VOC_LOG_COL_VOC]);
+    len[VOC_LOG_COL_TEMPERATURE] = varint_encode(zigzag_encode(temp_q - log->prev_temperature), encoded[VOC_LOG_COL_TEMPERATURE]);
+    len[VOC_LOG_COL_HUMIDITY] = varint_encode(zigzag_encode(hum_q - log->prev_humidity), encoded[VOC_LOG_COL_HUMIDITY]);
+
+    size_t new_chunks = 0;
+    for (int col = 0; col < VOC_LOG_COL_MAX; col++) {
+        new_chunks += chunks_needed(&log->columns[col], len[col]);
+    }
+    if (new_chunks > (size_t)(log->chunk_count - log->chunks_used)) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    bool new_run;
+    int label_id = label_for_append(log, label, &new_run);
+    if (label_id < 0) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (new_run) {
+        if (label_id == log->label_count) {
+            log->labels[label_id][0] = '\0';
+            strncat(log->labels[label_id], label, VOC_LOG_LABEL_LEN - 1);
+            log->label_count++;
+        }
+        log->runs[log->run_count].first_sample = log->count;
+        log->runs[log->run_count].label_id = (uint8_t)label_id;
+        log->run_count++;
+    }
+
+    for (int col = 0; col < VOC_LOG_COL_MAX; col++) {
+        column_write(log, &log->columns[col], encoded[col], len[col]);
+    }
+
+    log->prev_timestamp = timestamp_ms;
+    log->prev_voc = voc;
+    log->prev_temperature = temp_q;
+    log->prev_humidity = hum_q;
+    log->count++;
+    return ESP_OK;
+}
+
+uint32_t voc_log_count(const voc_log_t *log)
+{
+    return log->count;
+}
+
+size_t voc_log_bytes_used(const voc_log_t *log)
+{
+    size_t total = 0;
+    for (int col = 0; col < VOC_LOG_COL_MAX; col++) {
+        total += log->columns[col].len;
+    }
+    return total;
+}
+
+void voc_log_iter_init(voc_log_iter_t *iter, const voc_log_t *log)
+{
+    memset(iter, 0, sizeof(*iter));
+    iter->log = log;
+    for (int col = 0; col < VOC_LOG_COL_MAX; col++) {
+        iter->chunk[col] = log->columns[col].first_chunk;
+    }
+}
+
+static uint32_t iter_varint(voc_log_iter_t *iter, int col)
+{
+    const uint8_t *buffer = iter->log->buffer;
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (iter->offset[col] == CHUNK_PAYLOAD) {
+            iter->chunk[col] = get_link(buffer + (size_t)iter->chunk[col] * VOC_LOG_CHUNK_SIZE);
+            iter->offset[col] = 0;
+        }
+        uint8_t byte = buffer[(size_t)iter->chunk[col] * VOC_LOG_CHUNK_SIZE + iter->offset[col]++];
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            break;
+        }
+    }
+    return value;
+}
+
+bool voc_log_iter_next(voc_log_iter_t *iter, voc_log_sample_t *sample)
+{
+    const voc_log_t *log = iter->log;
+    if (iter->index >= log->count) {
+        return false;
+    }
+
+    iter->timestamp += iter_varint(iter, VOC_LOG_COL_TIMESTAMP);
+    iter->voc += (uint32_t)zigzag_decode(iter_varint(iter, VOC_LOG_COL_VOC));
+    iter->temperature += zigzag_decode(iter_varint(iter, VOC_LOG_COL_TEMPERATURE));
+    iter->humidity += zigzag_decode(iter_varint(iter, VOC_LOG_COL_HUMIDITY));
+
+    while (iter->run + 1 < log->run_count && log->runs[iter->run + 1].first_sample <= iter->index) {
+        iter->run++;
+    }
+
+    sample->timestamp_ms = iter->timestamp;
+    sample->voc = iter->voc;
+    sample->temperature = iter->temperature / 100.0f;
+    sample->humidity = iter->humidity / 100.0f;
+    sample->label = log->labels[log->runs[iter->run].label_id];
+
+    iter->index++;
+    return true;
+}
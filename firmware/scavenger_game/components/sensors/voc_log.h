@@ -0,0 +1,91 @@
+#ifndef VOC_LOG_H
+#define VOC_LOG_H
+
+#include <stddef.h>
+#include "stdint.h"
+#include "stdbool.h"
+#include "esp_err.h"
+
+#define VOC_LOG_LABEL_LEN   32
+#define VOC_LOG_MAX_LABELS  8
+#define VOC_LOG_MAX_RUNS    64
+#define VOC_LOG_CHUNK_SIZE  64      // Last two bytes of each chunk link to the next one
+
+// Columns grow independently as chains of fixed-size chunks carved from one buffer:
+//  - timestamp: unsigned varint delta in ms (timestamps must not go backwards)
+//  - VOC: zigzag varint delta
+//  - temperature: zigzag varint delta of int16 centi-degrees
+//  - humidity: zigzag varint delta of uint16 centi-percent
+// Labels are interned in a dictionary and stored as runs.
+typedef enum {
+    VOC_LOG_COL_TIMESTAMP = 0,
+    VOC_LOG_COL_VOC,
+    VOC_LOG_COL_TEMPERATURE,
+    VOC_LOG_COL_HUMIDITY,
+    VOC_LOG_COL_MAX
+} voc_log_column_t;
+
+typedef struct {
+    uint32_t first_sample;
+    uint8_t label_id;
+} voc_log_run_t;
+
+typedef struct {
+    uint16_t first_chunk;
+    uint16_t chunk;                 // Chunk being written
+    uint16_t offset;                // Write offset in that chunk
+    size_t len;                     // Encoded bytes in the column
+} voc_log_column_state_t;
+
+typedef struct {
+    uint8_t *buffer;
+    uint16_t chunk_count;
+    uint16_t chunks_used;
+    voc_log_column_state_t columns[VOC_LOG_COL_MAX];
+    uint32_t count;
+    uint32_t prev_timestamp;
+    uint32_t prev_voc;
+    int32_t prev_temperature;
+    int32_t prev_humidity;
+    char labels[VOC_LOG_MAX_LABELS][VOC_LOG_LABEL_LEN];
+    uint8_t label_count;
+    voc_log_run_t runs[VOC_LOG_MAX_RUNS];
+    uint16_t run_count;
+} voc_log_t;
+
+// Decoded sample; label points into the log's dictionary
+typedef struct {
+    uint32_t timestamp_ms;
+    uint32_t voc;
+    float temperature;
+    float humidity;
+    const char *label;
+} voc_log_sample_t;
+
+typedef struct {
+    const voc_log_t *log;
+    uint32_t index;
+    uint16_t run;
+    uint16_t chunk[VOC_LOG_COL_MAX];
+    uint16_t offset[VOC_LOG_COL_MAX];
+    uint32_t timestamp;
+    uint32_t voc;
+    int32_t temperature;
+    int32_t humidity;
+} voc_log_iter_t;
+
+esp_err_t voc_log_init(voc_log_t *log, uint8_t *buffer, size_t capacity);
+void voc_log_reset(voc_log_t *log);
+
+// ESP_ERR_NO_MEM once the buffer, the label dictionary or the run table is full.
+// A failed append leaves the log unchanged.
+esp_err_t voc_log_append(voc_log_t *log, uint32_t timestamp_ms, uint32_t voc,
+                         float temperature, float humidity, const char *label);
+
+uint32_t voc_log_count(const voc_log_t *log);
+size_t voc_log_bytes_used(const voc_log_t *log);     // Encoded column bytes
+
+void voc_log_iter_init(voc_log_iter_t *iter, const voc_log_t *log);
+bool voc_log_iter_next(voc_log_iter_t *iter, voc_log_sample_t *sample);
+
+#endif // VOC_LOG_H
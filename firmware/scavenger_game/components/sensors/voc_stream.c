@@ -0,0 +1,108 @@
+#include "voc_stream.h"
+#include "esp_log.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+static const char *TAG = "VOC_STREAM";
+
+#define CSV_LINE_MAX                96
+
+static block_writer_t writer;
+static atomic_bool writer_ready;     // Read by the sampling timer
+static voc_stream_format_t stream_format;
+static char stream_label[VOC_STREAM_LABEL_LEN];
+
+esp_err_t voc_stream_start(const char *path, voc_stream_format_t format, const char *label)
+{
+    if (!path || !label) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!atomic_load(&writer_ready)) {
+        esp_err_t ret = block_writer_init(&writer, "voc_stream");
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        atomic_store(&writer_ready, true);
+    }
+    if (block_writer_is_open(&writer)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    stream_format = format;
+    stream_label[0] = '\0';
+    strncat(stream_label, label, sizeof(stream_label) - 1);
+
+    esp_err_t ret;
+    if (format == VOC_STREAM_FORMAT_CSV) {
+        static const char header[] = "timestamp,voc,temperature,humidity,label\n";
+        ret = block_writer_open(&writer, path, header, sizeof(header) - 1);
+    } else {
+        voc_stream_header_t header = {
+            .magic = VOC_STREAM_MAGIC,
+            .version = VOC_STREAM_VERSION,
+            .record_size = sizeof(voc_stream_record_t),
+        };
+        memcpy(header.label, stream_label, sizeof(header.label));
+        ret = block_writer_open(&writer, path, &header, sizeof(header));
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "Streaming VOC samples to %s (%s)", path,
+             format == VOC_STREAM_FORMAT_CSV ? "csv" : "binary");
+    return ESP_OK;
+}
+
+esp_err_t voc_stream_stop(void)
+{
+    if (!atomic_load(&writer_ready)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t ret = block_writer_close(&writer);
+    if (ret == ESP_ERR_INVALID_STATE) {
+        return ret;
+    }
+
+    voc_stream_stats_t stats;
+    block_writer_get_stats(&writer, &stats);
+    ESP_LOGI(TAG, "Stream closed: %lu samples, %lu dropped, %lu blocks, %lu write errors",
+             stats.records_written, stats.records_dropped, stats.blocks_written, stats.write_errors);
+    return ret;
+}
+
+bool voc_stream_is_active(void)
+{
+    return atomic_load(&writer_ready) && block_writer_is_open(&writer);
+}
+
+esp_err_t voc_stream_push(uint32_t timestamp_ms, uint32_t voc, float temperature, float humidity)
+{
+    if (!voc_stream_is_active()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (stream_format == VOC_STREAM_FORMAT_CSV) {
+        char line[CSV_LINE_MAX];
+        int len = snprintf(line, sizeof(line), "%lu,%lu,%.2f,%.2f,%s\n",
+                           (unsigned long)timestamp_ms, (unsigned long)voc, temperature, humidity, stream_label);
+        return block_writer_append(&writer, line, (size_t)len < sizeof(line) ? (size_t)len : sizeof(line) - 1);
+    }
+
+    long temp_q = lroundf(temperature * 100.0f);
+    long hum_q = lroundf(humidity * 100.0f);
+    voc_stream_record_t record = {
+        .timestamp_ms = timestamp_ms,
+        .voc = voc,
+        .temperature = (int16_t)(temp_q < INT16_MIN ? INT16_MIN : (temp_q > INT16_MAX ? INT16_MAX : temp_q)),
+        .humidity = (uint16_t)(hum_q < 0 ? 0 : (hum_q > UINT16_MAX ? UINT16_MAX : hum_q)),
+    };
+    return block_writer_append(&writer, &record, sizeof(record));
+}
+
+void voc_stream_get_stats(voc_stream_stats_t *stats)
+{
+    block_writer_get_stats(atomic_load(&writer_ready) ? &writer : NULL, stats);
+}
@@ -0,0 +1,54 @@
+#ifndef VOC_STREAM_H
+#define VOC_STREAM_H
+
+#include <stddef.h>
+#include "stdint.h"
+#include "stdbool.h"
+#include "esp_err.h"
+#include "block_writer.h"
+
+// Continuous VOC capture to SD card through a double-buffered block_writer
+#define VOC_STREAM_BLOCK_SIZE       BLOCK_WRITER_BLOCK_SIZE
+#define VOC_STREAM_LABEL_LEN        32
+
+#define VOC_STREAM_MAGIC            0x314D5356  // "VSM1"
+#define VOC_STREAM_VERSION          1
+
+typedef enum {
+    VOC_STREAM_FORMAT_BINARY = 0,
+    VOC_STREAM_FORMAT_CSV
+} voc_stream_format_t;
+
+// Binary file layout (little endian): one header, then fixed-size records
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    char label[VOC_STREAM_LABEL_LEN];
+    uint8_t reserved[24];
+} voc_stream_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t timestamp_ms;
+    uint32_t voc;
+    int16_t temperature;            // Centi-degrees
+    uint16_t humidity;              // Centi-percent
+    uint32_t reserved;
+} voc_stream_record_t;
+
+typedef block_writer_stats_t voc_stream_stats_t;
+
+// Creates path (truncating it) and starts the writer task. The SD card must be mounted.
+esp_err_t voc_stream_start(const char *path, voc_stream_format_t format, const char *label);
+
+// Flushes the partial block, waits for the writer and closes the file
+esp_err_t voc_stream_stop(void);
+
+bool voc_stream_is_active(void);
+
+// Never blocks on the card. ESP_ERR_NO_MEM means the sample was dropped.
+esp_err_t voc_stream_push(uint32_t timestamp_ms, uint32_t voc, float temperature, float humidity);
+
+void voc_stream_get_stats(voc_stream_stats_t *stats);
+
+#endif // VOC_STREAM_H
@@ -0,0 +1,291 @@
+#include "state_persistence.h"
+#include "storage_manager.h"
+#include "nvs.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "STATE_PERSIST";
+
+// NVS keys are limited to 15 characters
+#define STATE_HEADER_KEY    "ps_hdr"
+#define STATE_SLOT_KEY      "ps_q%d"
+
+// Layout 2: the header and every quest slot are one u64 each, a single
+// 32-byte NVS entry. Layout 0 is migrated by state_persistence_load().
+#define STATE_LAYOUT_VERSION 2
+
+// Layout 0, one blob that embedded the quest text. Older firmware wrote it
+// under the current namespace; it is migrated once and then erased.
+#define V0_STATE_KEY        "player_state"
+#define V0_QUESTS           10
+
+typedef struct {
+    uint8_t quest_id;
+    char name[32];
+    char description[128];
+    uint32_t trigger_type;
+    uint32_t trigger_threshold;
+    uint32_t status;
+    uint32_t progress;
+    uint32_t target_value;
+    uint32_t completed_timestamp;
+} legacy_quest_t;
+
+typedef struct {
+    uint8_t active_quest_count;
+    uint8_t completed_quest_count;
+    uint32_t total_score;
+    legacy_quest_t quests[V0_QUESTS];
+} legacy_player_state_t;
+
+_Static_assert(sizeof(legacy_quest_t) == 188 && sizeof(legacy_player_state_t) == 1888,
+               "Layout 0 as older firmware wrote it");
+
+static nvs_handle_t nvs_handle;
+static bool persist_initialized = false;
+
+static state_persist_policy_t policy = {
+    .max_delay_ms = STATE_PERSIST_MAX_DELAY_MS,
+    .max_changes = STATE_PERSIST_MAX_CHANGES,
+};
+
+static uint32_t dirty_mask = 0;
+static uint16_t pending_changes = 0;
+static uint32_t first_change_ms = 0;    // Oldest change not yet flushed
+static bool retry_pending = false;      // Last flush failed; no new attempt before retry_at_ms
+static uint32_t retry_at_ms = 0;
+
+static uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static void slot_key(const char *format, int slot, char *key, size_t size)
+{
+    snprintf(key, size, format, slot);
+}
+
+static uint64_t pack_header(const player_state_t *state)
+{
+    return STATE_LAYOUT_VERSION | (uint64_t)state->active_quest_count << 8 |
+           (uint64_t)state->completed_quest_count << 16 | (uint64_t)state->total_score << 32;
+}
+
+static uint64_t pack_quest(const quest_t *quest)
+{
+    return quest->quest_id | (uint64_t)quest->status << 8 | (uint64_t)quest->progress << 16 |
+           (uint64_t)quest->completed_timestamp << 32;
+}
+
+static void unpack_quest(uint64_t value, quest_t *quest)
+{
+    quest->quest_id = (uint8_t)value;
+    quest->status = (uint8_t)(value >> 8);
+    quest->progress = (uint16_t)(value >> 16);
+    quest->completed_timestamp = (uint32_t)(value >> 32);
+}
+
+esp_err_t state_persistence_init(void)
+{
+    if (persist_initialized) {
+        return ESP_OK;
+    }
+
+    esp_err_t ret = nvs_open(STORAGE_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS handle: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    persist_initialized = true;
+    return ESP_OK;
+}
+
+void state_persistence_set_policy(const state_persist_policy_t* new_policy)
+{
+    if (new_policy) {
+        policy = *new_policy;
+    }
+}
+
+void state_persistence_mark(uint32_t dirty)
+{
+    if (!dirty_mask) {
+        first_change_ms = now_ms();
+    }
+    dirty_mask |= dirty;
+    if (pending_changes < UINT16_MAX) {
+        pending_changes++;
+    }
+}
+
+uint32_t state_persistence_ms_until_due(void)
+{
+    // Without NVS a flush cannot succeed, so never report one as due
+    if (!persist_initialized || !dirty_mask) {
+        return UINT32_MAX;
+    }
+    uint32_t now = now_ms();
+    if (retry_pending) {
+        // Both criteria still hold after a failure; only the back-off counts
+        int32_t left = (int32_t)(retry_at_ms - now);
+        return left > 0 ? (uint32_t)left : 0;
+    }
+    uint32_t waited = now - first_change_ms;
+    if (pending_changes >= policy.max_changes || waited >= policy.max_delay_ms) {
+        return 0;
+    }
+    return policy.max_delay_ms - waited;
+}
+
+esp_err_t state_persistence_poll(const player_state_t* state)
+{
+    if (!dirty_mask || state_persistence_ms_until_due() > 0) {
+        return ESP_OK;
+    }
+    return state_persistence_flush(state);
+}
+
+esp_err_t state_persistence_flush(const player_state_t* state)
+{
+    if (!persist_initialized || !state) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!dirty_mask) {
+        return ESP_OK;
+    }
+
+    // Slots before the header, so a saved header never counts a slot that
+    // was not written yet
+    esp_err_t ret = ESP_OK;
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    for (int i = 0; i < state->active_quest_count && i < MAX_QUESTS_PER_PLAYER && ret == ESP_OK; i++) {
+        if (dirty_mask & STATE_DIRTY_SLOT(i)) {
+            slot_key(STATE_SLOT_KEY, i, key, sizeof(key));
+            ret = nvs_set_u64(nvs_handle, key, pack_quest(&state->quests[i]));
+        }
+    }
+    if (ret == ESP_OK) {
+        ret = nvs_set_u64(nvs_handle, STATE_HEADER_KEY, pack_header(state));
+    }
+    if (ret == ESP_OK) {
+        ret = nvs_commit(nvs_handle);
+    }
+    if (ret != ESP_OK) {
+        // The changes stay pending with their age and count; poll() tries
+        // again once the back-off has passed, a forced flush right away
+        ESP_LOGE(TAG, "Failed to save player state: %s", esp_err_to_name(ret));
+        retry_pending = true;
+        retry_at_ms = now_ms() + STATE_PERSIST_RETRY_MS;
+        return ret;
+    }
+
+    ESP_LOGD(TAG, "Saved player state (dirty 0x%08lx, %u changes)", dirty_mask, pending_changes);
+    dirty_mask = 0;
+    pending_changes = 0;
+    retry_pending = false;
+    return ESP_OK;
+}
+
+// Keeps what the player did; the text is in the quest catalog now
+static void convert_legacy_quest(const legacy_quest_t *old, quest_t *quest)
+{
+    *quest = (quest_t) {
+        .completed_timestamp = old->completed_timestamp,
+        .progress = old->progress > UINT16_MAX ? UINT16_MAX : (uint16_t)old->progress,
+        .quest_id = old->quest_id,
+        .status = (uint8_t)old->status,
+    };
+}
+
+static esp_err_t load_layout_0(player_state_t *state)
+{
+    // Read once at boot; not worth 1.9 KB of RAM for good
+    legacy_player_state_t *old = malloc(sizeof(*old));
+    if (!old) {
+        return ESP_ERR_NO_MEM;
+    }
+    size_t size = sizeof(*old);
+    esp_err_t ret = nvs_get_blob(nvs_handle, V0_STATE_KEY, old, &size);
+    if (ret == ESP_OK && size != sizeof(*old)) {
+        ret = ESP_ERR_INVALID_SIZE;
+    }
+    if (ret == ESP_OK) {
+        state->completed_quest_count = old->completed_quest_count;
+        state->total_score = old->total_score;
+        for (int i = 0; i < old->active_quest_count && i < V0_QUESTS && i < MAX_QUESTS_PER_PLAYER; i++) {
+            convert_legacy_quest(&old->quests[i], &state->quests[i]);
+            state->active_quest_count = i + 1;
+        }
+    }
+    free(old);
+    return ret;
+}
+
+// Rewrites layout 0 in the current one and erases it
+static esp_err_t migrate_state(player_state_t *state)
+{
+    esp_err_t ret = load_layout_0(state);
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGI(TAG, "No saved player state found, initializing with defaults");
+        return ESP_OK;
+    }
+    if (ret != ESP_OK) {
+        memset(state, 0, sizeof(*state));
+        ESP_LOGE(TAG, "Failed to load layout 0 player state: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    // The new layout is complete before the old one goes
+    state_persistence_mark(STATE_DIRTY_ALL);
+    ret = state_persistence_flush(state);
+    if (ret == ESP_OK) {
+        nvs_erase_key(nvs_handle, V0_STATE_KEY);
+        ret = nvs_commit(nvs_handle);
+    }
+    ESP_LOGI(TAG, "Migrated player state from layout 0 (%d quests): %s", state->active_quest_count,
+             esp_err_to_name(ret));
+    return ESP_OK;
+}
+
+esp_err_t state_persistence_load(player_state_t* state)
+{
+    if (!persist_initialized || !state) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    memset(state, 0, sizeof(*state));
+
+    uint64_t header;
+    esp_err_t ret = nvs_get_u64(nvs_handle, STATE_HEADER_KEY, &header);
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        return migrate_state(state);
+    }
+    if (ret == ESP_OK && (uint8_t)header != STATE_LAYOUT_VERSION) {
+        ret = ESP_ERR_INVALID_VERSION;
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to load player state: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    uint8_t active_quest_count = (uint8_t)(header >> 8);
+    state->completed_quest_count = (uint8_t)(header >> 16);
+    state->total_score = (uint32_t)(header >> 32);
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    for (int i = 0; i < active_quest_count && i < MAX_QUESTS_PER_PLAYER; i++) {
+        uint64_t value;
+        slot_key(STATE_SLOT_KEY, i, key, sizeof(key));
+        if (nvs_get_u64(nvs_handle, key, &value) != ESP_OK) {
+            ESP_LOGW(TAG, "Quest slot %d unreadable, keeping %d quests", i, i);
+            break;
+        }
+        unpack_quest(value, &state->quests[i]);
+        state->active_quest_count = i + 1;
+    }
+
+    ESP_LOGD(TAG, "Player state loaded (%d quests)", state->active_quest_count);
+    return ESP_OK;
+}
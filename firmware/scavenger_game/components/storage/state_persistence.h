@@ -0,0 +1,59 @@
+#ifndef STATE_PERSISTENCE_H
+#define STATE_PERSISTENCE_H
+
+#include "stdint.h"
+#include "esp_err.h"
+#include "quest_system.h"
+
+// Write-back persistence of player_state_t. The quest system marks what it
+// changed; changes are batched and flushed in one NVS commit once the oldest
+// has waited max_delay_ms, once max_changes have piled up, or right away
+// through state_persistence_flush() (activation, completion). Each quest slot
+// is its own NVS key, packed into a u64 (one 32-byte NVS entry), so a flush
+// writes only the slots that changed.
+//
+// On power loss at most max_changes - 1 changes are lost, none older than
+// max_delay_ms; forced flushes are never lost once they have returned. A
+// failed flush keeps its changes pending and is retried every
+// STATE_PERSIST_RETRY_MS, so while NVS fails those bounds do not hold.
+
+#ifndef STATE_PERSIST_MAX_DELAY_MS
+#define STATE_PERSIST_MAX_DELAY_MS  60000
+#endif
+#ifndef STATE_PERSIST_MAX_CHANGES
+#define STATE_PERSIST_MAX_CHANGES   32
+#endif
+// Wait after a failed flush before poll() tries again
+#ifndef STATE_PERSIST_RETRY_MS
+#define STATE_PERSIST_RETRY_MS      10000
+#endif
+
+// Dirty bits, one per player quest slot. The counts and score go out with
+// every flush; NVS skips them when they have not changed.
+#define STATE_DIRTY_SLOT(i)         (1u << (i))
+#define STATE_DIRTY_ALL             0xFFFFFFFFu
+
+_Static_assert(MAX_QUESTS_PER_PLAYER <= 32, "Dirty mask holds a bit per quest slot");
+
+typedef struct {
+    uint32_t max_delay_ms;          // 0: flush every change
+    uint16_t max_changes;           // 0 or 1: flush every change
+} state_persist_policy_t;
+
+// Called from the quest task only; needs nvs_flash_init() first
+esp_err_t state_persistence_init(void);
+// Loads the saved state, migrating the single blob older firmware wrote
+esp_err_t state_persistence_load(player_state_t* state);
+void state_persistence_set_policy(const state_persist_policy_t* policy);
+
+// Records a change to the quest slots in dirty (STATE_DIRTY_* bits)
+void state_persistence_mark(uint32_t dirty);
+// Flushes when the policy says so; call every quest tick
+esp_err_t state_persistence_poll(const player_state_t* state);
+// Flushes pending changes now
+esp_err_t state_persistence_flush(const player_state_t* state);
+// Time until poll() will flush; UINT32_MAX when nothing is pending or
+// state_persistence_init() has not succeeded
+uint32_t state_persistence_ms_until_due(void);
+
+#endif // STATE_PERSISTENCE_H
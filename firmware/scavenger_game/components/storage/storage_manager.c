@@ -6,6 +6,7 @@
 #include "driver/sdmmc_host.h"
 #include "driver/sdspi_host.h"
 #include "sdmmc_cmd.h"
+#include <string.h>
 
 static const char *TAG = "STORAGE_MANAGER";
 
@@ -14,8 +15,8 @@ static bool nvs_initialized = false;
 static sdmmc_card_t* card = NULL;
 static bool sd_mounted = false;
 
-#define STORAGE_NAMESPACE "scavenger_sensory_hunt"
-#define PLAYER_STATE_KEY "player_state"
+// NVS keys are limited to 15 characters; player state keys are in
+// state_persistence.c
 #define QUEST_DATA_KEY "quest_data"
 
 esp_err_t storage_manager_init(void)
@@ -36,51 +37,6 @@ esp_err_t storage_manager_init(void)
     return ESP_OK;
 }
 
-esp_err_t storage_manager_save_player_state(const player_state_t* state)
-{
-    if (!nvs_initialized || !state) {
-        return ESP_ERR_INVALID_STATE;
-    }
-
-    esp_err_t ret = nvs_set_blob(nvs_handle, PLAYER_STATE_KEY, state, sizeof(player_state_t));
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to save player state: %s", esp_err_to_name(ret));
-        return ret;
-    }
-
-    ret = nvs_commit(nvs_handle);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to commit player state: %s", esp_err_to_name(ret));
-        return ret;
-    }
-
-    ESP_LOGD(TAG, "Player state saved successfully");
-    return ESP_OK;
-}
-
-esp_err_t storage_manager_load_player_state(player_state_t* state)
-{
-    if (!nvs_initialized || !state) {
-        return ESP_ERR_INVALID_STATE;
-    }
-
-    size_t required_size = sizeof(player_state_t);
-    esp_err_t ret = nvs_get_blob(nvs_handle, PLAYER_STATE_KEY, state, &required_size);
-    
-    if (ret == ESP_ERR_NVS_NOT_FOUND) {
-        // Initialize with default values
-        memset(state, 0, sizeof(player_state_t));
-        ESP_LOGI(TAG, "No saved player state found, initializing with defaults");
-        return ESP_OK;
-    } else if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to load player state: %s", esp_err_to_name(ret));
-        return ret;
-    }
-
-    ESP_LOGD(TAG, "Player state loaded successfully");
-    return ESP_OK;
-}
-
 esp_err_t storage_manager_save_quest_data(const void* data, size_t length)
 {
     if (!nvs_initialized || !data || length == 0) {
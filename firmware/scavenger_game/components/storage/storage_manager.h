@@ -5,9 +5,11 @@
 #include "esp_err.h"
 #include "quest_system.h"
 
+// NVS namespace of the game's data, at most 15 characters
+#define STORAGE_NAMESPACE "scavenger_hunt"
+
 esp_err_t storage_manager_init(void);
-esp_err_t storage_manager_save_player_state(const player_state_t* state);
-esp_err_t storage_manager_load_player_state(player_state_t* state);
+// Player state is saved by state_persistence.h
 esp_err_t storage_manager_save_quest_data(const void* data, size_t length);
 esp_err_t storage_manager_load_quest_data(void* data, size_t length);
 esp_err_t storage_manager_clear_all_data(void);
@@ -0,0 +1,74 @@
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+esp_log_level_t esp_log_host_level = ESP_LOG_INFO;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    (void)tag;
+    esp_log_host_level = level;
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    (void)level;
+    (void)tag;
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_FAIL: return "ESP_FAIL";
+    case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_RESPONSE: return "ESP_ERR_INVALID_RESPONSE";
+    case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+    case ESP_ERR_INVALID_VERSION: return "ESP_ERR_INVALID_VERSION";
+    default: return "UNKNOWN ERROR";
+    }
+}
+
+void esp_error_check_failed(esp_err_t rc, const char *file, int line, const char *expression)
+{
+    fprintf(stderr, "ESP_ERROR_CHECK failed: %s (0x%x) at %s:%d\n  %s\n",
+            esp_err_to_name(rc), rc, file, line, expression);
+    abort();
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    (void)caps;
+    return malloc(size);
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+    (void)caps;
+    return calloc(n, size);
+}
+
+void heap_caps_free(void *ptr)
+{
+    free(ptr);
+}
+
+void heap_caps_get_info(multi_heap_info_t *info, uint32_t caps)
+{
+    (void)caps;
+    // No heap accounting on the host; report an empty heap
+    *info = (multi_heap_info_t){0};
+}
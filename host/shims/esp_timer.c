@@ -0,0 +1,202 @@
+#include "esp_timer.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    int64_t expiry_us;
+    uint64_t period_us;             // 0 for one-shot
+    bool armed;
+    struct esp_timer *next;         // All created timers
+};
+
+static pthread_mutex_t timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t timer_cond;
+static pthread_once_t timer_once = PTHREAD_ONCE_INIT;
+static struct esp_timer *timers = NULL;
+static struct timespec start_time;
+static int64_t skew_us = 0;         // esp_timer_host_advance()
+
+static void *dispatcher(void *arg);
+
+static void timer_module_init(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&timer_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, dispatcher, NULL);
+    pthread_detach(thread);
+}
+
+int64_t esp_timer_get_time(void)
+{
+    pthread_once(&timer_once, timer_module_init);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)(now.tv_sec - start_time.tv_sec) * 1000000 + (now.tv_nsec - start_time.tv_nsec) / 1000 +
+           __atomic_load_n(&skew_us, __ATOMIC_RELAXED);
+}
+
+void esp_timer_host_advance(int64_t us)
+{
+    pthread_once(&timer_once, timer_module_init);
+    pthread_mutex_lock(&timer_lock);
+    __atomic_add_fetch(&skew_us, us, __ATOMIC_RELAXED);
+    // Let the dispatcher recompute its deadline
+    pthread_cond_signal(&timer_cond);
+    pthread_mutex_unlock(&timer_lock);
+}
+
+static struct esp_timer *earliest_armed(void)
+{
+    struct esp_timer *best = NULL;
+    for (struct esp_timer *t = timers; t; t = t->next) {
+        if (t->armed && (!best || t->expiry_us < best->expiry_us)) {
+            best = t;
+        }
+    }
+    return best;
+}
+
+static void *dispatcher(void *arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&timer_lock);
+    for (;;) {
+        struct esp_timer *t = earliest_armed();
+        if (!t) {
+            pthread_cond_wait(&timer_cond, &timer_lock);
+            continue;
+        }
+
+        int64_t now = esp_timer_get_time();
+        if (t->expiry_us > now) {
+            // Wall-clock deadline: expiry without the simulated skew
+            int64_t expiry_us = t->expiry_us - __atomic_load_n(&skew_us, __ATOMIC_RELAXED);
+            struct timespec deadline = start_time;
+            int64_t ns = (int64_t)deadline.tv_nsec + (expiry_us % 1000000) * 1000;
+            deadline.tv_sec += expiry_us / 1000000 + ns / 1000000000;
+            deadline.tv_nsec = ns % 1000000000;
+            pthread_cond_timedwait(&timer_cond, &timer_lock, &deadline);
+            continue;
+        }
+
+        if (t->period_us) {
+            t->expiry_us += (int64_t)t->period_us;
+        } else {
+            t->armed = false;
+        }
+
+        // Run without the lock so callbacks can re-arm or stop timers
+        esp_timer_cb_t callback = t->callback;
+        void *cb_arg = t->arg;
+        pthread_mutex_unlock(&timer_lock);
+        callback(cb_arg);
+        pthread_mutex_lock(&timer_lock);
+    }
+    return NULL;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    if (!create_args || !create_args->callback || !out_handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_once(&timer_once, timer_module_init);
+
+    struct esp_timer *t = calloc(1, sizeof(*t));
+    if (!t) {
+        return ESP_ERR_NO_MEM;
+    }
+    t->callback = create_args->callback;
+    t->arg = create_args->arg;
+
+    pthread_mutex_lock(&timer_lock);
+    t->next = timers;
+    timers = t;
+    pthread_mutex_unlock(&timer_lock);
+
+    *out_handle = t;
+    return ESP_OK;
+}
+
+static esp_err_t start(esp_timer_handle_t timer, uint64_t timeout_us, uint64_t period_us)
+{
+    if (!timer) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&timer_lock);
+    if (timer->armed) {
+        pthread_mutex_unlock(&timer_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->expiry_us = esp_timer_get_time() + (int64_t)timeout_us;
+    timer->period_us = period_us;
+    timer->armed = true;
+    pthread_cond_signal(&timer_cond);
+    pthread_mutex_unlock(&timer_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return start(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+    return start(timer, period_us, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (!timer) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&timer_lock);
+    esp_err_t ret = timer->armed ? ESP_OK : ESP_ERR_INVALID_STATE;
+    timer->armed = false;
+    pthread_mutex_unlock(&timer_lock);
+    return ret;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    if (!timer) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&timer_lock);
+    if (timer->armed) {
+        pthread_mutex_unlock(&timer_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    for (struct esp_timer **p = &timers; *p; p = &(*p)->next) {
+        if (*p == timer) {
+            *p = timer->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&timer_lock);
+    free(timer);
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    pthread_mutex_lock(&timer_lock);
+    bool armed = timer && timer->armed;
+    pthread_mutex_unlock(&timer_lock);
+    return armed;
+}
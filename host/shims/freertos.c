@@ -0,0 +1,264 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "esp_timer.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+
+typedef struct {
+    TaskFunction_t task;
+    void *arg;
+} task_start_t;
+
+struct host_semaphore {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    UBaseType_t count;
+    UBaseType_t max_count;
+};
+
+struct host_event_group {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    EventBits_t bits;
+};
+
+// Absolute CLOCK_MONOTONIC deadline for a FreeRTOS timeout
+static struct timespec deadline_after(TickType_t ticks)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t ms = (uint64_t)ticks * portTICK_PERIOD_MS;
+    ts.tv_sec += ms / 1000;
+    ts.tv_nsec += (long)(ms % 1000) * 1000000;
+    if (ts.tv_nsec >= 1000000000) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+    return ts;
+}
+
+static void cond_init_monotonic(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+// Wait on cond until it is signalled or the timeout expires; false on timeout
+static bool cond_wait_ticks(pthread_cond_t *cond, pthread_mutex_t *lock, TickType_t ticks,
+                            const struct timespec *deadline)
+{
+    if (ticks == 0) {
+        return false;
+    }
+    if (ticks == portMAX_DELAY) {
+        pthread_cond_wait(cond, lock);
+        return true;
+    }
+    return pthread_cond_timedwait(cond, lock, deadline) != ETIMEDOUT;
+}
+
+static void *task_trampoline(void *arg)
+{
+    task_start_t start = *(task_start_t *)arg;
+    free(arg);
+    start.task(start.arg);
+    return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t task, const char *name, uint32_t stack_depth,
+                       void *arg, UBaseType_t priority, TaskHandle_t *created_task)
+{
+    (void)name;
+    (void)stack_depth;
+    (void)priority;
+
+    task_start_t *start = malloc(sizeof(*start));
+    if (!start) {
+        return pdFAIL;
+    }
+    start->task = task;
+    start->arg = arg;
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, task_trampoline, start) != 0) {
+        free(start);
+        return pdFAIL;
+    }
+    pthread_detach(thread);
+    if (created_task) {
+        *created_task = NULL;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char *name, uint32_t stack_depth,
+                                   void *arg, UBaseType_t priority, TaskHandle_t *created_task, BaseType_t core_id)
+{
+    (void)core_id;
+    return xTaskCreate(task, name, stack_depth, arg, priority, created_task);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    (void)task;
+    pthread_exit(NULL);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    uint64_t ms = (uint64_t)ticks * portTICK_PERIOD_MS;
+    struct timespec ts = {
+        .tv_sec = (time_t)(ms / 1000),
+        .tv_nsec = (long)(ms % 1000) * 1000000,
+    };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(esp_timer_get_time() / 1000 / portTICK_PERIOD_MS);
+}
+
+static SemaphoreHandle_t semaphore_create(UBaseType_t max_count, UBaseType_t initial_count)
+{
+    struct host_semaphore *sem = calloc(1, sizeof(*sem));
+    if (!sem) {
+        return NULL;
+    }
+    pthread_mutex_init(&sem->lock, NULL);
+    cond_init_monotonic(&sem->cond);
+    sem->count = initial_count;
+    sem->max_count = max_count;
+    return sem;
+}
+
+// Mutexes are modelled as a binary semaphore that starts available; the
+// firmware never relies on priority inheritance or recursive locking
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return semaphore_create(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return semaphore_create(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count)
+{
+    return semaphore_create(max_count, initial_count);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks_to_wait)
+{
+    struct timespec deadline = deadline_after(ticks_to_wait);
+
+    pthread_mutex_lock(&sem->lock);
+    while (sem->count == 0) {
+        if (!cond_wait_ticks(&sem->cond, &sem->lock, ticks_to_wait, &deadline)) {
+            pthread_mutex_unlock(&sem->lock);
+            return pdFALSE;
+        }
+    }
+    sem->count--;
+    pthread_mutex_unlock(&sem->lock);
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    pthread_mutex_lock(&sem->lock);
+    if (sem->count >= sem->max_count) {
+        pthread_mutex_unlock(&sem->lock);
+        return pdFALSE;
+    }
+    sem->count++;
+    pthread_cond_signal(&sem->cond);
+    pthread_mutex_unlock(&sem->lock);
+    return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    pthread_cond_destroy(&sem->cond);
+    pthread_mutex_destroy(&sem->lock);
+    free(sem);
+}
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+    struct host_event_group *group = calloc(1, sizeof(*group));
+    if (!group) {
+        return NULL;
+    }
+    pthread_mutex_init(&group->lock, NULL);
+    cond_init_monotonic(&group->cond);
+    return group;
+}
+
+void vEventGroupDelete(EventGroupHandle_t group)
+{
+    pthread_cond_destroy(&group->cond);
+    pthread_mutex_destroy(&group->lock);
+    free(group);
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits_to_wait_for,
+                                BaseType_t clear_on_exit, BaseType_t wait_for_all, TickType_t ticks_to_wait)
+{
+    struct timespec deadline = deadline_after(ticks_to_wait);
+
+    pthread_mutex_lock(&group->lock);
+    for (;;) {
+        EventBits_t set = group->bits & bits_to_wait_for;
+        bool satisfied = wait_for_all ? (set == bits_to_wait_for) : (set != 0);
+        if (satisfied) {
+            EventBits_t bits = group->bits;
+            if (clear_on_exit) {
+                group->bits &= ~bits_to_wait_for;
+            }
+            pthread_mutex_unlock(&group->lock);
+            return bits;
+        }
+        if (!cond_wait_ticks(&group->cond, &group->lock, ticks_to_wait, &deadline)) {
+            EventBits_t bits = group->bits;
+            pthread_mutex_unlock(&group->lock);
+            return bits;
+        }
+    }
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    pthread_mutex_lock(&group->lock);
+    group->bits |= bits;
+    EventBits_t result = group->bits;
+    pthread_cond_broadcast(&group->cond);
+    pthread_mutex_unlock(&group->lock);
+    return result;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    pthread_mutex_lock(&group->lock);
+    EventBits_t previous = group->bits;
+    group->bits &= ~bits;
+    pthread_mutex_unlock(&group->lock);
+    return previous;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group)
+{
+    pthread_mutex_lock(&group->lock);
+    EventBits_t bits = group->bits;
+    pthread_mutex_unlock(&group->lock);
+    return bits;
+}
@@ -0,0 +1,43 @@
+#include "driver/i2c.h"
+
+esp_err_t i2c_param_config(i2c_port_t port, const i2c_config_t *conf)
+{
+    (void)port;
+    return conf ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t i2c_driver_install(i2c_port_t port, i2c_mode_t mode, size_t slv_rx_buf_len,
+                             size_t slv_tx_buf_len, int intr_alloc_flags)
+{
+    (void)port;
+    (void)mode;
+    (void)slv_rx_buf_len;
+    (void)slv_tx_buf_len;
+    (void)intr_alloc_flags;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_write_read_device(i2c_port_t port, uint8_t device_address,
+                                       const uint8_t *write_buffer, size_t write_size,
+                                       uint8_t *read_buffer, size_t read_size, TickType_t ticks_to_wait)
+{
+    (void)port;
+    (void)device_address;
+    (void)write_buffer;
+    (void)write_size;
+    (void)read_buffer;
+    (void)read_size;
+    (void)ticks_to_wait;
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t i2c_master_write_to_device(i2c_port_t port, uint8_t device_address,
+                                     const uint8_t *write_buffer, size_t write_size, TickType_t ticks_to_wait)
+{
+    (void)port;
+    (void)device_address;
+    (void)write_buffer;
+    (void)write_size;
+    (void)ticks_to_wait;
+    return ESP_ERR_NOT_FOUND;
+}
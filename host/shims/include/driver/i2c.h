@@ -0,0 +1,50 @@
+#ifndef DRIVER_I2C_H
+#define DRIVER_I2C_H
+
+// Host build shim: no bus is attached, so device transfers fail with
+// ESP_ERR_NOT_FOUND and the drivers fall back to their placeholder data
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+typedef int i2c_port_t;
+
+typedef enum {
+    I2C_MODE_SLAVE = 0,
+    I2C_MODE_MASTER,
+} i2c_mode_t;
+
+typedef enum {
+    GPIO_PULLUP_DISABLE = 0,
+    GPIO_PULLUP_ENABLE = 1,
+} gpio_pullup_t;
+
+typedef enum {
+    GPIO_NUM_NC = -1,
+    GPIO_NUM_0 = 0, GPIO_NUM_1, GPIO_NUM_2, GPIO_NUM_3, GPIO_NUM_4, GPIO_NUM_5,
+    GPIO_NUM_6, GPIO_NUM_7, GPIO_NUM_8, GPIO_NUM_9, GPIO_NUM_10, GPIO_NUM_11,
+} gpio_num_t;
+
+typedef struct {
+    i2c_mode_t mode;
+    int sda_io_num;
+    int scl_io_num;
+    bool sda_pullup_en;
+    bool scl_pullup_en;
+    union {
+        struct {
+            uint32_t clk_speed;
+        } master;
+    };
+    uint32_t clk_flags;
+} i2c_config_t;
+
+esp_err_t i2c_param_config(i2c_port_t port, const i2c_config_t *conf);
+esp_err_t i2c_driver_install(i2c_port_t port, i2c_mode_t mode, size_t slv_rx_buf_len,
+                             size_t slv_tx_buf_len, int intr_alloc_flags);
+esp_err_t i2c_master_write_read_device(i2c_port_t port, uint8_t device_address,
+                                       const uint8_t *write_buffer, size_t write_size,
+                                       uint8_t *read_buffer, size_t read_size, TickType_t ticks_to_wait);
+esp_err_t i2c_master_write_to_device(i2c_port_t port, uint8_t device_address,
+                                     const uint8_t *write_buffer, size_t write_size, TickType_t ticks_to_wait);
+
+#endif // DRIVER_I2C_H
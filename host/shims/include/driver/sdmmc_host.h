@@ -0,0 +1,32 @@
+#ifndef DRIVER_SDMMC_HOST_H
+#define DRIVER_SDMMC_HOST_H
+
+// Host build shim: configuration types only
+#include "sdmmc_cmd.h"
+
+#define SDMMC_HOST_SLOT_1           1
+
+#define SDMMC_HOST_DEFAULT() {                                              \
+        .flags = SDMMC_HOST_FLAG_4BIT | SDMMC_HOST_FLAG_1BIT,               \
+        .slot = SDMMC_HOST_SLOT_1,                                          \
+        .max_freq_khz = SDMMC_FREQ_DEFAULT,                                 \
+    }
+
+typedef struct {
+    int clk;
+    int cmd;
+    int d0;
+    int d1;
+    int d2;
+    int d3;
+    uint8_t width;
+    uint32_t flags;
+} sdmmc_slot_config_t;
+
+#define SDMMC_SLOT_CONFIG_DEFAULT() {                                       \
+        .clk = -1, .cmd = -1, .d0 = -1, .d1 = -1, .d2 = -1, .d3 = -1,       \
+        .width = 0,                                                         \
+        .flags = 0,                                                         \
+    }
+
+#endif // DRIVER_SDMMC_HOST_H
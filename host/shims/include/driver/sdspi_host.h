@@ -0,0 +1,7 @@
+#ifndef DRIVER_SDSPI_HOST_H
+#define DRIVER_SDSPI_HOST_H
+
+// Host build shim: nothing from the SPI card host is used
+#include "sdmmc_cmd.h"
+
+#endif // DRIVER_SDSPI_HOST_H
@@ -0,0 +1,31 @@
+#ifndef ESP_HEAP_CAPS_H
+#define ESP_HEAP_CAPS_H
+
+// Host build shim: capabilities are ignored, everything comes from malloc
+#include <stddef.h>
+#include <stdint.h>
+
+#define MALLOC_CAP_EXEC             (1 << 0)
+#define MALLOC_CAP_32BIT            (1 << 1)
+#define MALLOC_CAP_8BIT             (1 << 2)
+#define MALLOC_CAP_DMA              (1 << 3)
+#define MALLOC_CAP_SPIRAM           (1 << 10)
+#define MALLOC_CAP_INTERNAL         (1 << 11)
+#define MALLOC_CAP_DEFAULT          (1 << 12)
+
+typedef struct {
+    size_t total_free_bytes;
+    size_t total_allocated_bytes;
+    size_t largest_free_block;
+    size_t minimum_free_bytes;
+    size_t allocated_blocks;
+    size_t free_blocks;
+    size_t total_blocks;
+} multi_heap_info_t;
+
+void *heap_caps_malloc(size_t size, uint32_t caps);
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps);
+void heap_caps_free(void *ptr);
+void heap_caps_get_info(multi_heap_info_t *info, uint32_t caps);
+
+#endif // ESP_HEAP_CAPS_H
@@ -0,0 +1,34 @@
+#ifndef ESP_LOG_H
+#define ESP_LOG_H
+
+// Host build shim: printf logging to stderr, filtered by a global level
+#include <stdint.h>
+
+typedef enum {
+    ESP_LOG_NONE = 0,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+extern esp_log_level_t esp_log_host_level;
+
+// Only the "*" tag is supported
+void esp_log_level_set(const char *tag, esp_log_level_t level);
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...);
+
+#define ESP_LOG_LEVEL_HOST(level, letter, tag, format, ...) do {                            \
+        if (esp_log_host_level >= (level)) {                                                \
+            esp_log_write((level), (tag), letter " %s: " format "\n", (tag), ##__VA_ARGS__); \
+        }                                                                                   \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...) ESP_LOG_LEVEL_HOST(ESP_LOG_ERROR, "E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) ESP_LOG_LEVEL_HOST(ESP_LOG_WARN, "W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) ESP_LOG_LEVEL_HOST(ESP_LOG_INFO, "I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) ESP_LOG_LEVEL_HOST(ESP_LOG_DEBUG, "D", tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) ESP_LOG_LEVEL_HOST(ESP_LOG_VERBOSE, "V", tag, format, ##__VA_ARGS__)
+
+#endif // ESP_LOG_H
@@ -0,0 +1,9 @@
+#ifndef ESP_ROM_CRC_H
+#define ESP_ROM_CRC_H
+
+// Host build shim: standard CRC-32 (zlib), as the ROM function computes it
+#include <stdint.h>
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len);
+
+#endif // ESP_ROM_CRC_H
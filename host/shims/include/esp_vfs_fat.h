@@ -0,0 +1,21 @@
+#ifndef ESP_VFS_FAT_H
+#define ESP_VFS_FAT_H
+
+// Host build shim: "mounting" succeeds without a card. Paths under the mount
+// point are not remapped, so host tools pass host paths to the file APIs.
+#include "esp_err.h"
+#include "sdmmc_cmd.h"
+#include "driver/sdmmc_host.h"
+
+typedef struct {
+    bool format_if_mount_failed;
+    int max_files;
+    size_t allocation_unit_size;
+} esp_vfs_fat_sdmmc_mount_config_t;
+
+esp_err_t esp_vfs_fat_sdmmc_mount(const char *base_path, const sdmmc_host_t *host_config,
+                                  const void *slot_config, const esp_vfs_fat_sdmmc_mount_config_t *mount_config,
+                                  sdmmc_card_t **out_card);
+esp_err_t esp_vfs_fat_sdmmc_unmount(const char *base_path, sdmmc_card_t *card);
+
+#endif // ESP_VFS_FAT_H
@@ -0,0 +1,24 @@
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+// Host build shim: FreeRTOS types on top of pthreads, with a 1 kHz tick
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define configTICK_RATE_HZ          1000
+#define portMAX_DELAY               ((TickType_t)0xFFFFFFFFu)
+#define portTICK_PERIOD_MS          (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)           ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+
+#define pdFALSE                     ((BaseType_t)0)
+#define pdTRUE                      ((BaseType_t)1)
+#define pdFAIL                      pdFALSE
+#define pdPASS                      pdTRUE
+
+#define tskIDLE_PRIORITY            0
+
+#endif // FREERTOS_H
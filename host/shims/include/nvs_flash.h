@@ -0,0 +1,11 @@
+#ifndef NVS_FLASH_H
+#define NVS_FLASH_H
+
+// Host build shim: see nvs.h
+#include "nvs.h"
+
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_deinit(void);
+esp_err_t nvs_flash_erase(void);
+
+#endif // NVS_FLASH_H
@@ -0,0 +1,29 @@
+#ifndef SDMMC_CMD_H
+#define SDMMC_CMD_H
+
+// Host build shim: there is no card; see esp_vfs_fat.h
+#include "esp_err.h"
+#include <stdio.h>
+
+#define SDMMC_HOST_FLAG_1BIT        (1 << 0)
+#define SDMMC_HOST_FLAG_4BIT        (1 << 1)
+#define SDMMC_HOST_FLAG_8BIT        (1 << 2)
+#define SDMMC_HOST_FLAG_SPI         (1 << 3)
+
+#define SDMMC_FREQ_DEFAULT          20000
+#define SDMMC_FREQ_HIGHSPEED        40000
+
+typedef struct {
+    uint32_t flags;
+    int slot;
+    int max_freq_khz;
+} sdmmc_host_t;
+
+typedef struct {
+    sdmmc_host_t host;
+    uint64_t capacity_bytes;
+} sdmmc_card_t;
+
+void sdmmc_card_print_info(FILE *stream, const sdmmc_card_t *card);
+
+#endif // SDMMC_CMD_H
@@ -0,0 +1,444 @@
+#include "nvs_flash.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NVS_HOST_MAX_ENTRIES    256
+#define NVS_HOST_MAX_NAMESPACES 16
+#define NVS_HOST_FILE_MAGIC     0x4853564E  // "NVSH"
+
+typedef enum {
+    NVS_TYPE_U8 = 1,
+    NVS_TYPE_U32,
+    NVS_TYPE_I32,
+    NVS_TYPE_STR,
+    NVS_TYPE_BLOB,
+    NVS_TYPE_U64
+} nvs_type_t;
+
+typedef struct {
+    uint8_t ns;                     // Index into namespaces
+    uint8_t type;
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    uint32_t length;
+    uint8_t *data;
+} nvs_entry_t;
+
+static pthread_mutex_t nvs_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool nvs_initialized = false;
+static char *nvs_path = NULL;
+static char namespaces[NVS_HOST_MAX_NAMESPACES][NVS_KEY_NAME_MAX_SIZE];
+static size_t namespace_count = 0;
+static nvs_entry_t entries[NVS_HOST_MAX_ENTRIES];
+static size_t entry_count = 0;
+static nvs_host_stats_t nvs_stats;
+
+#define NVS_HOST_ENTRY_SIZE     32      // Flash entry of the real NVS page format
+
+// Handles are namespace index + 1 for read-write, with bit 8 set for read-only
+#define HANDLE_READONLY         0x100u
+
+static void clear_entries(void)
+{
+    for (size_t i = 0; i < entry_count; i++) {
+        free(entries[i].data);
+    }
+    entry_count = 0;
+    namespace_count = 0;
+}
+
+static int find_namespace(const char *name, bool create)
+{
+    for (size_t i = 0; i < namespace_count; i++) {
+        if (strcmp(namespaces[i], name) == 0) {
+            return (int)i;
+        }
+    }
+    if (!create || namespace_count == NVS_HOST_MAX_NAMESPACES) {
+        return -1;
+    }
+    strcpy(namespaces[namespace_count], name);
+    return (int)namespace_count++;
+}
+
+static nvs_entry_t *find_entry(uint8_t ns, const char *key)
+{
+    for (size_t i = 0; i < entry_count; i++) {
+        if (entries[i].ns == ns && strcmp(entries[i].key, key) == 0) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+static esp_err_t store_entry(uint8_t ns, const char *key, uint8_t type, const void *data, size_t length)
+{
+    nvs_entry_t *entry = find_entry(ns, key);
+    if (entry && entry->type == type && entry->length == length && memcmp(entry->data, data, length) == 0) {
+        return ESP_OK;
+    }
+    if (!entry) {
+        if (entry_count == NVS_HOST_MAX_ENTRIES) {
+            return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        }
+        entry = &entries[entry_count++];
+        memset(entry, 0, sizeof(*entry));
+        entry->ns = ns;
+        strcpy(entry->key, key);
+    }
+
+    uint8_t *copy = malloc(length ? length : 1);
+    if (!copy) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(copy, data, length);
+    free(entry->data);
+    entry->data = copy;
+    entry->type = type;
+    entry->length = (uint32_t)length;
+    return ESP_OK;
+}
+
+static esp_err_t load_file(void)
+{
+    FILE *f = fopen(nvs_path, "rb");
+    if (!f) {
+        return ESP_OK;              // Nothing saved yet
+    }
+
+    uint32_t header[2];
+    esp_err_t ret = ESP_OK;
+    if (fread(header, sizeof(header), 1, f) != 1 || header[0] != NVS_HOST_FILE_MAGIC) {
+        ret = ESP_ERR_NVS_NEW_VERSION_FOUND;
+    }
+    for (uint32_t i = 0; ret == ESP_OK && i < header[1]; i++) {
+        char ns[NVS_KEY_NAME_MAX_SIZE];
+        nvs_entry_t entry;
+        if (fread(ns, sizeof(ns), 1, f) != 1 || fread(entry.key, sizeof(entry.key), 1, f) != 1 ||
+            fread(&entry.type, 1, 1, f) != 1 || fread(&entry.length, sizeof(entry.length), 1, f) != 1) {
+            ret = ESP_ERR_NVS_NEW_VERSION_FOUND;
+            break;
+        }
+        ns[sizeof(ns) - 1] = '\0';
+        entry.key[sizeof(entry.key) - 1] = '\0';
+        uint8_t *data = malloc(entry.length ? entry.length : 1);
+        int index = find_namespace(ns, true);
+        if (!data || index < 0 || fread(data, 1, entry.length, f) != entry.length) {
+            free(data);
+            ret = ESP_ERR_NVS_NEW_VERSION_FOUND;
+            break;
+        }
+        ret = store_entry((uint8_t)index, entry.key, entry.type, data, entry.length);
+        free(data);
+    }
+    fclose(f);
+    return ret;
+}
+
+static esp_err_t save_file(void)
+{
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", nvs_path);
+    FILE *f = fopen(tmp, "wb");
+    if (!f) {
+        return ESP_FAIL;
+    }
+
+    uint32_t header[2] = { NVS_HOST_FILE_MAGIC, (uint32_t)entry_count };
+    bool ok = fwrite(header, sizeof(header), 1, f) == 1;
+    for (size_t i = 0; ok && i < entry_count; i++) {
+        const nvs_entry_t *entry = &entries[i];
+        ok = fwrite(namespaces[entry->ns], NVS_KEY_NAME_MAX_SIZE, 1, f) == 1 &&
+             fwrite(entry->key, sizeof(entry->key), 1, f) == 1 &&
+             fwrite(&entry->type, 1, 1, f) == 1 &&
+             fwrite(&entry->length, sizeof(entry->length), 1, f) == 1 &&
+             fwrite(entry->data, 1, entry->length, f) == entry->length;
+    }
+    if (fclose(f) != 0 || !ok) {
+        remove(tmp);
+        return ESP_FAIL;
+    }
+    // Replace atomically so a crash mid-commit keeps the previous state
+    return rename(tmp, nvs_path) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+void nvs_host_set_path(const char *path)
+{
+    pthread_mutex_lock(&nvs_lock);
+    free(nvs_path);
+    nvs_path = path ? strdup(path) : NULL;
+    pthread_mutex_unlock(&nvs_lock);
+}
+
+void nvs_host_get_stats(nvs_host_stats_t *stats)
+{
+    pthread_mutex_lock(&nvs_lock);
+    *stats = nvs_stats;
+    pthread_mutex_unlock(&nvs_lock);
+}
+
+void nvs_host_reset_stats(void)
+{
+    pthread_mutex_lock(&nvs_lock);
+    memset(&nvs_stats, 0, sizeof(nvs_stats));
+    pthread_mutex_unlock(&nvs_lock);
+}
+
+esp_err_t nvs_flash_init(void)
+{
+    pthread_mutex_lock(&nvs_lock);
+    esp_err_t ret = ESP_OK;
+    if (!nvs_initialized) {
+        clear_entries();
+        ret = nvs_path ? load_file() : ESP_OK;
+        nvs_initialized = ret == ESP_OK;
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return ret;
+}
+
+esp_err_t nvs_flash_deinit(void)
+{
+    pthread_mutex_lock(&nvs_lock);
+    esp_err_t ret = nvs_initialized ? ESP_OK : ESP_ERR_NVS_NOT_INITIALIZED;
+    clear_entries();
+    nvs_initialized = false;
+    pthread_mutex_unlock(&nvs_lock);
+    return ret;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    pthread_mutex_lock(&nvs_lock);
+    clear_entries();
+    nvs_initialized = false;
+    if (nvs_path) {
+        remove(nvs_path);
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    if (!name || !out_handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (strlen(name) >= NVS_KEY_NAME_MAX_SIZE) {
+        return ESP_ERR_NVS_KEY_TOO_LONG;
+    }
+
+    pthread_mutex_lock(&nvs_lock);
+    esp_err_t ret = ESP_OK;
+    int index = -1;
+    if (!nvs_initialized) {
+        ret = ESP_ERR_NVS_NOT_INITIALIZED;
+    } else if ((index = find_namespace(name, open_mode == NVS_READWRITE)) < 0) {
+        ret = open_mode == NVS_READWRITE ? ESP_ERR_NVS_NOT_ENOUGH_SPACE : ESP_ERR_NVS_NOT_FOUND;
+    } else {
+        *out_handle = (nvs_handle_t)(index + 1) | (open_mode == NVS_READONLY ? HANDLE_READONLY : 0);
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return ret;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    (void)handle;
+}
+
+// Resolves a handle to its namespace; caller holds nvs_lock
+static esp_err_t handle_namespace(nvs_handle_t handle, bool write, uint8_t *ns)
+{
+    uint32_t index = (handle & ~HANDLE_READONLY);
+    if (!nvs_initialized || index == 0 || index > namespace_count) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (write && (handle & HANDLE_READONLY)) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    *ns = (uint8_t)(index - 1);
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    pthread_mutex_lock(&nvs_lock);
+    uint8_t ns;
+    esp_err_t ret = handle_namespace(handle, false, &ns);
+    if (ret == ESP_OK) {
+        nvs_stats.commits++;
+        if (nvs_path) {
+            ret = save_file();
+        }
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return ret;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    pthread_mutex_lock(&nvs_lock);
+    uint8_t ns;
+    esp_err_t ret = handle_namespace(handle, true, &ns);
+    if (ret == ESP_OK) {
+        nvs_entry_t *entry = key ? find_entry(ns, key) : NULL;
+        if (!entry) {
+            ret = ESP_ERR_NVS_NOT_FOUND;
+        } else {
+            free(entry->data);
+            *entry = entries[--entry_count];
+        }
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return ret;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle)
+{
+    pthread_mutex_lock(&nvs_lock);
+    uint8_t ns;
+    esp_err_t ret = handle_namespace(handle, true, &ns);
+    for (size_t i = 0; ret == ESP_OK && i < entry_count;) {
+        if (entries[i].ns == ns) {
+            free(entries[i].data);
+            entries[i] = entries[--entry_count];
+        } else {
+            i++;
+        }
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return ret;
+}
+
+// Flash the real NVS spends on a value: one entry for a primitive; a header
+// entry plus whole data entries for a string, and a blob index entry on top
+// for a blob
+static size_t flash_size(uint8_t type, size_t length)
+{
+    if (type != NVS_TYPE_STR && type != NVS_TYPE_BLOB) {
+        return NVS_HOST_ENTRY_SIZE;
+    }
+    size_t data = (length + NVS_HOST_ENTRY_SIZE - 1) / NVS_HOST_ENTRY_SIZE * NVS_HOST_ENTRY_SIZE;
+    return NVS_HOST_ENTRY_SIZE * (type == NVS_TYPE_BLOB ? 2 : 1) + data;
+}
+
+static esp_err_t set_value(nvs_handle_t handle, const char *key, uint8_t type, const void *data, size_t length)
+{
+    if (!key || !data) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (strlen(key) >= NVS_KEY_NAME_MAX_SIZE) {
+        return ESP_ERR_NVS_KEY_TOO_LONG;
+    }
+
+    pthread_mutex_lock(&nvs_lock);
+    uint8_t ns;
+    esp_err_t ret = handle_namespace(handle, true, &ns);
+    if (ret == ESP_OK) {
+        const nvs_entry_t *entry = find_entry(ns, key);
+        bool unchanged = entry && entry->type == type && entry->length == length &&
+                         memcmp(entry->data, data, length) == 0;
+        ret = store_entry(ns, key, type, data, length);
+        if (ret == ESP_OK && unchanged) {
+            nvs_stats.unchanged_writes++;
+        } else if (ret == ESP_OK) {
+            nvs_stats.writes++;
+            nvs_stats.bytes_written += length;
+            nvs_stats.flash_bytes += flash_size(type, length);
+        }
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return ret;
+}
+
+static esp_err_t get_value(nvs_handle_t handle, const char *key, uint8_t type, void *out, size_t *length, bool exact)
+{
+    if (!key || !length) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&nvs_lock);
+    uint8_t ns;
+    esp_err_t ret = handle_namespace(handle, false, &ns);
+    const nvs_entry_t *entry = ret == ESP_OK ? find_entry(ns, key) : NULL;
+    if (ret == ESP_OK && !entry) {
+        ret = ESP_ERR_NVS_NOT_FOUND;
+    } else if (ret == ESP_OK && entry->type != type) {
+        ret = ESP_ERR_NVS_TYPE_MISMATCH;
+    } else if (ret == ESP_OK && !out && !exact) {
+        *length = entry->length;
+    } else if (ret == ESP_OK && (exact ? *length != entry->length : *length < entry->length)) {
+        ret = ESP_ERR_NVS_INVALID_LENGTH;
+    } else if (ret == ESP_OK) {
+        memcpy(out, entry->data, entry->length);
+        *length = entry->length;
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return ret;
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char *key, uint8_t value)
+{
+    return set_value(handle, key, NVS_TYPE_U8, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value)
+{
+    return set_value(handle, key, NVS_TYPE_U32, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_i32(nvs_handle_t handle, const char *key, int32_t value)
+{
+    return set_value(handle, key, NVS_TYPE_I32, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_u64(nvs_handle_t handle, const char *key, uint64_t value)
+{
+    return set_value(handle, key, NVS_TYPE_U64, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value)
+{
+    return set_value(handle, key, NVS_TYPE_STR, value, value ? strlen(value) + 1 : 0);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    return set_value(handle, key, NVS_TYPE_BLOB, value, length);
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char *key, uint8_t *out_value)
+{
+    size_t length = sizeof(*out_value);
+    return out_value ? get_value(handle, key, NVS_TYPE_U8, out_value, &length, true) : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out_value)
+{
+    size_t length = sizeof(*out_value);
+    return out_value ? get_value(handle, key, NVS_TYPE_U32, out_value, &length, true) : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t nvs_get_i32(nvs_handle_t handle, const char *key, int32_t *out_value)
+{
+    size_t length = sizeof(*out_value);
+    return out_value ? get_value(handle, key, NVS_TYPE_I32, out_value, &length, true) : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t nvs_get_u64(nvs_handle_t handle, const char *key, uint64_t *out_value)
+{
+    size_t length = sizeof(*out_value);
+    return out_value ? get_value(handle, key, NVS_TYPE_U64, out_value, &length, true) : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out_value, size_t *length)
+{
+    return get_value(handle, key, NVS_TYPE_STR, out_value, length, false);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    return get_value(handle, key, NVS_TYPE_BLOB, out_value, length, false);
+}
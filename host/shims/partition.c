@@ -0,0 +1,216 @@
+#include "esp_partition.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define HOST_MAX_PARTITIONS     4
+#define HOST_MAX_MAPPINGS       16
+#define HOST_ERASE_SIZE         4096
+
+typedef struct {
+    esp_partition_t partition;
+    int fd;
+} host_partition_t;
+
+typedef struct {
+    void *base;                     // NULL when the slot is free
+    size_t length;
+} host_mapping_t;
+
+static pthread_mutex_t partition_lock = PTHREAD_MUTEX_INITIALIZER;
+static host_partition_t partitions[HOST_MAX_PARTITIONS];
+static size_t partition_count = 0;
+static host_mapping_t mappings[HOST_MAX_MAPPINGS];
+
+static int partition_fd(const esp_partition_t *partition)
+{
+    for (size_t i = 0; i < partition_count; i++) {
+        if (&partitions[i].partition == partition) {
+            return partitions[i].fd;
+        }
+    }
+    return -1;
+}
+
+static bool in_partition(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    return offset <= partition->size && size <= partition->size - offset;
+}
+
+esp_err_t esp_partition_host_attach(const char *label, const char *path, size_t size)
+{
+    if (!label || !path || size == 0 || strlen(label) >= sizeof(partitions[0].partition.label)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    struct stat st;
+    fstat(fd, &st);
+    // Grow with erased flash
+    uint8_t erased[HOST_ERASE_SIZE];
+    memset(erased, 0xFF, sizeof(erased));
+    for (off_t pos = st.st_size; pos < (off_t)size;) {
+        size_t chunk = (size_t)size - (size_t)pos < sizeof(erased) ? (size_t)size - (size_t)pos : sizeof(erased);
+        if (pwrite(fd, erased, chunk, pos) != (ssize_t)chunk) {
+            close(fd);
+            return ESP_FAIL;
+        }
+        pos += (off_t)chunk;
+    }
+
+    pthread_mutex_lock(&partition_lock);
+    esp_err_t ret = ESP_OK;
+    if (partition_count == HOST_MAX_PARTITIONS) {
+        ret = ESP_ERR_NO_MEM;
+        close(fd);
+    } else {
+        host_partition_t *p = &partitions[partition_count++];
+        memset(p, 0, sizeof(*p));
+        p->fd = fd;
+        p->partition.type = ESP_PARTITION_TYPE_DATA;
+        p->partition.subtype = ESP_PARTITION_SUBTYPE_DATA_SPIFFS;
+        p->partition.size = (uint32_t)size;
+        p->partition.erase_size = HOST_ERASE_SIZE;
+        strcpy(p->partition.label, label);
+    }
+    pthread_mutex_unlock(&partition_lock);
+    return ret;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+    const esp_partition_t *found = NULL;
+    pthread_mutex_lock(&partition_lock);
+    for (size_t i = 0; i < partition_count && !found; i++) {
+        const esp_partition_t *p = &partitions[i].partition;
+        if ((type == ESP_PARTITION_TYPE_ANY || p->type == type) &&
+            (subtype == ESP_PARTITION_SUBTYPE_ANY || p->subtype == subtype) &&
+            // Stored labels end within the field, so this is still an exact match
+            (!label || strncmp(p->label, label, sizeof(p->label)) == 0)) {
+            found = p;
+        }
+    }
+    pthread_mutex_unlock(&partition_lock);
+    return found;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+    int fd = partition ? partition_fd(partition) : -1;
+    if (fd < 0 || !dst) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!in_partition(partition, src_offset, size)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return pread(fd, dst, size, (off_t)src_offset) == (ssize_t)size ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size)
+{
+    int fd = partition ? partition_fd(partition) : -1;
+    if (fd < 0 || !src) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!in_partition(partition, dst_offset, size)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    // NOR flash can only clear bits
+    uint8_t current[HOST_ERASE_SIZE];
+    const uint8_t *in = src;
+    for (size_t done = 0; done < size;) {
+        size_t chunk = size - done < sizeof(current) ? size - done : sizeof(current);
+        if (pread(fd, current, chunk, (off_t)(dst_offset + done)) != (ssize_t)chunk) {
+            return ESP_FAIL;
+        }
+        for (size_t i = 0; i < chunk; i++) {
+            current[i] &= in[done + i];
+        }
+        if (pwrite(fd, current, chunk, (off_t)(dst_offset + done)) != (ssize_t)chunk) {
+            return ESP_FAIL;
+        }
+        done += chunk;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    int fd = partition ? partition_fd(partition) : -1;
+    if (fd < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!in_partition(partition, offset, size) || offset % HOST_ERASE_SIZE || size % HOST_ERASE_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    uint8_t erased[HOST_ERASE_SIZE];
+    memset(erased, 0xFF, sizeof(erased));
+    for (size_t done = 0; done < size; done += sizeof(erased)) {
+        if (pwrite(fd, erased, sizeof(erased), (off_t)(offset + done)) != (ssize_t)sizeof(erased)) {
+            return ESP_FAIL;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t *partition, size_t offset, size_t size,
+                             esp_partition_mmap_memory_t memory, const void **out_ptr,
+                             esp_partition_mmap_handle_t *out_handle)
+{
+    (void)memory;
+    int fd = partition ? partition_fd(partition) : -1;
+    if (fd < 0 || !out_ptr || !out_handle || size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!in_partition(partition, offset, size)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Like the MMU, map whole pages and point into them
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t delta = offset % page;
+    void *base = mmap(NULL, size + delta, PROT_READ, MAP_SHARED, fd, (off_t)(offset - delta));
+    if (base == MAP_FAILED) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    pthread_mutex_lock(&partition_lock);
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    for (uint32_t i = 0; i < HOST_MAX_MAPPINGS; i++) {
+        if (!mappings[i].base) {
+            mappings[i].base = base;
+            mappings[i].length = size + delta;
+            *out_handle = i + 1;
+            *out_ptr = (const uint8_t *)base + delta;
+            ret = ESP_OK;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&partition_lock);
+    if (ret != ESP_OK) {
+        munmap(base, size + delta);
+    }
+    return ret;
+}
+
+void esp_partition_munmap(esp_partition_mmap_handle_t handle)
+{
+    if (handle == 0 || handle > HOST_MAX_MAPPINGS) {
+        return;
+    }
+    pthread_mutex_lock(&partition_lock);
+    host_mapping_t *m = &mappings[handle - 1];
+    if (m->base) {
+        munmap(m->base, m->length);
+        m->base = NULL;
+    }
+    pthread_mutex_unlock(&partition_lock);
+}
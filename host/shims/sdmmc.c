@@ -0,0 +1,27 @@
+#include "esp_vfs_fat.h"
+
+static sdmmc_card_t host_card;
+
+esp_err_t esp_vfs_fat_sdmmc_mount(const char *base_path, const sdmmc_host_t *host_config,
+                                  const void *slot_config, const esp_vfs_fat_sdmmc_mount_config_t *mount_config,
+                                  sdmmc_card_t **out_card)
+{
+    (void)slot_config;
+    (void)mount_config;
+    if (!base_path || !host_config || !out_card) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    host_card.host = *host_config;
+    *out_card = &host_card;
+    return ESP_OK;
+}
+
+esp_err_t esp_vfs_fat_sdmmc_unmount(const char *base_path, sdmmc_card_t *card)
+{
+    return base_path && card == &host_card ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+void sdmmc_card_print_info(FILE *stream, const sdmmc_card_t *card)
+{
+    fprintf(stream, "Name: host (no card)\nSpeed: %d kHz\n", card ? card->host.max_freq_khz : 0);
+}
@@ -0,0 +1,223 @@
+// Time the game's hot paths on the host build.
+//
+//   bench [iterations] [--nvs <file>]
+//
+// Each case runs a warm-up pass and then BENCH_ROUNDS timed rounds; the best
+// and median ns/op are reported. Numbers are for comparing changes on one
+// machine, not predictions of badge timings.
+
+#include "quest_system.h"
+#include "sensor_manager.h"
+#include "storage_manager.h"
+#include "state_persistence.h"
+#include "ml_model_manager.h"
+#include "nvs_flash.h"
+#include "esp_log.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_ROUNDS        5
+#define BENCH_IMU_FRAMES    16      // About one 100 ms tick at the 200 Hz FIFO rate
+
+typedef void (*bench_fn_t)(void *ctx, uint32_t i);
+
+static volatile uint32_t bench_sink;
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void bench_run(const char *name, bench_fn_t fn, void *ctx, uint32_t iterations)
+{
+    double ns_per_op[BENCH_ROUNDS];
+    uint32_t i = 0;
+
+    for (uint32_t warm = 0; warm < iterations / 10 + 1; warm++, i++) {
+        fn(ctx, i);
+    }
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        int64_t start = now_ns();
+        for (uint32_t n = 0; n < iterations; n++, i++) {
+            fn(ctx, i);
+        }
+        ns_per_op[round] = (double)(now_ns() - start) / iterations;
+    }
+
+    qsort(ns_per_op, BENCH_ROUNDS, sizeof(ns_per_op[0]), compare_double);
+    printf("%-32s %10lu %12.1f %12.1f\n", name, (unsigned long)iterations,
+           ns_per_op[0], ns_per_op[BENCH_ROUNDS / 2]);
+}
+
+static void bench_sensor_tick(void *ctx, uint32_t i)
+{
+    (void)ctx;
+    (void)i;
+    sensor_manager_host_tick(true);
+}
+
+typedef struct {
+    sensor_data_t env;
+    bmi270_batch_t imu;
+} replay_input_t;
+
+static void bench_replay_tick(void *ctx, uint32_t i)
+{
+    replay_input_t *input = ctx;
+    uint32_t edges = 0;
+    input->env.voc = 200 + i % 64;
+    sensor_manager_replay_tick((int64_t)i * 100000, &input->env, &input->imu, NULL, &edges);
+    bench_sink += edges;
+}
+
+static void bench_voc_classify(void *ctx, uint32_t i)
+{
+    (void)ctx;
+    ml_inference_result_t result;
+    ml_voc_classify(100 + i % 900, 21.5f, 48.0f, &result);
+    bench_sink += result.classification;
+}
+
+static void bench_quest_update(void *ctx, uint32_t i)
+{
+    (void)ctx;
+    (void)i;
+    quest_system_update();
+}
+
+static void bench_get_player_state(void *ctx, uint32_t i)
+{
+    player_state_t *state = ctx;
+    quest_get_player_state(state);
+    bench_sink += state->quests[i % MAX_QUESTS_PER_PLAYER].progress;
+}
+
+// A quest's progress changed: one slot written
+static void bench_flush_slot(void *ctx, uint32_t i)
+{
+    player_state_t *state = ctx;
+    // A changed value each time; NVS skips writes of identical data
+    state->quests[0].progress = i;
+    state_persistence_mark(STATE_DIRTY_SLOT(0));
+    state_persistence_flush(state);
+}
+
+// Everything changed, as the whole-blob save of older firmware wrote
+static void bench_flush_all(void *ctx, uint32_t i)
+{
+    player_state_t *state = ctx;
+    state->total_score = i;
+    for (int q = 0; q < state->active_quest_count; q++) {
+        state->quests[q].progress = i;
+    }
+    state_persistence_mark(STATE_DIRTY_ALL);
+    state_persistence_flush(state);
+}
+
+static void bench_load_state(void *ctx, uint32_t i)
+{
+    (void)i;
+    state_persistence_load(ctx);
+}
+
+static void run_flush(const char *name, bench_fn_t fn, void *ctx, uint32_t iterations, nvs_host_stats_t *nvs)
+{
+    nvs_host_reset_stats();
+    bench_run(name, fn, ctx, iterations);
+    nvs_host_get_stats(nvs);
+}
+
+static void fill_imu_batch(bmi270_batch_t *batch)
+{
+    memset(batch, 0, sizeof(*batch));
+    batch->count = BENCH_IMU_FRAMES;
+    batch->accel_lsb_per_g = 16384.0f;
+    batch->gyro_lsb_per_dps = 16.4f;
+    for (int f = 0; f < BENCH_IMU_FRAMES; f++) {
+        float phase = f * 0.4f;
+        batch->ax[f] = (int16_t)(2000.0f * sinf(phase));
+        batch->ay[f] = (int16_t)(1500.0f * cosf(phase));
+        batch->az[f] = (int16_t)(16384.0f + 800.0f * sinf(2.0f * phase));
+        batch->gx[f] = (int16_t)(50.0f * sinf(phase));
+        batch->gy[f] = (int16_t)(30.0f * cosf(phase));
+        batch->gz[f] = (int16_t)(10.0f * sinf(3.0f * phase));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t iterations = 100000;
+    const char *nvs_file = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--nvs") == 0 && i + 1 < argc) {
+            nvs_file = argv[++i];
+        } else if (atoi(argv[i]) > 0) {
+            iterations = (uint32_t)atoi(argv[i]);
+        } else {
+            fprintf(stderr, "usage: %s [iterations] [--nvs <file>]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    esp_log_level_set("*", ESP_LOG_WARN);
+    nvs_host_set_path(nvs_file);
+    if (nvs_flash_init() != ESP_OK || storage_manager_init() != ESP_OK ||
+        sensor_manager_init() != ESP_OK || ml_model_init() != ESP_OK) {
+        fprintf(stderr, "init failed\n");
+        return 1;
+    }
+
+    printf("%-32s %10s %12s %12s\n", "case", "iterations", "best ns/op", "median ns/op");
+
+    // Live sampling path: the real timer callback, both sensors read
+    sensor_manager_set_demand(SENSOR_EVENT_ALL);
+    bench_run("sensor_timer_callback", bench_sensor_tick, NULL, iterations);
+
+    // Everything after the reads, with a batched IMU tick; also keeps the
+    // background timer from touching the state benchmarked below
+    static replay_input_t replay_input = {
+        .env = { .temperature = 21.5f, .humidity = 48.0f, .pressure = 1013.0f, .voc = 200 },
+    };
+    fill_imu_batch(&replay_input.imu);
+    sensor_manager_begin_replay();
+    bench_run("sensor_manager_replay_tick", bench_replay_tick, &replay_input, iterations);
+
+    bench_run("ml_voc_classify", bench_voc_classify, NULL, iterations);
+
+    quest_system_init();
+    const uint8_t quests[] = { 1, 2, 3, 4, 6 };
+    for (size_t q = 0; q < sizeof(quests); q++) {
+        quest_activate(quests[q]);
+    }
+    bench_run("quest_system_update", bench_quest_update, NULL, iterations);
+
+    static player_state_t state;
+    quest_get_player_state(&state);
+    bench_run("quest_get_player_state", bench_get_player_state, &state, iterations);
+    uint32_t save_iterations = nvs_file ? iterations / 100 + 1 : iterations;
+    nvs_host_stats_t slot_nvs;
+    nvs_host_stats_t all_nvs;
+    run_flush("state_persistence_flush 1 slot", bench_flush_slot, &state, save_iterations, &slot_nvs);
+    run_flush("state_persistence_flush all", bench_flush_all, &state, save_iterations, &all_nvs);
+    bench_run("state_persistence_load", bench_load_state, &state, iterations);
+
+    sensor_manager_end_replay();
+
+    printf("\nplayer_state_t %zu bytes; NVS flash bytes per flush: %.0f for 1 slot, %.0f for all; %lu commits\n",
+           sizeof(player_state_t), slot_nvs.commits ? (double)slot_nvs.flash_bytes / slot_nvs.commits : 0.0,
+           all_nvs.commits ? (double)all_nvs.flash_bytes / all_nvs.commits : 0.0,
+           (unsigned long)(slot_nvs.commits + all_nvs.commits));
+    return 0;
+}
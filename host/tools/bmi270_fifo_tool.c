@@ -0,0 +1,392 @@
+// BMI270 FIFO decoding (bmi270_driver.h) on hand-built FIFO byte streams,
+// and the burst-read path against a fake device behind bmi270_bus_t.
+//
+//   bmi270_fifo_tool check              every frame type, truncation, the
+//                                       burst path and its error handling
+//   bmi270_fifo_tool bench [iterations] decode and burst-read throughput
+
+#include "bmi270_driver.h"
+#include "esp_log.h"
+#include "tool_common.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Header-mode frame headers and registers, as the datasheet gives them
+#define HDR_ACC_GYR         0x8C
+#define HDR_ACC             0x84
+#define HDR_GYR             0x88
+#define HDR_SKIP            0x40
+#define HDR_SENSORTIME      0x44
+#define HDR_CONFIG_CHANGE   0x48
+#define HDR_DROP            0x50
+#define HDR_EMPTY           0x80
+
+#define REG_CHIP_ID         0x00
+#define REG_FIFO_LENGTH_0   0x24
+#define REG_FIFO_DATA       0x26
+#define REG_ACC_CONF        0x40
+#define REG_GYR_CONF        0x42
+#define REG_FIFO_CONFIG_1   0x49
+#define REG_CMD             0x7E
+
+// FIFO byte stream under construction
+typedef struct {
+    uint8_t data[BMI270_FIFO_SIZE + 64];
+    size_t len;
+} stream_t;
+
+static void put_le16(stream_t *s, int16_t value)
+{
+    s->data[s->len++] = (uint8_t)value;
+    s->data[s->len++] = (uint8_t)((uint16_t)value >> 8);
+}
+
+// Distinct values per frame and axis
+static int16_t axis_value(int frame, int axis)
+{
+    return (int16_t)(frame * 97 - 4000 + axis * 1111 - (axis & 1) * 20000);
+}
+
+// Payload order is gyro x/y/z, then accel x/y/z
+static void put_acc_gyr(stream_t *s, int frame)
+{
+    s->data[s->len++] = HDR_ACC_GYR;
+    for (int axis = 0; axis < 6; axis++) {
+        put_le16(s, axis_value(frame, axis));
+    }
+}
+
+static void put_frame(stream_t *s, uint8_t header, int payload)
+{
+    s->data[s->len++] = header;
+    for (int i = 0; i < payload; i++) {
+        s->data[s->len++] = (uint8_t)(0xA5 + i);
+    }
+}
+
+static bool frame_matches(const bmi270_batch_t *batch, size_t i, int frame)
+{
+    return batch->gx[i] == axis_value(frame, 0) && batch->gy[i] == axis_value(frame, 1) &&
+           batch->gz[i] == axis_value(frame, 2) && batch->ax[i] == axis_value(frame, 3) &&
+           batch->ay[i] == axis_value(frame, 4) && batch->az[i] == axis_value(frame, 5);
+}
+
+// Decodes s into an empty batch and compares the frames with expected[]
+static void expect_decode(const char *name, const stream_t *s, const int *expected, size_t count,
+                          uint32_t skipped)
+{
+    static bmi270_batch_t batch;
+    memset(&batch, 0, sizeof(batch));
+    size_t decoded = bmi270_fifo_decode(s->data, s->len, &batch);
+    bool ok = decoded == count && batch.count == count && batch.skipped_frames == skipped;
+    for (size_t i = 0; ok && i < count; i++) {
+        ok = frame_matches(&batch, i, expected[i]);
+    }
+    printf("%s  %s: %zu frames, %u skipped\n", ok ? "ok  " : "FAIL", name, decoded,
+           (unsigned)batch.skipped_frames);
+    failures += !ok;
+}
+
+static void check_decode(void)
+{
+    stream_t s;
+    const int frames[] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+
+    s.len = 0;
+    for (int f = 0; f < 8; f++) {
+        put_acc_gyr(&s, f);
+    }
+    expect_decode("acc+gyr frames", &s, frames, 8, 0);
+
+    // Skip and drop frames report lost samples and do not end the stream
+    s.len = 0;
+    put_acc_gyr(&s, 0);
+    put_frame(&s, HDR_SKIP, 0);
+    s.data[s.len++] = 5;
+    put_acc_gyr(&s, 1);
+    put_frame(&s, HDR_DROP, 0);
+    s.data[s.len++] = 2;
+    put_acc_gyr(&s, 2);
+    expect_decode("skip and drop frames", &s, frames, 3, 7);
+
+    s.len = 0;
+    put_acc_gyr(&s, 0);
+    put_frame(&s, HDR_SENSORTIME, 3);
+    put_acc_gyr(&s, 1);
+    expect_decode("sensortime frame", &s, frames, 2, 0);
+
+    s.len = 0;
+    put_frame(&s, HDR_CONFIG_CHANGE, 1);
+    put_acc_gyr(&s, 0);
+    put_acc_gyr(&s, 1);
+    expect_decode("config change frame", &s, frames, 2, 0);
+
+    // Accel-only and gyro-only frames around a rate change are dropped
+    s.len = 0;
+    put_acc_gyr(&s, 0);
+    put_frame(&s, HDR_ACC, 6);
+    put_frame(&s, HDR_GYR, 6);
+    put_acc_gyr(&s, 1);
+    expect_decode("partial frames", &s, frames, 2, 0);
+
+    // The empty-FIFO header ends decoding
+    s.len = 0;
+    put_acc_gyr(&s, 0);
+    put_frame(&s, HDR_EMPTY, 0);
+    put_acc_gyr(&s, 1);
+    expect_decode("empty header", &s, frames, 1, 0);
+
+    s.len = 0;
+    put_acc_gyr(&s, 0);
+    put_frame(&s, 0x1F, 0);
+    put_acc_gyr(&s, 1);
+    expect_decode("unknown header", &s, frames, 1, 0);
+
+    // A frame cut off by the end of the read is left alone, for every cut
+    static const struct {
+        const char *name;
+        uint8_t header;
+        int payload;
+    } truncated[] = {
+        { "acc+gyr", HDR_ACC_GYR, 12 },
+        { "acc", HDR_ACC, 6 },
+        { "sensortime", HDR_SENSORTIME, 3 },
+        { "skip", HDR_SKIP, 1 },
+        { "drop", HDR_DROP, 1 },
+        { "config change", HDR_CONFIG_CHANGE, 1 },
+    };
+    for (size_t t = 0; t < sizeof(truncated) / sizeof(truncated[0]); t++) {
+        for (int keep = 0; keep < truncated[t].payload; keep++) {
+            char name[64];
+            snprintf(name, sizeof(name), "truncated %s frame, %d of %d payload bytes", truncated[t].name, keep,
+                     truncated[t].payload);
+            s.len = 0;
+            put_acc_gyr(&s, 0);
+            put_acc_gyr(&s, 1);
+            put_frame(&s, truncated[t].header, keep);
+            expect_decode(name, &s, frames, 2, 0);
+        }
+    }
+
+    // A full FIFO decodes up to BMI270_FIFO_MAX_FRAMES and stops there
+    static int many[BMI270_FIFO_MAX_FRAMES];
+    s.len = 0;
+    for (int f = 0; f < BMI270_FIFO_MAX_FRAMES; f++) {
+        many[f] = f;
+        put_acc_gyr(&s, f);
+    }
+    put_acc_gyr(&s, BMI270_FIFO_MAX_FRAMES);
+    expect_decode("more frames than the batch holds", &s, many, BMI270_FIFO_MAX_FRAMES, 0);
+
+    // Decoding appends to what the batch already holds
+    static bmi270_batch_t batch;
+    memset(&batch, 0, sizeof(batch));
+    s.len = 0;
+    put_acc_gyr(&s, 0);
+    put_acc_gyr(&s, 1);
+    bmi270_fifo_decode(s.data, s.len, &batch);
+    s.len = 0;
+    put_acc_gyr(&s, 2);
+    size_t decoded = bmi270_fifo_decode(s.data, s.len, &batch);
+    bool ok = decoded == 1 && batch.count == 3 && frame_matches(&batch, 2, 2);
+    printf("%s  decode appends: %zu frames\n", ok ? "ok  " : "FAIL", batch.count);
+    failures += !ok;
+}
+
+// Fake BMI270: chip ID, the FIFO length and data registers, and a log of
+// register writes
+typedef struct {
+    uint8_t chip_id;
+    uint8_t regs[128];
+    uint32_t writes;
+    stream_t fifo;
+    size_t reported_len;            // FIFO length register; may differ from fifo.len
+    esp_err_t fail_read;            // Returned for reads of fail_reg
+    uint8_t fail_reg;
+    uint32_t bursts;
+} fake_bmi270_t;
+
+static esp_err_t fake_read(void *ctx, uint8_t reg, uint8_t *data, size_t len)
+{
+    fake_bmi270_t *dev = ctx;
+    if (dev->fail_read != ESP_OK && reg == dev->fail_reg) {
+        return dev->fail_read;
+    }
+    if (reg == REG_CHIP_ID) {
+        memset(data, 0, len);
+        data[0] = dev->chip_id;
+    } else if (reg == REG_FIFO_LENGTH_0 && len == 2) {
+        data[0] = (uint8_t)dev->reported_len;
+        data[1] = (uint8_t)(dev->reported_len >> 8) | 0xC0;   // Reserved bits set
+    } else if (reg == REG_FIFO_DATA) {
+        // Past the end the device returns empty-frame headers
+        size_t n = len < dev->fifo.len ? len : dev->fifo.len;
+        memcpy(data, dev->fifo.data, n);
+        memset(data + n, HDR_EMPTY, len - n);
+        dev->bursts++;
+    } else if (reg + len <= sizeof(dev->regs)) {
+        memcpy(data, &dev->regs[reg], len);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t fake_write(void *ctx, uint8_t reg, const uint8_t *data, size_t len)
+{
+    fake_bmi270_t *dev = ctx;
+    if (reg + len > sizeof(dev->regs)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(&dev->regs[reg], data, len);
+    dev->writes++;
+    return ESP_OK;
+}
+
+static void use_fake(fake_bmi270_t *dev)
+{
+    memset(dev, 0, sizeof(*dev));
+    dev->chip_id = 0x24;
+    bmi270_bus_t bus = { .read = fake_read, .write = fake_write, .ctx = dev };
+    bmi270_set_bus(&bus);
+}
+
+static void check_burst(void)
+{
+    static fake_bmi270_t dev;
+    static bmi270_batch_t batch;
+
+    use_fake(&dev);
+    dev.chip_id = 0x26;
+    expect("wrong chip ID refused", bmi270_fifo_start(BMI270_ODR_200HZ) == ESP_ERR_NOT_FOUND &&
+                                    !bmi270_fifo_is_enabled(), "");
+    expect("bad ODR refused", bmi270_fifo_start((bmi270_odr_t)0x07) == ESP_ERR_INVALID_ARG, "");
+
+    use_fake(&dev);
+    expect("FIFO start", bmi270_fifo_start(BMI270_ODR_200HZ) == ESP_OK && bmi270_fifo_is_enabled(), "");
+    expect("accel and gyro at the FIFO rate, header mode, FIFO flushed",
+           (dev.regs[REG_ACC_CONF] & 0x0F) == BMI270_ODR_200HZ && (dev.regs[REG_GYR_CONF] & 0x0F) == BMI270_ODR_200HZ &&
+           dev.regs[REG_FIFO_CONFIG_1] == 0xD0 && dev.regs[REG_CMD] == 0xB0, "");
+
+    // One burst drains frames, skips and sensortime
+    for (int f = 0; f < 20; f++) {
+        put_acc_gyr(&dev.fifo, f);
+        if (f == 10) {
+            put_frame(&dev.fifo, HDR_SKIP, 0);
+            dev.fifo.data[dev.fifo.len++] = 3;
+        }
+    }
+    put_frame(&dev.fifo, HDR_SENSORTIME, 3);
+    dev.reported_len = dev.fifo.len;
+    memset(&batch, 0xEE, sizeof(batch));
+    esp_err_t ret = bmi270_read_batch(&batch);
+    bool ok = ret == ESP_OK && dev.bursts == 1 && batch.count == 20 && batch.skipped_frames == 3 &&
+              batch.accel_lsb_per_g == 4096.0f && batch.gyro_lsb_per_dps > 16.3f && batch.gyro_lsb_per_dps < 16.5f;
+    for (int f = 0; ok && f < 20; f++) {
+        ok = frame_matches(&batch, f, f);
+    }
+    expect("burst read: 20 frames, 3 skipped, scales set", ok, "");
+
+    // An empty FIFO costs no burst
+    dev.reported_len = 0;
+    dev.bursts = 0;
+    expect("empty FIFO", bmi270_read_batch(&batch) == ESP_OK && batch.count == 0 && dev.bursts == 0, "");
+
+    // A length register past the FIFO size reads at most the FIFO
+    dev.fifo.len = 0;
+    for (int f = 0; f < BMI270_FIFO_MAX_FRAMES + 4; f++) {
+        put_acc_gyr(&dev.fifo, f);
+    }
+    dev.reported_len = 0x3FFF;
+    expect("oversized length clamped to the FIFO",
+           bmi270_read_batch(&batch) == ESP_OK && batch.count == BMI270_FIFO_SIZE / 13, "");
+
+    dev.fail_read = ESP_ERR_TIMEOUT;
+    dev.fail_reg = REG_FIFO_DATA;
+    dev.reported_len = 13;
+    expect("burst error returned", bmi270_read_batch(&batch) == ESP_ERR_TIMEOUT, "");
+    dev.fail_reg = REG_FIFO_LENGTH_0;
+    expect("length error returned", bmi270_read_batch(&batch) == ESP_ERR_TIMEOUT, "");
+    dev.fail_read = ESP_OK;
+
+    // Stopping disables the FIFO on the device and falls back to single frames
+    expect("FIFO stop", bmi270_fifo_stop() == ESP_OK && dev.regs[REG_FIFO_CONFIG_1] == 0x00 &&
+                        !bmi270_fifo_is_enabled(), "");
+    dev.bursts = 0;
+    expect("single-frame reads after stop", bmi270_read_batch(&batch) == ESP_OK && batch.count == 1 &&
+                                            dev.bursts == 0, "");
+    expect("FIFO read refused after stop", bmi270_fifo_read(&batch) == ESP_ERR_INVALID_STATE, "");
+}
+
+static int check(void)
+{
+    check_decode();
+    check_burst();
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
+
+static int bench(uint32_t iterations)
+{
+    // A full FIFO, with a sensortime frame every 16 frames as the device adds them
+    static stream_t full;
+    full.len = 0;
+    for (int f = 0; full.len + 13 + 4 <= BMI270_FIFO_SIZE; f++) {
+        put_acc_gyr(&full, f);
+        if (f % 16 == 15) {
+            put_frame(&full, HDR_SENSORTIME, 3);
+        }
+    }
+    static bmi270_batch_t batch;
+    memset(&batch, 0, sizeof(batch));
+    batch.count = 0;
+    size_t frames = bmi270_fifo_decode(full.data, full.len, &batch);
+
+    double best = 0.0;
+    for (int round = 0; round < 5; round++) {
+        double start = now_s();
+        for (uint32_t i = 0; i < iterations; i++) {
+            batch.count = 0;
+            bmi270_fifo_decode(full.data, full.len, &batch);
+        }
+        double s = now_s() - start;
+        best = round == 0 || s < best ? s : best;
+    }
+    double per_fifo = best / iterations;
+    printf("decode: %zu bytes, %zu frames per FIFO: %.2f us per FIFO, %.1f ns/frame, %.0f MB/s\n", full.len,
+           frames, per_fifo * 1e6, per_fifo * 1e9 / frames, full.len / per_fifo / 1e6);
+
+    // The whole burst path, length read and copy from the fake device included
+    static fake_bmi270_t dev;
+    use_fake(&dev);
+    bmi270_fifo_start(BMI270_ODR_400HZ);
+    dev.fifo = full;
+    dev.reported_len = full.len;
+    best = 0.0;
+    for (int round = 0; round < 5; round++) {
+        double start = now_s();
+        for (uint32_t i = 0; i < iterations; i++) {
+            bmi270_read_batch(&batch);
+        }
+        double s = now_s() - start;
+        best = round == 0 || s < best ? s : best;
+    }
+    per_fifo = best / iterations;
+    printf("burst read: %.2f us per FIFO, %.1f ns/frame, %.1f M frames/s (the BMI270 makes 1600/s at most)\n",
+           per_fifo * 1e6, per_fifo * 1e9 / frames, frames / per_fifo / 1e6);
+    return batch.count == frames ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+    if (argc >= 2 && strcmp(argv[1], "check") == 0) {
+        return check();
+    }
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+        return bench(argc >= 3 ? (uint32_t)atoi(argv[2]) : 20000);
+    }
+    fprintf(stderr, "usage: %s check\n"
+                    "       %s bench [iterations]\n", argv[0], argv[0]);
+    return 2;
+}
@@ -0,0 +1,417 @@
+// Sliding-window features (sensor_features.h) against a brute-force
+// recomputation over the same time window.
+//
+//   features_tool check              every feature at 100 ms, 1 s and 10 s and
+//                                    across rate switches, slope and EMA in
+//                                    time units, window sizes, restart on rewind,
+//                                    copies read while another thread updates
+//   features_tool bench [iterations] ns per sensor_features_update
+
+#include "sensor_features.h"
+#include "tool_common.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_SAMPLES     40000
+#define RACE_UPDATES    200000  // Writer updates while a reader copies; exact as floats
+#define RACE_RESET      1000    // Writer resets the engine this often, as replay does
+
+// The defaults from sensor_features.c, which the reference has to know
+static const uint32_t window_ms[SENSOR_CH_MAX] = { 6000, 6000, 6000, 1500 };
+static const uint32_t ema_tau_ms[SENSOR_CH_MAX] = { 2000, 2000, 2000, 400 };
+
+static const char *const channel_names[SENSOR_CH_MAX] = { "temperature", "humidity", "pressure", "voc" };
+static const char *const feature_names[SENSOR_FEAT_PER_CHANNEL] = {
+    "last", "mean", "variance", "min", "max", "slope", "ema", "roc",
+};
+
+// Keeps every sample and rebuilds the window from scratch on each one
+typedef struct {
+    uint32_t window_ms;
+    uint32_t slot_ms;
+    uint32_t tau_ms;
+    uint32_t slots[MAX_SAMPLES];    // Indices into t/y of the samples that opened a slot
+    uint32_t first;                 // First slot still in the window
+    double t[MAX_SAMPLES];
+    double y[MAX_SAMPLES];
+    double ema;
+} reference_t;
+
+static void reference_init(reference_t *ref, uint32_t window, uint32_t tau)
+{
+    memset(ref, 0, sizeof(*ref));
+    ref->window_ms = window;
+    ref->slot_ms = window / SENSOR_FEATURE_MAX_WINDOW;
+    ref->tau_ms = tau;
+}
+
+static uint32_t reference_slots(const reference_t *ref, uint32_t pushed)
+{
+    return pushed - ref->first;
+}
+
+static void reference_push(reference_t *ref, uint32_t *pushed, uint32_t i, uint32_t time_ms, double value)
+{
+    if (i == 0) {
+        ref->ema = value;
+    } else {
+        double dt = time_ms - ref->t[i - 1];
+        ref->ema += (ref->tau_ms ? dt / (ref->tau_ms + dt) : 1.0) * (value - ref->ema);
+    }
+    ref->t[i] = time_ms;
+    ref->y[i] = value;
+
+    if (*pushed == 0 || time_ms - ref->t[ref->slots[*pushed - 1]] >= ref->slot_ms) {
+        if (reference_slots(ref, *pushed) == SENSOR_FEATURE_MAX_WINDOW) {
+            ref->first++;
+        }
+        ref->slots[(*pushed)++] = i;
+    }
+    while (reference_slots(ref, *pushed) > 2 && time_ms - ref->t[ref->slots[ref->first]] >= ref->window_ms) {
+        ref->first++;
+    }
+}
+
+static void reference_write(const reference_t *ref, uint32_t pushed, uint32_t last, double *out)
+{
+    uint32_t n = reference_slots(ref, pushed);
+    double mean = 0.0, min = INFINITY, max = -INFINITY, mean_t = 0.0;
+    for (uint32_t s = ref->first; s < pushed; s++) {
+        double y = ref->y[ref->slots[s]];
+        mean += y;
+        mean_t += ref->t[ref->slots[s]];
+        min = y < min ? y : min;
+        max = y > max ? y : max;
+    }
+    mean /= n;
+    mean_t /= n;
+    double variance = 0.0, stt = 0.0, sty = 0.0;
+    for (uint32_t s = ref->first; s < pushed; s++) {
+        double dy = ref->y[ref->slots[s]] - mean;
+        double dt = ref->t[ref->slots[s]] - mean_t;
+        variance += dy * dy;
+        stt += dt * dt;
+        sty += dt * dy;
+    }
+    out[SENSOR_FEAT_LAST] = ref->y[last];
+    out[SENSOR_FEAT_MEAN] = mean;
+    out[SENSOR_FEAT_VARIANCE] = variance / n;
+    out[SENSOR_FEAT_MIN] = min;
+    out[SENSOR_FEAT_MAX] = max;
+    out[SENSOR_FEAT_SLOPE] = stt > 0.0 ? sty / stt * 1000.0 : 0.0;
+    out[SENSOR_FEAT_EMA] = ref->ema;
+    out[SENSOR_FEAT_ROC] = ref->y[last] - ref->y[ref->slots[ref->first]];
+}
+
+// Readings of a room: slow random walks, and VOC with puffs on top
+static void reading(uint32_t i, float *env)
+{
+    static float temp = 21.0f, hum = 45.0f, pressure = 1013.0f, plume = 0.0f;
+    if (i == 0) {
+        temp = 21.0f;
+        hum = 45.0f;
+        pressure = 1013.0f;
+        plume = 0.0f;
+    }
+    temp += ((float)rand() / RAND_MAX - 0.5f) * 0.05f;
+    hum += ((float)rand() / RAND_MAX - 0.5f) * 0.2f;
+    pressure += ((float)rand() / RAND_MAX - 0.5f) * 0.1f;
+    if (rand() % 200 == 0) {
+        plume = 300.0f + rand() % 400;
+    }
+    plume *= 0.9f;
+    env[SENSOR_CH_TEMPERATURE] = temp;
+    env[SENSOR_CH_HUMIDITY] = hum;
+    env[SENSOR_CH_PRESSURE] = pressure;
+    env[SENSOR_CH_VOC] = roundf(120.0f + plume + rand() % 5);
+}
+
+typedef struct {
+    uint32_t period_ms;
+    uint32_t samples;
+} phase_t;
+
+// Runs the phases through the engine and the reference; jitter moves each
+// timestamp by up to that many ms
+static void compare(const char *name, const phase_t *phases, size_t phase_count, uint32_t jitter_ms)
+{
+    static sensor_feature_engine_t engine;
+    static reference_t refs[SENSOR_CH_MAX];
+    uint32_t pushed[SENSOR_CH_MAX] = { 0 };
+    sensor_features_init(&engine, NULL);
+    for (int ch = 0; ch < SENSOR_CH_MAX; ch++) {
+        reference_init(&refs[ch], window_ms[ch], ema_tau_ms[ch]);
+    }
+
+    srand(7);
+    double worst = 0.0;
+    int worst_ch = 0, worst_feat = 0;
+    uint32_t worst_i = 0, i = 0;
+    uint64_t base_ms = 5000;    // The engine counts from its first sample; the reference too
+    uint64_t time_ms = 0;
+    for (size_t p = 0; p < phase_count; p++) {
+        for (uint32_t k = 0; k < phases[p].samples && i < MAX_SAMPLES; k++, i++) {
+            uint32_t jitter = jitter_ms ? (uint32_t)(rand() % (jitter_ms + 1)) : 0;
+            uint64_t t = time_ms + jitter;
+            time_ms += phases[p].period_ms;
+
+            float env[SENSOR_CH_MAX];
+            reading(i, env);
+            sensor_features_update(&engine, env, i, (int64_t)(base_ms + t) * 1000);
+            const sensor_features_t *features = sensor_features_latest(&engine);
+            for (int ch = 0; ch < SENSOR_CH_MAX; ch++) {
+                double expected[SENSOR_FEAT_PER_CHANNEL];
+                reference_push(&refs[ch], &pushed[ch], i, (uint32_t)t, env[ch]);
+                reference_write(&refs[ch], pushed[ch], i, expected);
+                for (int f = 0; f < SENSOR_FEAT_PER_CHANNEL; f++) {
+                    // Relative to the size of the values, which floats carry to 7 digits
+                    double scale = 1.0 + fabs(env[ch]) * (f == SENSOR_FEAT_VARIANCE ? fabs(env[ch]) : 1.0);
+                    double error = fabs(SENSOR_FEATURE(features, ch, f) - expected[f]) / scale;
+                    if (error > worst) {
+                        worst = error;
+                        worst_ch = ch;
+                        worst_feat = f;
+                        worst_i = i;
+                    }
+                }
+            }
+        }
+    }
+
+    char detail[160];
+    snprintf(detail, sizeof(detail), ": %u samples, worst relative error %.1e (%s %s at sample %u)", i, worst,
+             channel_names[worst_ch], feature_names[worst_feat], worst_i);
+    expect(name, worst < 1e-5, detail);
+}
+
+// Slots in the default windows once a steady rate has filled them
+static void check_window_sizes(void)
+{
+    static const struct {
+        uint32_t period_ms;
+        uint16_t slow;
+        uint16_t voc;
+    } cases[] = {
+        { 100, 60, 15 },    // As the sample-counted windows held at 10 Hz
+        { 1000, 6, 2 },
+        { 10000, 2, 2 },    // Wider than the windows: the last two samples
+        { 93, 64, 17 },     // 65 slots would fit 6 s; the oldest gives way
+    };
+    static sensor_feature_engine_t engine;
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        sensor_features_init(&engine, NULL);
+        float env[SENSOR_CH_MAX];
+        for (uint32_t i = 0; i < 2000; i++) {
+            reading(i, env);
+            sensor_features_update(&engine, env, i, (int64_t)i * cases[c].period_ms * 1000);
+        }
+        uint16_t slow = engine.channels[SENSOR_CH_TEMPERATURE].count;
+        uint16_t voc = engine.channels[SENSOR_CH_VOC].count;
+        char detail[96];
+        snprintf(detail, sizeof(detail), " %u ms: %u and %u slots (expected %u and %u)", cases[c].period_ms, slow, voc,
+                 cases[c].slow, cases[c].voc);
+        expect("window size at", slow == cases[c].slow && voc == cases[c].voc, detail);
+    }
+}
+
+// A ramp has the same slope and change per window whatever the sample rate
+static void check_ramp(void)
+{
+    static const uint32_t periods[] = { 100, 250, 1000, 3000 };
+    static sensor_feature_engine_t engine;
+    const double rate = 0.5;    // Units per second
+    for (size_t p = 0; p < sizeof(periods) / sizeof(periods[0]); p++) {
+        sensor_features_init(&engine, NULL);
+        for (uint32_t i = 0; i < 200; i++) {
+            float value = (float)(3.0 + rate * i * periods[p] / 1000.0);
+            const float env[SENSOR_CH_MAX] = { value, value, value, value };
+            sensor_features_update(&engine, env, i, (int64_t)i * periods[p] * 1000);
+        }
+        const sensor_features_t *features = sensor_features_latest(&engine);
+        float slope = SENSOR_FEATURE(features, SENSOR_CH_TEMPERATURE, SENSOR_FEAT_SLOPE);
+        float roc = SENSOR_FEATURE(features, SENSOR_CH_TEMPERATURE, SENSOR_FEAT_ROC);
+        // The window spans its slots, which lie period apart and fit in 6 s
+        double span_s = (6000 - 1) / periods[p] * periods[p] / 1000.0;
+        char detail[96];
+        snprintf(detail, sizeof(detail), " %u ms: slope %.4f/s, change %.3f over %.2f s", periods[p], slope, roc,
+                 span_s);
+        expect("ramp at", fabs(slope - rate) < 1e-3 && fabs(roc - rate * span_s) < 1e-3, detail);
+    }
+}
+
+// After a step the EMA has moved the same way after the same time, close to
+// a continuous-time filter, at any rate well below the time constant
+static void check_ema(void)
+{
+    static const uint32_t periods[] = { 10, 100, 200 };
+    static sensor_feature_engine_t engine;
+    const uint32_t after_ms = 2000;     // One time constant of the slow channels
+    const double expected = 1.0 - exp(-1.0);
+    for (size_t p = 0; p < sizeof(periods) / sizeof(periods[0]); p++) {
+        sensor_features_init(&engine, NULL);
+        for (uint32_t t = 0; t <= after_ms; t += periods[p]) {
+            float value = t == 0 ? 0.0f : 1.0f;
+            const float env[SENSOR_CH_MAX] = { value, value, value, value };
+            sensor_features_update(&engine, env, t, (int64_t)t * 1000);
+        }
+        float ema = SENSOR_FEATURE(sensor_features_latest(&engine), SENSOR_CH_TEMPERATURE, SENSOR_FEAT_EMA);
+        char detail[96];
+        snprintf(detail, sizeof(detail), " %u ms: %.3f after one time constant (continuous %.3f)", periods[p], ema,
+                 expected);
+        expect("ema step at", fabs(ema - expected) < 0.02, detail);
+    }
+}
+
+static void check_restart(void)
+{
+    static sensor_feature_engine_t engine;
+    sensor_features_init(&engine, NULL);
+    float env[SENSOR_CH_MAX];
+    for (uint32_t i = 0; i < 100; i++) {
+        reading(i, env);
+        sensor_features_update(&engine, env, i, 1000000000LL + (int64_t)i * 100000);
+    }
+    // A replay starting at an earlier timestamp
+    const float value[SENSOR_CH_MAX] = { 30.0f, 60.0f, 1000.0f, 500.0f };
+    sensor_features_update(&engine, value, 100, 5000);
+    const sensor_features_t *features = sensor_features_latest(&engine);
+    bool ok = features->samples == 1 && engine.channels[SENSOR_CH_VOC].count == 1 &&
+              SENSOR_FEATURE(features, SENSOR_CH_VOC, SENSOR_FEAT_MEAN) == 500.0f &&
+              SENSOR_FEATURE(features, SENSOR_CH_VOC, SENSOR_FEAT_ROC) == 0.0f &&
+              engine.channels[SENSOR_CH_VOC].window_ms == window_ms[SENSOR_CH_VOC];
+    expect("restart when timestamps rewind", ok, "");
+}
+
+static sensor_feature_engine_t race_engine;
+static atomic_bool race_done;
+
+// Every channel of update i is i, so a vector is whole when its last values
+// all equal its seq; a reset one is all zero
+static void *race_writer(void *arg)
+{
+    (void)arg;
+    float env[SENSOR_CH_MAX];
+    for (uint32_t i = 1; i <= RACE_UPDATES; i++) {
+        if (i % RACE_RESET == 0) {
+            sensor_features_reset(&race_engine);
+        }
+        for (int ch = 0; ch < SENSOR_CH_MAX; ch++) {
+            env[ch] = (float)i;
+        }
+        sensor_features_update(&race_engine, env, i, (int64_t)i * 100000);
+    }
+    atomic_store(&race_done, true);
+    return NULL;
+}
+
+static void check_shared_copy(void)
+{
+    sensor_features_init(&race_engine, NULL);
+    sensor_features_t features;
+    bool empty = sensor_features_read(&race_engine, &features) && features.samples == 0;
+
+    pthread_t writer;
+    atomic_init(&race_done, false);
+    if (pthread_create(&writer, NULL, race_writer, NULL) != 0) {
+        expect("copy-out while the writer updates", false, ": no thread");
+        return;
+    }
+    uint64_t reads = 0, retries = 0, torn = 0;
+    while (!atomic_load(&race_done)) {
+        if (!sensor_features_read(&race_engine, &features)) {
+            retries++;
+            continue;
+        }
+        reads++;
+        float expected = features.samples ? (float)features.seq : 0.0f;
+        for (int ch = 0; ch < SENSOR_CH_MAX; ch++) {
+            if (SENSOR_FEATURE(&features, ch, SENSOR_FEAT_LAST) != expected) {
+                torn++;
+                break;
+            }
+        }
+    }
+    pthread_join(writer, NULL);
+
+    char detail[96];
+    snprintf(detail, sizeof(detail), ": %llu copies, %llu gave up, %llu torn", (unsigned long long)reads,
+             (unsigned long long)retries, (unsigned long long)torn);
+    expect("copy-out while the writer updates and resets", empty && reads > 0 && torn == 0, detail);
+}
+
+static int check(void)
+{
+    const phase_t fast[] = { { 100, 20000 } };
+    const phase_t medium[] = { { 1000, 5000 } };
+    const phase_t slow[] = { { 10000, 2000 } };
+    const phase_t fastest[] = { { 20, 20000 } };
+    // The scheduler's rates in the order a badge goes through them
+    const phase_t switching[] = {
+        { 100, 3000 }, { 10000, 20 }, { 1000, 300 }, { 100, 500 }, { 1000, 30 },
+        { 10000, 5 }, { 100, 100 }, { 20, 2000 }, { 1000, 100 },
+    };
+
+    compare("100 ms against brute force", fast, 1, 0);
+    compare("100 ms with 10 ms jitter", fast, 1, 10);
+    compare("1 s against brute force", medium, 1, 20);
+    compare("10 s against brute force", slow, 1, 50);
+    compare("20 ms (more samples than slots)", fastest, 1, 3);
+    compare("rate switches", switching, sizeof(switching) / sizeof(switching[0]), 5);
+    check_window_sizes();
+    check_ramp();
+    check_ema();
+    check_restart();
+    check_shared_copy();
+
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
+
+static int bench(uint32_t iterations)
+{
+    if (iterations == 0) {
+        return 2;
+    }
+    static sensor_feature_engine_t engine;
+    float (*env)[SENSOR_CH_MAX] = malloc(4096 * sizeof(*env));
+    for (uint32_t i = 0; i < 4096; i++) {
+        reading(i, env[i]);
+    }
+
+    static const uint32_t periods[] = { 100, 1000, 10000 };
+    printf("period   ns/update  (%d channels)\n", SENSOR_CH_MAX);
+    for (size_t p = 0; p < sizeof(periods) / sizeof(periods[0]); p++) {
+        double best = 0.0;
+        for (int round = 0; round < 5; round++) {
+            sensor_features_init(&engine, NULL);
+            double start = now_s();
+            for (uint32_t i = 0; i < iterations; i++) {
+                sensor_features_update(&engine, env[i % 4096], i, (int64_t)i * periods[p] * 1000);
+            }
+            double s = now_s() - start;
+            best = round == 0 || s < best ? s : best;
+        }
+        printf("%5u ms  %9.1f\n", periods[p], best * 1e9 / iterations);
+    }
+    free(env);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 2 && strcmp(argv[1], "check") == 0) {
+        return check();
+    }
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+        return bench(argc >= 3 ? (uint32_t)atoi(argv[2]) : 1000000);
+    }
+    fprintf(stderr, "usage: %s check\n"
+                    "       %s bench [iterations]\n", argv[0], argv[0]);
+    return 2;
+}
@@ -0,0 +1,266 @@
+// Fixed-point IMU kernels (imu_math.h) against their float counterparts.
+//
+//   imu_math_tool check              CORDIC atan2 vs atan2f, isqrt vs sqrt,
+//                                    the squared movement threshold and the
+//                                    batch peak
+//   imu_math_tool bench [iterations] ns per call of each pair
+//
+// bench compares the two paths on this machine only; a desktop FPU favours
+// the float versions, so time them on the badge before switching
+// SENSOR_IMU_FIXED_POINT.
+
+#include "imu_math.h"
+#include "tool_common.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// 16 CORDIC iterations resolve atan(2^-15) = 0.0017 deg; table rounding and
+// the final residual add a little on top
+#define ATAN2_MAX_ERROR_DEG     0.01
+
+#define ACC_LSB_PER_G           4096.0f     // +-8 g, as the driver configures it
+#define BATCH_FRAMES            157         // A full BMI270 FIFO
+
+static double angle_error(int32_t q16, double reference_deg)
+{
+    double error = fabs(IMU_Q16_TO_FLOAT(q16) - reference_deg);
+    // +180 and -180 are the same angle
+    return error > 180.0 ? 360.0 - error : error;
+}
+
+static void check_atan2(void)
+{
+    double worst = 0.0, sum = 0.0;
+    int32_t worst_y = 0, worst_x = 0;
+    uint32_t count = 0;
+
+    // Every direction at several magnitudes, the axes and the int16 extremes,
+    // then random raw readings
+    for (int step = 0; step < 3600; step++) {
+        double a = (step - 1800) * M_PI / 1800.0;
+        static const double radii[] = { 1.5, 40.0, 4096.0, 32767.0 };
+        for (size_t r = 0; r < sizeof(radii) / sizeof(radii[0]); r++) {
+            int32_t y = (int32_t)lround(radii[r] * sin(a));
+            int32_t x = (int32_t)lround(radii[r] * cos(a));
+            if (x == 0 && y == 0) {
+                continue;
+            }
+            double e = angle_error(imu_q_atan2(y, x), atan2((double)y, (double)x) * 180.0 / M_PI);
+            sum += e;
+            count++;
+            if (e > worst) {
+                worst = e;
+                worst_y = y;
+                worst_x = x;
+            }
+        }
+    }
+    srand(3);
+    for (int i = 0; i < 1000000; i++) {
+        int32_t y = rand() % 65536 - 32768;
+        int32_t x = rand() % 65536 - 32768;
+        if (x == 0 && y == 0) {
+            continue;
+        }
+        double e = angle_error(imu_q_atan2(y, x), atan2((double)y, (double)x) * 180.0 / M_PI);
+        sum += e;
+        count++;
+        if (e > worst) {
+            worst = e;
+            worst_y = y;
+            worst_x = x;
+        }
+    }
+
+    // atan2f itself, for scale
+    double float_worst = 0.0;
+    for (int i = 0; i < 100000; i++) {
+        int32_t y = rand() % 65536 - 32768;
+        int32_t x = rand() % 65536 - 32768;
+        double e = fabs(atan2f((float)y, (float)x) * 180.0 / M_PI - atan2((double)y, (double)x) * 180.0 / M_PI);
+        float_worst = e > float_worst ? e : float_worst;
+    }
+
+    char detail[160];
+    snprintf(detail, sizeof(detail), ": %u angles, max error %.5f deg at (%d, %d), mean %.5f deg (atan2f %.6f)",
+             count, worst, worst_y, worst_x, sum / count, float_worst);
+    expect("imu_q_atan2 vs atan2", worst <= ATAN2_MAX_ERROR_DEG, detail);
+
+    // On the negative x axis +-180 are both right; the residual picks one
+    bool ok = imu_q_atan2(0, 0) == 0 && angle_error(imu_q_atan2(0, 100), 0.0) <= ATAN2_MAX_ERROR_DEG &&
+              angle_error(imu_q_atan2(0, -100), 180.0) <= ATAN2_MAX_ERROR_DEG &&
+              angle_error(imu_q_atan2(100, 0), 90.0) <= ATAN2_MAX_ERROR_DEG &&
+              angle_error(imu_q_atan2(-100, 0), -90.0) <= ATAN2_MAX_ERROR_DEG &&
+              angle_error(imu_q_atan2(-32768, -32768), -135.0) <= ATAN2_MAX_ERROR_DEG;
+    expect("imu_q_atan2 on the axes and at the origin", ok, "");
+}
+
+static bool isqrt_exact(uint32_t v)
+{
+    uint32_t r = imu_q_isqrt(v);
+    return (uint64_t)r * r <= v && (uint64_t)(r + 1) * (r + 1) > v;
+}
+
+static void check_isqrt(void)
+{
+    uint32_t wrong = 0, count = 0;
+    // Around every perfect square up to the largest 3-axis int16 magnitude
+    for (uint32_t r = 0; r <= 56755; r++) {
+        uint32_t sq = r * r;
+        wrong += !isqrt_exact(sq);
+        wrong += sq > 0 && !isqrt_exact(sq - 1);
+        wrong += !isqrt_exact(sq + 1);
+        count += 3;
+    }
+    srand(5);
+    for (int i = 0; i < 1000000; i++) {
+        uint32_t v = (uint32_t)rand() << 1 ^ (uint32_t)rand();
+        wrong += !isqrt_exact(v);
+        count++;
+    }
+    wrong += !isqrt_exact(UINT32_MAX);
+
+    // sqrtf rounds in between, so truncating it is off by one now and then
+    uint32_t float_off = 0;
+    for (uint32_t v = 1u << 24; v < (1u << 24) + 1000000; v++) {
+        float_off += (uint32_t)sqrtf((float)v) != imu_q_isqrt(v);
+    }
+
+    char detail[128];
+    snprintf(detail, sizeof(detail), ": %u values, %u not floor(sqrt) (truncated sqrtf: %u of 1000000 off)", count,
+             wrong, float_off);
+    expect("imu_q_isqrt exact", wrong == 0, detail);
+}
+
+// mag_sq > threshold_sq must decide exactly like magnitude > threshold
+static void check_threshold(void)
+{
+    static const float thresholds[] = { 0.5f, 1.0f, 1.2f, 1.5f, 2.0f, 3.3f, 7.9f };
+    static const float scales[] = { ACC_LSB_PER_G, 32768.0f / 2.0f, 32768.0f / 16.0f };
+    uint32_t wrong = 0, count = 0;
+    for (size_t t = 0; t < sizeof(thresholds) / sizeof(thresholds[0]); t++) {
+        for (size_t s = 0; s < sizeof(scales) / sizeof(scales[0]); s++) {
+            uint32_t threshold_sq = imu_q_threshold_sq(thresholds[t], scales[s]);
+            double raw = (double)thresholds[t] * scales[s];
+            uint32_t centre = (uint32_t)(raw * raw);
+            for (uint32_t m = centre > 2000 ? centre - 2000 : 0; m < centre + 2000; m++) {
+                wrong += (m > threshold_sq) != (sqrt((double)m) > raw);
+                count++;
+            }
+        }
+    }
+    bool clamps = imu_q_threshold_sq(100.0f, ACC_LSB_PER_G) == UINT32_MAX && imu_q_threshold_sq(0.0f, 1.0f) == 0;
+    char detail[96];
+    snprintf(detail, sizeof(detail), ": %u magnitudes around 21 thresholds, %u decided differently", count, wrong);
+    expect("imu_q_threshold_sq matches the float comparison", wrong == 0 && clamps, detail);
+}
+
+static void fill_batch(int16_t *ax, int16_t *ay, int16_t *az, size_t count, unsigned seed)
+{
+    srand(seed);
+    for (size_t i = 0; i < count; i++) {
+        ax[i] = (int16_t)(rand() % 65536 - 32768);
+        ay[i] = (int16_t)(rand() % 65536 - 32768);
+        az[i] = (int16_t)(rand() % 65536 - 32768);
+    }
+}
+
+static void check_peak(void)
+{
+    static int16_t ax[BATCH_FRAMES], ay[BATCH_FRAMES], az[BATCH_FRAMES];
+    uint32_t wrong = 0;
+    double worst_rel = 0.0;
+    for (unsigned seed = 0; seed < 2000; seed++) {
+        size_t count = 1 + seed % BATCH_FRAMES;
+        fill_batch(ax, ay, az, count, seed);
+        uint64_t expected = 0;
+        for (size_t i = 0; i < count; i++) {
+            uint64_t m = (uint64_t)((int64_t)ax[i] * ax[i]) + (uint64_t)((int64_t)ay[i] * ay[i]) +
+                         (uint64_t)((int64_t)az[i] * az[i]);
+            expected = m > expected ? m : expected;
+        }
+        wrong += imu_q_peak_mag_sq(ax, ay, az, count) != expected;
+        double f = imu_f_peak_mag_sq(ax, ay, az, count, ACC_LSB_PER_G) * ACC_LSB_PER_G * ACC_LSB_PER_G;
+        double rel = fabs(f - (double)expected) / (double)expected;
+        worst_rel = rel > worst_rel ? rel : worst_rel;
+    }
+    // Three full-scale axes still fit 32 bits
+    int16_t min = -32768;
+    bool extreme = imu_q_peak_mag_sq(&min, &min, &min, 1) == 3u * 32768u * 32768u;
+    char detail[96];
+    snprintf(detail, sizeof(detail), ": 2000 batches, %u wrong, float path within %.1e", wrong, worst_rel);
+    expect("imu_q_peak_mag_sq exact", wrong == 0 && extreme, detail);
+}
+
+static int check(void)
+{
+    check_atan2();
+    check_isqrt();
+    check_threshold();
+    check_peak();
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
+
+// Best of five rounds; body runs iterations times over the input arrays
+#define TIME_NS(result, iterations, body)                       \
+    do {                                                        \
+        double best_ = 0.0;                                     \
+        for (int round_ = 0; round_ < 5; round_++) {            \
+            double start_ = now_s();                            \
+            for (uint32_t i = 0; i < (iterations); i++) {       \
+                body;                                           \
+            }                                                   \
+            double s_ = now_s() - start_;                       \
+            best_ = round_ == 0 || s_ < best_ ? s_ : best_;     \
+        }                                                       \
+        (result) = best_ * 1e9 / (iterations);                  \
+    } while (0)
+
+static int bench(uint32_t iterations)
+{
+    enum { INPUTS = 1024, MASK = INPUTS - 1 };
+    static int16_t ax[INPUTS], ay[INPUTS], az[INPUTS];
+    static uint32_t values[INPUTS];
+    fill_batch(ax, ay, az, INPUTS, 11);
+    for (int i = 0; i < INPUTS; i++) {
+        values[i] = (uint32_t)((int32_t)ax[i] * ax[i]) + (uint32_t)((int32_t)ay[i] * ay[i]);
+    }
+
+    volatile int32_t isink = 0;
+    volatile float fsink = 0.0f;
+    double q_ns, f_ns;
+
+    printf("%-28s %10s %10s\n", "kernel", "fixed ns", "float ns");
+    TIME_NS(q_ns, iterations, isink += imu_q_atan2(ay[i & MASK], az[i & MASK]));
+    TIME_NS(f_ns, iterations, fsink += atan2f(ay[i & MASK], az[i & MASK]) * (180.0f / (float)M_PI));
+    printf("%-28s %10.2f %10.2f\n", "atan2 (CORDIC / atan2f)", q_ns, f_ns);
+
+    TIME_NS(q_ns, iterations, isink += imu_q_isqrt(values[i & MASK]));
+    TIME_NS(f_ns, iterations, fsink += sqrtf((float)values[i & MASK]));
+    printf("%-28s %10.2f %10.2f\n", "isqrt / sqrtf", q_ns, f_ns);
+
+    uint32_t batches = iterations / BATCH_FRAMES + 1;
+    TIME_NS(q_ns, batches, isink += imu_q_peak_mag_sq(ax + (i & 511), ay + (i & 511), az + (i & 511), BATCH_FRAMES));
+    TIME_NS(f_ns, batches, fsink += imu_f_peak_mag_sq(ax + (i & 511), ay + (i & 511), az + (i & 511), BATCH_FRAMES,
+                                                      ACC_LSB_PER_G));
+    printf("%-28s %10.2f %10.2f   (%d frames)\n", "peak magnitude^2 per batch", q_ns, f_ns, BATCH_FRAMES);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 2 && strcmp(argv[1], "check") == 0) {
+        return check();
+    }
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+        return bench(argc >= 3 ? (uint32_t)atoi(argv[2]) : 10000000);
+    }
+    fprintf(stderr, "usage: %s check\n"
+                    "       %s bench [iterations]\n", argv[0], argv[0]);
+    return 2;
+}
@@ -0,0 +1,365 @@
+// Scores labeled VOC captures with the firmware's own classifier: every row
+// of the CSVs goes through ml_voc_classify (or ml_model_inference_batch with
+// --batch), exactly as on the badge, with the model loaded by ml_model_load.
+// Files are memory-mapped and parsed in place.
+//
+//   ml_eval [--model <model|forest>] [--batch] [--no-cache] <csv>...
+//
+// CSV columns as written by sensor_manager_export_voc_data and the voc
+// collector: timestamp,voc,temperature,humidity,label (any order, by header).
+// Labels: normal, cigarette, herbal or cannabis, other.
+
+#include "ml_forest.h"
+#include "ml_model_manager.h"
+#include "esp_log.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CLASSES         (VOC_CLASS_UNKNOWN + 1)
+#define BATCH_ROWS      1024
+#define MAX_COLUMNS     8
+
+enum { COL_VOC, COL_TEMPERATURE, COL_HUMIDITY, COL_LABEL, COL_COUNT };
+
+typedef struct {
+    bool batch;
+    ml_model_type_t type;
+    uint64_t confusion[CLASSES][CLASSES];   // [label][prediction]
+    uint64_t rows;
+    uint64_t skipped;                       // Unknown label or malformed row
+    uint64_t errors;                        // Inference failures
+    double classify_s;
+    float inputs[BATCH_ROWS][ML_VOC_INPUTS];
+    uint8_t labels[BATCH_ROWS];
+    size_t pending;
+} eval_t;
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Decimal without exponent, as the badge prints them
+static bool parse_number(const char *s, const char *end, float *value)
+{
+    static const double scale[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+    bool negative = s < end && *s == '-';
+    s += negative;
+    uint64_t mantissa = 0;
+    int decimals = -1;
+    int digits = 0;
+    for (; s < end; s++) {
+        if (*s >= '0' && *s <= '9') {
+            if (digits++ < 18) {
+                mantissa = mantissa * 10 + (uint64_t)(*s - '0');
+                decimals += decimals >= 0;
+            } else if (decimals < 0) {
+                return false;
+            }
+        } else if (*s == '.' && decimals < 0) {
+            decimals = 0;
+        } else if (*s != '\r' && *s != ' ') {
+            return false;
+        }
+    }
+    if (digits == 0 || decimals > 9) {
+        return false;
+    }
+    double v = (double)mantissa / scale[decimals > 0 ? decimals : 0];
+    *value = (float)(negative ? -v : v);
+    return true;
+}
+
+static int parse_label(const char *s, const char *end)
+{
+    static const struct { const char *name; voc_class_t voc_class; } names[] = {
+        { "normal", VOC_CLASS_NORMAL },
+        { "cigarette", VOC_CLASS_CIGARETTE },
+        { "herbal", VOC_CLASS_HERBAL },
+        { "cannabis", VOC_CLASS_HERBAL },
+        { "other", VOC_CLASS_OTHER },
+    };
+    while (end > s && (end[-1] == '\r' || end[-1] == ' ')) {
+        end--;
+    }
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        size_t len = strlen(names[i].name);
+        if ((size_t)(end - s) == len && memcmp(s, names[i].name, len) == 0) {
+            return names[i].voc_class;
+        }
+    }
+    return -1;
+}
+
+// Classifies the buffered rows; timed per block so the clock stays out of the rows
+static void flush(eval_t *eval)
+{
+    if (eval->pending == 0) {
+        return;
+    }
+    ml_inference_result_t results[BATCH_ROWS];
+    esp_err_t ret[BATCH_ROWS];
+    double start = now_s();
+    if (eval->batch) {
+        ret[0] = ml_model_inference_batch(eval->type, &eval->inputs[0][0], eval->pending, results);
+        for (size_t i = 1; i < eval->pending; i++) {
+            ret[i] = ret[0];
+        }
+    } else {
+        for (size_t i = 0; i < eval->pending; i++) {
+            const float *x = eval->inputs[i];
+            ret[i] = ml_voc_classify((uint32_t)x[0], x[1], x[2], &results[i]);
+        }
+    }
+    eval->classify_s += now_s() - start;
+
+    for (size_t i = 0; i < eval->pending; i++) {
+        if (ret[i] != ESP_OK) {
+            eval->errors++;
+        } else {
+            eval->confusion[eval->labels[i]][results[i].classification]++;
+        }
+    }
+    eval->pending = 0;
+}
+
+static void add_row(eval_t *eval, const float *x, int label)
+{
+    eval->rows++;
+    memcpy(eval->inputs[eval->pending], x, sizeof(eval->inputs[0]));
+    eval->labels[eval->pending] = (uint8_t)label;
+    if (++eval->pending == BATCH_ROWS) {
+        flush(eval);
+    }
+}
+
+// Column index of each field, from the header or the export's default order
+static bool parse_header(const char *line, const char *end, int *column)
+{
+    static const char *names[COL_COUNT] = { "voc", "temperature", "humidity", "label" };
+    for (int c = 0; c < COL_COUNT; c++) {
+        column[c] = -1;
+    }
+    int index = 0;
+    for (const char *field = line; field <= end; index++) {
+        const char *stop = memchr(field, ',', (size_t)(end - field));
+        stop = stop ? stop : end;
+        const char *trim = stop;
+        while (trim > field && (trim[-1] == '\r' || trim[-1] == ' ')) {
+            trim--;
+        }
+        for (int c = 0; c < COL_COUNT; c++) {
+            if ((size_t)(trim - field) == strlen(names[c]) && memcmp(field, names[c], (size_t)(trim - field)) == 0) {
+                column[c] = index;
+            }
+        }
+        field = stop + 1;
+    }
+    for (int c = 0; c < COL_COUNT; c++) {
+        if (column[c] < 0 || column[c] >= MAX_COLUMNS) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int eval_file(eval_t *eval, const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror(path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return 1;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    const char *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror(path);
+        return 1;
+    }
+    madvise((void *)data, (size_t)st.st_size, MADV_SEQUENTIAL);
+    const char *end = data + st.st_size;
+
+    // Default column order, replaced by the header if there is one
+    int column[COL_COUNT] = { 1, 2, 3, 4 };
+    const char *line = data;
+    const char *eol = memchr(line, '\n', (size_t)(end - line));
+    eol = eol ? eol : end;
+    if ((*line < '0' || *line > '9') && *line != '-') {
+        if (!parse_header(line, eol, column)) {
+            fprintf(stderr, "%s: header lacks voc, temperature, humidity or label\n", path);
+            munmap((void *)data, (size_t)st.st_size);
+            return 1;
+        }
+        line = eol + 1;
+    }
+
+    for (; line < end; line = eol + 1) {
+        eol = memchr(line, '\n', (size_t)(end - line));
+        eol = eol ? eol : end;
+        if (eol == line || (eol == line + 1 && *line == '\r')) {
+            continue;
+        }
+
+        // Split at commas; fields point into the mapping, field i ends before field i + 1
+        const char *field[MAX_COLUMNS + 2];
+        int fields = 0;
+        field[fields++] = line;
+        for (const char *p = line; p < eol && fields <= MAX_COLUMNS; p++) {
+            if (*p == ',') {
+                field[fields++] = p + 1;
+            }
+        }
+        field[fields] = eol + 1;
+
+        float x[ML_VOC_INPUTS];
+        int label = -1;
+        bool ok = true;
+        for (int c = 0; ok && c < COL_COUNT; c++) {
+            ok = column[c] < fields;
+        }
+        for (int c = 0; ok && c < ML_VOC_INPUTS; c++) {
+            ok = parse_number(field[column[c]], field[column[c] + 1] - 1, &x[c]);
+        }
+        if (ok) {
+            label = parse_label(field[column[COL_LABEL]], field[column[COL_LABEL] + 1] - 1);
+        }
+        if (!ok || label < 0 || !(x[0] >= 0.0f && x[0] <= (float)UINT32_MAX)) {
+            eval->skipped++;
+            continue;
+        }
+        add_row(eval, x, label);
+    }
+    flush(eval);
+    munmap((void *)data, (size_t)st.st_size);
+    return 0;
+}
+
+static void report(const eval_t *eval, double elapsed)
+{
+    static const char *names[CLASSES] = { "normal", "cigarette", "herbal", "other", "unknown" };
+    uint64_t correct = 0;
+    uint64_t scored = 0;
+
+    printf("\nconfusion (rows: label, columns: prediction)\n%-10s", "");
+    for (int p = 0; p < CLASSES; p++) {
+        printf(" %10s", names[p]);
+    }
+    printf("\n");
+    for (int l = 0; l < CLASSES - 1; l++) {
+        printf("%-10s", names[l]);
+        for (int p = 0; p < CLASSES; p++) {
+            printf(" %10llu", (unsigned long long)eval->confusion[l][p]);
+            scored += eval->confusion[l][p];
+        }
+        correct += eval->confusion[l][l];
+        printf("\n");
+    }
+
+    printf("\nclass       precision     recall         f1    support\n");
+    for (int c = 0; c < CLASSES - 1; c++) {
+        uint64_t support = 0;
+        uint64_t predicted = 0;
+        for (int i = 0; i < CLASSES; i++) {
+            support += eval->confusion[c][i];
+            predicted += eval->confusion[i][c];
+        }
+        if (support == 0 && predicted == 0) {
+            continue;
+        }
+        double precision = predicted ? (double)eval->confusion[c][c] / predicted : 0.0;
+        double recall = support ? (double)eval->confusion[c][c] / support : 0.0;
+        double f1 = precision + recall > 0.0 ? 2.0 * precision * recall / (precision + recall) : 0.0;
+        printf("%-10s %9.2f %% %8.2f %% %8.2f %% %10llu\n", names[c], 100.0 * precision, 100.0 * recall,
+               100.0 * f1, (unsigned long long)support);
+    }
+
+    printf("\naccuracy %.2f %% over %llu rows (%llu skipped, %llu errors)\n",
+           scored ? 100.0 * correct / scored : 0.0, (unsigned long long)eval->rows,
+           (unsigned long long)eval->skipped, (unsigned long long)eval->errors);
+    printf("%.0f rows/s overall, %.0f rows/s classifying (%.1f ns/row), %.2f s total\n",
+           elapsed > 0.0 ? eval->rows / elapsed : 0.0,
+           eval->classify_s > 0.0 ? eval->rows / eval->classify_s : 0.0,
+           eval->rows ? eval->classify_s * 1e9 / eval->rows : 0.0, elapsed);
+}
+
+int main(int argc, char **argv)
+{
+    esp_log_level_set("*", ESP_LOG_WARN);
+    static eval_t eval;
+    const char *model = NULL;
+    bool cache = true;
+    int first = 1;
+    for (; first < argc && strncmp(argv[first], "--", 2) == 0; first++) {
+        if (strcmp(argv[first], "--model") == 0 && first + 1 < argc) {
+            model = argv[++first];
+        } else if (strcmp(argv[first], "--batch") == 0) {
+            eval.batch = true;
+        } else if (strcmp(argv[first], "--no-cache") == 0) {
+            cache = false;
+        } else {
+            break;
+        }
+    }
+    if (first >= argc || (eval.batch && !model)) {
+        fprintf(stderr, "usage: %s [--model <model|forest>] [--batch] [--no-cache] <csv>...\n"
+                        "       --batch needs a model\n", argv[0]);
+        return 2;
+    }
+
+    ml_model_init();
+    if (model) {
+        // ml_model_load reads absolute paths as files, as from the SD card
+        char path[PATH_MAX];
+        uint32_t magic = 0;
+        FILE *f = realpath(model, path) ? fopen(path, "rb") : NULL;
+        if (!f || fread(&magic, sizeof(magic), 1, f) != 1) {
+            perror(model);
+            if (f) {
+                fclose(f);
+            }
+            return 1;
+        }
+        fclose(f);
+        eval.type = magic == ML_FOREST_MAGIC ? MODEL_VOC_FOREST : MODEL_VOC_CLASSIFIER;
+        esp_err_t ret = ml_model_load(eval.type, path);
+        if (ret != ESP_OK) {
+            fprintf(stderr, "%s: not a VOC model (%s)\n", model, esp_err_to_name(ret));
+            return 1;
+        }
+    }
+#if ML_VOC_CACHE_ENTRIES
+    if (!cache) {
+        ml_voc_cache_configure(0, 0.0f, 0.0f);
+    }
+#else
+    (void)cache;
+#endif
+
+    printf("%s via %s\n", !model ? "VOC thresholds" : eval.type == MODEL_VOC_FOREST ? "forest" : "int8 network",
+           eval.batch ? "ml_model_inference_batch" : "ml_voc_classify");
+    double start = now_s();
+    for (int i = first; i < argc; i++) {
+        if (eval_file(&eval, argv[i]) != 0) {
+            return 1;
+        }
+    }
+    report(&eval, now_s() - start);
+    return eval.errors ? 1 : 0;
+}
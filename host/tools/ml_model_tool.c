@@ -0,0 +1,838 @@
+// Check and time int8 models (tools/ml_quantize.py) with the firmware's engine.
+//
+//   ml_model_tool info <model>
+//   ml_model_tool verify <model> <vectors>    bit-exact against the Python reference
+//   ml_model_tool bench <model> [iterations]
+//   ml_model_tool load <image> [iterations]   mapped vs. copied load (pads image to 1 MB)
+//   ml_model_tool forest-verify <forest> <vectors>  against tools/ml_forest_convert.py
+//   ml_model_tool forest-bench <forest> [iterations]  flattened vs. pointer-chasing trees
+//   ml_model_tool batch <model|forest> [samples]     ml_model_inference_batch, batch 1..256
+//   ml_model_tool cache <model|forest> [samples] [recording]  ml_voc_classify cache on a drifting trace
+//   ml_model_tool cascade <model|forest> [forest|-] [samples|recording]  detection cascade vs. always-on
+
+#include "ml_net.h"
+#include "ml_forest.h"
+#include "ml_model_manager.h"
+#include "sensor_record.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define VECTORS_MAGIC   0x31564D51  // "QMV1"
+#define FOREST_VECTORS_MAGIC 0x31564651 // "QFV1"
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t count;
+    uint16_t input_size;
+    uint16_t output_size;
+} vectors_header_t;
+
+static uint8_t *read_file(const char *path, size_t *size)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    // malloc alignment satisfies ml_net_load
+    uint8_t *data = len > 0 ? malloc((size_t)len) : NULL;
+    if (!data || fread(data, 1, (size_t)len, f) != (size_t)len) {
+        fprintf(stderr, "%s: read failed\n", path);
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    *size = (size_t)len;
+    return data;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int info(const ml_net_t *net)
+{
+    printf("name %.*s\n", ML_NET_NAME_LEN, net->header->name);
+    printf("blob %zu bytes, arena %zu bytes\n", net->blob_size, ml_net_arena_size(net));
+    printf("input %u x %u, output %zu (scale %g)\n", net->header->input_length,
+           net->header->input_channels, net->output_size, net->output_scale);
+    for (int i = 0; i < net->header->layer_count; i++) {
+        ml_layer_desc_t layer;
+        memcpy(&layer, &net->layers[i], sizeof(layer));
+        printf("layer %d: %s %u -> %u kernel %u stride %u %s\n", i,
+               layer.type == ML_LAYER_DENSE ? "dense" : "conv1d", layer.in_channels, layer.out_channels,
+               layer.kernel, layer.stride, layer.activation == ML_ACT_RELU ? "relu" : "linear");
+    }
+    return 0;
+}
+
+static int verify(const ml_net_t *net, const char *path)
+{
+    size_t size;
+    uint8_t *data = read_file(path, &size);
+    if (!data) {
+        return 1;
+    }
+
+    vectors_header_t header;
+    memcpy(&header, data, sizeof(header));
+    size_t record = (size_t)header.input_size + header.output_size;
+    if (size < sizeof(header) || header.magic != VECTORS_MAGIC || header.input_size != net->input_size ||
+        header.output_size != net->output_size || size != sizeof(header) + header.count * record) {
+        fprintf(stderr, "%s: does not match the model\n", path);
+        free(data);
+        return 1;
+    }
+
+    int8_t *arena = malloc(ml_net_arena_size(net));
+    int8_t output[ML_NET_MAX_OUTPUTS];
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < header.count; i++) {
+        const int8_t *input = (const int8_t *)(data + sizeof(header) + i * record);
+        const int8_t *expected = input + header.input_size;
+        ml_net_run_quantized(net, input, arena, ml_net_arena_size(net), output);
+        if (memcmp(output, expected, header.output_size) != 0) {
+            if (mismatches++ < 5) {
+                fprintf(stderr, "vector %lu: output differs\n", (unsigned long)i);
+            }
+        }
+    }
+    printf("%lu vectors, %lu mismatches\n", (unsigned long)header.count, (unsigned long)mismatches);
+    free(arena);
+    free(data);
+    return mismatches ? 1 : 0;
+}
+
+static int bench(const ml_net_t *net, const uint8_t *blob, size_t size, uint32_t iterations)
+{
+    // A spread of inputs around the typical ranges; the engine does not branch on them
+    float *inputs = malloc(64 * net->input_size * sizeof(float));
+    srand(1);
+    for (size_t i = 0; i < 64 * net->input_size; i++) {
+        inputs[i] = (float)(rand() % 1000) * 0.5f;
+    }
+    int8_t *arena = malloc(ml_net_arena_size(net));
+    int8_t output[ML_NET_MAX_OUTPUTS];
+    uint32_t sink = 0;
+
+    double start = now_s();
+    for (uint32_t i = 0; i < iterations; i++) {
+        ml_net_run(net, inputs + (i % 64) * net->input_size, arena, ml_net_arena_size(net), output);
+        sink += (uint8_t)output[0];
+    }
+    double elapsed = now_s() - start;
+    printf("ml_net_run            %10.0f inferences/s  %8.1f ns/inference\n",
+           iterations / elapsed, elapsed * 1e9 / iterations);
+
+    // Through the manager: validation, softmax and result packing included
+    if (net->input_size == ML_VOC_INPUTS && ml_model_update(MODEL_VOC_CLASSIFIER, blob, size) == ESP_OK) {
+        ml_inference_result_t result;
+        start = now_s();
+        for (uint32_t i = 0; i < iterations; i++) {
+            ml_voc_classify(100 + i % 900, 21.5f, 48.0f, &result);
+            sink += result.classification;
+        }
+        elapsed = now_s() - start;
+        printf("ml_voc_classify       %10.0f inferences/s  %8.1f ns/inference\n",
+               iterations / elapsed, elapsed * 1e9 / iterations);
+
+        char info[512];
+        ml_model_get_info(MODEL_VOC_CLASSIFIER, info, sizeof(info));
+        printf("%s", info);
+    }
+
+    free(arena);
+    free(inputs);
+    return sink == 0xFFFFFFFF;  // Keeps the loops from being optimised away
+}
+
+static int load(const char *path, uint32_t iterations)
+{
+    esp_err_t ret = esp_partition_host_attach(ML_MODEL_PARTITION, path, 0x100000);
+    if (ret != ESP_OK || (ret = ml_model_load(MODEL_VOC_CLASSIFIER, ML_MODEL_PARTITION)) != ESP_OK) {
+        fprintf(stderr, "%s: %s\n", path, esp_err_to_name(ret));
+        return 1;
+    }
+
+    // Mapped in place: header read, mmap, CRC and validation
+    double start = now_s();
+    for (uint32_t i = 0; i < iterations; i++) {
+        ml_model_load(MODEL_VOC_CLASSIFIER, ML_MODEL_PARTITION);
+    }
+    double mapped = (now_s() - start) / iterations;
+
+    // The copy-in paths for the same blob: from a file, and from a buffer
+    ml_model_image_header_t header;
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                                ESP_PARTITION_SUBTYPE_ANY, ML_MODEL_PARTITION);
+    esp_partition_read(partition, 0, &header, sizeof(header));
+    size_t size = header.entries[0].size;
+    uint8_t *blob = malloc(size);
+    esp_partition_read(partition, header.entries[0].offset, blob, size);
+
+    char file[] = "/tmp/ml_model_tool_XXXXXX";
+    int fd = mkstemp(file);
+    if (fd < 0 || write(fd, blob, size) != (ssize_t)size) {
+        perror(file);
+        return 1;
+    }
+    close(fd);
+    start = now_s();
+    for (uint32_t i = 0; i < iterations; i++) {
+        ml_model_load(MODEL_VOC_CLASSIFIER, file);
+    }
+    double from_file = (now_s() - start) / iterations;
+    unlink(file);
+
+    start = now_s();
+    for (uint32_t i = 0; i < iterations; i++) {
+        ml_model_update(MODEL_VOC_CLASSIFIER, blob, size);
+    }
+    double copied = (now_s() - start) / iterations;
+    free(blob);
+
+    printf("model %zu bytes\n", size);
+    printf("mapped  %8.2f us per load, 0 heap bytes\n", mapped * 1e6);
+    printf("file    %8.2f us per load, %zu heap bytes\n", from_file * 1e6, size);
+    printf("buffer  %8.2f us per load, %zu heap bytes\n", copied * 1e6, size);
+    return 0;
+}
+
+// The textbook layout: one heap node per split, walked with a branch per level
+typedef struct naive_node {
+    struct naive_node *left;
+    struct naive_node *right;
+    uint32_t feature;
+    float threshold;
+    const uint8_t *leaf;
+} naive_node_t;
+
+static naive_node_t *naive_build(const ml_forest_t *forest, uint32_t index)
+{
+    naive_node_t *node = calloc(1, sizeof(*node));
+    if (forest->child[index] == 0) {
+        node->leaf = forest->leaf + (size_t)forest->value[index] * forest->header->class_count;
+        return node;
+    }
+    node->feature = forest->feature[index];
+    node->threshold = forest->threshold[index];
+    node->left = naive_build(forest, index + forest->child[index]);
+    node->right = naive_build(forest, index + forest->child[index] + 1);
+    return node;
+}
+
+static void naive_free(naive_node_t *node)
+{
+    if (node) {
+        naive_free(node->left);
+        naive_free(node->right);
+        free(node);
+    }
+}
+
+static void naive_predict(naive_node_t **trees, uint32_t tree_count, uint32_t classes, const float *x,
+                          uint32_t *scores)
+{
+    memset(scores, 0, classes * sizeof(uint32_t));
+    for (uint32_t t = 0; t < tree_count; t++) {
+        const naive_node_t *node = trees[t];
+        while (!node->leaf) {
+            node = x[node->feature] > node->threshold ? node->right : node->left;
+        }
+        for (uint32_t c = 0; c < classes; c++) {
+            scores[c] += node->leaf[c];
+        }
+    }
+}
+
+static int forest_verify(const ml_forest_t *forest, const char *path)
+{
+    size_t size;
+    uint8_t *data = read_file(path, &size);
+    if (!data) {
+        return 1;
+    }
+
+    vectors_header_t header;
+    memcpy(&header, data, sizeof(header));
+    size_t features = forest->header->feature_count;
+    size_t classes = forest->header->class_count;
+    size_t record = features * sizeof(float) + classes * sizeof(uint32_t);
+    if (size < sizeof(header) || header.magic != FOREST_VECTORS_MAGIC || header.input_size != features ||
+        header.output_size != classes || size != sizeof(header) + header.count * record) {
+        fprintf(stderr, "%s: does not match the forest\n", path);
+        free(data);
+        return 1;
+    }
+
+    // The batch path needs the inputs packed, the vector file interleaves them
+    float *inputs = malloc(header.count * features * sizeof(float));
+    uint32_t *expected = malloc(header.count * classes * sizeof(uint32_t));
+    uint32_t *batch = malloc(header.count * classes * sizeof(uint32_t));
+    for (uint32_t i = 0; i < header.count; i++) {
+        const uint8_t *rec = data + sizeof(header) + i * record;
+        memcpy(inputs + i * features, rec, features * sizeof(float));
+        memcpy(expected + i * classes, rec + features * sizeof(float), classes * sizeof(uint32_t));
+    }
+    ml_forest_predict_batch(forest, inputs, header.count, batch);
+
+    uint32_t mismatches = 0;
+    uint32_t scores[ML_FOREST_MAX_CLASSES];
+    for (uint32_t i = 0; i < header.count; i++) {
+        ml_forest_predict(forest, inputs + i * features, scores);
+        if (memcmp(scores, expected + i * classes, classes * sizeof(uint32_t)) != 0 ||
+            memcmp(batch + i * classes, expected + i * classes, classes * sizeof(uint32_t)) != 0) {
+            if (mismatches++ < 5) {
+                fprintf(stderr, "vector %lu: scores differ\n", (unsigned long)i);
+            }
+        }
+    }
+    printf("%lu vectors, %lu mismatches\n", (unsigned long)header.count, (unsigned long)mismatches);
+    free(batch);
+    free(expected);
+    free(inputs);
+    free(data);
+    return mismatches ? 1 : 0;
+}
+
+static int forest_bench(const ml_forest_t *forest, const uint8_t *blob, size_t size, uint32_t iterations)
+{
+    const ml_forest_header_t *header = forest->header;
+    size_t features = header->feature_count;
+    uint32_t classes = header->class_count;
+    printf("%u trees, %lu nodes, depth %u, %zu bytes\n", header->tree_count,
+           (unsigned long)header->node_count, header->depth, size);
+
+    naive_node_t **trees = malloc(header->tree_count * sizeof(*trees));
+    for (uint32_t t = 0; t < header->tree_count; t++) {
+        trees[t] = naive_build(forest, forest->root[t]);
+    }
+
+    // Inputs over the VOC ranges; branch predictors cannot learn the path
+    enum { SAMPLES = 256 };
+    float *inputs = malloc(SAMPLES * features * sizeof(float));
+    srand(1);
+    for (size_t i = 0; i < SAMPLES * features; i++) {
+        inputs[i] = (float)(rand() % 1000) * ((i % features) == 0 ? 1.0f : 0.08f);
+    }
+    uint32_t *batch = malloc(SAMPLES * classes * sizeof(uint32_t));
+    uint32_t scores[ML_FOREST_MAX_CLASSES];
+    uint32_t expected[ML_FOREST_MAX_CLASSES];
+    uint32_t sink = 0;
+
+    // Same answers before timing anything
+    ml_forest_predict_batch(forest, inputs, SAMPLES, batch);
+    for (size_t i = 0; i < SAMPLES; i++) {
+        naive_predict(trees, header->tree_count, classes, inputs + i * features, expected);
+        ml_forest_predict(forest, inputs + i * features, scores);
+        if (memcmp(scores, expected, classes * sizeof(uint32_t)) != 0 ||
+            memcmp(batch + i * classes, expected, classes * sizeof(uint32_t)) != 0) {
+            fprintf(stderr, "sample %zu: flattened and naive trees disagree\n", i);
+            return 1;
+        }
+    }
+
+    double start = now_s();
+    for (uint32_t i = 0; i < iterations; i++) {
+        naive_predict(trees, header->tree_count, classes, inputs + (i % SAMPLES) * features, scores);
+        sink += scores[0];
+    }
+    double elapsed = now_s() - start;
+    printf("naive pointer trees       %10.0f samples/s  %8.1f ns/sample\n",
+           iterations / elapsed, elapsed * 1e9 / iterations);
+
+    start = now_s();
+    for (uint32_t i = 0; i < iterations; i++) {
+        ml_forest_predict(forest, inputs + (i % SAMPLES) * features, scores);
+        sink += scores[0];
+    }
+    elapsed = now_s() - start;
+    printf("ml_forest_predict         %10.0f samples/s  %8.1f ns/sample\n",
+           iterations / elapsed, elapsed * 1e9 / iterations);
+
+    uint32_t rounds = iterations / SAMPLES > 0 ? iterations / SAMPLES : 1;
+    start = now_s();
+    for (uint32_t i = 0; i < rounds; i++) {
+        ml_forest_predict_batch(forest, inputs, SAMPLES, batch);
+        sink += batch[i % SAMPLES];
+    }
+    elapsed = now_s() - start;
+    printf("ml_forest_predict_batch   %10.0f samples/s  %8.1f ns/sample (%d per call)\n",
+           (double)rounds * SAMPLES / elapsed, elapsed * 1e9 / ((double)rounds * SAMPLES), SAMPLES);
+
+    // Through the manager, as the game calls it
+    if (features == ML_VOC_INPUTS && ml_model_update(MODEL_VOC_FOREST, blob, size) == ESP_OK) {
+        ml_inference_result_t result;
+        start = now_s();
+        for (uint32_t i = 0; i < iterations; i++) {
+            ml_voc_classify(50 + i % 950, 21.5f, 48.0f, &result);
+            sink += result.classification;
+        }
+        elapsed = now_s() - start;
+        printf("ml_voc_classify           %10.0f samples/s  %8.1f ns/sample\n",
+               iterations / elapsed, elapsed * 1e9 / iterations);
+    }
+
+    for (uint32_t t = 0; t < header->tree_count; t++) {
+        naive_free(trees[t]);
+    }
+    free(trees);
+    free(batch);
+    free(inputs);
+    return sink == 0xFFFFFFFF;
+}
+
+static int forest_main(int argc, char **argv)
+{
+    size_t size;
+    uint8_t *blob = read_file(argv[2], &size);
+    if (!blob) {
+        return 1;
+    }
+    ml_forest_t forest;
+    esp_err_t ret = ml_forest_load(&forest, blob, size);
+    if (ret != ESP_OK) {
+        fprintf(stderr, "%s: invalid forest (%s)\n", argv[2], esp_err_to_name(ret));
+        free(blob);
+        return 1;
+    }
+    ml_model_init();
+
+    int status = 2;
+    if (strcmp(argv[1], "forest-verify") == 0 && argc >= 4) {
+        status = forest_verify(&forest, argv[3]);
+    } else if (strcmp(argv[1], "forest-bench") == 0) {
+        status = forest_bench(&forest, blob, size, argc >= 4 ? (uint32_t)atoi(argv[3]) : 1000000);
+    }
+    free(blob);
+    return status;
+}
+
+// Installs a network or forest blob as the manager's VOC model of its type
+static esp_err_t install_voc_model(const char *path, ml_model_type_t *type)
+{
+    size_t size;
+    uint8_t *blob = read_file(path, &size);
+    if (!blob) {
+        return ESP_FAIL;
+    }
+    uint32_t magic = 0;
+    memcpy(&magic, blob, size >= sizeof(magic) ? sizeof(magic) : 0);
+    *type = magic == ML_FOREST_MAGIC ? MODEL_VOC_FOREST : MODEL_VOC_CLASSIFIER;
+    ml_model_init();
+    esp_err_t ret = ml_model_update(*type, blob, size);
+    free(blob);
+    if (ret != ESP_OK) {
+        fprintf(stderr, "%s: not a VOC model (%s)\n", path, esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+static int batch_bench(const char *path, uint32_t samples)
+{
+    ml_model_type_t type;
+    if (install_voc_model(path, &type) != ESP_OK) {
+        return 1;
+    }
+
+    // A captured log's worth of [VOC, temperature, humidity] rows
+    enum { MAX_BATCH = 256 };
+    float *inputs = malloc(MAX_BATCH * ML_VOC_INPUTS * sizeof(float));
+    srand(1);
+    for (size_t i = 0; i < MAX_BATCH; i++) {
+        inputs[i * ML_VOC_INPUTS] = 50.0f + rand() % 950;
+        inputs[i * ML_VOC_INPUTS + 1] = 15.0f + (rand() % 200) * 0.1f;
+        inputs[i * ML_VOC_INPUTS + 2] = 20.0f + (rand() % 600) * 0.1f;
+    }
+    ml_inference_result_t single[MAX_BATCH];
+    ml_inference_result_t results[MAX_BATCH];
+    uint32_t sink = 0;
+
+    for (size_t i = 0; i < MAX_BATCH; i++) {
+        ml_model_inference(type, inputs + i * ML_VOC_INPUTS, &single[i]);
+    }
+    ml_model_inference_batch(type, inputs, MAX_BATCH, results);
+    for (size_t i = 0; i < MAX_BATCH; i++) {
+        if (results[i].classification != single[i].classification ||
+            results[i].confidence != single[i].confidence) {
+            fprintf(stderr, "sample %zu: batch and single results differ\n", i);
+            return 1;
+        }
+    }
+
+    double start = now_s();
+    for (uint32_t i = 0; i < samples; i++) {
+        ml_model_inference(type, inputs + (i % MAX_BATCH) * ML_VOC_INPUTS, &single[0]);
+        sink += single[0].classification;
+    }
+    double base = (now_s() - start) / samples;
+    printf("%s, %u samples per size\n", type == MODEL_VOC_FOREST ? "forest" : "int8 network", samples);
+    printf("single     %10.0f samples/s  %8.1f ns/sample\n", 1.0 / base, base * 1e9);
+
+    for (uint32_t batch = 1; batch <= MAX_BATCH; batch *= 2) {
+        uint32_t calls = samples / batch > 0 ? samples / batch : 1;
+        start = now_s();
+        for (uint32_t i = 0; i < calls; i++) {
+            ml_model_inference_batch(type, inputs, batch, results);
+            sink += results[batch - 1].classification;
+        }
+        double per = (now_s() - start) / ((double)calls * batch);
+        printf("batch %3u  %10.0f samples/s  %8.1f ns/sample  %5.2fx\n", batch, 1.0 / per, per * 1e9, base / per);
+    }
+
+    char info[512];
+    ml_model_get_info(type, info, sizeof(info));
+    printf("%s", info);
+
+    free(inputs);
+    return sink == 0xFFFFFFFF;
+}
+
+// A [VOC, temperature, humidity] reading per ENV entry of a sensor_record file,
+// and their timestamps in times when that is not NULL
+static float *read_recording(const char *path, uint32_t *count, int64_t **times)
+{
+    size_t size;
+    uint8_t *data = read_file(path, &size);
+    if (!data) {
+        return NULL;
+    }
+    const sensor_record_header_t *header = (const sensor_record_header_t *)data;
+    if (size < sizeof(*header) || header->magic != SENSOR_RECORD_MAGIC) {
+        fprintf(stderr, "%s: not a sensor recording\n", path);
+        free(data);
+        return NULL;
+    }
+
+    float *trace = malloc(size / sizeof(sensor_record_entry_t) * ML_VOC_INPUTS * sizeof(float));
+    if (times) {
+        *times = malloc(size / sizeof(sensor_record_entry_t) * sizeof(**times));
+    }
+    uint32_t n = 0;
+    for (size_t offset = sizeof(*header); offset + sizeof(sensor_record_entry_t) <= size;) {
+        sensor_record_entry_t entry;
+        memcpy(&entry, data + offset, sizeof(entry));
+        offset += sizeof(entry);
+        if (offset + entry.length > size) {
+            break;
+        }
+        if (entry.type == SENSOR_RECORD_ENV && entry.length >= sizeof(sensor_record_env_t)) {
+            sensor_record_env_t env;
+            memcpy(&env, data + offset, sizeof(env));
+            trace[n * ML_VOC_INPUTS] = (float)env.voc;
+            trace[n * ML_VOC_INPUTS + 1] = env.temperature;
+            trace[n * ML_VOC_INPUTS + 2] = env.humidity;
+            if (times) {
+                (*times)[n] = entry.timestamp_us;
+            }
+            n++;
+        }
+        offset += entry.length;
+    }
+    free(data);
+    *count = n;
+    return trace;
+}
+
+static float noise(float amplitude)
+{
+    return amplitude * ((float)rand() / RAND_MAX * 2.0f - 1.0f);
+}
+
+// One reading a second of a room: VOC baseline and climate wander slowly
+// with sensor noise on top, and now and then a smoke plume rises and decays
+// smoke (optional) marks the samples a plume is in
+static float *drifting_trace(uint32_t count, bool *smoke)
+{
+    float *trace = malloc((size_t)count * ML_VOC_INPUTS * sizeof(float));
+    float baseline = 120.0f;
+    float plume = 0.0f;
+    float temp = 21.0f;
+    float hum = 45.0f;
+    srand(1);
+    for (uint32_t i = 0; i < count; i++) {
+        baseline += noise(0.2f);
+        baseline = baseline < 60.0f ? 60.0f : baseline > 250.0f ? 250.0f : baseline;
+        if (plume < 1.0f && rand() % 1800 == 0) {
+            plume = 250.0f + rand() % 500;
+        }
+        plume *= 0.98f;
+        temp += noise(0.01f) + 0.0005f * (23.0f - temp);
+        hum += noise(0.02f) + 0.0005f * (50.0f - hum);
+        trace[i * ML_VOC_INPUTS] = roundf(baseline + plume + noise(2.0f));
+        if (smoke) {
+            smoke[i] = plume >= 100.0f;
+        }
+        trace[i * ML_VOC_INPUTS + 1] = temp + noise(0.03f);
+        trace[i * ML_VOC_INPUTS + 2] = hum + noise(0.1f);
+    }
+    return trace;
+}
+
+#if ML_VOC_CACHE_ENTRIES
+static int cache_bench(const char *path, uint32_t samples, const char *recording)
+{
+    ml_model_type_t type;
+    if (install_voc_model(path, &type) != ESP_OK) {
+        return 1;
+    }
+
+    uint32_t count = samples;
+    float *trace = recording ? read_recording(recording, &count, NULL) : drifting_trace(samples, NULL);
+    if (!trace || count == 0) {
+        free(trace);
+        return 1;
+    }
+    ml_inference_result_t *exact = malloc(count * sizeof(*exact));
+    ml_inference_result_t result;
+
+    // Bucket sizes in VOC, degC, %RH; 0 is the uncached baseline
+    static const struct { uint32_t voc; float temp; float hum; } steps[] = {
+        { 0, 0.0f, 0.0f },
+        { 1, 0.1f, 0.25f },
+        { 2, 0.1f, 0.25f },
+        { ML_VOC_CACHE_VOC_STEP, ML_VOC_CACHE_TEMP_STEP, ML_VOC_CACHE_HUM_STEP },
+        { 8, 0.5f, 1.0f },
+        { 16, 1.0f, 2.0f },
+    };
+    printf("%s, %u readings from %s, %d cache entries\n", type == MODEL_VOC_FOREST ? "forest" : "int8 network",
+           count, recording ? recording : "a synthetic drifting trace", ML_VOC_CACHE_ENTRIES);
+    printf("voc  temp   hum     hit rate  evictions  ns/reading  cpu saved  agreement\n");
+
+    // Warm up caches and branch predictors before the baseline
+    ml_voc_cache_configure(0, 0.0f, 0.0f);
+    for (uint32_t i = 0; i < count; i++) {
+        const float *x = trace + i * ML_VOC_INPUTS;
+        ml_voc_classify((uint32_t)x[0], x[1], x[2], &exact[i]);
+    }
+
+    double base = 0.0;
+    for (size_t s = 0; s < sizeof(steps) / sizeof(steps[0]); s++) {
+        ml_voc_cache_configure(steps[s].voc, steps[s].temp, steps[s].hum);
+        double start = now_s();
+        uint32_t agree = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            const float *x = trace + i * ML_VOC_INPUTS;
+            ml_voc_classify((uint32_t)x[0], x[1], x[2], s == 0 ? &exact[i] : &result);
+            if (s > 0) {
+                agree += result.classification == exact[i].classification;
+            }
+        }
+        double per = (now_s() - start) / count;
+        if (s == 0) {
+            base = per;
+            printf("  uncached                                %8.1f\n", per * 1e9);
+            continue;
+        }
+        ml_voc_cache_stats_t stats;
+        ml_voc_cache_get_stats(&stats);
+        printf("%3lu  %4.2f  %4.2f     %6.1f %%  %9lu  %10.1f  %7.1f %%  %7.2f %%\n",
+               (unsigned long)steps[s].voc, steps[s].temp, steps[s].hum,
+               100.0 * stats.hits / count, (unsigned long)stats.evictions, per * 1e9,
+               100.0 * (1.0 - per / base), 100.0 * agree / count);
+    }
+
+    free(exact);
+    free(trace);
+    return 0;
+}
+#endif
+
+// Per-sample classification with and without the cascade, on the feature
+// vectors the sensor pipeline would publish for the trace
+static int cascade_bench(const char *path, const char *small, const char *source)
+{
+    ml_model_type_t type;
+    ml_model_type_t small_type = MODEL_VOC_FOREST;
+    if (install_voc_model(path, &type) != ESP_OK ||
+        (small && install_voc_model(small, &small_type) != ESP_OK)) {
+        return 1;
+    }
+    if (small && (type != MODEL_VOC_CLASSIFIER || small_type != MODEL_VOC_FOREST)) {
+        fprintf(stderr, "stage 2 needs a network as the model and a forest as the small model\n");
+        return 1;
+    }
+
+    uint32_t count = 86400;
+    bool recording = source && (source[0] < '0' || source[0] > '9');
+    if (source && !recording) {
+        count = (uint32_t)atoi(source);
+    }
+    bool *smoke = recording ? NULL : malloc(count * sizeof(*smoke));
+    int64_t *times = NULL;
+    float *trace = recording ? read_recording(source, &count, &times) : drifting_trace(count, smoke);
+    if (!trace || count == 0) {
+        free(trace);
+        free(times);
+        free(smoke);
+        return 1;
+    }
+    static sensor_feature_engine_t engine;
+    sensor_features_init(&engine, NULL);
+    sensor_features_t *features = malloc(count * sizeof(*features));
+    for (uint32_t i = 0; i < count; i++) {
+        const float env[SENSOR_CH_MAX] = {
+            [SENSOR_CH_TEMPERATURE] = trace[i * ML_VOC_INPUTS + 1],
+            [SENSOR_CH_HUMIDITY] = trace[i * ML_VOC_INPUTS + 2],
+            [SENSOR_CH_PRESSURE] = 1013.0f,
+            [SENSOR_CH_VOC] = trace[i * ML_VOC_INPUTS],
+        };
+        // The drifting trace has a reading a second
+        sensor_features_update(&engine, env, i, times ? times[i] : (int64_t)i * 1000000);
+        features[i] = *sensor_features_latest(&engine);
+    }
+    free(trace);
+    free(times);
+
+    // Smoke is scored against the trace's plumes; a recording has no ground
+    // truth, so there always-on inference without the cache is the reference
+    voc_class_t *reference = malloc(count * sizeof(*reference));
+    ml_inference_result_t result;
+    printf("%s%s, %u samples from %s\n", type == MODEL_VOC_FOREST ? "forest" : "int8 network",
+           small ? " + forest as stage 2" : "", count, recording ? source : "a synthetic drifting trace");
+    printf("strategy              ns/sample  speedup   gated  stage 2  cleared   full  smoke found  clean flagged  agreement\n");
+
+    double base = 0.0;
+    for (int run = 0; run < 4; run++) {
+        bool cascade = run >= 2;
+#if ML_VOC_CACHE_ENTRIES
+        if (run == 0) {
+            ml_voc_cache_configure(0, 0.0f, 0.0f);
+        } else {
+            ml_voc_cache_configure(ML_VOC_CACHE_VOC_STEP, ML_VOC_CACHE_TEMP_STEP, ML_VOC_CACHE_HUM_STEP);
+        }
+#endif
+        ml_cascade_config_t config = ML_CASCADE_DEFAULT_CONFIG;
+        config.small_model = run != 3;
+        if (run == 3 && !small) {
+            continue;
+        }
+        ml_cascade_configure(&config);
+
+        uint32_t smoke_samples = 0;
+        uint32_t found = 0;
+        uint32_t flagged = 0;
+        uint32_t agree = 0;
+        double start = now_s();
+        for (uint32_t i = 0; i < count; i++) {
+            if (cascade) {
+                ml_voc_classify_cascade(&features[i], &result);
+            } else {
+                ml_voc_classify_features(&features[i], &result);
+            }
+            if (run == 0) {
+                reference[i] = result.classification;
+            }
+            bool truth = smoke ? smoke[i] : reference[i] != VOC_CLASS_NORMAL;
+            bool detected = result.classification != VOC_CLASS_NORMAL;
+            smoke_samples += truth;
+            found += truth && detected;
+            flagged += !truth && detected;
+            agree += result.classification == reference[i];
+        }
+        double per = (now_s() - start) / count;
+        if (run == 0) {
+            base = per;
+        }
+
+        static const char *names[] = {
+            "always-on", "always-on + cache", "cascade", "cascade, no stage 2"
+        };
+        printf("%-20s %10.1f  %6.2fx", names[run], per * 1e9, base / per);
+        if (cascade) {
+            ml_cascade_stats_t stats;
+            ml_cascade_get_stats(&stats);
+            printf("  %5.1f %%  %5.1f %%  %5.1f %%  %5.1f %%", 100.0 * stats.gated / count,
+                   100.0 * stats.small_runs / count, 100.0 * stats.small_cleared / count,
+                   100.0 * stats.full_runs / count);
+        } else {
+            printf("  %7s  %7s  %7s  %5.1f %%", "-", "-", "-", 100.0);
+        }
+        printf("  %9.2f %%  %11.2f %%  %7.2f %%\n", smoke_samples ? 100.0 * found / smoke_samples : 100.0,
+               count > smoke_samples ? 100.0 * flagged / (count - smoke_samples) : 0.0, 100.0 * agree / count);
+    }
+#if ML_VOC_CACHE_ENTRIES
+    ml_voc_cache_configure(ML_VOC_CACHE_VOC_STEP, ML_VOC_CACHE_TEMP_STEP, ML_VOC_CACHE_HUM_STEP);
+#endif
+    ml_cascade_configure(NULL);
+
+    free(reference);
+    free(features);
+    free(smoke);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s info <model>\n"
+                        "       %s verify <model> <vectors>\n"
+                        "       %s bench <model> [iterations]\n"
+                        "       %s load <image> [iterations]\n"
+                        "       %s forest-verify <forest> <vectors>\n"
+                        "       %s forest-bench <forest> [iterations]\n"
+                        "       %s batch <model|forest> [samples]\n"
+                        "       %s cache <model|forest> [samples] [recording]\n"
+                        "       %s cascade <model|forest> [forest|-] [samples|recording]\n",
+                argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0]);
+        return 2;
+    }
+    if (strcmp(argv[1], "cascade") == 0) {
+        const char *small = argc >= 4 && strcmp(argv[3], "-") != 0 ? argv[3] : NULL;
+        return cascade_bench(argv[2], small, argc >= 5 ? argv[4] : NULL);
+    }
+#if ML_VOC_CACHE_ENTRIES
+    if (strcmp(argv[1], "cache") == 0) {
+        return cache_bench(argv[2], argc >= 4 ? (uint32_t)atoi(argv[3]) : 86400, argc >= 5 ? argv[4] : NULL);
+    }
+#endif
+    if (strcmp(argv[1], "batch") == 0) {
+        return batch_bench(argv[2], argc >= 4 ? (uint32_t)atoi(argv[3]) : 1000000);
+    }
+    if (strncmp(argv[1], "forest-", 7) == 0) {
+        return forest_main(argc, argv);
+    }
+    if (strcmp(argv[1], "load") == 0) {
+        ml_model_init();
+        return load(argv[2], argc >= 4 ? (uint32_t)atoi(argv[3]) : 10000);
+    }
+
+    size_t size;
+    uint8_t *blob = read_file(argv[2], &size);
+    if (!blob) {
+        return 1;
+    }
+    ml_net_t net;
+    esp_err_t ret = ml_net_load(&net, blob, size);
+    if (ret != ESP_OK) {
+        fprintf(stderr, "%s: invalid model (%s)\n", argv[2], esp_err_to_name(ret));
+        free(blob);
+        return 1;
+    }
+    ml_model_init();
+
+    int status = 2;
+    if (strcmp(argv[1], "info") == 0) {
+        status = info(&net);
+    } else if (strcmp(argv[1], "verify") == 0 && argc >= 4) {
+        status = verify(&net, argv[3]);
+    } else if (strcmp(argv[1], "bench") == 0) {
+        status = bench(&net, blob, size, argc >= 4 ? (uint32_t)atoi(argv[3]) : 1000000);
+    }
+    free(blob);
+    return status;
+}
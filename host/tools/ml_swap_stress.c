@@ -0,0 +1,229 @@
+// Hot-swap stress: inference runs while other threads keep replacing the
+// model, alternating between two blobs of the same type. Every result must
+// match one of the two models exactly, and no inference may find the model
+// missing. Build with -DHOST_SANITIZE=thread to have ThreadSanitizer watch it.
+//
+//   ml_swap_stress <model_a> <model_b> [seconds]
+
+#include "ml_forest.h"
+#include "ml_model_manager.h"
+#include "esp_log.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define INPUTS  64
+
+typedef struct {
+    ml_model_type_t type;
+    const uint8_t *blob[2];
+    size_t size[2];
+    char path[2][32];
+    float inputs[INPUTS][ML_VOC_INPUTS];
+    ml_inference_result_t expected[2][INPUTS];
+    atomic_bool stop;
+    atomic_ulong inferences;
+    atomic_ulong swaps;
+    atomic_ulong infos;
+    atomic_ulong mismatches;
+    atomic_ulong failures;
+    atomic_ulong worst_ns;
+} stress_t;
+
+static uint8_t *read_file(const char *path, size_t *size)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = len > 0 ? malloc((size_t)len) : NULL;
+    if (!data || fread(data, 1, (size_t)len, f) != (size_t)len) {
+        fprintf(stderr, "%s: read failed\n", path);
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    *size = (size_t)len;
+    return data;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static bool matches(const stress_t *stress, size_t i, const ml_inference_result_t *result)
+{
+    for (int m = 0; m < 2; m++) {
+        if (result->classification == stress->expected[m][i].classification &&
+            result->confidence == stress->expected[m][i].confidence) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void *inference_thread(void *arg)
+{
+    stress_t *stress = arg;
+    ml_inference_result_t results[INPUTS];
+    uint32_t i = 0;
+
+    while (!atomic_load(&stress->stop)) {
+        size_t n = i % INPUTS;
+        uint64_t start = now_ns();
+        esp_err_t ret;
+        if (i % 16 == 15) {
+            // The batch path pins the model once for all samples
+            ret = ml_model_inference_batch(stress->type, &stress->inputs[0][0], INPUTS, results);
+            for (size_t k = 0; ret == ESP_OK && k < INPUTS; k++) {
+                if (!matches(stress, k, &results[k])) {
+                    atomic_fetch_add(&stress->mismatches, 1);
+                }
+            }
+        } else {
+            ret = ml_model_inference(stress->type, stress->inputs[n], &results[0]);
+            if (ret == ESP_OK && !matches(stress, n, &results[0])) {
+                atomic_fetch_add(&stress->mismatches, 1);
+            }
+        }
+        uint64_t elapsed = now_ns() - start;
+        if (elapsed > atomic_load(&stress->worst_ns)) {
+            atomic_store(&stress->worst_ns, elapsed);
+        }
+        if (ret != ESP_OK) {
+            atomic_fetch_add(&stress->failures, 1);
+        }
+        atomic_fetch_add(&stress->inferences, 1);
+        i++;
+    }
+    return NULL;
+}
+
+// OTA-style pushes from a buffer
+static void *update_thread(void *arg)
+{
+    stress_t *stress = arg;
+    for (uint32_t i = 0; !atomic_load(&stress->stop); i++) {
+        if (ml_model_update(stress->type, stress->blob[i & 1], stress->size[i & 1]) != ESP_OK) {
+            atomic_fetch_add(&stress->failures, 1);
+        }
+        atomic_fetch_add(&stress->swaps, 1);
+    }
+    return NULL;
+}
+
+// Reloads from a file, racing the buffer updates
+static void *load_thread(void *arg)
+{
+    stress_t *stress = arg;
+    for (uint32_t i = 0; !atomic_load(&stress->stop); i++) {
+        if (ml_model_load(stress->type, stress->path[(i + 1) & 1]) != ESP_OK) {
+            atomic_fetch_add(&stress->failures, 1);
+        }
+        atomic_fetch_add(&stress->swaps, 1);
+    }
+    return NULL;
+}
+
+static void *info_thread(void *arg)
+{
+    stress_t *stress = arg;
+    char info[256];
+    while (!atomic_load(&stress->stop)) {
+        ml_model_get_info(stress->type, info, sizeof(info));
+        if (!strstr(info, "Loaded: Yes")) {
+            atomic_fetch_add(&stress->failures, 1);
+        }
+        atomic_fetch_add(&stress->infos, 1);
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <model_a> <model_b> [seconds]\n", argv[0]);
+        return 2;
+    }
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    static stress_t stress;
+    for (int m = 0; m < 2; m++) {
+        stress.blob[m] = read_file(argv[1 + m], &stress.size[m]);
+        if (!stress.blob[m]) {
+            return 1;
+        }
+        // ml_model_load treats absolute paths as files
+        snprintf(stress.path[m], sizeof(stress.path[m]), "/tmp/ml_swap_XXXXXX");
+        int fd = mkstemp(stress.path[m]);
+        if (fd < 0 || write(fd, stress.blob[m], stress.size[m]) != (ssize_t)stress.size[m]) {
+            perror(stress.path[m]);
+            return 1;
+        }
+        close(fd);
+    }
+    uint32_t magic;
+    memcpy(&magic, stress.blob[0], stress.size[0] >= sizeof(magic) ? sizeof(magic) : 0);
+    stress.type = magic == ML_FOREST_MAGIC ? MODEL_VOC_FOREST : MODEL_VOC_CLASSIFIER;
+    int seconds = argc >= 4 ? atoi(argv[3]) : 5;
+
+    srand(1);
+    for (size_t i = 0; i < INPUTS; i++) {
+        stress.inputs[i][0] = 50.0f + rand() % 950;
+        stress.inputs[i][1] = 15.0f + (rand() % 200) * 0.1f;
+        stress.inputs[i][2] = 20.0f + (rand() % 600) * 0.1f;
+    }
+
+    // What each model answers on its own
+    ml_model_init();
+    size_t differing = 0;
+    for (int m = 0; m < 2; m++) {
+        esp_err_t ret = ml_model_update(stress.type, stress.blob[m], stress.size[m]);
+        if (ret != ESP_OK) {
+            fprintf(stderr, "%s: not a VOC model (%s)\n", argv[1 + m], esp_err_to_name(ret));
+            return 1;
+        }
+        for (size_t i = 0; i < INPUTS; i++) {
+            ml_model_inference(stress.type, stress.inputs[i], &stress.expected[m][i]);
+        }
+    }
+    for (size_t i = 0; i < INPUTS; i++) {
+        differing += stress.expected[0][i].confidence != stress.expected[1][i].confidence ||
+                     stress.expected[0][i].classification != stress.expected[1][i].classification;
+    }
+
+    pthread_t threads[4];
+    pthread_create(&threads[0], NULL, inference_thread, &stress);
+    pthread_create(&threads[1], NULL, update_thread, &stress);
+    pthread_create(&threads[2], NULL, load_thread, &stress);
+    pthread_create(&threads[3], NULL, info_thread, &stress);
+    sleep((unsigned)seconds);
+    atomic_store(&stress.stop, true);
+    for (int t = 0; t < 4; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    printf("%s, %zu of %d inputs answered differently by the two models\n",
+           stress.type == MODEL_VOC_FOREST ? "forest" : "int8 network", differing, INPUTS);
+    printf("%lu inferences, %lu swaps, %lu info reads in %d s\n", atomic_load(&stress.inferences),
+           atomic_load(&stress.swaps), atomic_load(&stress.infos), seconds);
+    printf("%lu mismatches, %lu failures, slowest inference %.1f us\n", atomic_load(&stress.mismatches),
+           atomic_load(&stress.failures), atomic_load(&stress.worst_ns) / 1000.0);
+
+    unlink(stress.path[0]);
+    unlink(stress.path[1]);
+    free((void *)stress.blob[0]);
+    free((void *)stress.blob[1]);
+    return atomic_load(&stress.mismatches) || atomic_load(&stress.failures);
+}
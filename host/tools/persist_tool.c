@@ -0,0 +1,508 @@
+// Player state persistence (state_persistence.h) on the file-backed NVS shim.
+//
+//   persist_tool check [trials]     power loss at random points of play
+//   persist_tool bench [hours]      flash written per hour of play by policy
+//
+// Play is simulated at the 100 ms quest tick with esp_timer_host_advance():
+// the table's sensor quests plus a long "Step Counter" quest that advances
+// on every movement event, with trigger events drawn at fixed rates from a
+// seeded generator. Every run is a fresh process on a fresh NVS file;
+// "power loss" is _exit() without a flush and "reboot" a new process
+// loading the file.
+
+#include "quest_system.h"
+#include "quest_table.h"
+#include "sensor_manager.h"
+#include "storage_manager.h"
+#include "state_persistence.h"
+#include "nvs_flash.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "tool_common.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define TICK_MS         100
+#define TICKS_PER_HOUR  (3600 * 1000 / TICK_MS)
+#define STEP_TARGET     60000
+
+// Mean seconds between events of each trigger during play
+static const struct {
+    uint32_t event;
+    uint32_t mean_s;
+} trigger_rates[] = {
+    { SENSOR_EVENT_MOVEMENT, 4 },
+    { SENSOR_EVENT_TILT, 60 },
+    { SENSOR_EVENT_RAIN, 900 },
+    { SENSOR_EVENT_COLD, 600 },
+    { SENSOR_EVENT_DARK, 600 },
+    { SENSOR_EVENT_CIGARETTE, 1200 },
+    { SENSOR_EVENT_HERBAL, 1800 },
+};
+
+static const uint8_t played_quests[] = { 1, 2, 3, 4, 5, 6, 8, 9 };
+
+static char nvs_file[64];
+
+static bool write_all(int fd, const void *data, size_t size)
+{
+    const uint8_t *p = data;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+static bool read_all(int fd, void *data, size_t size)
+{
+    uint8_t *p = data;
+    while (size > 0) {
+        ssize_t n = read(fd, p, size);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+// Runs fn in a child process writing size bytes of result to out
+static bool run_child(bool (*fn)(void *ctx, int fd), void *ctx, void *out, size_t size)
+{
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return false;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        _exit(fn(ctx, fds[1]) ? 0 : 1);
+    }
+    close(fds[1]);
+    bool ok = pid > 0 && read_all(fds[0], out, size);
+    close(fds[0]);
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        ok = false;
+    }
+    return ok;
+}
+
+static bool boot(void)
+{
+    nvs_host_set_path(nvs_file);
+    return nvs_flash_init() == ESP_OK && storage_manager_init() == ESP_OK && sensor_manager_init() == ESP_OK &&
+           sensor_manager_begin_replay() == ESP_OK && quest_system_init() == ESP_OK;
+}
+
+static bool start_play(const state_persist_policy_t *policy)
+{
+    if (!boot()) {
+        return false;
+    }
+    state_persistence_set_policy(policy);
+    if (quest_add("Step Counter", "Keep moving all day", TRIGGER_MOVEMENT, STEP_TARGET) != ESP_OK) {
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(played_quests); i++) {
+        quest_activate(played_quests[i]);
+    }
+    for (uint8_t id = 1; id <= MAX_QUESTS; id++) {
+        if (!quest_table_find(id)) {
+            // The added quest takes the first id the table leaves free
+            return quest_activate(id) == ESP_OK;
+        }
+    }
+    return false;
+}
+
+static void play_tick(void)
+{
+    uint32_t events = 0;
+    for (size_t t = 0; t < sizeof(trigger_rates) / sizeof(trigger_rates[0]); t++) {
+        if (rng_next() % (trigger_rates[t].mean_s * 1000 / TICK_MS) == 0) {
+            events |= trigger_rates[t].event;
+        }
+    }
+    if (events) {
+        sensor_manager_post_events(events);
+    }
+    esp_timer_host_advance(TICK_MS * 1000);
+    quest_system_update();
+}
+
+static uint32_t total_progress(const player_state_t *state)
+{
+    uint32_t total = 0;
+    for (int i = 0; i < state->active_quest_count; i++) {
+        total += state->quests[i].progress;
+    }
+    return total;
+}
+
+static const quest_t *find_quest(const player_state_t *state, uint8_t quest_id)
+{
+    for (int i = 0; i < state->active_quest_count; i++) {
+        if (state->quests[i].quest_id == quest_id) {
+            return &state->quests[i];
+        }
+    }
+    return NULL;
+}
+
+// ---- check ----
+
+typedef struct {
+    uint32_t seed;
+    uint32_t ticks;                 // Power is lost after this many
+    state_persist_policy_t policy;
+} trial_t;
+
+typedef struct {
+    player_state_t live;            // At power loss
+    player_state_t settled;         // max_delay_ms before it
+} trial_result_t;
+
+static bool trial_child(void *ctx, int fd)
+{
+    const trial_t *trial = ctx;
+    static trial_result_t result;
+    if (!start_play(&trial->policy)) {
+        return false;
+    }
+    rng_state = trial->seed;
+    uint32_t settled_tick = trial->ticks - trial->policy.max_delay_ms / TICK_MS;
+    for (uint32_t t = 0; t < trial->ticks; t++) {
+        if (t == settled_tick) {
+            quest_get_player_state(&result.settled);
+        }
+        play_tick();
+    }
+    quest_get_player_state(&result.live);
+    // Power loss: no flush, no shutdown
+    return write_all(fd, &result, sizeof(result));
+}
+
+static bool reboot_child(void *ctx, int fd)
+{
+    (void)ctx;
+    player_state_t state;
+    return boot() && quest_get_player_state(&state) == ESP_OK && write_all(fd, &state, sizeof(state));
+}
+
+// Compares what a reboot restored with the state at power loss
+static bool check_trial(const trial_t *trial, const trial_result_t *result, const player_state_t *restored,
+                        uint32_t *lost)
+{
+    const state_persist_policy_t *policy = &trial->policy;
+    uint32_t live_progress = total_progress(&result->live);
+    uint32_t saved_progress = total_progress(restored);
+    *lost = saved_progress <= live_progress ? live_progress - saved_progress : 0;
+    bool ok = saved_progress <= live_progress && *lost + 1 <= policy->max_changes;
+    if (restored->active_quest_count != result->live.active_quest_count ||
+        restored->completed_quest_count != result->live.completed_quest_count ||
+        restored->total_score != result->live.total_score) {
+        ok = false;
+    }
+    for (int i = 0; i < result->live.active_quest_count; i++) {
+        const quest_t *live = &result->live.quests[i];
+        const quest_t *saved = find_quest(restored, live->quest_id);
+        const quest_t *settled = find_quest(&result->settled, live->quest_id);
+        // Completions are flushed at once; progress older than max_delay_ms is saved
+        if (!saved || saved->status != live->status || saved->progress > live->progress ||
+            (settled && saved->progress < settled->progress)) {
+            ok = false;
+        }
+    }
+    if (!ok) {
+        printf("FAIL: seed %u, power lost at %.1f min: %u/%u quests, score %lu/%lu, progress %u/%u\n",
+               trial->seed, trial->ticks * TICK_MS / 60000.0, restored->active_quest_count,
+               result->live.active_quest_count, (unsigned long)restored->total_score,
+               (unsigned long)result->live.total_score, total_progress(restored), total_progress(&result->live));
+    }
+    return ok;
+}
+
+// Layout 0 as older firmware wrote it, byte for byte: the whole state in one
+// blob, quest text included
+typedef struct {
+    uint8_t quest_id;
+    char name[32];
+    char description[128];
+    uint32_t trigger_type;
+    uint32_t trigger_threshold;
+    uint32_t status;
+    uint32_t progress;
+    uint32_t target_value;
+    uint32_t completed_timestamp;
+} old_quest_t;
+
+typedef struct {
+    uint8_t active_quest_count;
+    uint8_t completed_quest_count;
+    uint32_t total_score;
+    old_quest_t quests[10];
+} old_state_t;
+
+static const uint8_t old_ids[] = { 1, 5, 6 };
+
+static bool write_layout_0_child(void *ctx, int fd)
+{
+    (void)ctx;
+    static old_state_t old;
+    memset(&old, 0, sizeof(old));
+    for (int i = 0; i < 3; i++) {
+        old_quest_t *quest = &old.quests[i];
+        quest->quest_id = old_ids[i];
+        snprintf(quest->name, sizeof(quest->name), "Quest %u", old_ids[i]);
+        quest->status = i == 0 ? QUEST_COMPLETED : QUEST_ACTIVE;
+        quest->progress = i + 1;
+        quest->target_value = 5;
+        quest->completed_timestamp = i == 0 ? 1234 : 0;
+    }
+    old.active_quest_count = 3;
+    old.completed_quest_count = 1;
+    old.total_score = 100;
+
+    nvs_handle_t handle;
+    nvs_host_set_path(nvs_file);
+    if (nvs_flash_init() != ESP_OK || nvs_open(STORAGE_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        return false;
+    }
+    esp_err_t ret = nvs_set_blob(handle, "player_state", &old, sizeof(old));
+    uint8_t done = 1;
+    return ret == ESP_OK && nvs_commit(handle) == ESP_OK && write_all(fd, &done, 1);
+}
+
+static bool layout_0_gone_child(void *ctx, int fd)
+{
+    (void)ctx;
+    nvs_handle_t handle;
+    size_t size = 0;
+    nvs_host_set_path(nvs_file);
+    uint8_t gone = nvs_flash_init() == ESP_OK && nvs_open(STORAGE_NAMESPACE, NVS_READONLY, &handle) == ESP_OK &&
+                   nvs_get_blob(handle, "player_state", NULL, &size) == ESP_ERR_NVS_NOT_FOUND;
+    return write_all(fd, &gone, 1);
+}
+
+// Layout 0 loads as the same slim state, and is gone afterwards
+static bool check_migration(void)
+{
+    static player_state_t expected;
+    static player_state_t restored;
+    static player_state_t again;
+    memset(&expected, 0, sizeof(expected));
+    for (int i = 0; i < 3; i++) {
+        expected.quests[i] = (quest_t) {
+            .completed_timestamp = i == 0 ? 1234 : 0,
+            .progress = i + 1,
+            .quest_id = old_ids[i],
+            .status = i == 0 ? QUEST_COMPLETED : QUEST_ACTIVE,
+        };
+    }
+    expected.active_quest_count = 3;
+    expected.completed_quest_count = 1;
+    expected.total_score = 100;
+
+    uint8_t flag = 0;
+    remove(nvs_file);
+    bool ok = run_child(write_layout_0_child, NULL, &flag, 1) &&
+              run_child(reboot_child, NULL, &restored, sizeof(restored)) &&
+              memcmp(&expected, &restored, sizeof(expected)) == 0 &&
+              run_child(layout_0_gone_child, NULL, &flag, 1) && flag &&
+              run_child(reboot_child, NULL, &again, sizeof(again)) && memcmp(&expected, &again, sizeof(expected)) == 0;
+    printf("layout 0 migration: %s\n", ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// Failed flushes back off instead of retrying every tick, keep the age and
+// count of their changes, and nothing is due before state_persistence_init()
+static bool retry_child(void *ctx, int fd)
+{
+    (void)ctx;
+    static player_state_t state;
+    memset(&state, 0, sizeof(state));
+    state.active_quest_count = 1;
+    state.quests[0] = (quest_t) { .quest_id = 1, .status = QUEST_ACTIVE, .progress = 1 };
+    nvs_host_set_path(nvs_file);
+    state_persistence_set_policy(&(state_persist_policy_t) { .max_delay_ms = 1000, .max_changes = 3 });
+
+    state_persistence_mark(STATE_DIRTY_SLOT(0));
+    uint8_t ok = state_persistence_ms_until_due() == UINT32_MAX && state_persistence_poll(&state) == ESP_OK &&
+                 state_persistence_flush(&state) == ESP_ERR_INVALID_STATE;
+    ok = ok && nvs_flash_init() == ESP_OK && state_persistence_init() == ESP_OK &&
+         state_persistence_ms_until_due() <= 1000;
+
+    // Fill NVS so the slot key cannot be created
+    nvs_handle_t filler;
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    int fillers = 0;
+    ok = ok && nvs_open("filler", NVS_READWRITE, &filler) == ESP_OK;
+    while (ok && fillers < 1000) {
+        snprintf(key, sizeof(key), "f%d", fillers);
+        if (nvs_set_u32(filler, key, 0) != ESP_OK) {
+            break;
+        }
+        fillers++;
+    }
+
+    // Due by age, fails, then waits out the back-off even with the count reached
+    esp_timer_host_advance(1000 * 1000);
+    ok = ok && state_persistence_ms_until_due() == 0 && state_persistence_poll(&state) != ESP_OK;
+    uint32_t backoff = state_persistence_ms_until_due();
+    state_persistence_mark(STATE_DIRTY_SLOT(0));
+    state_persistence_mark(STATE_DIRTY_SLOT(0));
+    ok = ok && backoff > STATE_PERSIST_RETRY_MS - 10 && backoff <= STATE_PERSIST_RETRY_MS &&
+         state_persistence_ms_until_due() <= backoff && state_persistence_ms_until_due() > 0 &&
+         state_persistence_poll(&state) == ESP_OK;
+    esp_timer_host_advance((int64_t)STATE_PERSIST_RETRY_MS * 1000);
+    ok = ok && state_persistence_ms_until_due() == 0 && state_persistence_poll(&state) != ESP_OK &&
+         state_persistence_ms_until_due() > STATE_PERSIST_RETRY_MS - 10;
+
+    // Room again for the slot and the header: the next attempt saves everything
+    for (int i = fillers - 2; ok && i < fillers; i++) {
+        snprintf(key, sizeof(key), "f%d", i);
+        ok = i >= 0 && nvs_erase_key(filler, key) == ESP_OK;
+    }
+    ok = ok && nvs_commit(filler) == ESP_OK;
+    esp_timer_host_advance((int64_t)STATE_PERSIST_RETRY_MS * 1000);
+    static player_state_t loaded;
+    ok = ok && state_persistence_poll(&state) == ESP_OK && state_persistence_ms_until_due() == UINT32_MAX &&
+         state_persistence_load(&loaded) == ESP_OK && memcmp(&loaded, &state, sizeof(state)) == 0;
+    return write_all(fd, &ok, 1);
+}
+
+static int run_check(uint32_t trials)
+{
+    static trial_t trial;
+    static trial_result_t result;
+    static player_state_t restored;
+    trial.policy = (state_persist_policy_t) {
+        .max_delay_ms = STATE_PERSIST_MAX_DELAY_MS,
+        .max_changes = STATE_PERSIST_MAX_CHANGES,
+    };
+    uint32_t min_ticks = trial.policy.max_delay_ms / TICK_MS + 1;
+    bool ok = true;
+    uint32_t max_lost = 0;
+    uint64_t total_lost = 0;
+
+    rng_state = 0x5eed;
+    for (uint32_t n = 0; n < trials; n++) {
+        trial.seed = rng_next() | 1;
+        trial.ticks = min_ticks + rng_next() % TICKS_PER_HOUR;
+        remove(nvs_file);
+        uint32_t lost = 0;
+        if (!run_child(trial_child, &trial, &result, sizeof(result)) ||
+            !run_child(reboot_child, NULL, &restored, sizeof(restored))) {
+            printf("FAIL: seed %u, run failed\n", trial.seed);
+            ok = false;
+            continue;
+        }
+        ok &= check_trial(&trial, &result, &restored, &lost);
+        max_lost = lost > max_lost ? lost : max_lost;
+        total_lost += lost;
+    }
+    printf("%u power losses: at most %u progress steps lost (mean %.1f), bound %u steps / %lu ms\n",
+           trials, max_lost, trials ? (double)total_lost / trials : 0.0, trial.policy.max_changes - 1,
+           (unsigned long)trial.policy.max_delay_ms);
+
+    ok &= check_migration();
+    uint8_t retry_ok = 0;
+    remove(nvs_file);
+    retry_ok = run_child(retry_child, NULL, &retry_ok, 1) && retry_ok;
+    printf("flush failure back-off: %s\n", retry_ok ? "ok" : "FAIL");
+    ok &= retry_ok;
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+// ---- bench ----
+
+typedef struct {
+    const char *name;
+    state_persist_policy_t policy;
+    uint32_t hours;
+} bench_case_t;
+
+typedef struct {
+    nvs_host_stats_t nvs;
+    uint32_t steps;
+    uint32_t completed;
+} bench_result_t;
+
+static bool bench_child(void *ctx, int fd)
+{
+    const bench_case_t *bench = ctx;
+    bench_result_t result;
+    if (!start_play(&bench->policy)) {
+        return false;
+    }
+    // Only play counts, not setting up the quests
+    nvs_host_reset_stats();
+    rng_state = 0xbad9e;
+    for (uint32_t t = 0; t < bench->hours * TICKS_PER_HOUR; t++) {
+        play_tick();
+    }
+    player_state_t state;
+    quest_get_player_state(&state);
+    nvs_host_get_stats(&result.nvs);
+    result.steps = total_progress(&state);
+    result.completed = state.completed_quest_count;
+    return write_all(fd, &result, sizeof(result));
+}
+
+static int run_bench(uint32_t hours)
+{
+    bench_case_t cases[] = {
+        { "every change", { 0, 1 }, hours },
+        { "default", { STATE_PERSIST_MAX_DELAY_MS, STATE_PERSIST_MAX_CHANGES }, hours },
+        { "5 min / 64", { 300000, 64 }, hours },
+    };
+    printf("%u h of play; per hour:\n", hours);
+    printf("%-14s %10s %10s %8s %12s %12s\n", "policy", "delay ms", "changes", "commits", "value bytes", "flash bytes");
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        bench_result_t result;
+        remove(nvs_file);
+        if (!run_child(bench_child, &cases[c], &result, sizeof(result))) {
+            fprintf(stderr, "%s failed\n", cases[c].name);
+            return 1;
+        }
+        printf("%-14s %10lu %10u %8.0f %12.0f %12.0f\n", cases[c].name,
+               (unsigned long)cases[c].policy.max_delay_ms, cases[c].policy.max_changes,
+               (double)result.nvs.commits / hours, (double)result.nvs.bytes_written / hours,
+               (double)result.nvs.flash_bytes / hours);
+        if (c == 0) {
+            printf("%-14s %u progress steps, %u quests completed\n", "", result.steps, result.completed);
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2 || (strcmp(argv[1], "check") != 0 && strcmp(argv[1], "bench") != 0)) {
+        fprintf(stderr, "usage: %s check [trials] | bench [hours]\n", argv[0]);
+        return 2;
+    }
+    int arg = argc >= 3 ? atoi(argv[2]) : 0;
+
+    esp_log_level_set("*", ESP_LOG_NONE);
+    snprintf(nvs_file, sizeof(nvs_file), "/tmp/persist_tool_%d.nvs", (int)getpid());
+    int ret = strcmp(argv[1], "check") == 0 ? run_check(arg > 0 ? (uint32_t)arg : 50)
+                                            : run_bench(arg > 0 ? (uint32_t)arg : 1);
+    remove(nvs_file);
+    char tmp[80];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", nvs_file);
+    remove(tmp);
+    return ret;
+}
@@ -0,0 +1,132 @@
+// Quest tick cost against the number of active quests and distinct triggers.
+//
+//   quest_bench [ticks]
+//
+// Built with room for 32 active quests (see CMakeLists.txt). Each
+// configuration runs in a fresh process: N quests added with quest_add(),
+// spread round-robin over D sensor triggers, all active. "idle" ticks have no
+// trigger event pending; "1 event" ticks post one trigger's event, the
+// triggers taking turns, so N / D quests advance per tick.
+
+#include "quest_system.h"
+#include "quest_table.h"
+#include "sensor_manager.h"
+#include "storage_manager.h"
+#include "state_persistence.h"
+#include "nvs_flash.h"
+#include "esp_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_ROUNDS    5
+
+static const trigger_type_t triggers[] = {
+    TRIGGER_RAIN, TRIGGER_COLD, TRIGGER_DARK, TRIGGER_SMOKE, TRIGGER_HERBAL, TRIGGER_MOVEMENT, TRIGGER_TILT
+};
+static const uint32_t trigger_events[] = {
+    SENSOR_EVENT_RAIN, SENSOR_EVENT_COLD, SENSOR_EVENT_DARK, SENSOR_EVENT_CIGARETTE, SENSOR_EVENT_HERBAL,
+    SENSOR_EVENT_MOVEMENT, SENSOR_EVENT_TILT
+};
+
+#define TRIGGER_COUNT   (sizeof(triggers) / sizeof(triggers[0]))
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Best of BENCH_ROUNDS, ns per quest_system_update()
+static double time_ticks(uint32_t distinct, uint32_t ticks, bool events)
+{
+    double best = 0.0;
+    uint32_t turn = 0;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        int64_t start = now_ns();
+        for (uint32_t t = 0; t < ticks; t++) {
+            if (events) {
+                sensor_manager_post_events(trigger_events[turn++ % distinct]);
+            }
+            quest_system_update();
+        }
+        double ns = (double)(now_ns() - start) / ticks;
+        best = round == 0 || ns < best ? ns : best;
+    }
+    return best;
+}
+
+static int run_config(uint32_t quests, uint32_t distinct, uint32_t ticks)
+{
+    if (nvs_flash_init() != ESP_OK || storage_manager_init() != ESP_OK || sensor_manager_init() != ESP_OK) {
+        return 1;
+    }
+    // Keep the sampling timer from posting events of its own
+    sensor_manager_begin_replay();
+    quest_system_init();
+    // Time dispatch, not the write-back of progress (persist_tool covers that)
+    state_persistence_set_policy(&(state_persist_policy_t) { UINT32_MAX, UINT16_MAX });
+
+    for (uint32_t q = 0; q < quests; q++) {
+        if (quest_add("Bench", "Bench quest", triggers[q % distinct], UINT16_MAX) != ESP_OK) {
+            return 1;
+        }
+    }
+    // The added quests take the ids the generated table leaves free
+    for (uint8_t id = 1; id <= MAX_QUESTS; id++) {
+        if (!quest_table_find(id)) {
+            quest_activate(id);
+        }
+    }
+    player_state_t state;
+    quest_get_player_state(&state);
+    if (state.active_quest_count != quests) {
+        fprintf(stderr, "activated %u of %u quests\n", state.active_quest_count, quests);
+        return 1;
+    }
+
+    double idle = time_ticks(distinct, ticks, false);
+    double event = time_ticks(distinct, ticks, true);
+    printf("%6u  %8u  %12.1f  %15.1f\n", quests, distinct, idle, event);
+    fflush(stdout);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    // Each round advances quests; stay below the UINT16_MAX target
+    uint32_t ticks = argc >= 2 ? (uint32_t)atoi(argv[1]) : 10000;
+    if (ticks == 0 || ticks * BENCH_ROUNDS >= UINT16_MAX) {
+        fprintf(stderr, "usage: %s [ticks < %d]\n", argv[0], UINT16_MAX / BENCH_ROUNDS);
+        return 2;
+    }
+
+    // No sensors on the host; the BMI270 probe fails
+    esp_log_level_set("*", ESP_LOG_NONE);
+    static const uint32_t quest_counts[] = { 1, 4, 8, 16, 32 };
+    static const uint32_t distinct_counts[] = { 1, 7 };
+    printf("quests  triggers  idle ns/tick  1 event ns/tick\n");
+    for (size_t d = 0; d < sizeof(distinct_counts) / sizeof(distinct_counts[0]); d++) {
+        for (size_t n = 0; n < sizeof(quest_counts) / sizeof(quest_counts[0]); n++) {
+            uint32_t quests = quest_counts[n];
+            uint32_t distinct = distinct_counts[d];
+            if (quests > MAX_QUESTS_PER_PLAYER || distinct > TRIGGER_COUNT || distinct > quests) {
+                continue;
+            }
+            fflush(stdout);
+            pid_t pid = fork();
+            if (pid == 0) {
+                _exit(run_config(quests, distinct, ticks));
+            }
+            int status = 0;
+            if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                fprintf(stderr, "%u quests on %u triggers failed\n", quests, distinct);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,281 @@
+// Quest condition compiler and interpreter (quest_conditions.h) on the host.
+//
+//   quest_cond_tool check              evaluation semantics, compile errors and
+//                                      the generated bytecode of every condition
+//                                      in quests/quest_map.json against this compiler
+//   quest_cond_tool bench [iterations] evaluations per second
+//   quest_cond_tool compile <expr>     bytecode of one expression
+
+#include "quest_conditions.h"
+#include "quest_table.h"
+#include "tool_common.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define RAIN        SENSOR_EVENT_RAIN
+#define COLD        SENSOR_EVENT_COLD
+#define DARK        SENSOR_EVENT_DARK
+#define MOVE        SENSOR_EVENT_MOVEMENT
+#define TILT        SENSOR_EVENT_TILT
+
+// One tick of a scripted timeline: time, a few sensor fields, trigger levels
+// and the expected result
+typedef struct {
+    uint32_t t_ms;
+    float temperature;
+    float humidity;
+    uint32_t voc;
+    float tilt_angle;
+    uint32_t levels;
+    bool expect;
+} step_t;
+
+typedef struct {
+    const char *expr;
+    bool edges;                 // Check quest_cond_eval_edge instead
+    step_t steps[12];
+    int count;
+} eval_case_t;
+
+static const eval_case_t eval_cases[] = {
+    { "temperature < 15", false, {
+        { 0, 14.0f, 50, 0, 0, 0, true }, { 1, 15.0f, 50, 0, 0, 0, false }, { 2, 16.0f, 50, 0, 0, 0, false },
+        { 3, -5.0f, 50, 0, 0, 0, true } }, 4 },
+    { "temperature <= 15 && humidity > 80", false, {
+        { 0, 15.0f, 81, 0, 0, 0, true }, { 1, 15.0f, 80, 0, 0, 0, false }, { 2, 15.5f, 90, 0, 0, 0, false } }, 3 },
+    { "temperature > -5 and temperature != 0", false, {
+        { 0, -4.0f, 0, 0, 0, 0, true }, { 1, 0.0f, 0, 0, 0, 0, false }, { 2, -6.0f, 0, 0, 0, 0, false } }, 3 },
+    { "voc >= 350 || voc == 100", false, {
+        { 0, 0, 0, 350, 0, 0, true }, { 1, 0, 0, 349, 0, 0, false }, { 2, 0, 0, 100, 0, 0, true } }, 3 },
+    { "abs(tilt_angle) > 30", false, {
+        { 0, 0, 0, 0, -40.0f, 0, true }, { 1, 0, 0, 0, 40.0f, 0, true }, { 2, 0, 0, 0, -20.0f, 0, false } }, 3 },
+    { "!(rain || cold)", false, {
+        { 0, 0, 0, 0, 0, 0, true }, { 1, 0, 0, 0, 0, RAIN, false }, { 2, 0, 0, 0, 0, COLD, false },
+        { 3, 0, 0, 0, 0, DARK, true } }, 4 },
+    // && binds tighter than ||, ! tighter than &&
+    { "rain || cold && dark", false, {
+        { 0, 0, 0, 0, 0, RAIN, true }, { 1, 0, 0, 0, 0, COLD, false }, { 2, 0, 0, 0, 0, COLD | DARK, true } }, 3 },
+    { "not rain and cold", false, {
+        { 0, 0, 0, 0, 0, COLD, true }, { 1, 0, 0, 0, 0, RAIN | COLD, false }, { 2, 0, 0, 0, 0, 0, false } }, 3 },
+    { "true && !false", false, { { 0, 0, 0, 0, 0, 0, true } }, 1 },
+    // Dwell: restarts when the condition breaks
+    { "(temperature < 15 && humidity > 80) for 30s", false, {
+        { 0, 10.0f, 90, 0, 0, 0, false }, { 10000, 10.0f, 90, 0, 0, 0, false },
+        { 29999, 10.0f, 90, 0, 0, 0, false }, { 30000, 10.0f, 90, 0, 0, 0, true },
+        { 31000, 10.0f, 70, 0, 0, 0, false }, { 32000, 10.0f, 90, 0, 0, 0, false },
+        { 61000, 10.0f, 90, 0, 0, 0, false }, { 62000, 10.0f, 90, 0, 0, 0, true } }, 8 },
+    { "cold for 0s", false, { { 0, 0, 0, 0, 0, COLD, true }, { 5, 0, 0, 0, 0, 0, false } }, 2 },
+    { "cold for 500ms for 1s", false, {
+        { 0, 0, 0, 0, 0, COLD, false }, { 500, 0, 0, 0, 0, COLD, false }, { 1499, 0, 0, 0, 0, COLD, false },
+        { 1500, 0, 0, 0, 0, COLD, true } }, 4 },
+    // Sequence: b after an earlier a, inside the window; firing uses the a up
+    { "movement then tilt within 5s", false, {
+        { 0, 0, 0, 0, 0, MOVE, false }, { 1000, 0, 0, 0, 0, TILT, true }, { 2000, 0, 0, 0, 0, TILT, false },
+        { 3000, 0, 0, 0, 0, MOVE, false }, { 9000, 0, 0, 0, 0, TILT, false },
+        { 10000, 0, 0, 0, 0, MOVE | TILT, false }, { 11000, 0, 0, 0, 0, TILT, true },
+        { 12000, 0, 0, 0, 0, MOVE, false }, { 17000, 0, 0, 0, 0, TILT, true } }, 9 },
+    { "movement then tilt", false, {
+        { 0, 0, 0, 0, 0, MOVE, false }, { 100000, 0, 0, 0, 0, 0, false }, { 3600000, 0, 0, 0, 0, TILT, true } }, 3 },
+    { "rain then cold then dark", false, {
+        { 0, 0, 0, 0, 0, RAIN, false }, { 1, 0, 0, 0, 0, DARK, false }, { 2, 0, 0, 0, 0, COLD, false },
+        { 3, 0, 0, 0, 0, DARK, true }, { 4, 0, 0, 0, 0, DARK, false } }, 5 },
+    { "(rain then cold) for 1s", false, {
+        { 0, 0, 0, 0, 0, RAIN, false }, { 100, 0, 0, 0, 0, COLD, false }, { 1100, 0, 0, 0, 0, COLD, false } }, 3 },
+    // Edges: only the tick the condition becomes true counts
+    { "rain", true, {
+        { 0, 0, 0, 0, 0, RAIN, true }, { 1, 0, 0, 0, 0, RAIN, false }, { 2, 0, 0, 0, 0, 0, false },
+        { 3, 0, 0, 0, 0, RAIN, true } }, 4 },
+    { "cold for 1s", true, {
+        { 0, 0, 0, 0, 0, COLD, false }, { 1000, 0, 0, 0, 0, COLD, true }, { 2000, 0, 0, 0, 0, COLD, false } }, 3 },
+};
+
+typedef struct {
+    const char *expr;
+    esp_err_t error;
+    size_t offset;
+} error_case_t;
+
+static const error_case_t error_cases[] = {
+    { "", ESP_ERR_INVALID_ARG, 0 },
+    { "temperature", ESP_ERR_INVALID_ARG, 11 },
+    { "temperature < ", ESP_ERR_INVALID_ARG, 14 },
+    { "temperature < x", ESP_ERR_INVALID_ARG, 14 },
+    { "sunshine > 1", ESP_ERR_INVALID_ARG, 0 },
+    { "rainy", ESP_ERR_INVALID_ARG, 0 },
+    { "rain &&", ESP_ERR_INVALID_ARG, 7 },
+    { "(rain", ESP_ERR_INVALID_ARG, 5 },
+    { "rain )", ESP_ERR_INVALID_ARG, 5 },
+    { "rain for 5", ESP_ERR_INVALID_ARG, 10 },
+    { "rain for 5 hours", ESP_ERR_INVALID_ARG, 11 },
+    { "rain for -5s", ESP_ERR_INVALID_ARG, 9 },
+    { "rain then", ESP_ERR_INVALID_ARG, 9 },
+    { "abs(rain) > 1", ESP_ERR_INVALID_ARG, 4 },
+    { "((((((((((((((((((((((((((((((((((rain))))))))))))))))))))))))))))))))))", ESP_ERR_NO_MEM, 33 },
+    { "rain or cold or dark or rain or cold or dark or rain or cold or dark or rain or cold or dark or rain or "
+      "cold or dark or rain or cold or dark or rain or cold or dark or rain or cold or dark", ESP_ERR_NO_MEM, 0 },
+    { "rain for 1s for 1s for 1s for 1s for 1s for 1s for 1s for 1s for 1s", ESP_ERR_NO_MEM, 0 },
+};
+
+static int run_eval_case(const eval_case_t *c)
+{
+    quest_cond_program_t program;
+    quest_cond_state_t state = {0};
+    size_t offset = 0;
+    if (quest_cond_compile(c->expr, &program, &offset) != ESP_OK) {
+        printf("FAIL  %s: does not compile (at %zu)\n", c->expr, offset);
+        return 1;
+    }
+    for (int i = 0; i < c->count; i++) {
+        const step_t *step = &c->steps[i];
+        sensor_data_t data = {
+            .temperature = step->temperature,
+            .humidity = step->humidity,
+            .voc = step->voc,
+            .tilt_angle = step->tilt_angle,
+        };
+        bool value = c->edges ? quest_cond_eval_edge(&program, &state, &data, step->levels, step->t_ms)
+                              : quest_cond_eval(&program, &state, &data, step->levels, step->t_ms);
+        if (value != step->expect) {
+            printf("FAIL  %s: step %d (t=%u ms) gave %d\n", c->expr, i, step->t_ms, value);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int check(void)
+{
+    size_t count = sizeof(eval_cases) / sizeof(eval_cases[0]);
+    for (size_t i = 0; i < count; i++) {
+        failures += run_eval_case(&eval_cases[i]);
+    }
+    printf("evaluation: %zu expressions\n", count);
+
+    count = sizeof(error_cases) / sizeof(error_cases[0]);
+    for (size_t i = 0; i < count; i++) {
+        quest_cond_program_t program;
+        size_t offset = SIZE_MAX;
+        esp_err_t ret = quest_cond_compile(error_cases[i].expr, &program, &offset);
+        // Limits are hit somewhere in the middle; only syntax errors pin the offset
+        bool ok = ret == error_cases[i].error &&
+                  (ret == ESP_ERR_NO_MEM ? offset <= strlen(error_cases[i].expr) : offset == error_cases[i].offset);
+        if (!ok) {
+            printf("FAIL  \"%s\": %s at %zu\n", error_cases[i].expr, esp_err_to_name(ret), offset);
+            failures++;
+        }
+    }
+    printf("compile errors: %zu expressions\n", count);
+
+    int conditions = 0;
+    for (int i = 0; i < quest_table_count; i++) {
+        if (!quest_table[i].condition) {
+            continue;
+        }
+        const quest_cond_program_t *table = quest_table[i].condition;
+        quest_cond_program_t program;
+        size_t offset = 0;
+        conditions++;
+        if (quest_cond_compile(quest_table[i].condition_source, &program, &offset) != ESP_OK) {
+            printf("FAIL  quest %d \"%s\": error at %zu\n", quest_table[i].quest_id,
+                   quest_table[i].condition_source, offset);
+            failures++;
+        } else if (program.length != table->length || memcmp(program.code, table->code, program.length) != 0 ||
+                   program.timers != table->timers || program.depth != table->depth ||
+                   program.events != table->events) {
+            printf("FAIL  quest %d \"%s\": generated bytecode differs\n", quest_table[i].quest_id,
+                   quest_table[i].condition_source);
+            failures++;
+        }
+    }
+    printf("quest_map.json: %d conditions\n", conditions);
+
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
+
+static int bench(uint32_t iterations)
+{
+    static const char *exprs[] = {
+        "rain",
+        "temperature < 15",
+        "abs(tilt_angle) > 30 && movement_magnitude < 1.2",
+        "(temperature < 15 && humidity > 80) for 30s",
+        "movement then tilt within 5s",
+        "(temperature < 15 && humidity > 80 || abs(tilt_angle) > 30) for 10s then voc > 350 within 1min",
+    };
+
+    // Readings that wander across the thresholds, so every branch is taken
+    enum { SAMPLES = 256 };
+    static sensor_data_t data[SAMPLES];
+    static uint32_t levels[SAMPLES];
+    srand(1);
+    for (int i = 0; i < SAMPLES; i++) {
+        data[i].temperature = 10.0f + rand() % 100 / 10.0f;
+        data[i].humidity = 70.0f + rand() % 200 / 10.0f;
+        data[i].voc = 300 + rand() % 100;
+        data[i].tilt_angle = rand() % 80 - 40.0f;
+        data[i].movement_magnitude = 1.0f + rand() % 50 / 100.0f;
+        levels[i] = rand() & SENSOR_EVENT_ALL;
+    }
+
+    printf("%-100s  bytes  ns/eval  Meval/s\n", "expression");
+    for (size_t e = 0; e < sizeof(exprs) / sizeof(exprs[0]); e++) {
+        quest_cond_program_t program;
+        quest_cond_state_t state = {0};
+        if (quest_cond_compile(exprs[e], &program, NULL) != ESP_OK) {
+            fprintf(stderr, "%s: does not compile\n", exprs[e]);
+            return 1;
+        }
+        volatile uint32_t sink = 0;
+        double best = 0.0;
+        for (int round = 0; round < 5; round++) {
+            uint32_t hits = 0;
+            double start = now_s();
+            for (uint32_t i = 0; i < iterations; i++) {
+                hits += quest_cond_eval(&program, &state, &data[i % SAMPLES], levels[i % SAMPLES], i * 100);
+            }
+            double s = now_s() - start;
+            best = round == 0 || s < best ? s : best;
+            sink += hits;
+        }
+        printf("%-100s  %5u  %7.1f  %7.1f\n", exprs[e], program.length, best * 1e9 / iterations,
+               iterations / best / 1e6);
+    }
+    return 0;
+}
+
+static int compile(const char *expr)
+{
+    quest_cond_program_t program;
+    size_t offset = 0;
+    esp_err_t ret = quest_cond_compile(expr, &program, &offset);
+    if (ret != ESP_OK) {
+        fprintf(stderr, "%s\n%*s^ %s\n", expr, (int)offset, "", esp_err_to_name(ret));
+        return 1;
+    }
+    printf("%u bytes, %u timers, stack depth %u, sensor events 0x%02lx\n", program.length, program.timers,
+           program.depth, (unsigned long)program.events);
+    for (int i = 0; i < program.length; i++) {
+        printf("%02x%s", program.code[i], i % 16 == 15 || i == program.length - 1 ? "\n" : " ");
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 2 && strcmp(argv[1], "check") == 0) {
+        return check();
+    }
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+        return bench(argc >= 3 ? (uint32_t)atoi(argv[2]) : 10000000);
+    }
+    if (argc >= 3 && strcmp(argv[1], "compile") == 0) {
+        return compile(argv[2]);
+    }
+    fprintf(stderr, "usage: %s check\n"
+                    "       %s bench [iterations]\n"
+                    "       %s compile <expr>\n", argv[0], argv[0], argv[0]);
+    return 2;
+}
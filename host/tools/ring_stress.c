@@ -0,0 +1,228 @@
+// Sample ring stress: one producer publishes as fast as it can while several
+// consumers read through their own cursors, some of them slow enough to be
+// lapped, and one more thread keeps taking the latest sample. Every sample
+// carries its sequence number in each field, so a torn read shows up as
+// fields that disagree. Each consumer must see strictly increasing sequence
+// numbers whose gaps add up to its cursor's drop count, and in the end
+// read + dropped must equal what was published after it attached.
+// Build with -DHOST_SANITIZE=thread to have ThreadSanitizer watch it.
+//
+//   ring_stress [seconds] [consumers]
+
+#include "sensor_ring.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_CONSUMERS   8
+#define READ_BATCH      16
+// The producer publishes in bursts of half a ring with a short pause between,
+// so prompt consumers keep up while the bursts still race the readers
+#define PUBLISH_BURST   (SENSOR_RING_SIZE / 2)
+#define BURST_PAUSE_US  20
+
+typedef struct {
+    int id;
+    sensor_ring_cursor_t cursor;
+    uint32_t start;
+    uint64_t read;
+    uint64_t gaps;
+    uint64_t batches;
+    uint64_t out_of_order;
+    uint64_t torn;
+    uint64_t drop_mismatches;
+} consumer_t;
+
+static sensor_ring_t ring;
+static atomic_bool stop;
+static atomic_bool producer_done;
+static atomic_uint published;
+static atomic_ulong latest_reads;
+static atomic_ulong latest_misses;
+static atomic_ulong latest_torn;
+static atomic_ulong latest_backwards;
+
+// Every field derived from seq, so fields from two samples never agree
+static void fill(sensor_data_t *data, uint32_t seq)
+{
+    float f = (float)(seq & 0xFFFFF);
+    *data = (sensor_data_t) {
+        .temperature = f,
+        .humidity = f + 1.0f,
+        .pressure = f + 2.0f,
+        .voc = seq,
+        .accel_x = f + 3.0f,
+        .accel_y = f + 4.0f,
+        .accel_z = f + 5.0f,
+        .gyro_x = f + 6.0f,
+        .gyro_y = f + 7.0f,
+        .gyro_z = f + 8.0f,
+        .tilt_angle = f + 9.0f,
+        .movement_magnitude = f + 10.0f,
+    };
+}
+
+static bool consistent(const sensor_sample_t *sample)
+{
+    sensor_data_t expected;
+    fill(&expected, sample->seq);
+    const sensor_data_t *data = &sample->data;
+    return sample->timestamp_us == (int64_t)sample->seq * 10 && sample->sources == (sample->seq & 3) &&
+           data->voc == expected.voc && data->temperature == expected.temperature &&
+           data->humidity == expected.humidity && data->pressure == expected.pressure &&
+           data->accel_x == expected.accel_x && data->accel_y == expected.accel_y &&
+           data->accel_z == expected.accel_z && data->gyro_x == expected.gyro_x &&
+           data->gyro_y == expected.gyro_y && data->gyro_z == expected.gyro_z &&
+           data->tilt_angle == expected.tilt_angle &&
+           data->movement_magnitude == expected.movement_magnitude;
+}
+
+static void *producer_thread(void *arg)
+{
+    (void)arg;
+    sensor_data_t data;
+    for (uint32_t seq = 0; !atomic_load_explicit(&stop, memory_order_relaxed); seq++) {
+        fill(&data, seq);
+        sensor_ring_publish(&ring, &data, seq & 3, (int64_t)seq * 10);
+        atomic_store_explicit(&published, seq + 1, memory_order_relaxed);
+        if (seq % PUBLISH_BURST == PUBLISH_BURST - 1) {
+            usleep(BURST_PAUSE_US);
+        }
+    }
+    atomic_store(&producer_done, true);
+    return NULL;
+}
+
+// Checks one batch against the cursor's drop count before and after it
+static void check_batch(consumer_t *consumer, const sensor_sample_t *samples, size_t count,
+                        uint32_t *expected_seq, uint32_t dropped_before)
+{
+    uint64_t gaps = 0;
+    for (size_t i = 0; i < count; i++) {
+        const sensor_sample_t *sample = &samples[i];
+        int32_t ahead = (int32_t)(sample->seq - *expected_seq);
+        if (ahead < 0) {
+            consumer->out_of_order++;
+        } else {
+            gaps += (uint32_t)ahead;
+        }
+        if (!consistent(sample)) {
+            consumer->torn++;
+        }
+        *expected_seq = sample->seq + 1;
+    }
+    // Samples skipped after the last one returned count once the cursor moves past them
+    gaps += consumer->cursor.next - *expected_seq;
+    *expected_seq = consumer->cursor.next;
+    if (consumer->cursor.dropped - dropped_before != gaps) {
+        consumer->drop_mismatches++;
+    }
+    consumer->gaps += gaps;
+    consumer->read += count;
+    consumer->batches++;
+}
+
+static void *consumer_thread(void *arg)
+{
+    consumer_t *consumer = arg;
+    sensor_sample_t samples[READ_BATCH];
+    uint32_t expected_seq = consumer->cursor.next;
+    bool stopping = false;
+    while (!stopping) {
+        // Read everything left once the producer has stopped
+        stopping = atomic_load(&producer_done);
+        uint32_t dropped_before = consumer->cursor.dropped;
+        size_t count = sensor_ring_read(&ring, &consumer->cursor, samples, READ_BATCH);
+        check_batch(consumer, samples, count, &expected_seq, dropped_before);
+        // Odd consumers dawdle and get lapped
+        if (consumer->id & 1 && consumer->batches % 64 == 0) {
+            usleep(500);
+        } else if (count == 0) {
+            sched_yield();
+        }
+        if (stopping && count == READ_BATCH) {
+            stopping = false;
+        }
+    }
+    return NULL;
+}
+
+static void *latest_thread(void *arg)
+{
+    (void)arg;
+    sensor_sample_t sample;
+    uint32_t last = 0;
+    while (!atomic_load(&stop)) {
+        if (!sensor_ring_latest(&ring, &sample)) {
+            atomic_fetch_add(&latest_misses, 1);
+            continue;
+        }
+        if (!consistent(&sample)) {
+            atomic_fetch_add(&latest_torn, 1);
+        }
+        if ((int32_t)(sample.seq - last) < 0) {
+            atomic_fetch_add(&latest_backwards, 1);
+        }
+        last = sample.seq;
+        atomic_fetch_add(&latest_reads, 1);
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    int seconds = argc >= 2 ? atoi(argv[1]) : 5;
+    int consumer_count = argc >= 3 ? atoi(argv[2]) : 4;
+    if (seconds <= 0 || consumer_count <= 0 || consumer_count > MAX_CONSUMERS) {
+        fprintf(stderr, "usage: %s [seconds] [consumers, 1..%d]\n", argv[0], MAX_CONSUMERS);
+        return 2;
+    }
+
+    static consumer_t consumers[MAX_CONSUMERS];
+    sensor_ring_init(&ring);
+    for (int c = 0; c < consumer_count; c++) {
+        consumers[c].id = c;
+        sensor_ring_cursor_init(&ring, &consumers[c].cursor);
+        consumers[c].start = consumers[c].cursor.next;
+    }
+
+    pthread_t producer, latest, threads[MAX_CONSUMERS];
+    for (int c = 0; c < consumer_count; c++) {
+        pthread_create(&threads[c], NULL, consumer_thread, &consumers[c]);
+    }
+    pthread_create(&latest, NULL, latest_thread, NULL);
+    pthread_create(&producer, NULL, producer_thread, NULL);
+    sleep((unsigned)seconds);
+    atomic_store(&stop, true);
+    pthread_join(producer, NULL);
+    pthread_join(latest, NULL);
+    for (int c = 0; c < consumer_count; c++) {
+        pthread_join(threads[c], NULL);
+    }
+
+    uint32_t total = atomic_load(&published);
+    printf("%u samples published in %d s (%.1f M/s), ring of %d\n", total, seconds, total / 1e6 / seconds,
+           SENSOR_RING_SIZE);
+    bool ok = true;
+    for (int c = 0; c < consumer_count; c++) {
+        consumer_t *consumer = &consumers[c];
+        bool accounted = consumer->read + consumer->cursor.dropped == (uint32_t)(total - consumer->start) &&
+                         consumer->gaps == consumer->cursor.dropped;
+        bool pass = accounted && !consumer->out_of_order && !consumer->torn && !consumer->drop_mismatches;
+        printf("consumer %d%s: %llu read, %u dropped, %llu out of order, %llu torn, %llu drop mismatches: %s\n",
+               c, c & 1 ? " (slow)" : "", (unsigned long long)consumer->read, consumer->cursor.dropped,
+               (unsigned long long)consumer->out_of_order, (unsigned long long)consumer->torn,
+               (unsigned long long)consumer->drop_mismatches, pass ? "PASS" : "FAIL");
+        ok &= pass;
+    }
+    bool latest_pass = !atomic_load(&latest_torn) && !atomic_load(&latest_backwards);
+    printf("latest: %lu reads, %lu gave up racing the producer, %lu torn, %lu went backwards: %s\n",
+           atomic_load(&latest_reads), atomic_load(&latest_misses), atomic_load(&latest_torn),
+           atomic_load(&latest_backwards), latest_pass ? "PASS" : "FAIL");
+    ok &= latest_pass;
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,271 @@
+// Adaptive sampling (sensor_scheduler.h) end to end on a simulated clock: an
+// activity trace of quest demand, motion, VOC and logging is played through
+// the real sampling timer callback, and the periods between the samples it
+// publishes are checked against the schedule for each phase. The last hour
+// also has the VOC baseline handed from the timer to the service for NVS.
+//
+//   sched_trace            play the trace and check every phase
+//   sched_trace -v         also print every published sample
+//
+// The tool takes the sampling timer (sensor_manager_host_take_timer()) and
+// advances esp_timer to each tick the timer would have fired at. The BMI270
+// is a fake FIFO behind bmi270_set_bus(); the BME690 reads come from this
+// file's bme690_read_data(), which takes the place of the placeholder driver
+// in the sensors library.
+
+#include "sensor_manager.h"
+#include "sensor_features.h"
+#include "bme690_driver.h"
+#include "bmi270_driver.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "tool_common.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PERIOD_TOLERANCE_US     2000    // esp_timer keeps running under the simulated skew
+#define FRAMES_PER_READ         4
+#define FIFO_HDR_ACC_GYR        0x8C
+#define FIFO_FRAME_SIZE         13
+#define REG_CHIP_ID             0x00
+#define REG_FIFO_LENGTH_0       0x24
+#define REG_FIFO_DATA           0x26
+#define ACC_1G                  4096    // +-8 g range
+
+// What the badge is doing during one phase of the trace
+typedef struct {
+    const char *name;
+    uint32_t seconds;
+    uint32_t demand;            // SENSOR_EVENT_* bits the active quests want
+    bool moving;
+    float voc;                  // VOC at the start of the phase...
+    float voc_per_s;            // ...and its ramp
+    bool logging;
+    uint32_t env_ms;            // Expected BME690 period
+    uint32_t imu_ms;            // Expected BMI270 period
+    uint32_t settle_ms;         // Start of the phase the old rate may still cover
+    float voc_slope;            // VOC slope feature expected at the end, per second; 0: not checked
+} phase_t;
+
+static const phase_t trace[] = {
+    { "idle", 60, 0, false, 100, 0, false, 10000, 1000, 0, 0 },
+    { "rain quest active", 30, SENSOR_EVENT_RAIN, false, 100, 0, false, 1000, 1000, 1000, 0 },
+    { "movement quest active", 30, SENSOR_EVENT_MOVEMENT, false, 100, 0, false, 10000, 100, 10000, 0 },
+    { "moving, no quest", 20, 0, true, 100, 0, false, 10000, 100, 1000, 0 },
+    { "still, motion hold", 4, 0, false, 100, 0, false, 10000, 100, 0, 0 },
+    { "still", 30, 0, false, 100, 0, false, 10000, 1000, 2000, 0 },
+    { "VOC ramp at 1 s", 20, SENSOR_EVENT_RAIN, false, 100, 1.0f, false, 1000, 1000, 1000, 1.0f },
+    { "VOC ramp at 10 s", 60, 0, false, 120, 1.0f, false, 10000, 1000, 10000, 1.0f },
+    { "smoke", 15, 0, false, 600, 0, false, 100, 1000, 10000, 0 },
+    { "after smoke, burst holds", 8, 0, false, 110, 0, false, 100, 1000, 0, 0 },
+    { "clean air", 40, 0, false, 110, 0, false, 10000, 1000, 12000, 0 },
+    { "logging", 10, 0, false, 110, 0, true, 100, 1000, 1000, 0 },
+    { "logging stopped", 30, 0, false, 110, 0, false, 10000, 1000, 11000, 0 },
+    { "clean air, an hour", 3600, 0, false, 110, 0, false, 10000, 1000, 0, 0 },
+};
+
+static bool verbose = false;
+// Trace state the fake sensors read
+static bool moving = false;
+static float voc_now = 100.0f;
+
+esp_err_t bme690_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t bme690_read_data(float *temperature, float *humidity, float *pressure, uint32_t *voc)
+{
+    if (!temperature || !humidity || !pressure || !voc) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *temperature = 21.0f;
+    *humidity = 50.0f;
+    *pressure = 1013.0f;
+    *voc = (uint32_t)lroundf(voc_now);
+    return ESP_OK;
+}
+
+// A few frames per read: 1 g at rest, over 2 g while moving
+static esp_err_t fake_read(void *ctx, uint8_t reg, uint8_t *data, size_t len)
+{
+    (void)ctx;
+    memset(data, 0, len);
+    if (reg == REG_CHIP_ID) {
+        data[0] = 0x24;
+    } else if (reg == REG_FIFO_LENGTH_0 && len == 2) {
+        data[0] = FRAMES_PER_READ * FIFO_FRAME_SIZE;
+    } else if (reg == REG_FIFO_DATA) {
+        const int16_t frame[6] = { 0, 0, 0, moving ? 2 * ACC_1G : 0, 0, ACC_1G };
+        for (size_t pos = 0; pos + FIFO_FRAME_SIZE <= len; pos += FIFO_FRAME_SIZE) {
+            data[pos] = FIFO_HDR_ACC_GYR;
+            for (int axis = 0; axis < 6; axis++) {
+                data[pos + 1 + axis * 2] = (uint8_t)frame[axis];
+                data[pos + 2 + axis * 2] = (uint8_t)((uint16_t)frame[axis] >> 8);
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t fake_write(void *ctx, uint8_t reg, const uint8_t *data, size_t len)
+{
+    (void)ctx;
+    (void)reg;
+    (void)data;
+    (void)len;
+    return ESP_OK;
+}
+
+// Periods between the samples of one sensor within a phase
+typedef struct {
+    int64_t last_us;
+    uint32_t intervals;
+    uint32_t off;               // Intervals more than the tolerance from the schedule
+    int64_t min_us;
+    int64_t max_us;
+} period_stats_t;
+
+static void note_sample(period_stats_t *stats, int64_t t_us, uint32_t expected_ms, bool checked)
+{
+    if (checked && stats->last_us >= 0) {
+        int64_t interval = t_us - stats->last_us;
+        if (llabs(interval - (int64_t)expected_ms * 1000) > PERIOD_TOLERANCE_US) {
+            stats->off++;
+        }
+        stats->min_us = stats->intervals == 0 || interval < stats->min_us ? interval : stats->min_us;
+        stats->max_us = stats->intervals == 0 || interval > stats->max_us ? interval : stats->max_us;
+        stats->intervals++;
+    }
+    stats->last_us = checked ? t_us : -1;
+}
+
+static void drain(const phase_t *phase, int64_t phase_start_us, period_stats_t *env, period_stats_t *imu)
+{
+    sensor_sample_t samples[16];
+    size_t count;
+    while ((count = sensor_manager_read_samples(SENSOR_CONSUMER_QUEST, samples, 16)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            const sensor_sample_t *sample = &samples[i];
+            bool checked = sample->timestamp_us >= phase_start_us + (int64_t)phase->settle_ms * 1000;
+            if (verbose) {
+                printf("  %9.3f s %s%s voc %lu movement %.2f\n", sample->timestamp_us / 1e6,
+                       sample->sources & SENSOR_SOURCE_ENV ? "ENV " : "    ",
+                       sample->sources & SENSOR_SOURCE_IMU ? "IMU" : "   ", (unsigned long)sample->data.voc,
+                       sample->data.movement_magnitude);
+            }
+            if (sample->sources & SENSOR_SOURCE_ENV) {
+                note_sample(env, sample->timestamp_us, phase->env_ms, checked);
+            }
+            if (sample->sources & SENSOR_SOURCE_IMU) {
+                note_sample(imu, sample->timestamp_us, phase->imu_ms, checked);
+            }
+        }
+    }
+}
+
+static bool report(const char *sensor, const period_stats_t *stats, const phase_t *phase, uint32_t expected_ms)
+{
+    // A phase with room for two periods after settling has at least one interval
+    bool required = phase->seconds * 1000 - phase->settle_ms >= 2 * expected_ms;
+    bool ok = (stats->intervals > 0 || !required) && stats->off == 0;
+    printf("%s    %s every %5lu ms: %3lu intervals, %.1f..%.1f ms\n", ok ? "ok  " : "FAIL", sensor,
+           (unsigned long)expected_ms, (unsigned long)stats->intervals, stats->min_us / 1e3, stats->max_us / 1e3);
+    return ok;
+}
+
+static void play(const phase_t *phase)
+{
+    int64_t start_us = esp_timer_get_time();
+    int64_t end_us = start_us + (int64_t)phase->seconds * 1000000;
+    period_stats_t env = { .last_us = -1 };
+    period_stats_t imu = { .last_us = -1 };
+
+    moving = phase->moving;
+    voc_now = phase->voc;
+    sensor_manager_set_demand(phase->demand);
+    if (phase->logging) {
+        sensor_manager_start_voc_logging("trace");
+    } else {
+        sensor_manager_stop_voc_logging();
+    }
+
+    for (;;) {
+        int64_t next_us = sensor_manager_host_next_tick_us();
+        int64_t now_us = esp_timer_get_time();
+        int64_t target_us = next_us < end_us ? next_us : end_us;
+        if (target_us > now_us) {
+            esp_timer_host_advance(target_us - now_us);
+        }
+        voc_now = phase->voc + phase->voc_per_s * (esp_timer_get_time() - start_us) / 1e6f;
+        if (next_us >= end_us) {
+            break;
+        }
+        sensor_manager_host_tick(false);
+        // As the quest loop does after every wakeup
+        sensor_manager_service();
+        drain(phase, start_us, &env, &imu);
+    }
+
+    printf("%s (%lu s)\n", phase->name, (unsigned long)phase->seconds);
+    failures += !report("BME690", &env, phase, phase->env_ms);
+    failures += !report("BMI270", &imu, phase, phase->imu_ms);
+    if (phase->voc_slope != 0.0f) {
+        sensor_features_t features;
+        float slope = sensor_manager_get_features(&features) == ESP_OK
+                          ? SENSOR_FEATURE(&features, SENSOR_CH_VOC, SENSOR_FEAT_SLOPE) : 0.0f;
+        bool ok = fabsf(slope - phase->voc_slope) < 0.05f;
+        printf("%s    VOC slope %.3f/s (ramp %.3f/s)\n", ok ? "ok  " : "FAIL", slope, phase->voc_slope);
+        failures += !ok;
+    }
+}
+
+// After an hour past warm-up the timer has asked for the baseline to be
+// stored, and the service the trace calls after each tick wrote it
+static void check_baseline_stored(void)
+{
+    nvs_handle_t handle;
+    float stored = 0.0f;
+    size_t length = sizeof(stored);
+    if (nvs_open("sensors", NVS_READONLY, &handle) == ESP_OK) {
+        nvs_get_blob(handle, "voc_baseline", &stored, &length);
+        nvs_close(handle);
+    }
+    float baseline = sensor_manager_get_voc_baseline();
+    bool ok = stored > 0.0f && fabsf(stored - baseline) <= baseline * 0.05f;
+    printf("%s  VOC baseline %.1f stored in NVS (now %.1f)\n", ok ? "ok  " : "FAIL", stored, baseline);
+    failures += !ok;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 2 || (argc == 2 && strcmp(argv[1], "-v") != 0)) {
+        fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+        return 2;
+    }
+    verbose = argc == 2;
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    bmi270_bus_t bus = { .read = fake_read, .write = fake_write };
+    bmi270_set_bus(&bus);
+    if (nvs_flash_init() != ESP_OK || sensor_manager_init() != ESP_OK) {
+        fprintf(stderr, "sensor manager failed to start\n");
+        return 1;
+    }
+    sensor_manager_host_take_timer();
+    // Whatever the live timer sampled before it was taken is not part of the trace
+    sensor_sample_t sample;
+    while (sensor_manager_read_samples(SENSOR_CONSUMER_QUEST, &sample, 1) > 0) {
+    }
+
+    for (size_t p = 0; p < sizeof(trace) / sizeof(trace[0]); p++) {
+        play(&trace[p]);
+    }
+    check_baseline_stored();
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,47 @@
+#ifndef TOOL_COMMON_H
+#define TOOL_COMMON_H
+
+// Helpers shared by the host tools, each of which is a single file: check
+// results, a monotonic clock for benches and a seedable generator for test
+// signals.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+static int failures = 0;
+
+// One check line; detail is printed right after the name
+static inline void expect(const char *name, bool ok, const char *detail)
+{
+    printf("%s  %s%s\n", ok ? "ok  " : "FAIL", name, detail);
+    failures += !ok;
+}
+
+static inline double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Set it to restart a sequence; never 0
+static uint32_t rng_state = 1;
+
+static inline uint32_t rng_next(void)
+{
+    // xorshift32
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+// Uniform in [-amplitude, amplitude]
+static inline float noise(float amplitude)
+{
+    return amplitude * ((float)(rng_next() % 20001) / 10000.0f - 1.0f);
+}
+
+#endif // TOOL_COMMON_H
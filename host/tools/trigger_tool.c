@@ -0,0 +1,362 @@
+// Sensor-trigger quests (quest_system.h): edge semantics, and the
+// event-driven quest loop against the 100 ms polling loop it replaced.
+//
+//   trigger_tool check              progress per rising edge, levels already
+//                                   true at activation, pending edges, and
+//                                   thresholds from the quest table
+//   trigger_tool bench [minutes]    wakeups per minute and trigger-to-progress
+//                                   latency on a rainy trace, per sensor rate
+//
+// Readings go through the replay path with simulated timestamps. In bench the
+// quest loop runs in its own thread blocked in quest_system_wait_and_update(),
+// as in app_main; the old loop is simulated as a poll every 100 ms that counts
+// every poll with the trigger true. Every configuration is a fresh process.
+
+#include "quest_system.h"
+#include "quest_table.h"
+#include "sensor_manager.h"
+#include "storage_manager.h"
+#include "state_persistence.h"
+#include "nvs_flash.h"
+#include "esp_log.h"
+#include "tool_common.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define POLL_MS         100     // The loop app_main used to run
+#define DRY_HUMIDITY    60.0f
+#define RAIN_HUMIDITY   92.0f   // Rain is above 85 %RH
+#define RAMP_S          20      // Humidity crosses the threshold, with noise, over this
+#define RAIN_EVERY_S    600     // Mean time between showers
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static bool boot(void)
+{
+    if (nvs_flash_init() != ESP_OK || storage_manager_init() != ESP_OK || sensor_manager_init() != ESP_OK ||
+        sensor_manager_begin_replay() != ESP_OK || quest_system_init() != ESP_OK) {
+        return false;
+    }
+    // Flush every change so no write-back deadline wakes the loop
+    state_persistence_set_policy(&(state_persist_policy_t) { 0, 0 });
+    return true;
+}
+
+// Adds a quest and returns its id, the first one nothing else uses
+static uint8_t add_quest(const char *name, trigger_type_t trigger)
+{
+    for (uint8_t id = 1; id <= MAX_QUESTS; id++) {
+        if (!quest_get_def(id)) {
+            return quest_add(name, "Trigger tool quest", trigger, UINT16_MAX) == ESP_OK ? id : 0;
+        }
+    }
+    return 0;
+}
+
+static int64_t sim_us = 0;
+
+static uint32_t feed(float temperature, float humidity)
+{
+    const sensor_data_t env = {
+        .temperature = temperature,
+        .humidity = humidity,
+        .pressure = 1013.0f,
+        .voc = 100,
+    };
+    uint32_t edges = 0;
+    sim_us += POLL_MS * 1000;
+    sensor_manager_replay_tick(sim_us, &env, NULL, NULL, &edges);
+    return edges;
+}
+
+static uint16_t progress(uint8_t id)
+{
+    quest_t quest;
+    return quest_get_state(id, &quest) == ESP_OK ? quest.progress : 0xFFFF;
+}
+
+static void check_progress(const char *name, uint8_t id, uint16_t expected)
+{
+    char detail[64];
+    uint16_t actual = progress(id);
+    snprintf(detail, sizeof(detail), ": progress %u (expected %u)", actual, expected);
+    expect(name, actual == expected, detail);
+}
+
+static int run_check(void)
+{
+    if (!boot()) {
+        return 1;
+    }
+    uint8_t rain_a = add_quest("Rain A", TRIGGER_RAIN);
+    uint8_t rain_b = add_quest("Rain B", TRIGGER_RAIN);
+    uint8_t cold = add_quest("Cold", TRIGGER_COLD);
+    if (!rain_a || !rain_b || !cold) {
+        return 1;
+    }
+
+    // Raining before the quest exists: that is its first occurrence, once
+    feed(20.0f, DRY_HUMIDITY);
+    feed(20.0f, RAIN_HUMIDITY);
+    quest_activate(rain_a);
+    check_progress("level already true at activation counts", rain_a, 1);
+    quest_system_update();
+    check_progress("edge raised before activation is not counted again", rain_a, 1);
+    for (int i = 0; i < 20; i++) {
+        feed(20.0f, RAIN_HUMIDITY);
+        quest_system_update();
+    }
+    check_progress("a level that stays true counts once", rain_a, 1);
+    feed(20.0f, DRY_HUMIDITY);
+    feed(20.0f, RAIN_HUMIDITY);
+    quest_system_update();
+    check_progress("a new rising edge counts", rain_a, 2);
+
+    // An edge still pending when another quest on the same trigger starts
+    feed(20.0f, DRY_HUMIDITY);
+    quest_system_update();
+    feed(20.0f, RAIN_HUMIDITY);
+    quest_activate(rain_b);
+    check_progress("pending edge goes to the waiting quest", rain_a, 3);
+    check_progress("the new quest counts the level once", rain_b, 1);
+    quest_system_update();
+    check_progress("waiting quest sees the edge once", rain_a, 3);
+    check_progress("new quest sees the edge once", rain_b, 1);
+
+    // Not true at activation: nothing until it becomes true
+    quest_activate(cold);
+    check_progress("level false at activation", cold, 0);
+    feed(10.0f, DRY_HUMIDITY);
+    quest_system_update();
+    check_progress("first rising edge after activation", cold, 1);
+
+    // Chatter across the threshold: one step per rising edge
+    uint16_t before = progress(rain_a);
+    uint32_t rises = 0;
+    for (int i = 0; i < 40; i++) {
+        rises += (feed(20.0f, i & 1 ? 86.0f : 84.0f) & SENSOR_EVENT_RAIN) != 0;
+        quest_system_update();
+    }
+    char detail[64];
+    snprintf(detail, sizeof(detail), ": %u rising edges, %u steps", rises, progress(rain_a) - before);
+    expect("chatter counts each rising edge", rises == 20 && (uint32_t)(progress(rain_a) - before) == rises, detail);
+
+    // The rain threshold is the table's, and a new one holds from the next sample
+    float threshold = -1.0f;
+    for (int i = 0; i < quest_table_count; i++) {
+        if (quest_table[i].trigger_type == TRIGGER_RAIN && (quest_table[i].flags & QUEST_FLAG_THRESHOLD)) {
+            threshold = quest_table[i].threshold;
+        }
+    }
+    feed(20.0f, threshold - 0.5f);
+    bool below = !(sensor_manager_get_trigger_state() & SENSOR_EVENT_RAIN);
+    feed(20.0f, threshold + 0.5f);
+    bool above = sensor_manager_get_trigger_state() & SENSOR_EVENT_RAIN;
+    snprintf(detail, sizeof(detail), ": %.1f %%RH", threshold);
+    expect("rain threshold from the quest table", threshold >= 0.0f && below && above, detail);
+    bool set = sensor_manager_set_threshold(SENSOR_EVENT_RAIN, RAIN_HUMIDITY + 1.0f) == ESP_OK;
+    feed(20.0f, RAIN_HUMIDITY);
+    expect("a new threshold applies to the next sample",
+           set && !(sensor_manager_get_trigger_state() & SENSOR_EVENT_RAIN), "");
+    expect("dark has no threshold", sensor_manager_set_threshold(SENSOR_EVENT_DARK, 1.0f) == ESP_ERR_INVALID_ARG &&
+           sensor_manager_set_threshold(SENSOR_EVENT_RAIN | SENSOR_EVENT_COLD, 1.0f) == ESP_ERR_INVALID_ARG, "");
+
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
+
+// Humidity for one sample: dry with noise, and showers ramping up through the
+// rain threshold, staying 30..300 s, and ramping down again
+static float humidity_at(uint32_t period_ms)
+{
+    static uint32_t shower_left_ms = 0;
+    static uint32_t shower_ms = 0;
+    static uint32_t shower_elapsed_ms = 0;
+    if (shower_left_ms == 0 && rng_next() % (RAIN_EVERY_S * 1000 / period_ms) == 0) {
+        shower_ms = (2 * RAMP_S + 30 + rng_next() % 271) * 1000;
+        shower_left_ms = shower_ms;
+        shower_elapsed_ms = 0;
+    }
+    if (shower_left_ms == 0) {
+        return DRY_HUMIDITY + noise(2.0f);
+    }
+    shower_left_ms = shower_left_ms > period_ms ? shower_left_ms - period_ms : 0;
+    shower_elapsed_ms += period_ms;
+    uint32_t edge_ms = shower_elapsed_ms < shower_ms - shower_elapsed_ms ? shower_elapsed_ms
+                                                                         : shower_ms - shower_elapsed_ms;
+    float ramp = edge_ms >= RAMP_S * 1000 ? 1.0f : (float)edge_ms / (RAMP_S * 1000);
+    return DRY_HUMIDITY + (RAIN_HUMIDITY - DRY_HUMIDITY) * ramp + noise(1.5f);
+}
+
+typedef struct {
+    uint32_t wakeups;
+    uint32_t steps;
+    double latency_sum_ms;
+    double latency_max_ms;
+    uint32_t latencies;
+} loop_stats_t;
+
+static void print_stats(const char *loop, uint32_t period_ms, uint32_t minutes, const loop_stats_t *stats,
+                        uint32_t rises)
+{
+    printf("%-9s %6u ms  %5u  %11.1f  %13.1f  %11.3f  %11.3f\n", loop, period_ms, rises,
+           (double)stats->wakeups / minutes, (double)stats->steps / minutes,
+           stats->latencies ? stats->latency_sum_ms / stats->latencies : 0.0, stats->latency_max_ms);
+    // The child leaves with _exit()
+    fflush(stdout);
+}
+
+static uint8_t bench_quest;
+static atomic_bool bench_stop;
+static atomic_llong edge_published_ns;
+static atomic_uint steps_seen;
+static loop_stats_t event_stats;
+
+// The quest task of app_main, measuring how long a rising edge takes to
+// become progress
+static void *quest_thread(void *arg)
+{
+    (void)arg;
+    uint16_t last = progress(bench_quest);
+    while (!atomic_load(&bench_stop)) {
+        quest_system_wait_and_update(SENSOR_WAIT_FOREVER);
+        if (atomic_load(&bench_stop)) {
+            break;
+        }
+        event_stats.wakeups++;
+        uint16_t now = progress(bench_quest);
+        if (now != last) {
+            double ms = (now_ns() - atomic_load(&edge_published_ns)) / 1e6;
+            event_stats.latency_sum_ms += ms;
+            event_stats.latency_max_ms = ms > event_stats.latency_max_ms ? ms : event_stats.latency_max_ms;
+            event_stats.latencies++;
+            event_stats.steps += now - last;
+            last = now;
+            atomic_store(&steps_seen, event_stats.steps);
+        }
+    }
+    return NULL;
+}
+
+static int bench_config(uint32_t period_ms, uint32_t minutes, bool events)
+{
+    if (!boot() || !(bench_quest = add_quest("Rain", TRIGGER_RAIN)) || quest_activate(bench_quest) != ESP_OK) {
+        return 1;
+    }
+    sensor_manager_clear_events(SENSOR_EVENT_WAKE);
+    rng_state = 1;
+    uint64_t samples = (uint64_t)minutes * 60000 / period_ms;
+    uint32_t rises = 0;
+
+    if (events) {
+        pthread_t thread;
+        pthread_create(&thread, NULL, quest_thread, NULL);
+        for (uint64_t i = 0; i < samples; i++) {
+            const sensor_data_t env = { .temperature = 20.0f, .humidity = humidity_at(period_ms), .pressure = 1013.0f };
+            uint32_t edges = 0;
+            atomic_store(&edge_published_ns, now_ns());
+            sensor_manager_replay_tick((int64_t)i * period_ms * 1000, &env, NULL, NULL, &edges);
+            if (edges & SENSOR_EVENT_RAIN) {
+                // Let the quest loop take it before the next reading
+                rises++;
+                while (atomic_load(&steps_seen) < rises) {
+                    sched_yield();
+                }
+            }
+        }
+        atomic_store(&bench_stop, true);
+        sensor_manager_post_events(SENSOR_EVENT_WAKE);
+        pthread_join(thread, NULL);
+        print_stats("events", period_ms, minutes, &event_stats, rises);
+        return 0;
+    }
+
+    // Polls at a fixed phase to the sensor timer, as two free-running
+    // periodic tasks would be; half a poll is the mean over phases
+    loop_stats_t stats = { 0 };
+    uint32_t phase_ms = POLL_MS / 2;
+    int64_t rise_us = -1;
+    uint64_t next_sample = 0;
+    for (int64_t poll_us = (int64_t)phase_ms * 1000; poll_us < (int64_t)minutes * 60000000; poll_us += POLL_MS * 1000) {
+        while (next_sample < samples && (int64_t)next_sample * period_ms * 1000 <= poll_us) {
+            const sensor_data_t env = { .temperature = 20.0f, .humidity = humidity_at(period_ms), .pressure = 1013.0f };
+            uint32_t edges = 0;
+            int64_t t = (int64_t)next_sample++ * period_ms * 1000;
+            sensor_manager_replay_tick(t, &env, NULL, NULL, &edges);
+            if (edges & SENSOR_EVENT_RAIN) {
+                rises++;
+                if (rise_us < 0) {
+                    rise_us = t;
+                }
+            }
+        }
+        stats.wakeups++;
+        if (sensor_manager_get_trigger_state() & SENSOR_EVENT_RAIN) {
+            stats.steps++;
+            if (rise_us >= 0) {
+                double ms = (poll_us - rise_us) / 1e3;
+                stats.latency_sum_ms += ms;
+                stats.latency_max_ms = ms > stats.latency_max_ms ? ms : stats.latency_max_ms;
+                stats.latencies++;
+            }
+        }
+        rise_us = -1;
+    }
+    print_stats("polling", period_ms, minutes, &stats, rises);
+    return 0;
+}
+
+static int run_bench(uint32_t minutes)
+{
+    static const uint32_t periods[] = { 100, 1000 };
+    printf("%u simulated minutes of showers per configuration\n", minutes);
+    printf("loop      sensor     rises  wakeups/min  progress/min  latency ms  max latency\n");
+    for (size_t p = 0; p < sizeof(periods) / sizeof(periods[0]); p++) {
+        for (int events = 0; events <= 1; events++) {
+            fflush(stdout);
+            pid_t pid = fork();
+            if (pid == 0) {
+                _exit(bench_config(periods[p], minutes, events));
+            }
+            int status = 0;
+            if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                fprintf(stderr, "%u ms, %s failed\n", periods[p], events ? "events" : "polling");
+                return 1;
+            }
+        }
+    }
+    printf("Polling latency is simulated time to the next poll; event latency is the\n"
+           "wall-clock wake of the quest thread on this host. Polling counts every\n"
+           "poll with rain as progress, events count each rising edge.\n");
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    // No sensors on the host; the BMI270 probe fails
+    esp_log_level_set("*", ESP_LOG_NONE);
+    if (argc >= 2 && strcmp(argv[1], "check") == 0) {
+        return run_check();
+    }
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+        int minutes = argc >= 3 ? atoi(argv[2]) : 120;
+        if (minutes > 0) {
+            return run_bench((uint32_t)minutes);
+        }
+    }
+    fprintf(stderr, "usage: %s check\n"
+                    "       %s bench [minutes]\n", argv[0], argv[0]);
+    return 2;
+}
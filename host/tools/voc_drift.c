@@ -0,0 +1,190 @@
+// VOC baseline tracking on synthetic drift traces: badges whose sensors read
+// 0.5x to 3.6x the nominal level, drift over a week, breathe with the day and
+// see smoke now and then. Smoke detection with the raw thresholds is compared
+// against detection relative to the tracked baseline; each badge reboots
+// daily, continuing from its stored baseline. Finally the baseline is stored
+// in the NVS shim and picked up by sensor_manager_init.
+//
+//   voc_drift [days] [seed]
+
+#include "voc_baseline.h"
+#include "sensor_manager.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "esp_log.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CIGARETTE_VOC   350.0f      // As in sensor_manager.c, at VOC_BASELINE_NOMINAL
+#define HERBAL_VOC      600.0f
+
+typedef enum {
+    CLEAN = 0,
+    CIGARETTE,
+    HERBAL
+} smoke_t;
+
+typedef struct {
+    const char *name;
+    float gain;                     // Unit-to-unit sensitivity
+    float drift_per_day;            // Relative change of the clean-air level per day
+    float step_day;                 // Day the badge moves to a room with step_factor x the VOC
+    float step_factor;
+} badge_t;
+
+typedef struct {
+    uint32_t events;
+    uint32_t raw_hits;              // Events classified correctly at least once
+    uint32_t tracked_hits;
+    double raw_false_s;             // Time flagged as smoke in clean air
+    double tracked_false_s;
+    double error_sum;               // Tracking error after warm-up
+    float error_max;
+    uint32_t error_count;
+} result_t;
+
+static float uniform(float low, float high)
+{
+    return low + (high - low) * ((float)rand() / RAND_MAX);
+}
+
+static smoke_t classify(float voc)
+{
+    return voc >= HERBAL_VOC ? HERBAL : voc > CIGARETTE_VOC ? CIGARETTE : CLEAN;
+}
+
+static void simulate(const badge_t *badge, int days, result_t *result)
+{
+    voc_baseline_t tracker;
+    voc_baseline_init(&tracker, 0.0f);
+
+    int64_t t_us = 0;
+    int64_t end_us = (int64_t)days * 86400 * 1000000;
+    int64_t next_reboot_us = 86400LL * 1000000;
+    int64_t event_start_us = (int64_t)(uniform(1.0f, 6.0f) * 3600) * 1000000;
+    int64_t event_end_us = 0;
+    float event_level = 0.0f;       // Peak relative to the clean-air level
+    bool event_raw_hit = false;
+    bool event_tracked_hit = false;
+
+    while (t_us < end_us) {
+        double day = t_us / 86400e6;
+        float clean = VOC_BASELINE_NOMINAL * badge->gain * powf(1.0f + badge->drift_per_day, (float)day) *
+                      (1.0f + 0.1f * sinf(2.0f * (float)M_PI * (float)day));
+        if (badge->step_day > 0.0f && day >= badge->step_day) {
+            clean *= badge->step_factor;
+        }
+
+        // Smoke: a plume that rises in a minute, holds, and clears
+        float plume = 0.0f;
+        smoke_t truth = CLEAN;
+        if (t_us >= event_start_us && t_us < event_end_us) {
+            float since = (t_us - event_start_us) / 1e6f;
+            float until = (event_end_us - t_us) / 1e6f;
+            float shape = fminf(1.0f, fminf(since, until) / 60.0f);
+            plume = (event_level - 1.0f) * shape;
+            truth = event_level >= 7.0f ? HERBAL : CIGARETTE;
+        } else if (t_us >= event_end_us && event_end_us > event_start_us) {
+            result->events++;
+            result->raw_hits += event_raw_hit;
+            result->tracked_hits += event_tracked_hit;
+            event_start_us = t_us + (int64_t)(uniform(2.0f, 10.0f) * 3600) * 1000000;
+            event_end_us = 0;
+        } else if (t_us >= event_start_us) {
+            event_end_us = event_start_us + (int64_t)uniform(240.0f, 900.0f) * 1000000;
+            event_level = rand() % 2 ? uniform(4.5f, 5.5f) : uniform(8.0f, 10.0f);
+            event_raw_hit = event_tracked_hit = false;
+            continue;
+        }
+        float voc = roundf(clean * (1.0f + plume) * (1.0f + uniform(-0.03f, 0.03f)));
+
+        voc_baseline_update(&tracker, voc, t_us);
+        smoke_t raw = classify(voc);
+        smoke_t tracked = classify(voc_baseline_compensate(tracker.baseline, voc));
+
+        // Idle every 10 s, 1 s while a quest is active, 100 ms bursts in smoke
+        int64_t period_us = (int64_t)((t_us / 3600000000LL) % 3 ? 10000 : 1000) * 1000;
+        if (truth != CLEAN || tracked != CLEAN) {
+            period_us = 100000;
+        }
+        if (truth == CLEAN) {
+            result->raw_false_s += raw != CLEAN ? period_us / 1e6 : 0.0;
+            result->tracked_false_s += tracked != CLEAN ? period_us / 1e6 : 0.0;
+            // Error once warmed up, and not while the moved badge re-learns
+            if (day > 0.25 && (badge->step_day <= 0.0f || day < badge->step_day || day > badge->step_day + 0.5f)) {
+                float error = fabsf(tracker.baseline - clean) / clean;
+                result->error_sum += error;
+                result->error_count++;
+                result->error_max = fmaxf(result->error_max, error);
+            }
+        } else if (plume >= (event_level - 1.0f) * 0.9f) {
+            // Judge a plume near its plateau, where the class is defined
+            event_raw_hit |= raw == truth;
+            event_tracked_hit |= tracked == truth;
+        }
+
+        // Daily reboot: continue from what NVS would hold
+        if (t_us >= next_reboot_us) {
+            float stored = tracker.baseline;
+            voc_baseline_init(&tracker, stored);
+            next_reboot_us += 86400LL * 1000000;
+            t_us += 30 * 1000000;
+        }
+        t_us += period_us;
+    }
+}
+
+// sensor_manager_init must continue from the stored baseline
+static bool check_persistence(void)
+{
+    const float stored = 187.5f;
+    nvs_handle_t handle;
+    if (nvs_flash_init() != ESP_OK || nvs_open("sensors", NVS_READWRITE, &handle) != ESP_OK) {
+        return false;
+    }
+    nvs_set_blob(handle, "voc_baseline", &stored, sizeof(stored));
+    nvs_commit(handle);
+    nvs_close(handle);
+
+    if (sensor_manager_init() != ESP_OK) {
+        return false;
+    }
+    float baseline = sensor_manager_get_voc_baseline();
+    printf("persistence: stored %.1f, sensor_manager_init restored %.1f\n", stored, baseline);
+    return fabsf(baseline - stored) < stored * 0.01f;
+}
+
+int main(int argc, char **argv)
+{
+    int days = argc >= 2 ? atoi(argv[1]) : 7;
+    srand(argc >= 3 ? (unsigned)atoi(argv[2]) : 1);
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    static const badge_t badges[] = {
+        { "nominal",        1.0f,  0.00f, 0.0f, 0.0f },
+        { "low unit",       0.5f,  0.00f, 0.0f, 0.0f },
+        { "high unit",      3.6f,  0.00f, 0.0f, 0.0f },
+        { "drifting up",    1.3f,  0.06f, 0.0f, 0.0f },
+        { "drifting down",  1.6f, -0.06f, 0.0f, 0.0f },
+        { "moved rooms",    0.8f,  0.00f, 3.0f, 1.8f },
+    };
+
+    bool ok = true;
+    printf("%d days per badge, events found (raw | tracked), false smoke (raw | tracked), baseline error\n", days);
+    printf("badge          gain  events  raw hits  tracked   raw false  tracked false  mean err  max err\n");
+    for (size_t b = 0; b < sizeof(badges) / sizeof(badges[0]); b++) {
+        result_t result = {0};
+        simulate(&badges[b], days, &result);
+        double mean = result.error_count ? result.error_sum / result.error_count : 0.0;
+        printf("%-14s %4.1f  %6lu  %8lu  %7lu  %8.0f s  %11.0f s  %6.1f %%  %5.1f %%\n", badges[b].name,
+               badges[b].gain, (unsigned long)result.events, (unsigned long)result.raw_hits,
+               (unsigned long)result.tracked_hits, result.raw_false_s, result.tracked_false_s,
+               100.0 * mean, 100.0 * result.error_max);
+        ok &= result.tracked_hits * 100 >= result.events * 95 && result.tracked_false_s < 60.0 && mean < 0.05;
+    }
+
+    ok &= check_persistence();
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
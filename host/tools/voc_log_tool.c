@@ -0,0 +1,398 @@
+// Training log (voc_log.h): decode round trip, refused appends, and how many
+// bytes a sample costs at the logging rates.
+//
+//   voc_log_tool check               round trip, rewind/full/label limits, and
+//                                    the drops sensor_manager counts when live
+//                                    samples follow a replay or fill the log,
+//                                    and sessions the service catches up on late
+//   voc_log_tool bench [samples]     bytes per sample and ns per append/decode
+
+#include "voc_log.h"
+#include "sensor_manager.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs_flash.h"
+#include "tool_common.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// As in sensor_manager.c
+#define LOG_BUFFER_SIZE     48000
+
+#define MAX_SAMPLES         200000
+
+typedef struct {
+    uint32_t timestamp_ms;
+    uint32_t voc;
+    float temperature;
+    float humidity;
+    const char *label;
+} input_t;
+
+// A room sampled every period_ms: slow temperature/humidity walks, VOC with
+// puffs on top, and the given scheduling jitter
+static void generate(input_t *in, uint32_t n, uint32_t period_ms, uint32_t jitter_ms)
+{
+    static const char *const labels[] = { "clean", "cigarette", "herbal" };
+    float temp = 21.0f, hum = 45.0f, plume = 0.0f;
+    uint32_t t = 1000;
+    for (uint32_t i = 0; i < n; i++) {
+        temp += ((float)rand() / RAND_MAX - 0.5f) * 0.05f;
+        hum += ((float)rand() / RAND_MAX - 0.5f) * 0.2f;
+        if (rand() % 200 == 0) {
+            plume = 300.0f + rand() % 400;
+        }
+        plume *= 0.9f;
+        t += period_ms + (jitter_ms ? (uint32_t)(rand() % (jitter_ms + 1)) : 0);
+        in[i].timestamp_ms = t;
+        in[i].voc = (uint32_t)(120.0f + plume) + rand() % 5;
+        in[i].temperature = temp;
+        in[i].humidity = hum;
+        in[i].label = labels[(i / 500) % 3];
+    }
+}
+
+// Appends until the first refusal; returns the number accepted
+static uint32_t append_all(voc_log_t *log, const input_t *in, uint32_t n)
+{
+    uint32_t i = 0;
+    while (i < n && voc_log_append(log, in[i].timestamp_ms, in[i].voc, in[i].temperature,
+                                   in[i].humidity, in[i].label) == ESP_OK) {
+        i++;
+    }
+    return i;
+}
+
+// Decodes the log and compares it with the first n inputs. Temperature and
+// humidity are stored in hundredths.
+static bool matches(const voc_log_t *log, const input_t *in, uint32_t n)
+{
+    voc_log_iter_t iter;
+    voc_log_sample_t sample;
+    uint32_t i = 0;
+    voc_log_iter_init(&iter, log);
+    while (voc_log_iter_next(&iter, &sample)) {
+        if (i >= n || sample.timestamp_ms != in[i].timestamp_ms || sample.voc != in[i].voc ||
+            fabsf(sample.temperature - in[i].temperature) > 0.0051f ||
+            fabsf(sample.humidity - in[i].humidity) > 0.0051f || strcmp(sample.label, in[i].label) != 0) {
+            return false;
+        }
+        i++;
+    }
+    return i == n && voc_log_count(log) == n;
+}
+
+static input_t inputs[MAX_SAMPLES];
+static uint8_t buffer[LOG_BUFFER_SIZE];
+
+static void check_codec(void)
+{
+    voc_log_t log;
+    char detail[96];
+
+    expect("init refuses a buffer smaller than one chunk per column",
+           voc_log_init(&log, buffer, VOC_LOG_COL_MAX * VOC_LOG_CHUNK_SIZE - 1) == ESP_ERR_INVALID_ARG, "");
+
+    voc_log_init(&log, buffer, sizeof(buffer));
+    generate(inputs, 3000, 100, 5);
+    uint32_t n = append_all(&log, inputs, 3000);
+    snprintf(detail, sizeof(detail), " (%lu samples, %.2f bytes each)", (unsigned long)n,
+             (double)voc_log_bytes_used(&log) / n);
+    expect("round trip at 100 ms with jitter and label runs", n == 3000 && matches(&log, inputs, n), detail);
+
+    // Extremes of every column: clamped temperature/humidity, full-range deltas
+    static const input_t extremes[] = {
+        { 0, 0, -400.0f, -5.0f, "x" },
+        { 0, UINT32_MAX, 400.0f, 700.0f, "x" },
+        { UINT32_MAX, 0, -327.68f, 0.0f, "x" },
+    };
+    voc_log_reset(&log);
+    bool ok = append_all(&log, extremes, 3) == 3;
+    voc_log_iter_t iter;
+    voc_log_sample_t sample;
+    voc_log_iter_init(&iter, &log);
+    ok = ok && voc_log_iter_next(&iter, &sample) && sample.temperature == -327.68f && sample.humidity == 0.0f;
+    ok = ok && voc_log_iter_next(&iter, &sample) && sample.voc == UINT32_MAX &&
+         sample.temperature == 327.67f && sample.humidity == 655.35f;
+    ok = ok && voc_log_iter_next(&iter, &sample) && sample.timestamp_ms == UINT32_MAX && sample.voc == 0;
+    expect("extreme values and deltas", ok && !voc_log_iter_next(&iter, &sample), "");
+
+    // Timestamps may repeat but not go back; a refused append changes nothing
+    voc_log_reset(&log);
+    n = append_all(&log, inputs, 100);
+    size_t bytes = voc_log_bytes_used(&log);
+    esp_err_t ret = voc_log_append(&log, inputs[99].timestamp_ms - 1, 1, 20.0f, 40.0f, "rewind");
+    expect("earlier timestamp refused with ESP_ERR_INVALID_ARG",
+           ret == ESP_ERR_INVALID_ARG && voc_log_bytes_used(&log) == bytes && matches(&log, inputs, n), "");
+    inputs[100] = inputs[99];
+    expect("repeated timestamp accepted", append_all(&log, inputs + 100, 1) == 1 && matches(&log, inputs, 101), "");
+
+    // Buffer full: the refused sample leaves the log decodable as before
+    voc_log_init(&log, buffer, 16 * VOC_LOG_CHUNK_SIZE);
+    generate(inputs, 1000, 100, 5);
+    n = append_all(&log, inputs, 1000);
+    bytes = voc_log_bytes_used(&log);
+    ret = voc_log_append(&log, inputs[n].timestamp_ms, inputs[n].voc, inputs[n].temperature,
+                         inputs[n].humidity, inputs[n].label);
+    snprintf(detail, sizeof(detail), " (%lu samples in 16 chunks)", (unsigned long)n);
+    expect("full buffer refused with ESP_ERR_NO_MEM, log intact",
+           n > 0 && n < 1000 && ret == ESP_ERR_NO_MEM && voc_log_bytes_used(&log) == bytes &&
+           matches(&log, inputs, n), detail);
+
+    // Label dictionary and run table
+    voc_log_init(&log, buffer, sizeof(buffer));
+    char names[VOC_LOG_MAX_LABELS + 1][VOC_LOG_LABEL_LEN];
+    for (int i = 0; i <= VOC_LOG_MAX_LABELS; i++) {
+        snprintf(names[i], sizeof(names[i]), "label%d", i);
+        inputs[i] = (input_t){ 1000 + i, 100, 20.0f, 40.0f, names[i] };
+    }
+    n = append_all(&log, inputs, VOC_LOG_MAX_LABELS + 1);
+    expect("label past the dictionary refused", n == VOC_LOG_MAX_LABELS && matches(&log, inputs, n), "");
+
+    voc_log_reset(&log);
+    for (int i = 0; i <= VOC_LOG_MAX_RUNS; i++) {
+        inputs[i] = (input_t){ 1000 + i, 100, 20.0f, 40.0f, names[i % 2] };
+    }
+    n = append_all(&log, inputs, VOC_LOG_MAX_RUNS + 1);
+    expect("run past the run table refused", n == VOC_LOG_MAX_RUNS && matches(&log, inputs, n), "");
+    inputs[n] = inputs[n - 1];
+    inputs[n].timestamp_ms++;
+    expect("same label still accepted with the run table full",
+           append_all(&log, inputs + n, 1) == 1 && matches(&log, inputs, n + 1), "");
+
+    voc_log_reset(&log);
+    expect("reset empties the log", voc_log_count(&log) == 0 && voc_log_bytes_used(&log) == 0 &&
+           append_all(&log, inputs, 1) == 1 && matches(&log, inputs, 1), "");
+}
+
+// Runs the sampling timer on the simulated clock for the given number of ticks
+static void run_ticks(uint32_t ticks)
+{
+    for (uint32_t i = 0; i < ticks; i++) {
+        int64_t delay = sensor_manager_host_next_tick_us() - esp_timer_get_time();
+        if (delay > 0) {
+            esp_timer_host_advance(delay);
+        }
+        sensor_manager_host_tick(false);
+        sensor_manager_service();
+    }
+}
+
+static uint32_t count_lines(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    uint32_t lines = 0;
+    int c;
+    while (f && (c = fgetc(f)) != EOF) {
+        lines += c == '\n';
+    }
+    if (f) {
+        fclose(f);
+    }
+    return lines;
+}
+
+// Lines of an export with the given label
+static uint32_t count_label(const char *path, const char *label)
+{
+    FILE *f = fopen(path, "r");
+    char line[128];
+    size_t n = strlen(label);
+    uint32_t lines = 0;
+    while (f && fgets(line, sizeof(line), f)) {
+        size_t len = strcspn(line, "\n");
+        lines += len > n && line[len - n - 1] == ',' && strncmp(line + len - n, label, n) == 0;
+    }
+    if (f) {
+        fclose(f);
+    }
+    return lines;
+}
+
+// Environmental samples published since the last call
+static uint32_t published_env(void)
+{
+    sensor_sample_t samples[16];
+    size_t count;
+    uint32_t env = 0;
+    while ((count = sensor_manager_read_samples(SENSOR_CONSUMER_QUEST, samples, 16)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            env += (samples[i].sources & SENSOR_SOURCE_ENV) != 0;
+        }
+    }
+    return env;
+}
+
+// Two sessions started and stopped with no service call in between, so the
+// second starts before the first is copied: both arrive whole, each with
+// its own label
+static void check_unserviced_sessions(const char *path)
+{
+    static const char *const labels[] = { "first", "second" };
+    uint32_t published[2];
+    char detail[128];
+
+    published_env();
+    for (int s = 0; s < 2; s++) {
+        sensor_manager_start_voc_logging(labels[s]);
+        for (int i = 0; i < 10; i++) {
+            int64_t delay = sensor_manager_host_next_tick_us() - esp_timer_get_time();
+            if (delay > 0) {
+                esp_timer_host_advance(delay);
+            }
+            sensor_manager_host_tick(false);
+        }
+        sensor_manager_stop_voc_logging();
+        published[s] = published_env();
+    }
+    bool refused = sensor_manager_export_voc_data(path) == ESP_ERR_INVALID_STATE;
+    sensor_manager_service();
+    bool exported = sensor_manager_export_voc_data(path) == ESP_OK;
+    uint32_t logged[2] = { count_label(path, labels[0]), count_label(path, labels[1]) };
+    snprintf(detail, sizeof(detail), " (%lu+%lu published, %lu+%lu logged)", (unsigned long)published[0],
+             (unsigned long)published[1], (unsigned long)logged[0], (unsigned long)logged[1]);
+    expect("sessions stopped before the service ran logged whole",
+           refused && exported && published[0] > 0 && published[1] > 0 && logged[0] == published[0] &&
+           logged[1] == published[1], detail);
+}
+
+// The drops sensor_manager counts for the logger
+static void check_pipeline(void)
+{
+    sensor_voc_log_stats_t stats;
+    char detail[128];
+    char path[] = "/tmp/voc_log_tool_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0 || nvs_flash_init() != ESP_OK || sensor_manager_init() != ESP_OK) {
+        expect("sensor manager", false, " failed to start");
+        return;
+    }
+    close(fd);
+    sensor_manager_host_take_timer();
+
+    // Live samples, then a replay whose recording is from later on, then live again
+    sensor_manager_start_voc_logging("live");
+    run_ticks(50);
+    sensor_manager_get_voc_log_stats(&stats);
+    uint32_t live = stats.samples;
+
+    sensor_manager_begin_replay();
+    sensor_data_t env = { .temperature = 21.0f, .humidity = 45.0f, .pressure = 1013.0f, .voc = 150 };
+    int64_t replay_us = esp_timer_get_time() + 3600LL * 1000000;
+    for (int i = 0; i < 20; i++) {
+        sensor_manager_replay_tick(replay_us + i * 100000LL, &env, NULL, NULL, NULL);
+    }
+    sensor_manager_end_replay();
+    run_ticks(50);
+    sensor_manager_stop_voc_logging();
+    sensor_manager_service();
+    sensor_manager_get_voc_log_stats(&stats);
+    snprintf(detail, sizeof(detail), " (%lu live, %lu logged, %lu out of order)", (unsigned long)live,
+             (unsigned long)stats.samples, (unsigned long)stats.dropped_rewind);
+    expect("live samples after a replay counted as out of order",
+           live > 0 && stats.samples == live + 20 && stats.dropped_rewind > 0 && stats.dropped_full == 0 &&
+           stats.dropped_ring == 0, detail);
+
+    uint32_t logged = stats.samples;
+    bool exported = sensor_manager_export_voc_data(path) == ESP_OK;
+    sensor_manager_get_voc_log_stats(&stats);
+    expect("export writes every sample and clears the counts",
+           exported && count_lines(path) == logged + 1 && stats.samples == 0 && stats.dropped_rewind == 0, "");
+
+    check_unserviced_sessions(path);
+
+    // Log at the burst rate until the buffer runs out
+    sensor_manager_start_voc_logging("fill");
+    uint32_t ticks = 0;
+    do {
+        run_ticks(1000);
+        ticks += 1000;
+        sensor_manager_get_voc_log_stats(&stats);
+    } while (stats.dropped_full == 0 && ticks < 100000);
+    uint32_t full = stats.samples;
+    run_ticks(100);
+    sensor_manager_stop_voc_logging();
+    sensor_manager_service();
+    sensor_manager_get_voc_log_stats(&stats);
+    snprintf(detail, sizeof(detail), " (%lu samples, %.2f bytes each, %lu dropped)", (unsigned long)full,
+             (double)stats.bytes / full, (unsigned long)stats.dropped_full);
+    expect("samples past a full log counted",
+           stats.dropped_full >= 100 && stats.samples == full && stats.dropped_rewind == 0, detail);
+    remove(path);
+}
+
+static int check(void)
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+    srand(11);
+    check_codec();
+    check_pipeline();
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
+
+static int bench(uint32_t samples)
+{
+    if (samples == 0 || samples > MAX_SAMPLES) {
+        return 2;
+    }
+    static uint8_t big[MAX_SAMPLES * 24];
+    voc_log_t log;
+
+    // Burst rate while logging, the active rate, and the idle rate
+    static const uint32_t periods[] = { 100, 1000, 10000 };
+    printf("period   bytes/sample  samples in %u B  ns/append  ns/decode\n", LOG_BUFFER_SIZE);
+    for (size_t p = 0; p < sizeof(periods) / sizeof(periods[0]); p++) {
+        srand(3);
+        generate(inputs, samples, periods[p], periods[p] / 20);
+        double best_append = 0.0, best_decode = 0.0;
+        for (int round = 0; round < 5; round++) {
+            voc_log_init(&log, big, sizeof(big));
+            double start = now_s();
+            append_all(&log, inputs, samples);
+            double s = now_s() - start;
+            best_append = round == 0 || s < best_append ? s : best_append;
+
+            voc_log_iter_t iter;
+            voc_log_sample_t sample;
+            uint32_t sink = 0;
+            start = now_s();
+            voc_log_iter_init(&iter, &log);
+            while (voc_log_iter_next(&iter, &sample)) {
+                sink += sample.voc;
+            }
+            s = now_s() - start;
+            best_decode = round == 0 || s < best_decode ? s : best_decode;
+            if (sink == 0) {
+                printf("(empty)\n");
+            }
+        }
+        double per_sample = (double)voc_log_bytes_used(&log) / voc_log_count(&log);
+
+        voc_log_init(&log, buffer, sizeof(buffer));
+        uint32_t fits = append_all(&log, inputs, samples);
+        printf("%5lu ms  %12.2f  %15lu%s  %9.1f  %9.1f\n", (unsigned long)periods[p], per_sample,
+               (unsigned long)fits, fits == samples ? "+" : " ", best_append * 1e9 / samples,
+               best_decode * 1e9 / samples);
+    }
+    printf("(+: all samples fit; a raw sample is %u bytes)\n", (unsigned)sizeof(voc_stream_record_t));
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 2 && strcmp(argv[1], "check") == 0) {
+        return check();
+    }
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+        return bench(argc >= 3 ? (uint32_t)atoi(argv[2]) : 100000);
+    }
+    fprintf(stderr, "usage: %s check\n"
+                    "       %s bench [samples]\n", argv[0], argv[0]);
+    return 2;
+}
@@ -0,0 +1,342 @@
+// Streaming capture (voc_stream.h over block_writer.h) into a temp file:
+// file contents in both formats, drop accounting when the card stalls, and
+// sustained throughput for sessions of hours.
+//
+//   voc_stream_tool check            binary header + records and CSV read back,
+//                                    whole blocks, drops all-or-nothing while
+//                                    the writer is stuck
+//   voc_stream_tool bench [hours]    a session at the 100 ms logging rate,
+//                                    1000x compressed, then flat out: blocks,
+//                                    drops, max_write_us, MB/s
+
+#include "voc_stream.h"
+#include "esp_log.h"
+#include "tool_common.h"
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOGGING_PERIOD_MS   100     // Burst rate while streaming
+#define SPEEDUP             1000
+#define CSV_HEADER          "timestamp,voc,temperature,humidity,label\n"
+
+// Sample i of a session: everything derives from i, so a read-back can be checked
+static uint32_t sample_voc(uint32_t i)
+{
+    return 100 + (i * 7919u) % 900;
+}
+
+static float sample_temperature(uint32_t i)
+{
+    return -10.0f + (float)(i % 5000) / 100.0f;
+}
+
+static float sample_humidity(uint32_t i)
+{
+    return (float)(i % 10000) / 100.0f;
+}
+
+static esp_err_t push(uint32_t i)
+{
+    return voc_stream_push(i * LOGGING_PERIOD_MS, sample_voc(i), sample_temperature(i), sample_humidity(i));
+}
+
+// Pushes sample i, waiting for the writer whenever both blocks are still
+// with it; returns ESP_OK or the first other error. Refused attempts count
+// as drops in the stats.
+static esp_err_t push_waiting(uint32_t i, uint32_t *refused)
+{
+    esp_err_t ret;
+    while ((ret = push(i)) == ESP_ERR_NO_MEM) {
+        (*refused)++;
+        usleep(1000);
+    }
+    return ret;
+}
+
+static long file_size(const char *path)
+{
+    struct stat st;
+    return stat(path, &st) == 0 ? (long)st.st_size : -1;
+}
+
+static uint32_t blocks_for(long bytes)
+{
+    return (uint32_t)((bytes + VOC_STREAM_BLOCK_SIZE - 1) / VOC_STREAM_BLOCK_SIZE);
+}
+
+// Checks a binary record against sample index; out of range indices never match
+static bool record_is(const voc_stream_record_t *record, uint32_t i)
+{
+    return record->timestamp_ms == i * LOGGING_PERIOD_MS && record->voc == sample_voc(i) &&
+           record->temperature == (int16_t)lroundf(sample_temperature(i) * 100.0f) &&
+           record->humidity == (uint16_t)lroundf(sample_humidity(i) * 100.0f) && record->reserved == 0;
+}
+
+static void check_binary(const char *path, uint32_t n)
+{
+    char detail[128];
+    bool pushed = voc_stream_start(path, VOC_STREAM_FORMAT_BINARY, "binary-check") == ESP_OK;
+    uint32_t refused = 0;
+    for (uint32_t i = 0; pushed && i < n; i++) {
+        pushed = push_waiting(i, &refused) == ESP_OK;
+    }
+    bool stopped = voc_stream_stop() == ESP_OK;
+    voc_stream_stats_t stats;
+    voc_stream_get_stats(&stats);
+
+    FILE *f = fopen(path, "rb");
+    voc_stream_header_t header;
+    bool ok = f && fread(&header, sizeof(header), 1, f) == 1 && header.magic == VOC_STREAM_MAGIC &&
+              header.version == VOC_STREAM_VERSION && header.record_size == sizeof(voc_stream_record_t) &&
+              strcmp(header.label, "binary-check") == 0;
+    expect("binary header", ok, "");
+
+    voc_stream_record_t record;
+    uint32_t count = 0;
+    while (ok && fread(&record, sizeof(record), 1, f) == 1) {
+        ok = record_is(&record, count++);
+    }
+    if (f) {
+        fclose(f);
+    }
+    long size = file_size(path);
+    snprintf(detail, sizeof(detail), " (%lu records, %ld bytes)", (unsigned long)count, size);
+    expect("binary records read back in order", pushed && stopped && ok && count == n &&
+           size == (long)(sizeof(header) + n * sizeof(record)), detail);
+    snprintf(detail, sizeof(detail), " (%lu blocks, %lu dropped, %lu errors, max_write_us %lu)",
+             (unsigned long)stats.blocks_written, (unsigned long)stats.records_dropped,
+             (unsigned long)stats.write_errors, (unsigned long)stats.max_write_us);
+    expect("binary stats", stats.records_written == n && stats.records_dropped == refused && stats.write_errors == 0 &&
+           stats.bytes_written == (uint64_t)size && stats.blocks_written == blocks_for(size), detail);
+}
+
+static void check_csv(const char *path, uint32_t n)
+{
+    char detail[128];
+    bool pushed = voc_stream_start(path, VOC_STREAM_FORMAT_CSV, "csv-check") == ESP_OK;
+    uint32_t refused = 0;
+    for (uint32_t i = 0; pushed && i < n; i++) {
+        pushed = push_waiting(i, &refused) == ESP_OK;
+    }
+    bool stopped = voc_stream_stop() == ESP_OK;
+    voc_stream_stats_t stats;
+    voc_stream_get_stats(&stats);
+
+    FILE *f = fopen(path, "r");
+    char line[128];
+    bool ok = f && fgets(line, sizeof(line), f) && strcmp(line, CSV_HEADER) == 0;
+    expect("csv header", ok, "");
+
+    uint32_t count = 0;
+    while (ok && fgets(line, sizeof(line), f)) {
+        unsigned long timestamp, voc;
+        float temperature, humidity;
+        char label[VOC_STREAM_LABEL_LEN];
+        uint32_t i = count++;
+        ok = sscanf(line, "%lu,%lu,%f,%f,%31s", &timestamp, &voc, &temperature, &humidity, label) == 5 &&
+             timestamp == i * LOGGING_PERIOD_MS && voc == sample_voc(i) &&
+             fabsf(temperature - sample_temperature(i)) < 0.006f && fabsf(humidity - sample_humidity(i)) < 0.006f &&
+             strcmp(label, "csv-check") == 0;
+    }
+    if (f) {
+        fclose(f);
+    }
+    long size = file_size(path);
+    snprintf(detail, sizeof(detail), " (%lu lines, %ld bytes)", (unsigned long)count, size);
+    expect("csv lines read back in order, across block boundaries", pushed && stopped && ok && count == n, detail);
+    snprintf(detail, sizeof(detail), " (%lu blocks, %lu dropped, %lu errors)", (unsigned long)stats.blocks_written,
+             (unsigned long)stats.records_dropped, (unsigned long)stats.write_errors);
+    expect("csv stats", stats.records_written == n && stats.records_dropped == refused && stats.write_errors == 0 &&
+           stats.bytes_written == (uint64_t)size && stats.blocks_written == blocks_for(size), detail);
+}
+
+// Reads a pipe to the end; the stream behind it is one binary header and records
+typedef struct {
+    int fd;
+    uint32_t records;
+    bool in_order;
+} pipe_reader_t;
+
+static void *read_pipe(void *arg)
+{
+    pipe_reader_t *reader = arg;
+    static uint8_t data[VOC_STREAM_BLOCK_SIZE * 64];
+    size_t len = 0;
+    ssize_t n;
+    // The stall test writes a few hundred kilobytes at most
+    while ((n = read(reader->fd, data + len, sizeof(data) - len)) > 0) {
+        len += (size_t)n;
+    }
+    reader->in_order = len >= sizeof(voc_stream_header_t) &&
+                       (len - sizeof(voc_stream_header_t)) % sizeof(voc_stream_record_t) == 0;
+    reader->records = 0;
+    int64_t last = -1;
+    for (size_t pos = sizeof(voc_stream_header_t); reader->in_order && pos < len; pos += sizeof(voc_stream_record_t)) {
+        voc_stream_record_t record;
+        memcpy(&record, data + pos, sizeof(record));
+        uint32_t i = record.timestamp_ms / LOGGING_PERIOD_MS;
+        reader->in_order = (int64_t)i > last && record_is(&record, i);
+        last = i;
+        reader->records++;
+    }
+    return NULL;
+}
+
+// A card that stops taking writes: the stream goes to a FIFO nobody reads until
+// both blocks are full. Pushes must keep returning at once, drop whole
+// records, and every record accepted must still reach the file in order.
+static void check_stall(const char *dir)
+{
+    char path[256];
+    char detail[160];
+    snprintf(path, sizeof(path), "%s/stall.fifo", dir);
+    if (mkfifo(path, 0600) != 0) {
+        expect("stalled writer", false, " (mkfifo failed)");
+        return;
+    }
+    pipe_reader_t reader = { .fd = open(path, O_RDONLY | O_NONBLOCK) };
+    bool started = reader.fd >= 0 && voc_stream_start(path, VOC_STREAM_FORMAT_BINARY, "stall") == ESP_OK;
+    if (started) {
+        // Reads block from here on, but the test only starts reading later
+        fcntl(reader.fd, F_SETFL, 0);
+    }
+
+    // The pipe buffers 64 KiB and both RAM blocks another 32 KiB
+    uint32_t pushed = 0, dropped = 0;
+    while (started && pushed < 20000) {
+        esp_err_t ret = push(pushed++);
+        dropped += ret == ESP_ERR_NO_MEM;
+    }
+    pthread_t thread;
+    pthread_create(&thread, NULL, read_pipe, &reader);
+    bool stopped = started && voc_stream_stop() == ESP_OK;
+    pthread_join(thread, NULL);
+    close(reader.fd);
+    remove(path);
+
+    voc_stream_stats_t stats;
+    voc_stream_get_stats(&stats);
+    snprintf(detail, sizeof(detail), " (%lu pushed, %lu dropped, %lu read back)", (unsigned long)pushed,
+             (unsigned long)stats.records_dropped, (unsigned long)reader.records);
+    expect("stalled writer drops whole records, keeps the rest in order",
+           stopped && dropped > 0 && stats.records_dropped == dropped &&
+           stats.records_written + stats.records_dropped == pushed && reader.in_order &&
+           reader.records == stats.records_written, detail);
+    // fsync fails on a pipe, so every block counts as a write error
+    snprintf(detail, sizeof(detail), " (%lu errors)", (unsigned long)stats.write_errors);
+    expect("failed block writes counted", stats.write_errors > 0 && stats.blocks_written == 0, detail);
+}
+
+static int check(void)
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+    char dir[] = "/tmp/voc_stream_tool_XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    char path[256];
+    snprintf(path, sizeof(path), "%s/stream.bin", dir);
+
+    expect("push before start refused", push(0) == ESP_ERR_INVALID_STATE && !voc_stream_is_active(), "");
+    expect("stop before start refused", voc_stream_stop() == ESP_ERR_INVALID_STATE, "");
+    // Header plus records fill exactly three blocks, then a partial one
+    check_binary(path, 3 * (VOC_STREAM_BLOCK_SIZE / sizeof(voc_stream_record_t)) + 100);
+    expect("restart truncates", voc_stream_start(path, VOC_STREAM_FORMAT_BINARY, "empty") == ESP_OK &&
+           voc_stream_start(path, VOC_STREAM_FORMAT_CSV, "again") == ESP_ERR_INVALID_STATE &&
+           voc_stream_stop() == ESP_OK && file_size(path) == (long)sizeof(voc_stream_header_t), "");
+    remove(path);
+
+    snprintf(path, sizeof(path), "%s/stream.csv", dir);
+    check_csv(path, 5000);
+    remove(path);
+
+    check_stall(dir);
+    rmdir(dir);
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// One session: period_ns 0 pushes flat out
+static void run_session(const char *path, voc_stream_format_t format, uint32_t records, int64_t period_ns)
+{
+    int64_t max_push_ns = 0;
+    int64_t start = now_ns();
+    voc_stream_start(path, format, "bench");
+    for (uint32_t i = 0; i < records; i++) {
+        if (period_ns) {
+            int64_t due = start + (int64_t)i * period_ns;
+            struct timespec ts = { .tv_sec = due / 1000000000, .tv_nsec = due % 1000000000 };
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        }
+        int64_t t = now_ns();
+        push(i);
+        t = now_ns() - t;
+        max_push_ns = t > max_push_ns ? t : max_push_ns;
+    }
+    voc_stream_stop();
+    double seconds = (now_ns() - start) / 1e9;
+
+    voc_stream_stats_t stats;
+    voc_stream_get_stats(&stats);
+    printf("%-6s %-9s %9lu %8lu %7lu %8.1f %8.1f %11lu %9.1f\n",
+           format == VOC_STREAM_FORMAT_CSV ? "csv" : "binary", period_ns ? "logging" : "flat out",
+           (unsigned long)records, (unsigned long)stats.records_dropped, (unsigned long)stats.blocks_written,
+           stats.bytes_written / 1e6, stats.bytes_written / 1e6 / seconds, (unsigned long)stats.max_write_us,
+           max_push_ns / 1e3);
+    remove(path);
+}
+
+static int bench(double hours)
+{
+    if (hours <= 0.0) {
+        return 2;
+    }
+    esp_log_level_set("*", ESP_LOG_NONE);
+    char path[] = "/tmp/voc_stream_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+
+    uint32_t records = (uint32_t)(hours * 3600 * 1000 / LOGGING_PERIOD_MS);
+    int64_t period_ns = (int64_t)LOGGING_PERIOD_MS * 1000000 / SPEEDUP;
+    printf("%.1f h at %d ms, replayed %dx faster; flat out pushes without pacing\n", hours, LOGGING_PERIOD_MS,
+           SPEEDUP);
+    printf("format pace        records  dropped  blocks       MB     MB/s max_write_us max_push_us\n");
+    run_session(path, VOC_STREAM_FORMAT_BINARY, records, period_ns);
+    run_session(path, VOC_STREAM_FORMAT_CSV, records, period_ns);
+    run_session(path, VOC_STREAM_FORMAT_BINARY, records, 0);
+    run_session(path, VOC_STREAM_FORMAT_CSV, records, 0);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 2 && strcmp(argv[1], "check") == 0) {
+        return check();
+    }
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+        return bench(argc >= 3 ? atof(argv[2]) : 1.0);
+    }
+    fprintf(stderr, "usage: %s check\n"
+                    "       %s bench [hours]\n", argv[0], argv[0]);
+    return 2;
+}
@@ -39,8 +39,7 @@ void app_main(void)
     ESP_LOGI(TAG, "Starting main game loop...");
 
     while (1) {
-        // Main game loop
-        quest_system_update();
-        vTaskDelay(pdMS_TO_TICKS(100));
+        // Main game loop: sleeps until a sensor trigger for an active quest fires
+        quest_system_wait_and_update(SENSOR_WAIT_FOREVER);
     }
 }
\ No newline at end of file
@@ -0,0 +1,232 @@
+#!/usr/bin/env python3
+"""
+Decision-forest converter for the badge's tree evaluator (ml_forest.h)
+Flattens a trained forest into the breadth-first blob ml_model_update loads as MODEL_VOC_FOREST.
+Pure Python; scikit-learn is only needed for --sklearn.
+"""
+
+import argparse
+import json
+import math
+import random
+import struct
+import sys
+
+ML_FOREST_MAGIC = 0x31535246  # "FRS1"
+ML_FOREST_VERSION = 1
+ML_FOREST_MAX_CLASSES = 8
+ML_FOREST_MAX_DEPTH = 32
+ML_FOREST_NAME_LEN = 16
+VECTORS_MAGIC = 0x31564651  # "QFV1"
+
+HEADER_FORMAT = '<IHHHBBII%ds' % ML_FOREST_NAME_LEN
+
+
+def float32_floor(v):
+    """Largest float32 <= v, so x <= v and x <= float32_floor(v) agree for float32 x"""
+    v = max(-3.4e38, min(3.4e38, v))
+    f = struct.unpack('<f', struct.pack('<f', v))[0]
+    if f > v:
+        bits = struct.unpack('<I', struct.pack('<f', f))[0]
+        if f == 0.0:
+            bits = 0x80000001
+        elif f > 0.0:
+            bits -= 1
+        else:
+            bits += 1
+        f = struct.unpack('<f', struct.pack('<I', bits))[0]
+    return f
+
+
+def float32(v):
+    return struct.unpack('<f', struct.pack('<f', v))[0]
+
+
+def quantize_leaf(value):
+    """Class distribution -> uint8 scores, ~probability * 255"""
+    total = sum(value)
+    if total <= 0:
+        return tuple([0] * len(value))
+    return tuple(int(round(255.0 * v / total)) for v in value)
+
+
+def flatten(spec):
+    """Breadth-first node arrays of every tree; siblings end up adjacent"""
+    leaves = {}
+    nodes = []  # (feature, threshold, child, value)
+    roots = []
+    depth = 0
+    for tree in spec['trees']:
+        source = tree['nodes']
+        root = len(nodes)
+        roots.append(root)
+        order = [(0, 0)]
+        position = {0: 0}
+        i = 0
+        while i < len(order):
+            index, level = order[i]
+            node = source[index]
+            if 'value' not in node:
+                for side in ('left', 'right'):
+                    position[node[side]] = len(order)
+                    order.append((node[side], level + 1))
+            depth = max(depth, level)
+            i += 1
+
+        for index, level in order:
+            node = source[index]
+            if 'value' in node:
+                payload = quantize_leaf(node['value'])
+                value = leaves.setdefault(payload, len(leaves))
+                nodes.append((0, math.inf, 0, value))
+            else:
+                child = position[node['left']] - position[index]
+                if child > 0xFFFF:
+                    raise ValueError('tree too wide for 16-bit child offsets')
+                nodes.append((node['feature'], float32_floor(node['threshold']), child, 0))
+        if len(nodes) - root > 0xFFFF:
+            raise ValueError('tree has more than 65535 nodes')
+
+    if depth > ML_FOREST_MAX_DEPTH:
+        raise ValueError('depth %d exceeds %d' % (depth, ML_FOREST_MAX_DEPTH))
+    leaf_table = sorted(leaves, key=leaves.get)
+    return roots, nodes, leaf_table, depth
+
+
+def pad4(data):
+    return data + b'\0' * (-len(data) % 4)
+
+
+def pack(spec, roots, nodes, leaf_table, depth):
+    classes = spec['class_count']
+    if not 2 <= classes <= ML_FOREST_MAX_CLASSES:
+        raise ValueError('2..%d classes supported' % ML_FOREST_MAX_CLASSES)
+    name = spec.get('name', 'unnamed').encode()[:ML_FOREST_NAME_LEN - 1]
+    header = struct.pack(HEADER_FORMAT, ML_FOREST_MAGIC, ML_FOREST_VERSION, len(roots), spec['feature_count'],
+                         classes, depth, len(nodes), len(leaf_table), name)
+    n = len(nodes)
+    return (header +
+            struct.pack('<%dI' % len(roots), *roots) +
+            struct.pack('<%df' % n, *[node[1] for node in nodes]) +
+            pad4(struct.pack('<%dH' % n, *[node[2] for node in nodes])) +
+            pad4(struct.pack('<%dH' % n, *[node[3] for node in nodes])) +
+            pad4(bytes(node[0] for node in nodes)) +
+            b''.join(bytes(leaf) for leaf in leaf_table))
+
+
+def reference_predict(roots, nodes, leaf_table, classes, x):
+    """Scores as ml_forest_predict computes them"""
+    scores = [0] * classes
+    for root in roots:
+        i = root
+        while nodes[i][2] != 0:
+            feature, threshold, child, _ = nodes[i]
+            i += child + (1 if x[feature] > threshold else 0)
+        for c, v in enumerate(leaf_table[nodes[i][3]]):
+            scores[c] += v
+    return scores
+
+
+def spec_from_sklearn(path, name):
+    import joblib  # Only needed for this path
+    model = joblib.load(path)
+    estimators = getattr(model, 'estimators_', [model])
+    trees = []
+    for estimator in estimators:
+        tree = estimator.tree_
+        nodes = []
+        for i in range(tree.node_count):
+            left, right = int(tree.children_left[i]), int(tree.children_right[i])
+            if left == right:  # -1 for both at a leaf
+                nodes.append({'value': [float(v) for v in tree.value[i][0]]})
+            else:
+                # scikit-learn goes left when x <= threshold
+                nodes.append({'feature': int(tree.feature[i]), 'threshold': float(tree.threshold[i]),
+                              'left': left, 'right': right})
+        trees.append({'nodes': nodes})
+    return {'name': name, 'feature_count': int(model.n_features_in_), 'class_count': len(model.classes_),
+            'trees': trees}
+
+
+# [VOC, temperature, humidity] ranges the example splits on
+EXAMPLE_RANGES = [(50.0, 1000.0), (15.0, 35.0), (20.0, 80.0)]
+
+
+def example_spec(trees, depth, seed):
+    """Random forest with the shape of the planned VOC classifier"""
+    rng = random.Random(seed)
+
+    def grow(nodes, level, bounds):
+        index = len(nodes)
+        if level == depth or (level >= 2 and rng.random() < 0.25):
+            nodes.append({'value': [rng.random() ** 3 for _ in range(4)]})
+            return index
+        feature = 0 if rng.random() < 0.5 else rng.randrange(3)
+        low, high = bounds[feature]
+        threshold = rng.uniform(low, high)
+        nodes.append({'feature': feature, 'threshold': threshold})
+        left_bounds = list(bounds)
+        left_bounds[feature] = (low, threshold)
+        right_bounds = list(bounds)
+        right_bounds[feature] = (threshold, high)
+        nodes[index]['left'] = grow(nodes, level + 1, left_bounds)
+        nodes[index]['right'] = grow(nodes, level + 1, right_bounds)
+        return index
+
+    forest = []
+    for _ in range(trees):
+        nodes = []
+        grow(nodes, 0, EXAMPLE_RANGES)
+        forest.append({'nodes': nodes})
+    return {'name': 'example-forest', 'feature_count': 3, 'class_count': 4, 'trees': forest}
+
+
+def random_inputs(feature_count, count, rng):
+    ranges = EXAMPLE_RANGES if feature_count == len(EXAMPLE_RANGES) else [(0.0, 1.0)] * feature_count
+    return [[float32(rng.uniform(low, high)) for low, high in ranges] for _ in range(count)]
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Flatten a decision forest for ml_forest')
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument('--spec', help='JSON forest spec (see docs/ML_TRAINING_GUIDE.md)')
+    source.add_argument('--sklearn', help='joblib file of a scikit-learn tree or forest classifier')
+    source.add_argument('--example', action='store_true', help='Random example forest')
+    parser.add_argument('--name', default='sklearn-forest', help='Model version string (--sklearn)')
+    parser.add_argument('--trees', type=int, default=32, help='Trees in the example forest')
+    parser.add_argument('--depth', type=int, default=8, help='Depth of the example trees')
+    parser.add_argument('--vectors', help='Also write reference input/score vectors here')
+    parser.add_argument('--count', type=int, default=1000, help='Reference vectors to write')
+    parser.add_argument('--seed', type=int, default=2025)
+    parser.add_argument('output', help='Forest blob to write')
+    args = parser.parse_args()
+
+    if args.spec:
+        with open(args.spec) as f:
+            spec = json.load(f)
+    elif args.sklearn:
+        spec = spec_from_sklearn(args.sklearn, args.name)
+    else:
+        spec = example_spec(args.trees, args.depth, args.seed)
+
+    roots, nodes, leaf_table, depth = flatten(spec)
+    blob = pack(spec, roots, nodes, leaf_table, depth)
+    with open(args.output, 'wb') as f:
+        f.write(blob)
+    print('%s: %d bytes, %d trees, %d nodes, %d distinct leaves, depth %d' %
+          (args.output, len(blob), len(roots), len(nodes), len(leaf_table), depth))
+
+    if args.vectors:
+        rng = random.Random(args.seed + 1)
+        features, classes = spec['feature_count'], spec['class_count']
+        with open(args.vectors, 'wb') as f:
+            f.write(struct.pack('<IIHH', VECTORS_MAGIC, args.count, features, classes))
+            for x in random_inputs(features, args.count, rng):
+                scores = reference_predict(roots, nodes, leaf_table, classes, x)
+                f.write(struct.pack('<%df' % features, *x) + struct.pack('<%dI' % classes, *scores))
+        print('%s: %d reference vectors' % (args.vectors, args.count))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+"""
+Model image builder for the badge's "storage" partition (ml_model_image.h)
+Packs model blobs from ml_quantize.py so ml_model_load() can run them in place from flash.
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+ML_MODEL_IMAGE_MAGIC = 0x314C444D  # "MDL1"
+ML_MODEL_IMAGE_VERSION = 1
+ML_MODEL_IMAGE_MAX_ENTRIES = 4
+PARTITION_SIZE = 0x100000  # partitions.csv
+ENTRY_FORMAT = '<B3xIII'
+HEADER_FORMAT = '<IHHII'
+BLOB_ALIGN = 64
+
+# ml_model_type_t
+MODEL_TYPES = {'voc_classifier': 0, 'voc_forest': 1}
+
+
+def build_image(models):
+    header_size = struct.calcsize(HEADER_FORMAT) + ML_MODEL_IMAGE_MAX_ENTRIES * struct.calcsize(ENTRY_FORMAT)
+    entries = b''
+    data = b''
+    offset = header_size
+    for model_type, blob in models:
+        offset += -offset % BLOB_ALIGN
+        data += b'\xff' * (offset - header_size - len(data))
+        entries += struct.pack(ENTRY_FORMAT, model_type, offset, len(blob), zlib.crc32(blob))
+        data += blob
+        offset += len(blob)
+    entries += b'\0' * (ML_MODEL_IMAGE_MAX_ENTRIES * struct.calcsize(ENTRY_FORMAT) - len(entries))
+    header = struct.pack(HEADER_FORMAT, ML_MODEL_IMAGE_MAGIC, ML_MODEL_IMAGE_VERSION, len(models),
+                         zlib.crc32(entries), 0)
+    return header + entries + data
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Build a model image for the storage partition')
+    parser.add_argument('-o', '--output', required=True, help='Image file to write')
+    parser.add_argument('models', nargs='+', metavar='TYPE=BLOB',
+                        help='Model type (%s) and blob file' % ', '.join(MODEL_TYPES))
+    args = parser.parse_args()
+
+    if len(args.models) > ML_MODEL_IMAGE_MAX_ENTRIES:
+        parser.error('at most %d models' % ML_MODEL_IMAGE_MAX_ENTRIES)
+    models = []
+    for arg in args.models:
+        name, _, path = arg.partition('=')
+        if name not in MODEL_TYPES or not path:
+            parser.error('expected TYPE=BLOB with TYPE one of %s' % ', '.join(MODEL_TYPES))
+        with open(path, 'rb') as f:
+            models.append((MODEL_TYPES[name], f.read()))
+
+    image = build_image(models)
+    if len(image) > PARTITION_SIZE:
+        parser.error('image is %d bytes, the partition holds %d' % (len(image), PARTITION_SIZE))
+    with open(args.output, 'wb') as f:
+        f.write(image)
+    print('%s: %d bytes, %d models' % (args.output, len(image), len(models)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
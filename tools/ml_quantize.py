@@ -0,0 +1,311 @@
+#!/usr/bin/env python3
+"""
+Int8 model converter for the badge's inference engine (ml_net.h)
+Quantizes a small MLP / 1-D conv model and writes the blob ml_model_update loads.
+Pure Python so the integer reference runs anywhere; TensorFlow is only needed for --keras.
+"""
+
+import argparse
+import json
+import math
+import random
+import struct
+import sys
+
+ML_NET_MAGIC = 0x314E4D51  # "QMN1"
+ML_NET_VERSION = 1
+ML_NET_MAX_LAYERS = 8
+ML_NET_MAX_CHANNELS = 8
+ML_NET_NAME_LEN = 16
+VECTORS_MAGIC = 0x31564D51  # "QMV1"
+
+HEADER_FORMAT = '<IHBBHHf%df%df%ds' % (ML_NET_MAX_CHANNELS, ML_NET_MAX_CHANNELS, ML_NET_NAME_LEN)
+LAYER_FORMAT = '<BBHHHHHiifII'
+LAYER_TYPES = {'dense': 1, 'conv1d': 2}
+ACTIVATIONS = {'none': 0, 'linear': 0, 'relu': 1}
+
+
+def layer_output_length(layer, length):
+    if layer['type'] == 'dense':
+        return 1
+    return (length - layer['kernel']) // layer.get('stride', 1) + 1
+
+
+def float_forward(spec, x):
+    """Float reference of the normalised model, returns every layer's output"""
+    channels = spec['input_channels']
+    act = [(v - spec['input_mean'][i % channels]) / spec['input_std'][i % channels] for i, v in enumerate(x)]
+    outputs = [act]
+    length = spec['input_length']
+    for layer in spec['layers']:
+        out_length = layer_output_length(layer, length)
+        stride = layer.get('stride', 1)
+        out = []
+        for t in range(out_length):
+            if layer['type'] == 'dense':
+                window = act
+                rows = layer['weights']
+            else:
+                start = t * stride * channels
+                window = act[start:start + layer['kernel'] * channels]
+                rows = [[w for tap in row for w in tap] for row in layer['weights']]
+            for o, row in enumerate(rows):
+                v = layer['bias'][o] + sum(w * a for w, a in zip(row, window))
+                out.append(max(v, 0.0) if layer.get('activation', 'none') == 'relu' else v)
+        act = out
+        outputs.append(act)
+        length = out_length
+        channels = len(layer['bias'])
+    return outputs
+
+
+def quantize_multiplier(real):
+    """real ~= multiplier * 2^-(31 + shift) with multiplier in [2^30, 2^31)"""
+    mantissa, exponent = math.frexp(real)
+    multiplier = int(round(mantissa * (1 << 31)))
+    if multiplier == (1 << 31):
+        multiplier //= 2
+        exponent += 1
+    shift = -exponent
+    if not -30 <= shift <= 31:
+        raise ValueError('layer scale ratio %g out of range' % real)
+    return multiplier, shift
+
+
+def tensor_scale(values):
+    peak = max((abs(v) for v in values), default=0.0)
+    return max(peak, 1e-6) / 127.0
+
+
+def quantize(spec, calibration):
+    """Returns (header fields, quantized layers) with per-tensor symmetric scales"""
+    if not 1 <= len(spec['layers']) <= ML_NET_MAX_LAYERS:
+        raise ValueError('1..%d layers supported' % ML_NET_MAX_LAYERS)
+    if spec['input_channels'] > ML_NET_MAX_CHANNELS:
+        raise ValueError('at most %d input channels' % ML_NET_MAX_CHANNELS)
+
+    traces = [float_forward(spec, x) for x in calibration]
+    scales = [tensor_scale([v for trace in traces for v in trace[i]]) for i in range(len(spec['layers']) + 1)]
+
+    layers = []
+    length = spec['input_length']
+    channels = spec['input_channels']
+    for i, layer in enumerate(spec['layers']):
+        if layer['type'] == 'dense':
+            rows = layer['weights']
+            kernel, stride, in_channels = 1, 1, length * channels
+        else:
+            rows = [[w for tap in row for w in tap] for row in layer['weights']]
+            kernel, stride, in_channels = layer['kernel'], layer.get('stride', 1), channels
+        flat = [w for row in rows for w in row]
+        w_scale = tensor_scale(flat)
+        acc_scale = scales[i] * w_scale
+        multiplier, shift = quantize_multiplier(acc_scale / scales[i + 1])
+        layers.append({
+            'type': LAYER_TYPES[layer['type']],
+            'activation': ACTIVATIONS[layer.get('activation', 'none')],
+            'kernel': kernel,
+            'stride': stride,
+            'in_channels': in_channels,
+            'out_channels': len(rows),
+            'multiplier': multiplier,
+            'shift': shift,
+            'out_scale': scales[i + 1],
+            'weights': [max(-127, min(127, int(round(w / w_scale)))) for w in flat],
+            'bias': [int(round(b / acc_scale)) for b in layer['bias']],
+        })
+        length = layer_output_length(layer, length)
+        channels = len(rows)
+    return scales[0], layers
+
+
+def requantize(acc, multiplier, shift, low):
+    total = 31 + shift
+    v = (acc * multiplier + (1 << (total - 1))) >> total
+    return max(low, min(127, v))
+
+
+def reference_run(spec, layers, xq):
+    """Integer reference, bit-exact with ml_net_run_quantized"""
+    act = list(xq)
+    length = spec['input_length']
+    for layer in layers:
+        taps = layer['kernel'] * layer['in_channels']
+        if layer['type'] == LAYER_TYPES['dense']:
+            out_length, step = 1, 0
+        else:
+            out_length = (length - layer['kernel']) // layer['stride'] + 1
+            step = layer['stride'] * layer['in_channels']
+        low = 0 if layer['activation'] == ACTIVATIONS['relu'] else -128
+        w = layer['weights']
+        out = []
+        for t in range(out_length):
+            window = act[t * step:t * step + taps]
+            for o in range(layer['out_channels']):
+                row = w[o * taps:(o + 1) * taps]
+                acc = layer['bias'][o] + sum(a * b for a, b in zip(row, window))
+                out.append(requantize(acc, layer['multiplier'], layer['shift'], low))
+        act = out
+        length = out_length
+    return act
+
+
+def pack(spec, input_scale, layers):
+    channels = spec['input_channels']
+    pad = ML_NET_MAX_CHANNELS - channels
+    mean = list(spec['input_mean']) + [0.0] * pad
+    inv_std = [1.0 / s for s in spec['input_std']] + [1.0] * pad
+    name = spec.get('name', 'unnamed').encode()[:ML_NET_NAME_LEN - 1]
+    header = struct.pack(HEADER_FORMAT, ML_NET_MAGIC, ML_NET_VERSION, len(layers), 0,
+                         spec['input_length'], channels, input_scale, *mean, *inv_std, name)
+
+    offset = len(header) + len(layers) * struct.calcsize(LAYER_FORMAT)
+    descs = b''
+    data = b''
+    for layer in layers:
+        weights = struct.pack('<%db' % len(layer['weights']), *layer['weights'])
+        weights += b'\0' * (-len(weights) % 4)
+        bias = struct.pack('<%di' % len(layer['bias']), *layer['bias'])
+        descs += struct.pack(LAYER_FORMAT, layer['type'], layer['activation'], layer['kernel'],
+                             layer['stride'], layer['in_channels'], layer['out_channels'], 0,
+                             layer['multiplier'], layer['shift'], layer['out_scale'],
+                             offset + len(data), offset + len(data) + len(weights))
+        data += weights + bias
+    return header + descs + data
+
+
+def quantize_input(spec, input_scale, x):
+    channels = spec['input_channels']
+    inv_std = [1.0 / s for s in spec['input_std']]
+    out = []
+    for i, v in enumerate(x):
+        q = (v - spec['input_mean'][i % channels]) * inv_std[i % channels] / input_scale
+        out.append(int(max(-128, min(127, math.floor(q + 0.5) if q >= 0 else math.ceil(q - 0.5)))))
+    return out
+
+
+def example_spec(kind, seed):
+    """Random model with the shape of the planned VOC classifiers"""
+    rng = random.Random(seed)
+
+    def dense(n_in, n_out, activation):
+        return {'type': 'dense', 'activation': activation,
+                'weights': [[rng.gauss(0, 1 / math.sqrt(n_in)) for _ in range(n_in)] for _ in range(n_out)],
+                'bias': [rng.gauss(0, 0.1) for _ in range(n_out)]}
+
+    def conv(n_in, n_out, kernel, stride):
+        return {'type': 'conv1d', 'activation': 'relu', 'kernel': kernel, 'stride': stride,
+                'weights': [[[rng.gauss(0, 1 / math.sqrt(n_in * kernel)) for _ in range(n_in)]
+                             for _ in range(kernel)] for _ in range(n_out)],
+                'bias': [rng.gauss(0, 0.1) for _ in range(n_out)]}
+
+    if kind == 'mlp':
+        # [VOC, temperature, humidity] -> 16 -> 16 -> 4 classes
+        return {'name': 'example-mlp', 'input_length': 1, 'input_channels': 3,
+                'input_mean': [300.0, 22.0, 50.0], 'input_std': [150.0, 5.0, 15.0],
+                'layers': [dense(3, 16, 'relu'), dense(16, 16, 'relu'), dense(16, 4, 'none')]}
+    # 64-sample window of [VOC, temperature, humidity, pressure]
+    return {'name': 'example-conv', 'input_length': 64, 'input_channels': 4,
+            'input_mean': [300.0, 22.0, 50.0, 1013.0], 'input_std': [150.0, 5.0, 15.0, 10.0],
+            'layers': [conv(4, 8, 5, 2), conv(8, 8, 5, 2), dense(13 * 8, 16, 'relu'), dense(16, 4, 'none')]}
+
+
+def spec_from_keras(path, mean, std, name):
+    import tensorflow as tf  # Only needed for this path
+    model = tf.keras.models.load_model(path)
+    shape = model.input_shape
+    length, channels = (1, shape[-1]) if len(shape) == 2 else (shape[1], shape[2])
+    layers = []
+    for layer in model.layers:
+        config = layer.get_config()
+        kind = layer.__class__.__name__
+        if kind in ('Flatten', 'InputLayer', 'Dropout'):
+            continue
+        kernel, bias = (w.tolist() for w in layer.get_weights())
+        activation = config.get('activation', 'linear')
+        if activation == 'softmax':
+            activation = 'linear'  # The badge applies softmax itself
+        if kind == 'Dense':
+            layers.append({'type': 'dense', 'activation': activation,
+                           'weights': [list(col) for col in zip(*kernel)], 'bias': bias})
+        elif kind == 'Conv1D' and config['padding'] == 'valid':
+            # Keras kernel is [kernel][in][out]; ml_net wants [out][kernel][in]
+            layers.append({'type': 'conv1d', 'activation': activation,
+                           'kernel': config['kernel_size'][0], 'stride': config['strides'][0],
+                           'weights': [[[tap[i][o] for i in range(len(tap))] for tap in kernel]
+                                       for o in range(len(bias))],
+                           'bias': bias})
+        else:
+            raise ValueError('unsupported layer %s' % layer.name)
+    return {'name': name, 'input_length': length, 'input_channels': channels,
+            'input_mean': mean or [0.0] * channels, 'input_std': std or [1.0] * channels, 'layers': layers}
+
+
+def random_inputs(spec, count, rng):
+    channels = spec['input_channels']
+    size = spec['input_length'] * channels
+    return [[rng.gauss(spec['input_mean'][i % channels], 1.5 * spec['input_std'][i % channels])
+             for i in range(size)] for _ in range(count)]
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Quantize a model for ml_net (int8)')
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument('--spec', help='JSON model spec (see docs/ML_TRAINING_GUIDE.md)')
+    source.add_argument('--keras', help='Keras model file (Dense/Conv1D layers)')
+    source.add_argument('--example', choices=['mlp', 'conv'], help='Random example model')
+    parser.add_argument('--name', default='keras-model', help='Model version string (--keras)')
+    parser.add_argument('--mean', type=float, nargs='+', help='Input mean per channel (--keras)')
+    parser.add_argument('--std', type=float, nargs='+', help='Input std per channel (--keras)')
+    parser.add_argument('--calibration', help='CSV of raw input rows for activation ranges')
+    parser.add_argument('--vectors', help='Also write reference input/output vectors here')
+    parser.add_argument('--count', type=int, default=1000, help='Reference vectors to write')
+    parser.add_argument('--seed', type=int, default=2025)
+    parser.add_argument('output', help='Model blob to write')
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    if args.spec:
+        with open(args.spec) as f:
+            spec = json.load(f)
+    elif args.keras:
+        spec = spec_from_keras(args.keras, args.mean, args.std, args.name)
+    else:
+        spec = example_spec(args.example, args.seed)
+
+    if args.calibration:
+        with open(args.calibration) as f:
+            calibration = [[float(v) for v in line.split(',')] for line in f if line.strip()]
+    else:
+        calibration = spec.get('calibration') or random_inputs(spec, 256, rng)
+
+    input_scale, layers = quantize(spec, calibration)
+    blob = pack(spec, input_scale, layers)
+    with open(args.output, 'wb') as f:
+        f.write(blob)
+
+    macs = 0
+    length = spec['input_length']
+    for layer, source_layer in zip(layers, spec['layers']):
+        length = layer_output_length(source_layer, length)
+        macs += length * layer['out_channels'] * layer['kernel'] * layer['in_channels']
+    print('%s: %d bytes, %d layers, %d MACs per inference' % (args.output, len(blob), len(layers), macs))
+
+    if args.vectors:
+        inputs = random_inputs(spec, args.count, rng)
+        output_size = None
+        with open(args.vectors, 'wb') as f:
+            records = b''
+            for x in inputs:
+                xq = quantize_input(spec, input_scale, x)
+                yq = reference_run(spec, layers, xq)
+                output_size = len(yq)
+                records += struct.pack('<%db' % len(xq), *xq) + struct.pack('<%db' % len(yq), *yq)
+            f.write(struct.pack('<IIHH', VECTORS_MAGIC, len(inputs), len(inputs[0]), output_size))
+            f.write(records)
+        print('%s: %d reference vectors' % (args.vectors, len(inputs)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
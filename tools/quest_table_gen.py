@@ -0,0 +1,552 @@
+#!/usr/bin/env python3
+"""
+Quest table generator (quest_table.h)
+Compiles quests/quest_map.json into a C file with a const quest table, condition
+bytecode included, so the badge keeps quest definitions in flash and does no
+parsing or copying at startup. Run by the quest_engine build; can also be run by
+hand to check the JSON.
+"""
+
+import argparse
+import json
+import math
+import re
+import struct
+import sys
+
+MAX_QUESTS = 20  # quest_system.h; builds may raise it
+MAX_QUEST_NAME_LEN = 32
+MAX_QUEST_DESC_LEN = 128
+MAX_POINTS = 0xFFFF
+MAX_TARGET = 0xFFFF
+
+QUEST_FLAG_THRESHOLD = 0x01
+QUEST_FLAG_COMBO = 0x02
+
+# JSON trigger -> trigger_type_t, and the range its threshold may take in the
+# units sensor_manager compares (sensor_manager_set_threshold); None for
+# triggers without a threshold. The badge has one threshold per trigger.
+TRIGGERS = {
+    'humidity': ('TRIGGER_RAIN', (0.0, 100.0)),       # %RH
+    'temperature': ('TRIGGER_COLD', (-40.0, 85.0)),   # degC
+    'darkness': ('TRIGGER_DARK', None),
+    'cigarette': ('TRIGGER_SMOKE', (0.0, 10000.0)),   # VOC at VOC_BASELINE_NOMINAL
+    'herbal': ('TRIGGER_HERBAL', (0.0, 10000.0)),
+    'movement': ('TRIGGER_MOVEMENT', (0.0, 16.0)),    # g
+    'tilt': ('TRIGGER_TILT', (0.0, 180.0)),           # degrees
+    'lora': ('TRIGGER_PROXIMITY', None),
+    'manual': ('TRIGGER_MANUAL', None),
+}
+
+
+# Condition bytecode (quest_conditions.h); the generated file asserts that
+# these still match
+COND_MAX_CODE = 64
+COND_MAX_TIMERS = 8
+COND_MAX_DEPTH = 32
+COND_MAX_NAME = 24  # quest_parser.c name buffer, with the terminator
+OP_FALSE, OP_TRUE, OP_CMP, OP_LEVEL, OP_NOT, OP_AND, OP_OR, OP_FOR, OP_THEN = range(9)
+
+# sensor_manager.h SENSOR_EVENT_* bits
+EVENTS = {
+    'SENSOR_EVENT_RAIN': 1 << 0,
+    'SENSOR_EVENT_COLD': 1 << 1,
+    'SENSOR_EVENT_DARK': 1 << 2,
+    'SENSOR_EVENT_CIGARETTE': 1 << 3,
+    'SENSOR_EVENT_HERBAL': 1 << 4,
+    'SENSOR_EVENT_MOVEMENT': 1 << 5,
+    'SENSOR_EVENT_TILT': 1 << 6,
+}
+
+# quest_field_t order, with the sensor behind each field
+COND_FIELDS = [
+    ('temperature', 'SENSOR_EVENT_COLD'),
+    ('humidity', 'SENSOR_EVENT_RAIN'),
+    ('pressure', 'SENSOR_EVENT_RAIN'),
+    ('voc', 'SENSOR_EVENT_CIGARETTE'),
+    ('accel_x', 'SENSOR_EVENT_MOVEMENT'),
+    ('accel_y', 'SENSOR_EVENT_MOVEMENT'),
+    ('accel_z', 'SENSOR_EVENT_MOVEMENT'),
+    ('gyro_x', 'SENSOR_EVENT_MOVEMENT'),
+    ('gyro_y', 'SENSOR_EVENT_MOVEMENT'),
+    ('gyro_z', 'SENSOR_EVENT_MOVEMENT'),
+    ('tilt_angle', 'SENSOR_EVENT_TILT'),
+    ('movement_magnitude', 'SENSOR_EVENT_MOVEMENT'),
+]
+COND_FIELD_NAMES = [name for name, _ in COND_FIELDS]
+
+COND_TRIGGERS = {
+    'rain': 'SENSOR_EVENT_RAIN',
+    'cold': 'SENSOR_EVENT_COLD',
+    'dark': 'SENSOR_EVENT_DARK',
+    'cigarette': 'SENSOR_EVENT_CIGARETTE',
+    'herbal': 'SENSOR_EVENT_HERBAL',
+    'movement': 'SENSOR_EVENT_MOVEMENT',
+    'tilt': 'SENSOR_EVENT_TILT',
+}
+
+# quest_cmp_t values, two-character operators first
+COND_CMPS = [('<=', 1), ('>=', 3), ('==', 4), ('!=', 5), ('<', 0), ('>', 2)]
+
+# What strtof() takes, short of hex floats, infinities and NaNs
+COND_NUMBER = re.compile(r'[+-]?(\d+\.?\d*|\.\d+)([eE][+-]?\d+)?')
+
+
+class QuestError(Exception):
+    pass
+
+
+def f32(value):
+    """Rounds to the nearest float, as the badge's float arithmetic does."""
+    return struct.unpack('<f', struct.pack('<f', value))[0]
+
+
+class ConditionError(Exception):
+    def __init__(self, what, pos):
+        Exception.__init__(self, what)
+        self.pos = pos
+
+
+class ConditionCompiler:
+    """Port of quest_parser.c: the same grammar, bytecode and limits.
+    quest_cond_tool check compares the two on every quest in the map."""
+
+    def __init__(self, source):
+        self.source = source
+        self.pos = 0
+        self.code = bytearray()
+        self.timers = 0
+        self.depth = 0
+        self.max_depth = 0
+        self.nesting = 0
+        self.events = 0
+
+    def fail(self, what):
+        raise ConditionError(what, self.pos)
+
+    def name_char(self, pos):
+        return pos < len(self.source) and (self.source[pos] == '_' or
+                                           self.source[pos].isascii() and self.source[pos].isalnum())
+
+    def skip_space(self):
+        while self.pos < len(self.source) and self.source[self.pos] in ' \t\n\v\f\r':
+            self.pos += 1
+
+    def accept(self, tok):
+        self.skip_space()
+        if not self.source.startswith(tok, self.pos):
+            return False
+        # Keywords must not run into a longer name
+        if tok[0].isalpha() and self.name_char(self.pos + len(tok)):
+            return False
+        self.pos += len(tok)
+        return True
+
+    def expect(self, tok):
+        if not self.accept(tok):
+            self.fail('expected %r' % tok)
+
+    def read_name(self):
+        self.skip_space()
+        end = self.pos
+        while self.name_char(end):
+            end += 1
+        name = self.source[self.pos:end]
+        if not name or len(name) >= COND_MAX_NAME or name[0].isdigit():
+            self.fail('expected a name')
+        return name
+
+    def read_number(self):
+        self.skip_space()
+        match = COND_NUMBER.match(self.source, self.pos)
+        value = f32(float(match.group(0))) if match else math.nan
+        if not math.isfinite(value):
+            self.fail('expected a number')
+        self.pos = match.end()
+        return value
+
+    def read_duration(self):
+        self.skip_space()
+        start = self.pos
+        value = self.read_number()
+        scale = 1.0 if self.accept('ms') else 1000.0 if self.accept('s') else 60000.0 if self.accept('min') else 0
+        if not scale:
+            self.fail('expected ms, s or min')
+        ms = f32(value * scale)
+        if value < 0.0 or ms > 2147483648.0:
+            self.pos = start
+            self.fail('duration out of range')
+        return int(f32(ms + 0.5))
+
+    def emit(self, op, operands, pops, pushes):
+        if len(self.code) + 1 + len(operands) > COND_MAX_CODE:
+            self.fail('over %d bytes of bytecode' % COND_MAX_CODE)
+        self.code.append(op)
+        self.code += bytes(operands)
+        self.depth += pushes - pops
+        if self.depth > COND_MAX_DEPTH:
+            self.fail('stack deeper than %d' % COND_MAX_DEPTH)
+        self.max_depth = max(self.max_depth, self.depth)
+
+    def emit_timer(self, op, ms, pops):
+        if self.timers >= COND_MAX_TIMERS:
+            self.fail('over %d "for" and "then" operators' % COND_MAX_TIMERS)
+        self.timers += 1
+        self.emit(op, bytes([self.timers - 1]) + struct.pack('<I', ms), pops, 1)
+
+    def nest(self):
+        self.nesting += 1
+        if self.nesting > COND_MAX_DEPTH:
+            self.fail('nested deeper than %d' % COND_MAX_DEPTH)
+
+    def parse_comparison(self, field, absolute):
+        for tok, cmp in COND_CMPS:
+            if self.accept(tok):
+                break
+        else:
+            self.fail('expected a comparison')
+        value = self.read_number()
+        operand = field | cmp << 4 | (0x80 if absolute else 0)
+        self.emit(OP_CMP, bytes([operand]) + struct.pack('<f', value), 0, 1)
+        self.events |= EVENTS[COND_FIELDS[field][1]]
+
+    def parse_primary(self):
+        if self.accept('('):
+            self.nest()
+            self.parse_seq()
+            self.expect(')')
+            self.nesting -= 1
+            return
+
+        name = self.read_name()
+        start = self.pos
+        self.pos += len(name)
+        if name in ('true', 'false'):
+            self.emit(OP_TRUE if name == 'true' else OP_FALSE, b'', 0, 1)
+        elif name == 'abs':
+            self.expect('(')
+            name = self.read_name()
+            if name not in COND_FIELD_NAMES:
+                self.fail('expected a sensor field')
+            self.pos += len(name)
+            self.expect(')')
+            self.parse_comparison(COND_FIELD_NAMES.index(name), True)
+        elif name in COND_FIELD_NAMES:
+            self.parse_comparison(COND_FIELD_NAMES.index(name), False)
+        elif name in COND_TRIGGERS:
+            event = EVENTS[COND_TRIGGERS[name]]
+            self.emit(OP_LEVEL, bytes([event]), 0, 1)
+            self.events |= event
+        else:
+            self.pos = start
+            self.fail('unknown name %r' % name)
+
+    def parse_postfix(self):
+        self.parse_primary()
+        while self.accept('for'):
+            self.emit_timer(OP_FOR, self.read_duration(), 1)
+
+    def parse_not(self):
+        if self.accept('!') or self.accept('not'):
+            self.nest()
+            self.parse_not()
+            self.nesting -= 1
+            self.emit(OP_NOT, b'', 1, 1)
+            return
+        self.parse_postfix()
+
+    def parse_and(self):
+        self.parse_not()
+        while self.accept('&&') or self.accept('and'):
+            self.parse_not()
+            self.emit(OP_AND, b'', 2, 1)
+
+    def parse_or(self):
+        self.parse_and()
+        while self.accept('||') or self.accept('or'):
+            self.parse_and()
+            self.emit(OP_OR, b'', 2, 1)
+
+    def parse_seq(self):
+        self.parse_or()
+        while self.accept('then'):
+            self.parse_or()
+            self.emit_timer(OP_THEN, self.read_duration() if self.accept('within') else 0, 2)
+
+    def compile(self):
+        self.parse_seq()
+        self.skip_space()
+        if self.pos != len(self.source):
+            self.fail('unexpected text')
+        return {'code': bytes(self.code), 'timers': self.timers, 'depth': self.max_depth, 'events': self.events}
+
+
+def compile_condition(source, where):
+    try:
+        return ConditionCompiler(source).compile()
+    except ConditionError as e:
+        raise QuestError('%s: condition: %s at %d: %s' % (where, e, e.pos, source[e.pos:] or '(end)'))
+
+
+def c_string(text):
+    out = '"'
+    for byte in text.encode('utf-8'):
+        char = chr(byte)
+        if char in '"\\':
+            out += '\\' + char
+        elif 0x20 <= byte < 0x7F:
+            out += char
+        else:
+            # Octal, so a following digit cannot extend the escape
+            out += '\\%03o' % byte
+    return out + '"'
+
+
+class StringPool:
+    """Interns strings into one NUL-separated pool; equal strings share storage."""
+
+    def __init__(self):
+        self.offsets = {}
+        self.strings = []
+        self.size = 0
+
+    def add(self, text):
+        if text not in self.offsets:
+            self.offsets[text] = self.size
+            self.strings.append(text)
+            self.size += len(text.encode('utf-8')) + 1
+        return self.offsets[text]
+
+
+def parse_quests(doc):
+    quests = []
+    seen = set()
+    for entry in doc.get('quests', []):
+        quest_id = entry.get('id')
+        name = entry.get('name', '')
+        where = 'quest %s (%s)' % (quest_id, name or '?')
+        if not isinstance(quest_id, int) or not 1 <= quest_id <= MAX_QUESTS:
+            raise QuestError('%s: id must be 1..%d' % (where, MAX_QUESTS))
+        if quest_id in seen:
+            raise QuestError('%s: duplicate id' % where)
+        seen.add(quest_id)
+        if not name or len(name.encode('utf-8')) >= MAX_QUEST_NAME_LEN:
+            raise QuestError('%s: name must be 1..%d bytes' % (where, MAX_QUEST_NAME_LEN - 1))
+        if len(entry.get('description', '').encode('utf-8')) >= MAX_QUEST_DESC_LEN:
+            raise QuestError('%s: description over %d bytes' % (where, MAX_QUEST_DESC_LEN - 1))
+
+        flags = 0
+        required = 0
+        condition = None
+        if entry.get('type') == 'combo':
+            ids = entry.get('required', [])
+            if not ids or any(not isinstance(i, int) or not 1 <= i <= MAX_QUESTS for i in ids):
+                raise QuestError('%s: combo needs required ids 1..%d' % (where, MAX_QUESTS))
+            for i in ids:
+                required |= 1 << (i - 1)
+            flags |= QUEST_FLAG_COMBO
+            trigger = 'TRIGGER_NONE'
+            threshold = 0.0
+            target = len(set(ids))
+        elif 'condition' in entry:
+            # Compiled here; the badge only evaluates it (quest_conditions.h)
+            condition = entry['condition']
+            if not isinstance(condition, str) or not condition.strip():
+                raise QuestError('%s: condition must be an expression' % where)
+            condition = {'source': condition, 'program': compile_condition(condition, where)}
+            trigger = 'TRIGGER_NONE'
+            threshold = 0.0
+            target = entry.get('target', 1)
+        else:
+            if entry.get('trigger') not in TRIGGERS:
+                raise QuestError('%s: unknown trigger %r' % (where, entry.get('trigger')))
+            trigger, limits = TRIGGERS[entry['trigger']]
+            threshold = 0.0
+            if limits is None:
+                if 'threshold' in entry:
+                    raise QuestError('%s: trigger %s takes no threshold' % (where, entry['trigger']))
+            else:
+                value = entry.get('threshold')
+                if isinstance(value, bool) or not isinstance(value, (int, float)):
+                    raise QuestError('%s: trigger %s needs a numeric threshold' % (where, entry['trigger']))
+                threshold = float(value)
+                low, high = limits
+                if not math.isfinite(threshold) or not low <= threshold <= high:
+                    raise QuestError('%s: threshold %s outside %s..%s' % (where, threshold, low, high))
+                flags |= QUEST_FLAG_THRESHOLD
+            target = entry.get('target', 1)
+
+        points = entry.get('points', 100)
+        if not isinstance(points, int) or not 0 <= points <= MAX_POINTS:
+            raise QuestError('%s: points must be 0..%d' % (where, MAX_POINTS))
+        if not isinstance(target, int) or not 1 <= target <= MAX_TARGET:
+            raise QuestError('%s: target must be 1..%d' % (where, MAX_TARGET))
+
+        quests.append({
+            'id': quest_id,
+            'name': name,
+            'description': entry.get('description', ''),
+            'hint': entry.get('hint', ''),
+            'trigger': trigger,
+            'threshold': threshold,
+            'target': target,
+            'points': points,
+            'required': required,
+            'flags': flags,
+            'condition': condition,
+        })
+
+    for quest in quests:
+        missing = [i + 1 for i in range(MAX_QUESTS) if quest['required'] >> i & 1 and i + 1 not in seen]
+        if missing:
+            raise QuestError('quest %d: requires unknown quests %s' % (quest['id'], missing))
+    check_thresholds(quests)
+    if not quests:
+        raise QuestError('no quests')
+    return sorted(quests, key=lambda q: q['id'])
+
+
+def check_thresholds(quests):
+    """Quests on one trigger share its threshold, and the cigarette band ends where herbal starts."""
+    thresholds = {}
+    for quest in quests:
+        if not quest['flags'] & QUEST_FLAG_THRESHOLD:
+            continue
+        other = thresholds.setdefault(quest['trigger'], quest)
+        if other['threshold'] != quest['threshold']:
+            raise QuestError('quest %d: threshold %s differs from quest %d\'s %s for %s'
+                             % (quest['id'], quest['threshold'], other['id'], other['threshold'],
+                                quest['trigger']))
+    cigarette = thresholds.get('TRIGGER_SMOKE')
+    herbal = thresholds.get('TRIGGER_HERBAL')
+    if cigarette and herbal and cigarette['threshold'] >= herbal['threshold']:
+        raise QuestError('quest %d: cigarette threshold %s not below herbal threshold %s (quest %d)'
+                         % (cigarette['id'], cigarette['threshold'], herbal['threshold'], herbal['id']))
+
+
+def generate(quests, source):
+    pool = StringPool()
+    for quest in quests:
+        for field in ('name', 'description', 'hint'):
+            quest[field + '_offset'] = pool.add(quest[field])
+        if quest['condition'] is not None:
+            quest['condition_offset'] = pool.add(quest['condition']['source'])
+
+    lines = [
+        '// Generated by tools/quest_table_gen.py from %s; do not edit.' % source,
+        '',
+        '#include "quest_table.h"',
+        '',
+        '_Static_assert(MAX_QUESTS >= %d && MAX_QUEST_NAME_LEN == %d && MAX_QUEST_DESC_LEN == %d,'
+        % (MAX_QUESTS, MAX_QUEST_NAME_LEN, MAX_QUEST_DESC_LEN),
+        '               "tools/quest_table_gen.py limits are out of date");',
+        '',
+        '_Static_assert(QUEST_COND_MAX_CODE == %d && QUEST_COND_MAX_TIMERS == %d && QUEST_COND_MAX_DEPTH == %d &&'
+        % (COND_MAX_CODE, COND_MAX_TIMERS, COND_MAX_DEPTH),
+        '               QUEST_OP_THEN == %d && QUEST_FIELD_COUNT == %d && SENSOR_EVENT_TILT == 0x%02X,'
+        % (OP_THEN, len(COND_FIELDS), EVENTS['SENSOR_EVENT_TILT']),
+        '               "tools/quest_table_gen.py bytecode is out of date");',
+        '',
+        '// %d strings, %d bytes' % (len(pool.strings), pool.size),
+        'static const char quest_strings[] =',
+    ]
+    for text in pool.strings:
+        lines.append('    %s "\\0"' % c_string(text))
+    lines[-1] += ';'
+
+    conditions = [quest for quest in quests if quest['condition'] is not None]
+    if conditions:
+        lines += ['', '// Condition bytecode, in table order',
+                  'static const quest_cond_program_t quest_conditions[] = {']
+        for number, quest in enumerate(conditions):
+            program = quest['condition']['program']
+            quest['condition_number'] = number
+            code = ['0x%02X' % byte for byte in program['code']]
+            lines.append('    {  // %s' % ' '.join(quest['condition']['source'].split()))
+            lines.append('        .code = {')
+            for start in range(0, len(code), 12):
+                lines.append('            %s,' % ', '.join(code[start:start + 12]))
+            lines += [
+                '        },',
+                '        .length = %d,' % len(program['code']),
+                '        .timers = %d,' % program['timers'],
+                '        .depth = %d,' % program['depth'],
+                '        .events = 0x%02X,' % program['events'],
+                '    },',
+            ]
+        lines.append('};')
+
+    lines += ['', 'const quest_def_t quest_table[] = {']
+    for quest in quests:
+        lines += [
+            '    {',
+            '        .name = quest_strings + %d,' % quest['name_offset'],
+            '        .description = quest_strings + %d,' % quest['description_offset'],
+            '        .hint = quest_strings + %d,' % quest['hint_offset'],
+            '        .condition_source = %s,' % ('quest_strings + %d' % quest['condition_offset']
+                                                 if quest['condition'] is not None else 'NULL'),
+            '        .condition = %s,' % ('&quest_conditions[%d]' % quest['condition_number']
+                                          if quest['condition'] is not None else 'NULL'),
+            '        .threshold = %sf,' % repr(quest['threshold']),
+            '        .required = 0x%08X,' % quest['required'],
+            '        .points = %d,' % quest['points'],
+            '        .target_value = %d,' % quest['target'],
+            '        .quest_id = %d,' % quest['id'],
+            '        .trigger_type = %s,' % quest['trigger'],
+            '        .flags = 0x%02X,' % quest['flags'],
+            '    },',
+        ]
+    lines += ['};', '', 'const uint8_t quest_table_count = %d;' % len(quests), '']
+
+    index = ['QUEST_TABLE_NONE'] * (quests[-1]['id'] + 1)
+    for position, quest in enumerate(quests):
+        index[quest['id']] = str(position)
+    lines += [
+        '// quest_id -> quest_table position',
+        'static const uint8_t quest_index[%d] = {' % len(index),
+        '    %s' % ', '.join(index),
+        '};',
+        '',
+        'const quest_def_t* quest_table_find(uint8_t quest_id)',
+        '{',
+        '    if (quest_id >= sizeof(quest_index) || quest_index[quest_id] == QUEST_TABLE_NONE) {',
+        '        return NULL;',
+        '    }',
+        '    return &quest_table[quest_index[quest_id]];',
+        '}',
+        '',
+    ]
+    return '\n'.join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compile quest_map.json into a const C quest table')
+    parser.add_argument('quest_map', help='quests/quest_map.json')
+    parser.add_argument('-o', '--output', help='C file to write (default: only check the JSON)')
+    args = parser.parse_args()
+
+    try:
+        with open(args.quest_map, encoding='utf-8') as f:
+            quests = parse_quests(json.load(f))
+    except (OSError, ValueError, QuestError) as e:
+        print('%s: %s' % (args.quest_map, e), file=sys.stderr)
+        return 1
+
+    if args.output:
+        code = generate(quests, 'quests/quest_map.json')
+        # Leave an unchanged file alone so the build does not recompile it
+        try:
+            with open(args.output, encoding='utf-8') as f:
+                if f.read() == code:
+                    return 0
+        except OSError:
+            pass
+        with open(args.output, 'w', encoding='utf-8') as f:
+            f.write(code)
+    else:
+        print('%d quests OK' % len(quests))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())